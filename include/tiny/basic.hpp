@@ -12,6 +12,7 @@
 #include <iterator>
 #include <bitset>
 
+#include <stddef.h>
 #include <stdint.h>
 
 namespace tiny
@@ -27,6 +28,9 @@ typedef uint8_t reg_type;
 #elif defined(TINY_ARDUINO_DUE)
 //# include <chip.h>
 typedef uint32_t reg_type;
+#else
+// host, AVR alike registers
+typedef uint8_t reg_type;
 #endif // TINY_ARDUINO_MEGA
 
 /** Control and status register type. */
@@ -41,14 +45,143 @@ enum { register_width = sizeof(register_type) * 8 };
 /** The type representing register bits. */
 typedef std::bitset<register_width> register_bits_type;
 
+/** A register bit field, the position and the width are known at compile
+ *  time, so the masks and the shifts fold into immediate operands and no
+ *  shift count is computed in an interrupt.
+ *
+ *  @tparam RegT The register value type, uint8_t on AVR, uint32_t on SAM.
+ *  @tparam Offset The position of the lsb of the field.
+ *  @tparam Width The number of bits.
+ */
+template <typename RegT, unsigned int Offset, unsigned int Width = 1>
+struct field
+{
+  typedef RegT value_type;
+
+  static_assert(Width != 0 && Offset + Width <= sizeof(RegT) * 8, "Field outside the register");
+
+  enum { offset = Offset, width = Width };
+
+  /** Returns the bits of the field in place. */
+  static constexpr value_type mask(void)
+  {
+    return static_cast<value_type>((~0ull >> (64 - Width)) << Offset);
+  }
+
+  /** Returns the value put in place, the extra bits are cut off. */
+  static constexpr value_type value(unsigned long long v)
+  {
+    return static_cast<value_type>((v << Offset) & mask());
+  }
+
+  /** Returns the field value of the register value. */
+  static constexpr value_type get(value_type r)
+  {
+    return static_cast<value_type>((r & mask()) >> Offset);
+  }
+
+  /** Returns the register value with the field replaced. */
+  static constexpr value_type replace(value_type r, unsigned long long v)
+  {
+    return static_cast<value_type>((r & static_cast<value_type>(~mask())) | value(v));
+  }
+
+  /** Whether any bit of the field is set in the register value. */
+  static constexpr bool is_set(value_type r) { return (r & mask()) != 0; }
+
+  /** Reads the field of the register. */
+  static value_type read(const volatile value_type* r) { return get(*r); }
+
+  /** Writes the field of the register, read-modify-write. */
+  static void write(volatile value_type* r, unsigned long long v) { *r = replace(*r, v); }
+
+  /** Sets all the bits of the field. */
+  static void set(volatile value_type* r) { *r |= mask(); }
+
+  /** Clears all the bits of the field. */
+  static void clear(volatile value_type* r) { *r &= static_cast<value_type>(~mask()); }
+
+  /** Sets or clears the field, branch free. */
+  static void assign(volatile value_type* r, bool state) { write(r, state? ~0ull: 0); }
+};
+
+/** A field the peripheral lacks, nothing is set and nothing reads set. */
+template <typename RegT, unsigned int Offset>
+struct field<RegT, Offset, 0>
+{
+  typedef RegT value_type;
+
+  enum { offset = Offset, width = 0 };
+
+  static constexpr value_type mask(void) { return 0; }
+  static constexpr value_type value(unsigned long long) { return 0; }
+  static constexpr value_type get(value_type) { return 0; }
+  static constexpr value_type replace(value_type r, unsigned long long) { return r; }
+  static constexpr bool is_set(value_type) { return false; }
+  static value_type read(const volatile value_type*) { return 0; }
+  static void write(volatile value_type*, unsigned long long) { }
+  static void set(volatile value_type*) { }
+  static void clear(volatile value_type*) { }
+  static void assign(volatile value_type*, bool) { }
+};
+
+namespace detail
+{
+
+/** Returns the position of the lowest bit set, zero for no bits. */
+constexpr unsigned int lowest_bit(unsigned long long m, unsigned int pos = 0)
+{
+  return m == 0 || (m & 1) != 0? pos: lowest_bit(m >> 1, pos + 1);
+}
+
+/** Returns the number of the bits set. */
+constexpr unsigned int bits_count(unsigned long long m)
+{
+  return m == 0? 0: static_cast<unsigned int>(m & 1) + bits_count(m >> 1);
+}
+
+} // namespace detail
+
+/** The field of a contiguous mask, e.g. of a CMSIS _Msk constant. Zero
+ *  mask gives the empty field.
+ */
+template <typename RegT, unsigned long long Mask>
+struct mask_field: field<RegT, detail::lowest_bit(Mask), detail::bits_count(Mask)>
+{
+  static_assert(mask_field::mask() == Mask, "Mask isn't contiguous");
+};
+
+/** Returns the union of the field masks, e.g. to enable several bits by
+ *  a single write.
+ */
+template <typename FieldT>
+constexpr typename FieldT::value_type fields_mask(void)
+{
+  return FieldT::mask();
+}
+
+template <typename FieldT, typename NextT, typename... RestT>
+constexpr typename FieldT::value_type fields_mask(void)
+{
+  return static_cast<typename FieldT::value_type>(FieldT::mask() | fields_mask<NextT, RestT...>());
+}
+
 /** Returns the mask for the given bit no. */
 template <typename ResultT>
-inline ResultT mask(size_t pos) { return static_cast<ResultT>(1 << pos); }
+constexpr ResultT mask(size_t pos) { return static_cast<ResultT>(1ull << pos); }
 
 /** Returns the mask for the given bit no. */
-inline register_type mask(size_t pos) { return mask<register_type>(pos); }
+constexpr reg_type mask(size_t pos) { return mask<reg_type>(pos); }
 
-#ifdef TINY_ARDUINO_MEGA
+/** Returns the bits of the mask shifted down to the lsb, no loop, the
+ *  division by the lowest bit of the mask is the shift.
+ */
+constexpr size_t bits_value(reg_type r, reg_type mask)
+{
+  return mask == 0? 0: static_cast<size_t>((r & mask) / (mask & (~mask + 1u)));
+}
+
+#if defined(TINY_ARDUINO_MEGA) || defined(TINY_HOST)
 
 /** Reads the register bit.
  *
@@ -58,18 +191,18 @@ inline register_type mask(size_t pos) { return mask<register_type>(pos); }
  */
 inline size_t bit(register_ptr r, size_t pos)
 {
-  return *r & (1 << pos);
+  return *r & mask(pos);
 }
 
 /** Reads the register bit.
  *
- *  @param r Register address.
+ *  @param r Register value.
  *  @param pos Position of the bit where 0 is lsb.
  *  @return r & (1 << bit_pos)
  */
-inline size_t bit(register_type r, size_t pos)
+constexpr size_t bit(reg_type r, size_t pos)
 {
-  return r & (1 << pos);
+  return r & mask(pos);
 }
 
 /** Tests whether bit is set or clear.
@@ -78,8 +211,13 @@ inline size_t bit(register_type r, size_t pos)
  *  @param pos Position of the bit where 0 is lsb.
  *  @return True if set, false if clear.
  */
-template <typename T>
-inline bool is_bit(T r, size_t pos)
+inline bool is_bit(register_ptr r, size_t pos)
+{
+  return bit(r, pos) != 0;
+}
+
+/** Tests whether bit is set or clear. */
+constexpr bool is_bit(reg_type r, size_t pos)
 {
   return bit(r, pos) != 0;
 }
@@ -99,13 +237,13 @@ inline void set_bit(register_type& r, size_t pos)
 /** Clears the register bit. */
 inline void clear_bit(register_ptr r, size_t pos)
 {
-  *r &= ~mask(pos);
+  *r &= static_cast<reg_type>(~mask(pos));
 }
 
 /** Clears the register bit. */
 inline void clear_bit(register_type& r, size_t pos)
 {
-  r &= ~mask(pos);
+  r &= static_cast<reg_type>(~mask(pos));
 }
 
 /** Sets the register bit. */
@@ -116,25 +254,21 @@ inline void set_bit(T& r, size_t pos, bool value)
 }
 
 /** Returns the value of bits specified. */
-inline size_t bits_value(register_ptr r, const register_bits_type& mask)
+inline size_t bits_value(register_ptr r, reg_type mask)
 {
-  register_type msk = static_cast<register_type>(mask.to_ulong());
-  size_t v          = *r & msk;
-
-  for (; msk && (msk & 1) == 0; msk >>= 1) { v >>= 1; }
-
-  return v;
+  return bits_value(static_cast<reg_type>(*r), mask);
 }
 
 /** Returns the value of bits specified. */
-inline size_t bits_value(register_type r, const register_bits_type& mask)
+inline size_t bits_value(register_ptr r, const register_bits_type& mask)
 {
-  register_type msk = static_cast<register_type>(mask.to_ulong());
-  size_t v          = r & msk;
-
-  for (; msk && (msk & 1) == 0; msk >>= 1) { v >>= 1; }
+  return bits_value(static_cast<reg_type>(*r), static_cast<reg_type>(mask.to_ulong()));
+}
 
-  return v;
+/** Returns the value of bits specified. */
+inline size_t bits_value(reg_type r, const register_bits_type& mask)
+{
+  return bits_value(r, static_cast<reg_type>(mask.to_ulong()));
 }
 
 #elif defined(TINY_ARDUINO_DUE)
@@ -145,7 +279,7 @@ inline size_t bits_value(register_type r, const register_bits_type& mask)
  *  @param pos Position of the bit where 0 is lsb.
  *  @return r & (1 << bit_pos)
  */
-inline size_t bit(register_type r, register_type mask)
+constexpr size_t bit(reg_type r, reg_type mask)
 {
   return r & mask;
 }
@@ -156,8 +290,7 @@ inline size_t bit(register_type r, register_type mask)
  *  @param pos Position of the bit where 0 is lsb.
  *  @return True if set, false if clear.
  */
-template <typename T>
-inline bool is_bit(T r, register_type mask)
+constexpr bool is_bit(reg_type r, reg_type mask)
 {
   return bit(r, mask) != 0;
 }
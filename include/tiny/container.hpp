@@ -389,6 +389,14 @@ bool operator==(const bitset<Sz>& lhs, const bitset<Sz>& rhs)
 namespace detail
 {
 
+/** Prevents the compiler from moving memory accesses across. */
+inline void compiler_barrier(void)
+{
+#if defined(__GNUC__)
+  __asm__ __volatile__("" ::: "memory");
+#endif // __GNUC__
+}
+
 // efficient variants
 template <size_t Capacity, typename IndexT>
 inline size_t inc_index(volatile IndexT &i)
@@ -408,19 +416,51 @@ template <> inline size_t inc_index<0x100, size_t>(volatile size_t &i) { return
 template <> inline size_t inc_index<0x200, size_t>(volatile size_t &i) { return ++i &= 0x1ff; }
 template <> inline size_t inc_index<0x400, size_t>(volatile size_t &i) { return ++i &= 0x3ff; }
 
+template <> inline size_t inc_index<0x10, uint8_t>(volatile uint8_t &i) { return ++i &= 0x0f; }
+template <> inline size_t inc_index<0x20, uint8_t>(volatile uint8_t &i) { return ++i &= 0x1f; }
+template <> inline size_t inc_index<0x40, uint8_t>(volatile uint8_t &i) { return ++i &= 0x3f; }
+template <> inline size_t inc_index<0x80, uint8_t>(volatile uint8_t &i) { return ++i &= 0x7f; }
+template <> inline size_t inc_index<0x100, uint8_t>(volatile uint8_t &i) { return ++i; }
+
+/** Default index type of the queue, a byte on AVR where wider stores are
+ *  split into byte writes an interrupt can come between.
+ */
+template <size_t Capacity, bool Byte = (Capacity <= 0x100)>
+struct queue_index
+{
+  typedef size_t type;
+};
+
+#if defined(__AVR__)
+template <size_t Capacity>
+struct queue_index<Capacity, true>
+{
+  typedef uint8_t type;
+};
+#endif // __AVR__
+
 } // namespace detail
 
 /** Ring buffer queue.
  *
  *  @tparam T The type of the object to store in queue.
  *  @tparam Capacity Capacity of the queue.
- *  @tparam IndexT The type of item pointers.
+ *  @tparam IndexT The type of item pointers, a byte on AVR if the Capacity
+ *    allows.
  *
  *  @note Use power of two of the Capacity value to have optimized queue indexing.
  *  @note Actual size of queue is Capacity - 1 due to last element is
  *    used to distinct empty and non-empty queue.
+ *  @note Unless push_if_overflow is set the queue is safe for a single
+ *    producer and a single consumer running in different contexts, e.g.
+ *    an interrupt handler and the main loop, even if one preempts the other
+ *    at any point: the head is written by push only, the tail by pop only,
+ *    both are published after the element is accessed. The publishing is
+ *    a single store only if IndexT is stored at once, a byte on AVR: the
+ *    wider indices of the larger queues are two byte writes there, so
+ *    either side must then mask the other one, as uart_core does.
  */
-template <typename T, size_t Capacity, typename IndexT = size_t>
+template <typename T, size_t Capacity, typename IndexT = typename detail::queue_index<Capacity>::type>
 class queue
 {
 public:
@@ -495,9 +535,21 @@ public:
   {
     if (!empty())
     {
-    	const T el = _array[_tail];
-      inc_index(_tail);
+#ifdef __ICCAVR__
+  #pragma diag_suppress = Pe340 // reference to temporary is used
+#endif // __ICCAVR__
+
+      detail::compiler_barrier();
+      IndexT tmp_tail = _tail;
+      const T el      = _array[tmp_tail];
+      inc_index(tmp_tail);
+      detail::compiler_barrier();
+      _tail = tmp_tail;
       return el;
+
+#ifdef __ICCAVR__
+  #pragma diag_default = Pe340
+#endif // __ICCAVR__
     }
 
     return T();
@@ -509,6 +561,18 @@ public:
     _tail = _head = 0;
   }
 
+  /** Returns the slot the next element is pushed to, the producer side. */
+  size_t head_index(void) const
+  {
+    return _head;
+  }
+
+  /** Returns the slot of the element at the tail, the consumer side. */
+  size_t tail_index(void) const
+  {
+    return _tail;
+  }
+
   /** Whether queue is empty. */
   bool empty(void) const
   {
@@ -550,6 +614,51 @@ public:
     return _head < _tail? Capacity - (_tail - _head): _head - _tail;
   }
 
+  /** Returns the contiguous elements at the tail, the consumer side.
+   *
+   *  @param data Receives the pointer to the first element.
+   *  @return The number of the elements, the rest if any follows the wrap.
+   */
+  size_t readable(const_pointer& data) const
+  {
+    const IndexT head = _head;
+    const IndexT tail = _tail;
+    data              = &_array[tail];
+    return head >= tail? head - tail: Capacity - tail;
+  }
+
+  /** Removes n elements returned by readable. */
+  void consume(size_t n)
+  {
+    size_t tail = _tail + n;
+    if (tail >= Capacity) { tail -= Capacity; }
+    detail::compiler_barrier();
+    _tail = static_cast<IndexT>(tail);
+  }
+
+  /** Returns the contiguous room at the head, the producer side.
+   *
+   *  @param data Receives the pointer to the first free element.
+   *  @return The number of the elements may be written, see commit.
+   */
+  size_t writable(pointer& data)
+  {
+    const IndexT head = _head;
+    const IndexT tail = _tail;
+    data              = &_array[head];
+    if (tail > head) { return tail - head - 1; }
+    return tail == 0? Capacity - head - 1: Capacity - head;
+  }
+
+  /** Pushes n elements written into the room returned by writable. */
+  void commit(size_t n)
+  {
+    size_t head = _head + n;
+    if (head >= Capacity) { head -= Capacity; }
+    detail::compiler_barrier();
+    _head = static_cast<IndexT>(head);
+  }
+
 //////////////////////////////////////////////////////////////////////////
 // private stuff
 
@@ -569,6 +678,9 @@ private:
     IndexT tmp_head = _head;
     inc_index(tmp_head);
 
+    // publish the element pushed before the head
+    detail::compiler_barrier();
+
     if (_push_if_overflow)
     {
       // cyclic queue
@@ -583,7 +695,7 @@ private:
       // non cyclic queue
       if (tmp_head != _tail)
       {
-        inc_index(_head);
+        _head = tmp_head;
       }
     }
 
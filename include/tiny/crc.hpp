@@ -0,0 +1,266 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_CRC_HPP_
+#define TINY_CRC_HPP_
+
+#include <tiny/detail/auto_sense.hpp>
+#include <tiny/detail/index_sequence.hpp>
+
+#if defined (TINY_ARDUINO_MEGA)
+# include <avr/pgmspace.h>
+#endif // TINY_ARDUINO_MEGA
+
+#include <cstddef>
+#include <stdint.h>
+
+/** The number of the lookup tables, 4 enables slicing-by-4 of the
+ *  reflected CRCs. Four CRC-32 tables take 4K, so it's Due only by default.
+ */
+#ifndef TINY_CRC_SLICES
+# if defined (TINY_ARDUINO_DUE)
+#  define TINY_CRC_SLICES 4
+# else
+#  define TINY_CRC_SLICES 1
+# endif // TINY_ARDUINO_DUE
+#endif // TINY_CRC_SLICES
+
+#if defined (TINY_ARDUINO_MEGA)
+# define TINY_CRC_TABLE_SECTION PROGMEM
+#else
+# define TINY_CRC_TABLE_SECTION
+#endif // TINY_ARDUINO_MEGA
+
+/** Library root namespace. */
+namespace tiny
+{
+
+namespace detail
+{
+
+/** CRC arithmetic, all of it is constexpr to build the tables at compile time. */
+template <typename T, T Poly, bool Reflect>
+struct crc_math
+{
+  enum { width = sizeof(T) * 8 };
+
+  /** Reverses the bit order. */
+  static constexpr T reflect(T value, unsigned bits = width, T result = 0)
+  {
+    return bits == 0? result:
+      reflect(static_cast<T>(value >> 1), bits - 1, static_cast<T>((result << 1) | (value & 1)));
+  }
+
+  /** Shifts the register by the given number of bits. */
+  static constexpr T shift(T value, unsigned bits)
+  {
+    return bits == 0? value:
+      Reflect?
+        shift(static_cast<T>((value & 1) != 0? (value >> 1) ^ reflect(Poly): value >> 1), bits - 1):
+        shift(static_cast<T>((value & (T(1) << (width - 1))) != 0? (value << 1) ^ Poly: value << 1), bits - 1);
+  }
+
+  /** Returns the register after the octet starting from zero. */
+  static constexpr T octet(size_t index)
+  {
+    return Reflect?
+      shift(static_cast<T>(index), 8):
+      shift(static_cast<T>(static_cast<T>(index) << (width - 8)), 8);
+  }
+
+  /** Returns the table entry, the slice k adds k zero octets after the index. */
+  static constexpr T entry(size_t index, size_t slice)
+  {
+    return slice == 0? octet(index):
+      static_cast<T>((entry(index, slice - 1) >> 8) ^ octet(entry(index, slice - 1) & 0xff));
+  }
+
+  /** Returns the register after the data, bit by bit. */
+  static constexpr T bitwise(T value, const char* data, size_t size)
+  {
+    return size == 0? value:
+      Reflect?
+        bitwise(shift(static_cast<T>(value ^ static_cast<uint8_t>(*data)), 8), data + 1, size - 1):
+        bitwise(shift(static_cast<T>(value ^ (static_cast<T>(static_cast<uint8_t>(*data)) << (width - 8))), 8),
+                data + 1, size - 1);
+  }
+};
+
+/** Lookup tables, slice after slice. */
+template <typename T, T Poly, bool Reflect, size_t Slices,
+          typename Indices = typename make_index_sequence<Slices * 256>::type>
+struct crc_table;
+
+template <typename T, T Poly, bool Reflect, size_t Slices, size_t... I>
+struct crc_table<T, Poly, Reflect, Slices, index_sequence<I...> >
+{
+  static const T values[sizeof...(I)];
+};
+
+template <typename T, T Poly, bool Reflect, size_t Slices, size_t... I>
+const T crc_table<T, Poly, Reflect, Slices, index_sequence<I...> >::values[sizeof...(I)] TINY_CRC_TABLE_SECTION =
+{
+  crc_math<T, Poly, Reflect>::entry(I % 256, I / 256)...
+};
+
+#if defined (TINY_ARDUINO_MEGA)
+inline uint8_t crc_load(const uint8_t* p) { return pgm_read_byte(p); }
+inline uint16_t crc_load(const uint16_t* p) { return pgm_read_word(p); }
+inline uint32_t crc_load(const uint32_t* p) { return pgm_read_dword(p); }
+#else
+template <typename T>
+inline T crc_load(const T* p) { return *p; }
+#endif // TINY_ARDUINO_MEGA
+
+} // namespace detail
+
+/** Table driven CRC, the parameters are as in the CRC catalogue.
+ *
+ *  @tparam T Register type, uint8_t, uint16_t or uint32_t.
+ *  @tparam Poly Polynomial, normal form.
+ *  @tparam Init Initial value.
+ *  @tparam Reflect Whether the input and the output are reflected.
+ *  @tparam XorOut Final xor value.
+ *  @tparam Slices 4 for slicing-by-4, reflected CRCs only, the others use
+ *    the single table whatever it is.
+ *
+ *  The tables are built at compile time, they are in flash on both boards.
+ *  The update by octet is short enough for the rx interrupt, the update by
+ *  block is for the contiguous ring spans, see readable.
+ */
+template <typename T, T Poly, T Init, bool Reflect, T XorOut, size_t Slices = TINY_CRC_SLICES>
+class crc
+{
+public:
+  /** Register type. */
+  typedef T value_type;
+
+  enum
+  {
+    width  = sizeof(T) * 8,           /**< CRC width in bits. */
+    slices = Reflect? Slices: 1       /**< The number of the tables used. */
+  };
+
+  static_assert(width == 8 || width == 16 || width == 32, "CRC of 8, 16 or 32 bits only");
+  static_assert(Slices == 1 || Slices == 4, "Single table or slicing-by-4 only");
+
+public:
+  crc(void): _value(initial()) {}
+
+public:
+  /** Starts over. */
+  void reset(void) { _value = initial(); }
+
+  /** Updates with the octet. */
+  void update(uint8_t octet) { _value = step(_value, octet); }
+
+  /** Updates with the data. */
+  void update(const uint8_t* data, size_t size) { _value = block(_value, data, size); }
+
+  /** Returns the CRC of the data so far. */
+  value_type value(void) const { return static_cast<value_type>(_value ^ XorOut); }
+
+  /** Returns the register, e.g. to check the residue. */
+  value_type raw(void) const { return _value; }
+
+public:
+  /** Returns the initial register. */
+  static constexpr value_type initial(void) { return Reflect? math::reflect(Init): Init; }
+
+  /** Returns the register updated with the octet. */
+  static value_type step(value_type value, uint8_t octet)
+  {
+    return Reflect?
+      static_cast<value_type>((value >> 8) ^ load((value ^ octet) & 0xff)):
+      static_cast<value_type>((value << 8) ^ load(((value >> (width - 8)) ^ octet) & 0xff));
+  }
+
+  /** Returns the register updated with the data. */
+  static value_type block(value_type value, const uint8_t* data, size_t size)
+  {
+    return block(value, data, size, slices_tag<slices>());
+  }
+
+  /** Returns the CRC of the data. */
+  static value_type compute(const uint8_t* data, size_t size)
+  {
+    return static_cast<value_type>(block(initial(), data, size) ^ XorOut);
+  }
+
+  /** Returns the CRC of the string at compile time, e.g. for the check value. */
+  static constexpr value_type of(const char* data, size_t size)
+  {
+    return static_cast<value_type>(math::bitwise(initial(), data, size) ^ XorOut);
+  }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  typedef detail::crc_math<T, Poly, Reflect> math;
+  typedef detail::crc_table<T, Poly, Reflect, slices> table;
+
+  template <size_t N> struct slices_tag {};
+
+private:
+  static value_type load(size_t index)
+  {
+    return detail::crc_load(&table::values[index]);
+  }
+
+  //-----------------------------------------------------------------------------
+  static value_type block(value_type value, const uint8_t* data, size_t size, slices_tag<1>)
+  {
+    for (size_t i = 0; i < size; ++i) { value = step(value, data[i]); }
+    return value;
+  }
+
+  //-----------------------------------------------------------------------------
+  static value_type block(value_type value, const uint8_t* data, size_t size, slices_tag<4>)
+  {
+    // the octet k of the word goes through 3 - k more zero octets
+    for (; size >= 4; size -= 4, data += 4)
+    {
+      const uint32_t x = value ^ (static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+                                  static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24);
+      value = static_cast<value_type>(load(3 * 256 + (x & 0xff)) ^ load(2 * 256 + ((x >> 8) & 0xff)) ^
+                                      load(256 + ((x >> 16) & 0xff)) ^ load(x >> 24));
+    }
+
+    return block(value, data, size, slices_tag<1>());
+  }
+
+private:
+  value_type _value;
+};
+
+/** CRC-8/SMBUS. */
+typedef crc<uint8_t, 0x07, 0x00, false, 0x00> crc8;
+
+/** CRC-8/MAXIM, 1-Wire. */
+typedef crc<uint8_t, 0x31, 0x00, true, 0x00> crc8_maxim;
+
+/** CRC-16/MODBUS. */
+typedef crc<uint16_t, 0x8005, 0xffff, true, 0x0000> crc16_modbus;
+
+/** CRC-16/CCITT-FALSE. */
+typedef crc<uint16_t, 0x1021, 0xffff, false, 0x0000> crc16_ccitt;
+
+/** CRC-16/XMODEM. */
+typedef crc<uint16_t, 0x1021, 0x0000, false, 0x0000> crc16_xmodem;
+
+/** CRC-16/KERMIT. */
+typedef crc<uint16_t, 0x1021, 0x0000, true, 0x0000> crc16_kermit;
+
+/** CRC-32, Ethernet, zip. */
+typedef crc<uint32_t, 0x04c11db7, 0xffffffff, true, 0xffffffff> crc32;
+
+/** CRC-32C, Castagnoli. */
+typedef crc<uint32_t, 0x1edc6f41, 0xffffffff, true, 0xffffffff> crc32c;
+
+} // namespace tiny
+
+#endif // TINY_CRC_HPP_
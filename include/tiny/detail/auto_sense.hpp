@@ -11,6 +11,8 @@
 # define TINY_ARDUINO_DUE
 #elif defined (ARDUINO_ARCH_AVR) || defined (ARDUINO_AVR_MEGA2560)
 # define TINY_ARDUINO_MEGA
+#elif defined (TINY_HOST)
+// host build, used by unit tests and simulations
 # else
 # error "Can't detect platform we are doing!"
 #endif // TINY_DETAIL_AUTO_SENSE_HPP_
@@ -0,0 +1,59 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_DETAIL_INDEX_SEQUENCE_HPP_
+#define TINY_DETAIL_INDEX_SEQUENCE_HPP_
+
+#include <cstddef>
+
+namespace tiny
+{
+
+namespace detail
+{
+
+/** Compile time index sequence, C++11 lacks std::index_sequence. */
+template <size_t... I>
+struct index_sequence
+{
+  enum { size = sizeof...(I) };
+};
+
+/** Joins two sequences, the second one is shifted past the first one. */
+template <typename First, typename Second>
+struct concat_index_sequence;
+
+template <size_t... I1, size_t... I2>
+struct concat_index_sequence<index_sequence<I1...>, index_sequence<I2...> >
+{
+  typedef index_sequence<I1..., (sizeof...(I1) + I2)...> type;
+};
+
+/** Makes 0..N-1 sequence, the depth is logarithmic so N may be large. */
+template <size_t N>
+struct make_index_sequence
+{
+  typedef typename concat_index_sequence<typename make_index_sequence<N / 2>::type,
+                                         typename make_index_sequence<N - N / 2>::type>::type type;
+};
+
+template <>
+struct make_index_sequence<0>
+{
+  typedef index_sequence<> type;
+};
+
+template <>
+struct make_index_sequence<1>
+{
+  typedef index_sequence<0> type;
+};
+
+} // namespace detail
+
+} // namespace tiny
+
+#endif // TINY_DETAIL_INDEX_SEQUENCE_HPP_
@@ -0,0 +1,185 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_DETAIL_INTERRUPTS_HPP_
+#define TINY_DETAIL_INTERRUPTS_HPP_
+
+#include <tiny/detail/auto_sense.hpp>
+
+#if defined (TINY_ARDUINO_MEGA)
+# include <avr/io.h>
+# include <avr/interrupt.h>
+# include <avr/sleep.h>
+#elif defined (TINY_ARDUINO_DUE)
+# include <chip.h>
+#endif // TINY_ARDUINO_MEGA
+
+namespace tiny
+{
+
+namespace detail
+{
+
+/** Disables all the interrupts for the lifetime and restores previous state.
+ *
+ *  On the host it counts the guards alive, the tests hold the simulated
+ *  interrupts while masked.
+ */
+class interrupt_guard
+{
+public:
+#if defined (TINY_ARDUINO_MEGA)
+  interrupt_guard(void): _sreg(SREG) { cli(); }
+  ~interrupt_guard(void) { SREG = _sreg; }
+#elif defined (TINY_ARDUINO_DUE)
+  interrupt_guard(void): _primask(__get_PRIMASK()) { __disable_irq(); }
+  ~interrupt_guard(void) { if (!_primask) { __enable_irq(); } }
+#else
+  interrupt_guard(void) { ++depth(); }
+  ~interrupt_guard(void) { --depth(); }
+
+  /** Whether a guard is alive. */
+  static bool masked(void) { return depth() != 0; }
+#endif // TINY_ARDUINO_MEGA
+
+private:
+  interrupt_guard(const interrupt_guard&); // inhibit copy
+  interrupt_guard& operator=(const interrupt_guard&);
+
+private:
+#if defined (TINY_ARDUINO_MEGA)
+  uint8_t _sreg;
+#elif defined (TINY_ARDUINO_DUE)
+  uint32_t _primask;
+#else
+  static unsigned int& depth(void)
+  {
+    static unsigned int value = 0;
+    return value;
+  }
+#endif // TINY_ARDUINO_MEGA
+};
+
+/** Atomically ors bits into the value and returns the previous value.
+ *
+ *  @note On Mega interrupts are masked for the operation, others use
+ *    exclusive access instructions so nested interrupts are safe.
+ */
+template <typename T>
+inline T atomic_fetch_or(volatile T& value, T bits)
+{
+#if defined (TINY_ARDUINO_MEGA)
+  interrupt_guard guard;
+  const T prev = value;
+  value = prev | bits;
+  return prev;
+#else
+  return __sync_fetch_and_or(&value, bits);
+#endif // TINY_ARDUINO_MEGA
+}
+
+/** Atomically ands bits into the value and returns the previous value. */
+template <typename T>
+inline T atomic_fetch_and(volatile T& value, T bits)
+{
+#if defined (TINY_ARDUINO_MEGA)
+  interrupt_guard guard;
+  const T prev = value;
+  value = prev & bits;
+  return prev;
+#else
+  return __sync_fetch_and_and(&value, bits);
+#endif // TINY_ARDUINO_MEGA
+}
+
+/** Atomically replaces the value and returns the previous one. */
+template <typename T>
+inline T atomic_exchange(volatile T& value, T desired)
+{
+#if defined (TINY_ARDUINO_MEGA)
+  interrupt_guard guard;
+  const T prev = value;
+  value = desired;
+  return prev;
+#else
+  T prev = value;
+  for (T seen; (seen = __sync_val_compare_and_swap(&value, prev, desired)) != prev; )
+  {
+    prev = seen;
+  }
+  return prev;
+#endif // TINY_ARDUINO_MEGA
+}
+
+/** Atomically replaces the value if it's still the expected one.
+ *
+ *  @return True if replaced.
+ */
+template <typename T>
+inline bool atomic_compare_exchange(volatile T& value, T expected, T desired)
+{
+#if defined (TINY_ARDUINO_MEGA)
+  interrupt_guard guard;
+  if (value != expected) { return false; }
+  value = desired;
+  return true;
+#else
+  return __sync_bool_compare_and_swap(&value, expected, desired);
+#endif // TINY_ARDUINO_MEGA
+}
+
+/** Sleeps until the next interrupt unless the word is already non-zero.
+ *
+ *  The check and the sleep are done with interrupts masked so an interrupt
+ *  setting the word right before the sleep can't be missed. On Due WFI,
+ *  on Mega the idle sleep mode is used, on the host it returns at once.
+ *  The interrupt mask of the caller is restored, on Mega the caller having
+ *  interrupts masked isn't put to sleep as nothing could wake it.
+ */
+template <typename T>
+inline void wait_for_event(const volatile T& word)
+{
+#if defined (TINY_ARDUINO_MEGA)
+  const uint8_t sreg = SREG;
+  cli();
+  if (word == 0 && (sreg & _BV(SREG_I)) != 0)
+  {
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_enable();
+    sei(); // the instruction after sei is executed before any interrupt
+    sleep_cpu();
+    sleep_disable();
+  }
+  SREG = sreg;
+#elif defined (TINY_ARDUINO_DUE)
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (word == 0)
+  {
+    __WFI(); // wakes on pending interrupt even if masked
+  }
+  if (!primask) { __enable_irq(); }
+#else
+  (void)&word;
+#endif // TINY_ARDUINO_MEGA
+}
+
+/** Sleeps until the next interrupt. */
+inline void wait_for_interrupt(void)
+{
+#if defined (TINY_ARDUINO_MEGA)
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_mode();
+#elif defined (TINY_ARDUINO_DUE)
+  __WFI();
+#endif // TINY_ARDUINO_MEGA
+}
+
+} // namespace detail
+
+} // namespace tiny
+
+#endif // TINY_DETAIL_INTERRUPTS_HPP_
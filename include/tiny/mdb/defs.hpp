@@ -0,0 +1,68 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_MDB_DEFS_HPP_
+#define TINY_MDB_DEFS_HPP_
+
+#include <cstddef>
+#include <stdint.h>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** MDB (Multi-Drop Bus) root namespace. */
+namespace mdb
+{
+
+/** Nine bits word type. */
+typedef unsigned short word_type;
+
+/** Framing constants. */
+enum
+{
+  mode_bit     = 0x100, /**< Address byte from master, the last byte from peripheral. */
+  max_block    = 36,    /**< The largest block without the checksum. */
+  address_mask = 0xf8,  /**< Peripheral address part of the address byte. */
+  command_mask = 0x07   /**< Command part of the address byte. */
+};
+
+/** Control octets. */
+enum control
+{
+  ack = 0x00, /**< Acknowledge. */
+  ret = 0xaa, /**< Retransmit, master only. */
+  nak = 0xff  /**< Negative acknowledge. */
+};
+
+/** Timing in milliseconds. */
+enum timing
+{
+  t_response   = 5, /**< The longest peripheral response time. */
+  t_inter_byte = 1  /**< The longest gap between the block octets. */
+};
+
+/** Nine bits word time at 9600 bps in microseconds, 11 bits. */
+enum { word_time_us = 1146 };
+
+/** Returns the time of the words on the line in milliseconds, rounded up. */
+inline unsigned long words_time_ms(size_t words)
+{
+  return (static_cast<unsigned long>(words) * word_time_us + 999) / 1000;
+}
+
+/** Returns the block checksum, the sum of the octets modulo 256. */
+inline uint8_t checksum(const uint8_t* data, size_t size, uint8_t sum = 0)
+{
+  for (size_t i = 0; i < size; ++i) { sum = static_cast<uint8_t>(sum + data[i]); }
+  return sum;
+}
+
+} // namespace mdb
+
+} // namespace tiny
+
+#endif // TINY_MDB_DEFS_HPP_
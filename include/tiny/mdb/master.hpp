@@ -0,0 +1,380 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_MDB_MASTER_HPP_
+#define TINY_MDB_MASTER_HPP_
+
+#include <tiny/mdb/defs.hpp>
+#include <tiny/serial/blocking.hpp>
+#include <tiny/detail/interrupts.hpp>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** MDB (Multi-Drop Bus) root namespace. */
+namespace mdb
+{
+
+/** Transfer status. */
+enum transfer_status
+{
+  ts_idle,   /**< Nothing sent yet. */
+  ts_busy,   /**< Waiting for the response. */
+  ts_ack,    /**< Peripheral acknowledged. */
+  ts_nak,    /**< Peripheral rejected or the response is still broken after retries. */
+  ts_data,   /**< Peripheral responded with data, acknowledged. */
+  ts_timeout /**< No response after retries. */
+};
+
+/** MDB master (VMC).
+ *
+ *  @tparam PortT Nine bits port type, basic_uart<extended> or any having
+ *    on_rx, write and async_write.
+ *  @tparam ClockT Millisecond clock, see tiny::io::default_wait_policy.
+ *
+ *  The master takes over the port receiving by the rx hook. The response
+ *  is collected in the interrupt which also acknowledges it or requests
+ *  the retransmission (RET) on a checksum error, so the peripheral gets
+ *  the reply in time whatever the main loop does. The command is sent
+ *  again by poll if there is no response within the timeout.
+ */
+template <typename PortT, typename ClockT = ::tiny::io::default_wait_policy>
+class master
+{
+public:
+  /** Port type. */
+  typedef PortT port_type;
+
+  /** Time type. */
+  typedef typename ClockT::time_type time_type;
+
+public:
+  /** Creates the master.
+   *
+   *  @param timeout Response timeout after the command is sent.
+   *  @param retries The number of the command or RET retransmissions.
+   */
+  master(port_type& port, time_type timeout = t_response, size_t retries = 2):
+    _port(port),
+    _timeout(timeout),
+    _retries(retries),
+    _status(ts_idle),
+    _command_size(0),
+    _size(0),
+    _attempts(0),
+    _sent_at(0),
+    _wait(0)
+  {
+    // empty
+  }
+
+public:
+  /** Starts, the port is expected to be opened at 9600 9n1. */
+  void start(void)
+  {
+    _port.on_rx(&master::on_word, this);
+  }
+
+  /** Stops and releases the port rx hook. */
+  void stop(void)
+  {
+    _port.on_rx(nullptr);
+  }
+
+  /** Sends the command, poll it till completion.
+   *
+   *  @param command The address byte, the peripheral address and the command.
+   *  @return False if busy or the data is too long.
+   */
+  bool send(uint8_t command, const uint8_t* data = nullptr, size_t size = 0)
+  {
+    if (busy() || size > max_block) { return false; }
+
+    _command[0] = command;
+    for (size_t i = 0; i < size; ++i) { _command[i + 1] = data[i]; }
+    _command_size = size + 1;
+    _attempts     = 0;
+
+    transmit();
+    return true;
+  }
+
+  /** Retransmits the command on timeout, call it from the main loop.
+   *
+   *  @return The transfer status.
+   */
+  transfer_status poll(void)
+  {
+    if (_status != ts_busy) { return _status; }
+
+    bool expired = false;
+    {
+      ::tiny::detail::interrupt_guard guard;
+      expired = _status == ts_busy && ClockT::now() - _sent_at >= _wait;
+    }
+
+    if (expired)
+    {
+      if (_attempts < _retries)
+      {
+        ++_attempts;
+        transmit();
+      } else
+      {
+        _status = ts_timeout;
+      }
+    }
+
+    return _status;
+  }
+
+  /** Returns the transfer status. */
+  transfer_status status(void) const { return _status; }
+
+  /** Whether waiting for the response. */
+  bool busy(void) const { return _status == ts_busy; }
+
+  /** Returns the response data, valid for ts_data until the next send. */
+  const uint8_t* response(void) const { return _response; }
+
+  /** Returns the response size without the checksum. */
+  size_t response_size(void) const { return _status == ts_data? _size: 0; }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  master(const master&); // inhibit copy
+  master& operator=(const master&);
+
+private:
+  static bool on_word(typename port_type::octet_type word, void* context)
+  {
+    static_cast<master*>(context)->receive(static_cast<word_type>(word));
+    return true;
+  }
+
+  //-----------------------------------------------------------------------------
+  void receive(word_type word)
+  {
+    if (_status != ts_busy) { return; }
+
+    const uint8_t octet = static_cast<uint8_t>(word);
+
+    // data octets till the checksum having the mode bit
+    if ((word & mode_bit) == 0)
+    {
+      if (_size < sizeof(_response)) { _response[_size++] = octet; }
+      return;
+    }
+
+    if (_size == 0 && (octet == ack || octet == nak))
+    {
+      _status = octet == ack? ts_ack: ts_nak;
+      return;
+    }
+
+    if (_size != 0 && _size <= max_block && checksum(_response, _size) == octet)
+    {
+      reply(ack);
+      _status = ts_data;
+      return;
+    }
+
+    // broken response
+    if (_attempts < _retries)
+    {
+      ++_attempts;
+      _size    = 0;
+      _sent_at = ClockT::now();
+      _wait    = _timeout + words_time_ms(max_block + 1);
+      reply(ret);
+    } else
+    {
+      reply(nak);
+      _status = ts_nak;
+    }
+  }
+
+  //-----------------------------------------------------------------------------
+  void transmit(void)
+  {
+    {
+      ::tiny::detail::interrupt_guard guard;
+      _size    = 0;
+      _sent_at = ClockT::now();
+      _wait    = _timeout + words_time_ms(_command_size + 1);
+      _status  = ts_busy;
+    }
+
+    _port.write(static_cast<typename port_type::octet_type>(mode_bit | _command[0]));
+    for (size_t i = 1; i < _command_size; ++i)
+    {
+      _port.write(static_cast<typename port_type::octet_type>(_command[i]));
+    }
+    _port.write(static_cast<typename port_type::octet_type>(checksum(_command, _command_size)));
+  }
+
+  //-----------------------------------------------------------------------------
+  void reply(uint8_t octet)
+  {
+    _port.async_write(static_cast<typename port_type::octet_type>(octet));
+  }
+
+private:
+  port_type& _port;
+  time_type _timeout;
+  size_t _retries;
+  volatile transfer_status _status;
+  uint8_t _command[max_block + 1];
+  size_t _command_size;
+  uint8_t _response[max_block + 1];
+  size_t _size;
+  size_t _attempts;
+  time_type _sent_at;
+  time_type _wait;
+};
+
+/** Round-robin poll scheduler of several peripherals.
+ *
+ *  @tparam MasterT Master type.
+ *  @tparam Peripherals The number of the peripherals.
+ *
+ *  Every attached peripheral is sent its POLL command in turn unless a
+ *  command is submitted for it, then the command goes first. The handler
+ *  is called with the transfer result from poll.
+ */
+template <typename MasterT, size_t Peripherals>
+class scheduler
+{
+public:
+  /** Transfer result handler, the data is valid for ts_data only. */
+  typedef void (*handler_type)(size_t index, transfer_status status,
+                               const uint8_t* data, size_t size, void* context);
+
+  /** The number of the peripherals. */
+  enum { peripherals = Peripherals };
+
+public:
+  scheduler(MasterT& master):
+    _master(master),
+    _current(Peripherals),
+    _next(0)
+  {
+    for (size_t i = 0; i < Peripherals; ++i) { detach(i); }
+  }
+
+public:
+  /** Attaches the peripheral polled by the given command, e.g. 0x12 for cashless #1. */
+  void attach(size_t index, uint8_t poll_command, handler_type handler, void* context = nullptr)
+  {
+    _slots[index].attached = true;
+    _slots[index].poll     = poll_command;
+    _slots[index].pending  = false;
+    _slots[index].handler  = handler;
+    _slots[index].context  = context;
+  }
+
+  /** Detaches the peripheral. */
+  void detach(size_t index)
+  {
+    _slots[index].attached = false;
+    _slots[index].pending  = false;
+    _slots[index].handler  = nullptr;
+  }
+
+  /** Submits the command sent before the next poll of the peripheral.
+   *
+   *  @return False if a command is already pending or the data is too long.
+   */
+  bool submit(size_t index, uint8_t command, const uint8_t* data = nullptr, size_t size = 0)
+  {
+    slot& s = _slots[index];
+    if (!s.attached || s.pending || size > max_block) { return false; }
+
+    s.command[0] = command;
+    for (size_t i = 0; i < size; ++i) { s.command[i + 1] = data[i]; }
+    s.size    = size + 1;
+    s.pending = true;
+    return true;
+  }
+
+  /** Completes the current transfer and starts the next one, call it
+   *  from the main loop.
+   *
+   *  @return True if a transfer has been completed.
+   */
+  bool poll(void)
+  {
+    bool completed = false;
+
+    if (_current != Peripherals)
+    {
+      const transfer_status status = _master.poll();
+      if (status == ts_busy) { return false; }
+
+      slot& s          = _slots[_current];
+      const size_t idx = _current;
+      _current         = Peripherals;
+      completed        = true;
+
+      if (s.handler != nullptr)
+      {
+        s.handler(idx, status, _master.response(), _master.response_size(), s.context);
+      }
+    }
+
+    for (size_t i = 0; i < Peripherals; ++i)
+    {
+      const size_t idx = (_next + i) % Peripherals;
+      slot& s          = _slots[idx];
+      if (!s.attached) { continue; }
+
+      _next    = idx + 1;
+      _current = idx;
+
+      if (s.pending)
+      {
+        s.pending = false;
+        _master.send(s.command[0], s.command + 1, s.size - 1);
+      } else
+      {
+        _master.send(s.poll);
+      }
+      break;
+    }
+
+    return completed;
+  }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  struct slot
+  {
+    bool attached;
+    bool pending;
+    uint8_t poll;
+    uint8_t command[max_block + 1];
+    size_t size;
+    handler_type handler;
+    void* context;
+  };
+
+private:
+  MasterT& _master;
+  size_t _current;
+  size_t _next;
+  slot _slots[Peripherals];
+};
+
+} // namespace mdb
+
+} // namespace tiny
+
+#endif // TINY_MDB_MASTER_HPP_
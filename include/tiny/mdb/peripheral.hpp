@@ -0,0 +1,212 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_MDB_PERIPHERAL_HPP_
+#define TINY_MDB_PERIPHERAL_HPP_
+
+#include <tiny/mdb/defs.hpp>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** MDB (Multi-Drop Bus) root namespace. */
+namespace mdb
+{
+
+/** MDB peripheral.
+ *
+ *  @tparam PortT Nine bits port type, basic_uart<extended> or any having
+ *    on_rx and async_write.
+ *
+ *  The peripheral takes over the port receiving by the rx hook. Commands
+ *  addressed to it are collected in the interrupt, the command handler is
+ *  called from the interrupt as soon as the block is complete and the
+ *  response is queued right away, so the response time doesn't depend on
+ *  the main loop. The handler must be short.
+ *
+ *  MDB blocks have no length, it's told by the length handler for the
+ *  octets received so far. The port transmit buffer must hold the largest
+ *  response, max_block plus the checksum.
+ */
+template <typename PortT>
+class peripheral
+{
+public:
+  /** Port type. */
+  typedef PortT port_type;
+
+  /** Returns the command block length including the address byte and
+   *  the checksum, zero while unknown.
+   */
+  typedef size_t (*length_handler)(const uint8_t* block, size_t size, void* context);
+
+  /** Handles the command block without the checksum, the address byte
+   *  first. Fills the response and its size, none means ACK.
+   */
+  typedef void (*command_handler)(const uint8_t* block, size_t size,
+                                  uint8_t* response, size_t& response_size, void* context);
+
+public:
+  /** Creates the peripheral of the given address, e.g. 0x10 for cashless #1. */
+  peripheral(port_type& port, uint8_t address, length_handler length, command_handler command,
+             void* context = nullptr):
+    _port(port),
+    _address(static_cast<uint8_t>(address & address_mask)),
+    _length(length),
+    _command(command),
+    _context(context),
+    _state(st_idle),
+    _size(0),
+    _response_size(0),
+    _commands(0),
+    _errors(0)
+  {
+    // empty
+  }
+
+public:
+  /** Starts serving, the port is expected to be opened at 9600 9n1. */
+  void start(void)
+  {
+    _port.on_rx(nullptr);
+    _state = st_idle;
+    _port.on_rx(&peripheral::on_word, this);
+  }
+
+  /** Stops serving and releases the port rx hook. */
+  void stop(void)
+  {
+    _port.on_rx(nullptr);
+  }
+
+  /** Returns the peripheral address. */
+  uint8_t address(void) const { return _address; }
+
+  /** Returns the number of the commands handled. */
+  size_t commands(void) const { return _commands; }
+
+  /** Returns the number of checksum errors and overflows. */
+  size_t errors(void) const { return _errors; }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  enum state { st_idle, st_command, st_response };
+
+private:
+  peripheral(const peripheral&); // inhibit copy
+  peripheral& operator=(const peripheral&);
+
+private:
+  static bool on_word(typename port_type::octet_type word, void* context)
+  {
+    static_cast<peripheral*>(context)->receive(static_cast<word_type>(word));
+    return true;
+  }
+
+  //-----------------------------------------------------------------------------
+  void receive(word_type word)
+  {
+    const uint8_t octet = static_cast<uint8_t>(word);
+
+    // the address byte starts a block, the others are ignored
+    if ((word & mode_bit) != 0)
+    {
+      _size  = 0;
+      _state = (octet & address_mask) == _address? st_command: st_idle;
+    }
+
+    switch (_state)
+    {
+    case st_command:
+      receive_command(octet);
+      break;
+
+    case st_response:
+      // master reply to the data sent
+      if (octet == ret) { send_response(); }
+      else { _state = st_idle; }
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  //-----------------------------------------------------------------------------
+  void receive_command(uint8_t octet)
+  {
+    if (_size == sizeof(_block))
+    {
+      ++_errors;
+      _state = st_idle;
+      return;
+    }
+
+    _block[_size++] = octet;
+
+    const size_t expected = _length(_block, _size, _context);
+    if (expected == 0 || _size < expected) { return; }
+
+    _state = st_idle;
+
+    if (checksum(_block, _size - 1) != _block[_size - 1])
+    {
+      ++_errors;
+      send(mode_bit | nak);
+      return;
+    }
+
+    ++_commands;
+    _response_size = 0;
+    _command(_block, _size - 1, _response, _response_size, _context);
+
+    if (_response_size == 0)
+    {
+      send(mode_bit | ack);
+      return;
+    }
+
+    if (_response_size > max_block) { _response_size = max_block; }
+    send_response();
+    _state = st_response;
+  }
+
+  //-----------------------------------------------------------------------------
+  void send_response(void)
+  {
+    for (size_t i = 0; i < _response_size; ++i) { send(_response[i]); }
+    send(mode_bit | checksum(_response, _response_size));
+  }
+
+  //-----------------------------------------------------------------------------
+  void send(unsigned int word)
+  {
+    if (!_port.async_write(static_cast<typename port_type::octet_type>(word))) { ++_errors; }
+  }
+
+private:
+  port_type& _port;
+  uint8_t _address;
+  length_handler _length;
+  command_handler _command;
+  void* _context;
+  state _state;
+  uint8_t _block[max_block + 1];
+  size_t _size;
+  uint8_t _response[max_block];
+  size_t _response_size;
+  size_t _commands;
+  size_t _errors;
+};
+
+} // namespace mdb
+
+} // namespace tiny
+
+#endif // TINY_MDB_PERIPHERAL_HPP_
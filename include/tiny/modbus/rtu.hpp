@@ -0,0 +1,580 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_MODBUS_RTU_HPP_
+#define TINY_MODBUS_RTU_HPP_
+
+#include <tiny/serial/idle_line.hpp>
+#include <tiny/detail/auto_sense.hpp>
+#include <tiny/detail/interrupts.hpp>
+#include <tiny/container.hpp>
+#include <tiny/crc.hpp>
+
+#if defined (TINY_ARDUINO_MEGA) || defined (TINY_ARDUINO_DUE)
+# include <Arduino.h>
+#else
+# include <chrono>
+#endif // TINY_ARDUINO_MEGA || TINY_ARDUINO_DUE
+
+#include <cstddef>
+#include <stdint.h>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** Modbus root namespace. */
+namespace modbus
+{
+
+/** Updates CRC-16/MODBUS with the octet. */
+inline uint16_t crc16_update(uint16_t crc, uint8_t octet)
+{
+  return crc16_modbus::step(crc, octet);
+}
+
+/** Returns CRC-16/MODBUS of the data. */
+inline uint16_t crc16(const uint8_t* data, size_t size, uint16_t crc = 0xffff)
+{
+  return crc16_modbus::block(crc, data, size);
+}
+
+/** Supported function codes. */
+enum function_code
+{
+  fc_read_holding_registers   = 3,
+  fc_read_input_registers     = 4,
+  fc_write_single_register    = 6,
+  fc_write_multiple_registers = 16
+};
+
+/** Exception codes. */
+enum exception_code
+{
+  ex_none                 = 0,
+  ex_illegal_function     = 1,
+  ex_illegal_data_address = 2,
+  ex_illegal_data_value   = 3,
+  ex_device_failure       = 4
+};
+
+/** Register spaces. */
+enum register_space
+{
+  holding_registers,
+  input_registers
+};
+
+/** Register map access.
+ *
+ *  Reads count registers starting at address into values or writes them
+ *  from values if write is true.
+ *
+ *  @return ex_none or the exception code to respond with.
+ */
+typedef uint8_t (*register_access)(register_space space, bool write, uint16_t address,
+                                   uint16_t* values, uint16_t count, void* context);
+
+/** Microsecond clock, micros() on the targets. */
+struct rtu_clock
+{
+  /** Time type, wraps around. */
+  typedef uint32_t time_type;
+
+  /** Returns the current time. */
+  static time_type now(void)
+  {
+#if defined (TINY_ARDUINO_MEGA) || defined (TINY_ARDUINO_DUE)
+    return micros();
+#else
+    using namespace std::chrono;
+    return static_cast<time_type>(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+#endif // TINY_ARDUINO_MEGA || TINY_ARDUINO_DUE
+  }
+};
+
+/** Inter-character (t1.5) and inter-frame (t3.5) times in microseconds. */
+struct rtu_timing
+{
+  uint32_t octet; /**< The time of 11 bits character. */
+  uint32_t t15;   /**< The longest silence within a frame. */
+  uint32_t t35;   /**< The shortest silence between frames. */
+
+  /** Returns the timing for the baud rate, fixed above 19200 bps. */
+  static rtu_timing for_baud(unsigned long baud_rate)
+  {
+    rtu_timing t;
+    t.octet = ::tiny::io::bit_times_us(11, baud_rate);
+    t.t15   = baud_rate > 19200? 750: ::tiny::io::bit_times_us(33, baud_rate * 2);
+    t.t35   = baud_rate > 19200? 1750: ::tiny::io::bit_times_us(77, baud_rate * 2);
+    return t;
+  }
+};
+
+/** RTU frame receiver.
+ *
+ *  @tparam MaxAdu The largest frame, 256 by the specification.
+ *
+ *  Octets are stored from the rx interrupt by put along with the running
+ *  CRC, a silence over t1.5 within a frame marks it broken. The frame is
+ *  ready once the line is silent for t3.5, it's detected either by poll
+ *  or by the next octet. The frames are double buffered: the next frame
+ *  is received while the ready one waits for release, only a frame
+ *  coming while both wait is dropped and then the receiver waits for
+ *  t3.5 silence to resynchronize.
+ */
+template <size_t MaxAdu = 256>
+class rtu_framer
+{
+public:
+  /** Time type. */
+  typedef uint32_t time_type;
+
+  /** The largest frame. */
+  enum { max_adu = MaxAdu };
+
+public:
+  rtu_framer(void):
+    _last(0),
+    _fill(0),
+    _read(0),
+    _sync(true)
+  {
+    timing(rtu_timing::for_baud(19200));
+  }
+
+public:
+  /** Sets the timing, see rtu_timing. */
+  void timing(const rtu_timing& t)
+  {
+    _timing = t;
+  }
+
+  /** Stores an octet received at the given time, the interrupt context. */
+  void put(uint8_t octet, time_type now)
+  {
+    const time_type gap = now - _last;
+    _last               = now;
+
+    // the frame before ended, missed by poll
+    frame* f = &_frames[_fill];
+    if (!f->ready && f->length != 0 && gap >= _timing.t35 + _timing.octet)
+    {
+      close();
+      f = &_frames[_fill];
+    }
+
+    if (f->ready)
+    {
+      // both frames wait for release
+      _sync = false;
+      return;
+    }
+
+    if (!_sync)
+    {
+      // the octet ending t3.5 silence starts the frame
+      if (gap < _timing.t35 + _timing.octet) { return; }
+      _sync = true;
+    }
+
+    if (f->length != 0 && gap > _timing.t15 + _timing.octet) { f->broken = true; }
+
+    if (f->length < MaxAdu)
+    {
+      f->adu[f->length++] = octet;
+      f->crc              = crc16_update(f->crc, octet);
+    } else
+    {
+      f->broken = true;
+    }
+  }
+
+  /** Marks the frame ready if the line is silent for t3.5. Must not be
+   *  preempted by put.
+   *
+   *  @return True if a frame is ready.
+   */
+  bool poll(time_type now)
+  {
+    const frame& f = _frames[_read];
+    if (!f.ready && f.length != 0 && now - _last >= _timing.t35) { close(); }
+    return f.ready;
+  }
+
+  /** Whether the frame is ready. */
+  bool ready(void) const { return _frames[_read].ready; }
+
+  /** Whether the ready frame is complete and the CRC matches. */
+  bool valid(void) const
+  {
+    const frame& f = _frames[_read];
+    return !f.broken && f.length >= 4 && f.crc == 0;
+  }
+
+  /** Returns the frame received. */
+  const uint8_t* adu(void) const { return _frames[_read].adu; }
+
+  /** Returns the frame size including the address and the CRC. */
+  size_t size(void) const { return _frames[_read].length; }
+
+  /** Releases the ready frame, the next one if any becomes ready. */
+  void release(void)
+  {
+    frame& f = _frames[_read];
+    if (!f.ready) { return; }
+
+    f.clear();
+    ::tiny::detail::compiler_barrier();
+    f.ready = false;
+    _read   = static_cast<uint8_t>(_read ^ 1);
+  }
+
+  /** Drops the frames, put must not run meanwhile. */
+  void reset(void)
+  {
+    for (size_t i = 0; i < 2; ++i)
+    {
+      _frames[i].clear();
+      _frames[i].ready = false;
+    }
+    _fill = _read = 0;
+    _sync = true;
+  }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  struct frame
+  {
+    frame(void): length(0), crc(0xffff), broken(false), ready(false) {}
+
+    void clear(void)
+    {
+      length = 0;
+      crc    = 0xffff;
+      broken = false;
+    }
+
+    uint8_t adu[MaxAdu];
+    size_t length;
+    uint16_t crc;
+    bool broken;
+    volatile bool ready;
+  };
+
+  //-----------------------------------------------------------------------------
+  void close(void)
+  {
+    _frames[_fill].ready = true;
+    _fill                = static_cast<uint8_t>(_fill ^ 1);
+  }
+
+private:
+  rtu_timing _timing;
+  frame _frames[2];
+  time_type _last;
+  uint8_t _fill;
+  uint8_t _read;
+  bool _sync;
+};
+
+/** Modbus RTU slave.
+ *
+ *  @tparam UartT Port type, basic_uart or any having on_rx, writable and
+ *    commit.
+ *  @tparam ClockT Microsecond clock, see rtu_clock.
+ *
+ *  The slave takes over the port receiving by the rx hook, the octets
+ *  are framed and CRC checked in the interrupt as they arrive and the
+ *  request is parsed in place. Responses are built right in the port
+ *  transmit buffer room with CRC computed on the way, the part not
+ *  fitting goes out by the next polls, the request received meanwhile
+ *  waits in the framer.
+ *
+ *  Supports read holding registers (3), read input registers (4), write
+ *  single register (6) and write multiple registers (16). Broadcast
+ *  writes are served without a response.
+ */
+template <typename UartT, typename ClockT = rtu_clock, size_t MaxAdu = 256>
+class rtu_slave
+{
+public:
+  /** Port type. */
+  typedef UartT uart_type;
+
+  /** Framer type. */
+  typedef rtu_framer<MaxAdu> framer_type;
+
+  /** The most registers read by a request. */
+  enum { max_read = 125, max_write = 123 };
+
+public:
+  /** Creates the slave of the given address. */
+  rtu_slave(uart_type& uart, uint8_t address, register_access access, void* context = nullptr):
+    _uart(uart),
+    _address(address),
+    _access(access),
+    _context(context),
+    _head_size(0),
+    _words(0),
+    _sent(0),
+    _total(0),
+    _tx_crc(0xffff),
+    _served(0),
+    _errors(0)
+  {
+    // empty
+  }
+
+public:
+  /** Starts serving, the port is expected to be opened at baud_rate. */
+  void start(unsigned long baud_rate)
+  {
+    _uart.on_rx(nullptr);
+    _framer.timing(rtu_timing::for_baud(baud_rate));
+    _framer.reset();
+    _sent = _total = 0;
+    _uart.on_rx(&rtu_slave::on_octet, this);
+  }
+
+  /** Stops serving and releases the port rx hook. */
+  void stop(void)
+  {
+    _uart.on_rx(nullptr);
+  }
+
+  /** Serves a request if it's received, call it from the main loop.
+   *  Never waits, the response not fitting into the transmit buffer
+   *  goes on by the next calls first.
+   *
+   *  @return True if a request to the slave has been served.
+   */
+  bool poll(void)
+  {
+    if (!flush()) { return false; }
+
+    {
+      ::tiny::detail::interrupt_guard guard;
+      if (!_framer.poll(ClockT::now())) { return false; }
+    }
+
+    bool served = false;
+    if (!_framer.valid()) { ++_errors; }
+    else { served = process(_framer.adu(), _framer.size() - 2); }
+
+    _framer.release();
+    return served;
+  }
+
+  /** Whether a response is still being written. */
+  bool responding(void) const { return _sent != _total; }
+
+  /** Returns the slave address. */
+  uint8_t address(void) const { return _address; }
+
+  /** Returns the number of requests served. */
+  size_t served(void) const { return _served; }
+
+  /** Returns the number of broken frames and CRC errors. */
+  size_t errors(void) const { return _errors; }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  rtu_slave(const rtu_slave&); // inhibit copy
+  rtu_slave& operator=(const rtu_slave&);
+
+private:
+  static bool on_octet(typename uart_type::octet_type octet, void* context)
+  {
+    static_cast<rtu_slave*>(context)->_framer.put(static_cast<uint8_t>(octet), ClockT::now());
+    return true;
+  }
+
+  //-----------------------------------------------------------------------------
+  static uint16_t get16(const uint8_t* p)
+  {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+  }
+
+  //-----------------------------------------------------------------------------
+  bool process(const uint8_t* adu, size_t size)
+  {
+    const uint8_t address = adu[0];
+    if (address != _address && address != 0) { return false; }
+
+    const bool broadcast = address == 0;
+    const uint8_t fc     = adu[1];
+    const uint8_t* data  = adu + 2;
+    const size_t length  = size - 2;
+    uint8_t ex           = ex_none;
+
+    ++_served;
+
+    switch (fc)
+    {
+    case fc_read_holding_registers:
+    case fc_read_input_registers:
+    {
+      if (broadcast) { return true; }
+      if (length != 4) { ex = ex_illegal_data_value; break; }
+
+      const uint16_t start = get16(data);
+      const uint16_t count = get16(data + 2);
+      if (count == 0 || count > max_read) { ex = ex_illegal_data_value; break; }
+      if (uint32_t(start) + count > 0x10000) { ex = ex_illegal_data_address; break; }
+
+      const register_space space = fc == fc_read_holding_registers? holding_registers: input_registers;
+      if ((ex = _access(space, false, start, _values, count, _context)) != ex_none) { break; }
+
+      // the values go out of _values as they are
+      begin(fc);
+      put(static_cast<uint8_t>(count * 2));
+      _words = count;
+      end();
+      return true;
+    }
+
+    case fc_write_single_register:
+    {
+      if (length != 4) { ex = ex_illegal_data_value; break; }
+
+      _values[0] = get16(data + 2);
+      if ((ex = _access(holding_registers, true, get16(data), _values, 1, _context)) != ex_none) { break; }
+      if (broadcast) { return true; }
+
+      begin(fc);
+      for (size_t i = 0; i < length; ++i) { put(data[i]); }
+      end();
+      return true;
+    }
+
+    case fc_write_multiple_registers:
+    {
+      if (length < 5) { ex = ex_illegal_data_value; break; }
+
+      const uint16_t start = get16(data);
+      const uint16_t count = get16(data + 2);
+      if (count == 0 || count > max_write || data[4] != count * 2 || length != 5u + count * 2)
+      {
+        ex = ex_illegal_data_value;
+        break;
+      }
+      if (uint32_t(start) + count > 0x10000) { ex = ex_illegal_data_address; break; }
+
+      for (uint16_t i = 0; i < count; ++i) { _values[i] = get16(data + 5 + i * 2); }
+      if ((ex = _access(holding_registers, true, start, _values, count, _context)) != ex_none) { break; }
+      if (broadcast) { return true; }
+
+      begin(fc);
+      for (size_t i = 0; i < 4; ++i) { put(data[i]); }
+      end();
+      return true;
+    }
+
+    default:
+      ex = ex_illegal_function;
+      break;
+    }
+
+    if (broadcast) { return true; }
+
+    begin(static_cast<uint8_t>(fc | 0x80));
+    put(ex);
+    end();
+    return true;
+  }
+
+  //-----------------------------------------------------------------------------
+  void begin(uint8_t fc)
+  {
+    _head_size = 0;
+    _words     = 0;
+    put(_address);
+    put(fc);
+  }
+
+  //-----------------------------------------------------------------------------
+  void put(uint8_t octet)
+  {
+    _head[_head_size++] = octet;
+  }
+
+  //-----------------------------------------------------------------------------
+  void end(void)
+  {
+    _sent   = 0;
+    _total  = _head_size + _words * 2u + 2;
+    _tx_crc = 0xffff;
+    flush();
+  }
+
+  //-----------------------------------------------------------------------------
+  // the response octet, the head, the values and the CRC once it's final
+  uint8_t octet_at(size_t i) const
+  {
+    if (i < _head_size) { return _head[i]; }
+
+    i -= _head_size;
+    if (i < _words * 2u)
+    {
+      const uint16_t value = _values[i / 2];
+      return static_cast<uint8_t>((i & 1) != 0? value: value >> 8);
+    }
+
+    return static_cast<uint8_t>(i == _words * 2u? _tx_crc: _tx_crc >> 8);
+  }
+
+  //-----------------------------------------------------------------------------
+  // writes the response into the transmit buffer room, true once it's all out
+  bool flush(void)
+  {
+    const size_t crc_at = _total - 2;
+    while (_sent != _total)
+    {
+      typename uart_type::octet_type* data;
+      const size_t room = _uart.writable(data);
+      if (room == 0) { return false; }
+
+      size_t n = 0;
+      for (; n < room && _sent != _total; ++n, ++_sent)
+      {
+        const uint8_t octet = octet_at(_sent);
+        if (_sent < crc_at) { _tx_crc = crc16_update(_tx_crc, octet); }
+        data[n] = octet;
+      }
+
+      _uart.commit(n);
+    }
+
+    return true;
+  }
+
+private:
+  uart_type& _uart;
+  uint8_t _address;
+  register_access _access;
+  void* _context;
+  framer_type _framer;
+  uint16_t _values[max_read];
+  uint8_t _head[6];
+  uint8_t _head_size;
+  uint16_t _words;
+  size_t _sent;
+  size_t _total;
+  uint16_t _tx_crc;
+  size_t _served;
+  size_t _errors;
+};
+
+} // namespace modbus
+
+} // namespace tiny
+
+#endif // TINY_MODBUS_RTU_HPP_
@@ -0,0 +1,221 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_POOL_HPP_
+#define TINY_POOL_HPP_
+
+#include <tiny/container.hpp>
+#include <tiny/detail/interrupts.hpp>
+
+#include <cstddef>
+#include <stdint.h>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** Fixed block pool.
+ *
+ *  @tparam BlockSize Block size in octets.
+ *  @tparam Count The number of the blocks, up to 65534.
+ *
+ *  Blocks are referred by handles, the index of the block. Allocate and
+ *  free take constant time and may be called from any context including
+ *  nested interrupts: the free list head is the block index with a
+ *  modification tag against ABA swapped by compare-and-swap, exclusive
+ *  access instructions on Due, interrupts masked on Mega. Blocks are
+ *  aligned to 4 octets.
+ */
+template <size_t BlockSize, size_t Count>
+class pool
+{
+public:
+  /** Block handle type. */
+  typedef uint16_t handle_type;
+
+  enum
+  {
+    block_size  = BlockSize, /**< Block size in octets. */
+    count       = Count,     /**< The number of the blocks. */
+    null_handle = 0xffff     /**< No block. */
+  };
+
+  static_assert(Count >= 1 && Count < null_handle, "Pool of 1..65534 blocks");
+
+public:
+  pool(void):
+    _head(0)
+  {
+    for (size_t i = 0; i + 1 < Count; ++i) { _next[i] = static_cast<handle_type>(i + 1); }
+    _next[Count - 1] = null_handle;
+  }
+
+public:
+  /** Takes a block.
+   *
+   *  @return The block or null_handle if the pool is exhausted.
+   */
+  handle_type allocate(void)
+  {
+    for (;;)
+    {
+      const uint32_t head      = _head;
+      const handle_type handle = static_cast<handle_type>(head);
+      if (handle == null_handle) { return null_handle; }
+
+      // stale if the block is taken meanwhile, then the tag differs
+      const uint32_t next = tagged(head, _next[handle]);
+      if (detail::atomic_compare_exchange(_head, head, next)) { return handle; }
+    }
+  }
+
+  /** Returns the block to the pool, it must be allocated. */
+  void free(handle_type handle)
+  {
+    for (;;)
+    {
+      const uint32_t head = _head;
+      _next[handle]       = static_cast<handle_type>(head);
+      if (detail::atomic_compare_exchange(_head, head, tagged(head, handle))) { return; }
+    }
+  }
+
+  /** Returns the block data. */
+  uint8_t* data(handle_type handle)
+  {
+    return reinterpret_cast<uint8_t*>(_blocks[handle]);
+  }
+
+  /** Returns the block data. */
+  const uint8_t* data(handle_type handle) const
+  {
+    return reinterpret_cast<const uint8_t*>(_blocks[handle]);
+  }
+
+  /** Returns the handle of the block data. */
+  handle_type handle(const uint8_t* data) const
+  {
+    return static_cast<handle_type>(reinterpret_cast<const block_type*>(data) - _blocks);
+  }
+
+  /** Whether no blocks are left, a snapshot. */
+  bool empty(void) const
+  {
+    return static_cast<handle_type>(_head) == null_handle;
+  }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  typedef uint32_t block_type[(BlockSize + 3) / 4];
+
+private:
+  pool(const pool&); // inhibit copy
+  pool& operator=(const pool&);
+
+private:
+  static uint32_t tagged(uint32_t head, handle_type handle)
+  {
+    return ((head & 0xffff0000) + 0x10000) | handle;
+  }
+
+private:
+  volatile uint32_t _head;
+  volatile handle_type _next[Count];
+  block_type _blocks[Count];
+};
+
+/** Queue of the frames in the pool blocks.
+ *
+ *  @tparam PoolT Pool type.
+ *  @tparam Capacity Queue capacity, one less frames.
+ *
+ *  Hands complete frames over from the interrupt to the main loop or back
+ *  by the handle, single producer and single consumer as tiny::queue. The
+ *  consumer frees the block. A default built queue, e.g. of an array,
+ *  takes its pool by attach before the use.
+ */
+template <typename PoolT, size_t Capacity>
+class frame_queue
+{
+public:
+  /** Pool type. */
+  typedef PoolT pool_type;
+
+  /** Block handle type. */
+  typedef typename PoolT::handle_type handle_type;
+
+  /** Frame, the block and its used size. */
+  struct frame
+  {
+    handle_type handle;
+    uint16_t size;
+  };
+
+public:
+  frame_queue(void):
+    _pool(nullptr)
+  {
+    // empty
+  }
+
+  explicit frame_queue(pool_type& pool):
+    _pool(&pool)
+  {
+    // empty
+  }
+
+public:
+  /** Takes the pool of the blocks, before the first use. */
+  void attach(pool_type& pool) { _pool = &pool; }
+
+  /** Queues the frame.
+   *
+   *  @return False if full, the block stays with the caller.
+   */
+  bool push(handle_type handle, size_t size)
+  {
+    const frame f = { handle, static_cast<uint16_t>(size) };
+    return _frames.push(f);
+  }
+
+  /** Whether there are no frames. */
+  bool empty(void) const { return _frames.empty(); }
+
+  /** Whether a frame can be queued. */
+  bool can_push(void) const { return _frames.can_push(); }
+
+  /** Returns the first frame, null if empty. */
+  const frame* front(void) const { return _frames.front(); }
+
+  /** Takes the first frame, the block goes to the caller. */
+  frame pop(void) { return _frames.pop(); }
+
+  /** Drops the first frame freeing its block. */
+  void drop(void)
+  {
+    if (!_frames.empty()) { _pool->free(_frames.pop().handle); }
+  }
+
+  /** Returns the pool of the blocks. */
+  pool_type& blocks(void) { return *_pool; }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  frame_queue(const frame_queue&); // inhibit copy
+  frame_queue& operator=(const frame_queue&);
+
+private:
+  pool_type* _pool;
+  queue<frame, Capacity> _frames;
+};
+
+} // namespace tiny
+
+#endif // TINY_POOL_HPP_
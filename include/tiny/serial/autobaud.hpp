@@ -0,0 +1,126 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_AUTOBAUD_HPP_
+#define TINY_SERIAL_AUTOBAUD_HPP_
+
+#include <cstddef>
+#include <stdint.h>
+
+/** The number of the line edges captured for the baud rate detection. */
+#ifndef TINY_SERIAL_AUTOBAUD_EDGES
+# define TINY_SERIAL_AUTOBAUD_EDGES 32
+#endif // TINY_SERIAL_AUTOBAUD_EDGES
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+namespace detail
+{
+
+/** The rates detected, the baud_rate values. */
+static const unsigned long autobaud_rates[] =
+{
+  110, 300, 600, 1200, 2400, 4800, 8738, 9600, 19200, 38400, 57600, 115200, 128000, 256000
+};
+
+} // namespace detail
+
+/** Detects the baud rate by the line edges.
+ *
+ *  @param edges Timestamps of the line level changes, the first one is a
+ *    start bit edge.
+ *  @param count The number of the edges.
+ *  @param ticks_per_second The timestamp clock.
+ *  @param tolerance The largest error to a standard rate in 1/1000.
+ *
+ *  The shortest interval between the edges is taken for a single bit cell,
+ *  so the trace must have an alone bit, e.g. 'U' (0x55) or usual text.
+ *  The cell is refined by the low level runs, the start bit and the zero
+ *  bits after, as the high ones may include the idle line between the
+ *  characters. The rate found snaps to the nearest of the baud_rate values.
+ *
+ *  @return The rate or zero if the trace doesn't fit any.
+ */
+inline unsigned long detect_baud(const uint32_t* edges, size_t count, unsigned long ticks_per_second,
+                                 unsigned long tolerance = 40)
+{
+  if (count < 3) { return 0; }
+
+  uint32_t cell = 0xffffffff;
+  for (size_t i = 1; i < count; ++i)
+  {
+    const uint32_t interval = edges[i] - edges[i - 1];
+    if (interval != 0 && interval < cell) { cell = interval; }
+  }
+
+  // the mean cell over the low runs, the high ones may take the idle line
+  // in, twice as the jittered shortest interval may round the long ones
+  // wrong
+  uint32_t ticks = 0;
+  uint32_t cells = 0;
+  for (size_t pass = 0; pass < 2; ++pass)
+  {
+    ticks = 0;
+    cells = 0;
+    for (size_t i = 1; i < count; i += 2)
+    {
+      const uint32_t interval = edges[i] - edges[i - 1];
+      const uint32_t n        = (interval + cell / 2) / cell;
+      if (n == 0 || n > 10) { continue; }
+
+      ticks += interval;
+      cells += n;
+    }
+
+    if (cells == 0) { return 0; }
+    cell = (ticks + cells / 2) / cells;
+  }
+
+  const unsigned long measured = static_cast<unsigned long>(
+      (static_cast<uint64_t>(ticks_per_second) * cells + ticks / 2) / ticks);
+
+  unsigned long best       = 0;
+  unsigned long best_error = tolerance + 1;
+  for (size_t i = 0; i < sizeof(detail::autobaud_rates) / sizeof(detail::autobaud_rates[0]); ++i)
+  {
+    const unsigned long rate  = detail::autobaud_rates[i];
+    const unsigned long diff  = measured > rate? measured - rate: rate - measured;
+    const unsigned long error = static_cast<unsigned long>(static_cast<uint64_t>(diff) * 1000 / rate);
+    if (error < best_error)
+    {
+      best       = rate;
+      best_error = error;
+    }
+  }
+
+  return best;
+}
+
+/** Returns the line high time proving a character ended, a character
+ *  time: a cell longer than the longest high run within a character, the
+ *  data ones, the parity and the stop bits. The next falling edge is a
+ *  start bit then, the port opens there.
+ *
+ *  @param baud The rate detected.
+ *  @param char_bits The bits of a character, start, data, parity and stop.
+ *  @param ticks_per_second The timestamp clock.
+ */
+inline uint32_t idle_gap(unsigned long baud, unsigned long char_bits, unsigned long ticks_per_second)
+{
+  return static_cast<uint32_t>((static_cast<uint64_t>(ticks_per_second) * char_bits + baud - 1) / baud);
+}
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_AUTOBAUD_HPP_
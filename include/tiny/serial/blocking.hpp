@@ -0,0 +1,176 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_BLOCKING_HPP_
+#define TINY_SERIAL_BLOCKING_HPP_
+
+#include <tiny/detail/auto_sense.hpp>
+#include <tiny/detail/interrupts.hpp>
+
+#if defined (TINY_ARDUINO_MEGA) || defined (TINY_ARDUINO_DUE)
+# include <Arduino.h>
+#else
+# include <chrono>
+# include <thread>
+#endif // TINY_ARDUINO_MEGA || TINY_ARDUINO_DUE
+
+#include <cstddef>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** Default wait policy.
+ *
+ *  Supplies the millisecond clock and the way to idle while waiting. On
+ *  the targets the CPU sleeps until the next interrupt (WFI on Due, idle
+ *  sleep mode on Mega), it's woken up by the port interrupts or the
+ *  system tick at the latest.
+ *
+ *  To drive virtual time in tests use a policy having the same members.
+ */
+struct default_wait_policy
+{
+  /** Time point type, milliseconds. */
+  typedef unsigned long time_type;
+
+  /** Returns the current time. */
+  static time_type now(void)
+  {
+#if defined (TINY_ARDUINO_MEGA) || defined (TINY_ARDUINO_DUE)
+    return millis();
+#else
+    using namespace std::chrono;
+    return static_cast<time_type>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+#endif // TINY_ARDUINO_MEGA || TINY_ARDUINO_DUE
+  }
+
+  /** Idles until something may have changed. */
+  static void idle(void)
+  {
+#if defined (TINY_ARDUINO_MEGA) || defined (TINY_ARDUINO_DUE)
+    ::tiny::detail::wait_for_interrupt();
+#else
+    std::this_thread::yield();
+#endif // TINY_ARDUINO_MEGA || TINY_ARDUINO_DUE
+  }
+};
+
+/** Reads octets waiting for them at most timeout.
+ *
+ *  @tparam WaitPolicyT Wait policy, see default_wait_policy.
+ *  @param uart Uart instance.
+ *  @param data Buffer to read into.
+ *  @param size The size of the buffer.
+ *  @param timeout Timeout in the policy time units.
+ *
+ *  @return Returns the number of octets read, less than size on timeout.
+ */
+template <typename WaitPolicyT, typename UartT>
+inline size_t read(UartT& uart,
+                   typename UartT::octet_type* data,
+                   size_t size,
+                   typename WaitPolicyT::time_type timeout)
+{
+  const typename WaitPolicyT::time_type start = WaitPolicyT::now();
+  size_t n = 0;
+
+  while (n < size)
+  {
+    if (uart.try_read(data[n])) { ++n; continue; }
+    if (WaitPolicyT::now() - start >= timeout) { break; }
+    WaitPolicyT::idle();
+  }
+
+  return n;
+}
+
+/** Reads octets until the delimiter (stored as well) waiting at most timeout.
+ *
+ *  @return Returns the number of octets read including the delimiter.
+ *    If the delimiter is not met either the buffer is full or timed out.
+ */
+template <typename WaitPolicyT, typename UartT>
+inline size_t read_until(UartT& uart,
+                         typename UartT::octet_type* data,
+                         size_t size,
+                         typename UartT::octet_type delim,
+                         typename WaitPolicyT::time_type timeout)
+{
+  const typename WaitPolicyT::time_type start = WaitPolicyT::now();
+  size_t n = 0;
+
+  while (n < size)
+  {
+    if (uart.try_read(data[n]))
+    {
+      if (data[n++] == delim) { break; }
+      continue;
+    }
+    if (WaitPolicyT::now() - start >= timeout) { break; }
+    WaitPolicyT::idle();
+  }
+
+  return n;
+}
+
+/** Writes octets waiting for the room at most timeout.
+ *
+ *  @return Returns the number of octets written, less than size on timeout.
+ */
+template <typename WaitPolicyT, typename UartT, typename OctetT>
+inline size_t write(UartT& uart,
+                    const OctetT* data,
+                    size_t size,
+                    typename WaitPolicyT::time_type timeout)
+{
+  const typename WaitPolicyT::time_type start = WaitPolicyT::now();
+  size_t n = 0;
+
+  while (n < size)
+  {
+    if (uart.async_write(static_cast<typename UartT::octet_type>(data[n]))) { ++n; continue; }
+    if (WaitPolicyT::now() - start >= timeout) { break; }
+    WaitPolicyT::idle();
+  }
+
+  return n;
+}
+
+/** Reads with the default wait policy. */
+template <typename UartT>
+inline size_t read(UartT& uart, typename UartT::octet_type* data, size_t size,
+                   default_wait_policy::time_type timeout)
+{
+  return read<default_wait_policy>(uart, data, size, timeout);
+}
+
+/** Reads until the delimiter with the default wait policy. */
+template <typename UartT>
+inline size_t read_until(UartT& uart, typename UartT::octet_type* data, size_t size,
+                         typename UartT::octet_type delim,
+                         default_wait_policy::time_type timeout)
+{
+  return read_until<default_wait_policy>(uart, data, size, delim, timeout);
+}
+
+/** Writes with the default wait policy. */
+template <typename UartT, typename OctetT>
+inline size_t write(UartT& uart, const OctetT* data, size_t size,
+                    default_wait_policy::time_type timeout)
+{
+  return write<default_wait_policy>(uart, data, size, timeout);
+}
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_BLOCKING_HPP_
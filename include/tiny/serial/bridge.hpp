@@ -0,0 +1,169 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_BRIDGE_HPP_
+#define TINY_SERIAL_BRIDGE_HPP_
+
+#include <cstddef>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** One way port to port forwarding in the receive interrupt.
+ *
+ *  @tparam FromPortT Source port type, basic_uart or any having on_rx and
+ *    readable/consume.
+ *  @tparam ToPortT Destination port type, basic_uart or any having
+ *    async_write.
+ *
+ *  The source rx hook writes every octet straight into the destination
+ *  transmit path, so an octet is neither buffered twice nor waits for the
+ *  main loop. If the destination buffer is full the octet stays in the
+ *  source receive buffer and so do the next ones till poll moves them, the
+ *  order is kept and the source buffer is the backpressure reserve. The
+ *  optional filter translates octets, e.g. 9 to 8 data bits, or drops them.
+ *
+ *  @note The source rx interrupt must not be of higher priority than the
+ *    destination one and nothing else may write into the destination. Use
+ *    two bridges for both ways.
+ */
+template <typename FromPortT, typename ToPortT>
+class bridge
+{
+public:
+  /** Source port type. */
+  typedef FromPortT from_port_type;
+
+  /** Destination port type. */
+  typedef ToPortT to_port_type;
+
+  /** Source octet type. */
+  typedef typename from_port_type::octet_type from_octet_type;
+
+  /** Destination octet type. */
+  typedef typename to_port_type::octet_type to_octet_type;
+
+  /** Filter, translates the octet into out or returns false to drop it.
+   *  Runs in the source rx interrupt.
+   */
+  typedef bool (*filter_type)(from_octet_type octet, to_octet_type& out, void* context);
+
+public:
+  bridge(from_port_type& from, to_port_type& to):
+    _from(from),
+    _to(to),
+    _filter(nullptr),
+    _context(nullptr),
+    _stalled(false),
+    _dropped(0)
+  {
+    // empty
+  }
+
+  ~bridge(void)
+  {
+    close();
+  }
+
+public:
+  /** Sets the filter, pass nullptr to forward the octets as they are
+   *  (the 9th bit is cut for a 8 bit destination). Call it while closed.
+   */
+  void filter(filter_type handler, void* context = nullptr)
+  {
+    _filter  = handler;
+    _context = context;
+  }
+
+  /** Starts forwarding, takes over the source rx hook. */
+  void open(void)
+  {
+    _from.on_rx(&bridge::forward, this);
+  }
+
+  /** Stops forwarding, the octets received are buffered by the source. */
+  void close(void)
+  {
+    _from.on_rx(nullptr);
+  }
+
+  /** Moves the octets held back by the destination buffer being full,
+   *  call it from the main loop.
+   *
+   *  @return Whether everything is forwarded.
+   */
+  bool poll(void)
+  {
+    const from_octet_type* data = nullptr;
+    for (size_t n = _from.readable(data); n != 0; n = _from.readable(data))
+    {
+      size_t i = 0;
+      for (; i < n && pass(data[i]); ++i) { }
+
+      // consumed after written, the hook sees the backlog till it is empty
+      _from.consume(i);
+      if (i != n) { return false; }
+    }
+
+    return true;
+  }
+
+  /** Whether the last octet received is held back in the source buffer. */
+  bool stalled(void) const { return _stalled; }
+
+  /** Returns the number of the octets dropped by the filter. */
+  size_t dropped(void) const { return _dropped; }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  bridge(const bridge&); // inhibit copy
+  bridge& operator=(const bridge&);
+
+private:
+  static bool forward(from_octet_type octet, void* context)
+  {
+    bridge* self = static_cast<bridge*>(context);
+
+    // behind the backlog the octet is buffered to keep the order
+    const from_octet_type* data = nullptr;
+    self->_stalled = self->_from.readable(data) != 0 || !self->pass(octet);
+    return !self->_stalled;
+  }
+
+  //-----------------------------------------------------------------------------
+  bool pass(from_octet_type octet)
+  {
+    to_octet_type out = static_cast<to_octet_type>(octet);
+    if (_filter != nullptr && !_filter(octet, out, _context))
+    {
+      ++_dropped;
+      return true;
+    }
+
+    return _to.async_write(out);
+  }
+
+private:
+  from_port_type& _from;
+  to_port_type& _to;
+  filter_type _filter;
+  void* _context;
+  volatile bool _stalled;
+  volatile size_t _dropped;
+};
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_BRIDGE_HPP_
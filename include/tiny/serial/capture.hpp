@@ -0,0 +1,393 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_CAPTURE_HPP_
+#define TINY_SERIAL_CAPTURE_HPP_
+
+#include <tiny/container.hpp>
+#include <tiny/detail/interrupts.hpp>
+
+#include <cstddef>
+#include <stdint.h>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** Traffic capture log, a ring of the octets passing a port.
+ *
+ *  A record is a tag, the time since the previous record (0, 1, 2 or 4
+ *  octets, LE) and the octet:
+ *  - tag bit 0, the direction, see capture_direction;
+ *  - tag bit 1, the 9th bit;
+ *  - tag bits 2..3, the time size code, 0, 1, 2 and 4 octets;
+ *  - tag bit 4, records lost before this one, the ring was full.
+ *
+ *  The port records with the interrupts masked, around the data register
+ *  access and the clock read, so the records of the interrupt handler,
+ *  the octets written directly and the bridges writing in keep the line
+ *  order. The dump side is a single other context, see readable and
+ *  consume, it takes the indices masked as they are wider than a store on
+ *  AVR. The records are whole or none.
+ */
+class capture_log
+{
+public:
+  /** Traffic direction. */
+  enum capture_direction
+  {
+    rx = 0, /**< Received. */
+    tx = 1  /**< Sent. */
+  };
+
+  /** Tag bits. */
+  enum
+  {
+    tag_tx         = 0x01,
+    tag_ninth      = 0x02,
+    tag_time_shift = 2,
+    tag_time_mask  = 0x0c,
+    tag_lost       = 0x10,
+    max_record     = 6
+  };
+
+public:
+  /** Creates the log on the buffer.
+   *
+   *  @param buffer The ring storage, one octet stays unused.
+   *  @param size The ring size.
+   */
+  capture_log(uint8_t* buffer, size_t size):
+    _buffer(buffer),
+    _size(size),
+    _head(0),
+    _tail(0),
+    _last(0),
+    _lost(0),
+    _started(false)
+  {
+    // empty
+  }
+
+public:
+  /** Records the octet, the interrupts masked.
+   *
+   *  @param time The port clock, ticks.
+   */
+  void record(capture_direction dir, uint16_t octet, uint32_t time)
+  {
+    const uint32_t delta = _started? time - _last: 0;
+    const uint8_t code   = delta == 0? 0: delta <= 0xff? 1: delta <= 0xffff? 2: 3;
+    const size_t bytes   = code == 3? 4: code;
+
+    if (room() < bytes + 2)
+    {
+      ++_lost;
+      return;
+    }
+
+    uint8_t tag = static_cast<uint8_t>(dir | code << tag_time_shift);
+    if ((octet & 0x100) != 0) { tag |= tag_ninth; }
+    if (_lost != 0)           { tag |= tag_lost; }
+
+    size_t head = _head;
+    put(head, tag);
+    for (size_t i = 0; i < bytes; ++i) { put(head, static_cast<uint8_t>(delta >> (8 * i))); }
+    put(head, static_cast<uint8_t>(octet));
+
+    ::tiny::detail::compiler_barrier();
+    _head    = head;
+    _last    = time;
+    _lost    = 0;
+    _started = true;
+  }
+
+  /** Returns the contiguous octets logged, the rest if any follows the
+   *  ring wrap. Records may span the wrap.
+   */
+  size_t readable(const uint8_t*& data) const
+  {
+    size_t head;
+    {
+      ::tiny::detail::interrupt_guard guard;
+      head = _head;
+    }
+    const size_t tail = _tail;
+    data              = _buffer + tail;
+    return head >= tail? head - tail: _size - tail;
+  }
+
+  /** Removes n octets returned by readable. */
+  void consume(size_t n)
+  {
+    size_t tail = _tail + n;
+    if (tail >= _size) { tail -= _size; }
+    ::tiny::detail::interrupt_guard guard;
+    _tail = tail;
+  }
+
+  /** Returns the records lost since the last one logged. */
+  size_t lost(void) const { return _lost; }
+
+  /** Drops the octets logged, the next record starts the time over. */
+  void clear(void)
+  {
+    ::tiny::detail::interrupt_guard guard;
+    _head    = _tail = 0;
+    _lost    = 0;
+    _started = false;
+  }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  capture_log(const capture_log&); // inhibit copy
+  capture_log& operator=(const capture_log&);
+
+private:
+  size_t room(void) const
+  {
+    const size_t head = _head;
+    const size_t tail = _tail;
+    return head >= tail? _size - 1 - (head - tail): tail - head - 1;
+  }
+
+  //-----------------------------------------------------------------------------
+  void put(size_t& head, uint8_t octet)
+  {
+    _buffer[head] = octet;
+    if (++head == _size) { head = 0; }
+  }
+
+private:
+  uint8_t* _buffer;
+  size_t _size;
+  volatile size_t _head;
+  volatile size_t _tail;
+  uint32_t _last;
+  size_t _lost;
+  bool _started;
+};
+
+/** Capture log owning its ring.
+ *
+ *  @tparam Size The ring size.
+ */
+template <size_t Size>
+class capture_ring : public capture_log
+{
+public:
+  capture_ring(void): capture_log(_storage, Size) { }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  uint8_t _storage[Size];
+};
+
+/** Capture log record decoded. */
+struct capture_event
+{
+  uint32_t time;  /**< Ticks since the first record. */
+  uint16_t octet; /**< The octet with the 9th bit. */
+  uint8_t dir;    /**< capture_log::rx or capture_log::tx. */
+  bool lost;      /**< Records were lost before this one. */
+};
+
+/** Incremental decoder of the capture log octets. */
+class capture_reader
+{
+public:
+  capture_reader(void): _time(0), _size(0), _need(1) { }
+
+public:
+  /** Takes the next octet of the log.
+   *
+   *  @return True if a record is complete, it's returned then.
+   */
+  bool feed(uint8_t octet, capture_event& event)
+  {
+    _record[_size++] = octet;
+    if (_size == 1)
+    {
+      const uint8_t code = (octet & capture_log::tag_time_mask) >> capture_log::tag_time_shift;
+      _need              = 2 + (code == 3? 4: code);
+    }
+    if (_size < _need) { return false; }
+
+    const uint8_t tag = _record[0];
+    uint32_t delta    = 0;
+    for (size_t i = _need - 2; i > 0; --i) { delta = delta << 8 | _record[i]; }
+
+    _time       += delta;
+    event.time  = _time;
+    event.octet = static_cast<uint16_t>(_record[_need - 1] | ((tag & capture_log::tag_ninth) != 0? 0x100: 0));
+    event.dir   = tag & capture_log::tag_tx;
+    event.lost  = (tag & capture_log::tag_lost) != 0;
+    _size       = 0;
+    return true;
+  }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  uint32_t _time;
+  uint8_t _record[capture_log::max_record];
+  size_t _size;
+  size_t _need;
+};
+
+/** Replays a capture log into a port.
+ *
+ *  @tparam PortT Port type having receive(octet), the rx interrupt, e.g.
+ *    the host simulated ones.
+ *
+ *  The received octets are delivered at their times divided by the speed
+ *  up, the sent ones are expected from the port in order, see check.
+ */
+template <typename PortT>
+class replayer
+{
+public:
+  /** Port type. */
+  typedef PortT port_type;
+
+public:
+  /** Creates the replayer.
+   *
+   *  @param log The log octets, the whole records.
+   *  @param speedup Time divider, 1 plays the original timing, zero
+   *    delivers everything on the first poll.
+   */
+  replayer(port_type& port, const uint8_t* log, size_t size, uint32_t speedup = 1):
+    _port(port),
+    _log(log),
+    _size(size),
+    _offset(0),
+    _speedup(speedup),
+    _pending(false),
+    _delivered(0),
+    _mismatches(0),
+    _lost(0),
+    _event()
+  {
+    // empty
+  }
+
+public:
+  /** Delivers the received octets due.
+   *
+   *  @param elapsed Time since the start of the replay, the log ticks.
+   *  @return The number of the octets delivered.
+   */
+  size_t poll(uint32_t elapsed)
+  {
+    size_t n = 0;
+    for (;;)
+    {
+      if (!_pending && !next()) { break; }
+      if (_event.dir == capture_log::tx)
+      {
+        // kept for check, the later rx octets wait
+        if (_expected.can_push()) { _expected.push(_event.octet); _pending = false; continue; }
+        break;
+      }
+      if (_speedup != 0 && _event.time / _speedup > elapsed) { break; }
+
+      _port.receive(static_cast<typename port_type::octet_type>(_event.octet));
+      _pending = false;
+      ++_delivered;
+      ++n;
+    }
+
+    return n;
+  }
+
+  /** Compares the octet the port sent with the captured one.
+   *
+   *  @return False if it differs or nothing more was captured.
+   */
+  bool check(uint16_t octet)
+  {
+    if (_expected.empty())
+    {
+      // the port is ahead of the log
+      if (!_pending && !next()) { ++_mismatches; return false; }
+      if (_event.dir != capture_log::tx) { ++_mismatches; return false; }
+      _expected.push(_event.octet);
+      _pending = false;
+    }
+
+    if (_expected.pop() == octet) { return true; }
+
+    ++_mismatches;
+    return false;
+  }
+
+  /** Whether every record is delivered or expected. */
+  bool done(void) const { return !_pending && _offset == _size; }
+
+  /** Returns the log time of the next octet due, ticks. */
+  uint32_t next_time(void) const { return _event.time; }
+
+  /** Returns the number of the octets delivered. */
+  size_t delivered(void) const { return _delivered; }
+
+  /** Returns the number of the sent octets differing from the log. */
+  size_t mismatches(void) const { return _mismatches; }
+
+  /** Returns the number of the records marked as following lost ones. */
+  size_t lost(void) const { return _lost; }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  replayer(const replayer&); // inhibit copy
+  replayer& operator=(const replayer&);
+
+private:
+  bool next(void)
+  {
+    while (_offset < _size)
+    {
+      if (!_reader.feed(_log[_offset++], _event)) { continue; }
+
+      if (_event.lost) { ++_lost; }
+      _pending = true;
+      return true;
+    }
+
+    return false;
+  }
+
+private:
+  port_type& _port;
+  const uint8_t* _log;
+  size_t _size;
+  size_t _offset;
+  uint32_t _speedup;
+  bool _pending;
+  size_t _delivered;
+  size_t _mismatches;
+  size_t _lost;
+  capture_reader _reader;
+  capture_event _event;
+  queue<uint16_t, 64> _expected;
+};
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_CAPTURE_HPP_
@@ -11,79 +11,41 @@
 namespace detail
 {
 
-/** Generic instance factory declaration. */
-template <port_kind Kind, port_num Num> inline basic_uart<Kind>& uart_instance(void);
-
-/** Returns a reference to uart0, 8bit max. */
-template <> inline basic_uart<port_kind::usual>& uart_instance<port_kind::usual, port_num::com0>(void)
-{
-#if defined(UBRRH) && defined(UBRRL)
-	static basic_uart<port_kind::usual> port(iocs_registers(&UBRRH, &UBRRL, &UCSRA, &UCSRB, &UCSRC, &UDR));
-#else
-	static basic_uart<port_kind::usual> port(iocs_registers(&UBRR0H, &UBRR0L, &UCSR0A, &UCSR0B, &UCSR0C, &UDR0));
-#endif
-
-	return port;
-}
-
-/** Returns a reference to uart1, 8bit max. */
-template <> inline basic_uart<port_kind::usual>& uart_instance<port_kind::usual, port_num::com1>(void)
-{
-	static basic_uart<port_kind::usual> port(iocs_registers(&UBRR1H, &UBRR1L, &UCSR1A, &UCSR1B, &UCSR1C, &UDR1));
-
-	return port;
-}
-
-/** Returns a reference to uart2, 8bit max. */
-template <> inline basic_uart<port_kind::usual>& uart_instance<port_kind::usual, port_num::com2>(void)
-{
-	static basic_uart<port_kind::usual> port(iocs_registers(&UBRR2H, &UBRR2L, &UCSR2A, &UCSR2B, &UCSR2C, &UDR2));
-
-	return port;
-}
-
-/** Returns a reference to uart3, 8bit max. */
-template <> inline basic_uart<port_kind::usual>& uart_instance<port_kind::usual, port_num::com3>(void)
+/** Returns the registers of the port, given for the ports the MCU has. */
+template <port_num Num> inline iocs_registers port_registers(void)
 {
-	static basic_uart<port_kind::usual> port(iocs_registers(&UBRR3H, &UBRR3L, &UCSR3A, &UCSR3B, &UCSR3C, &UDR3));
-
-	return port;
+	return fixed_registers<Num>::bundle();
 }
 
-/** Returns a reference to uart0, 9bit max. */
-template <> inline basic_uart<port_kind::extended>& uart_instance<port_kind::extended, port_num::com0>(void)
+/** The registers policy of the port, fixed or given at run time. */
+template <port_num Num, bool Fixed>
+struct select_registers
 {
-#if defined(UBRRH) && defined(UBRRL)
-	static basic_uart<port_kind::extended> port(iocs_registers(&UBRRH, &UBRRL, &UCSRA, &UCSRB, &UCSRC, &UDR));
-#else
-	static basic_uart<port_kind::extended> port(iocs_registers(&UBRR0H, &UBRR0L, &UCSR0A, &UCSR0B, &UCSR0C, &UDR0));
-#endif
+	typedef runtime_registers type;
 
-	return port;
-}
+	static type make(void) { return type(port_registers<Num>()); }
+};
 
-/** Returns a reference to uart1, 9bit max. */
-template <> inline basic_uart<port_kind::extended>& uart_instance<port_kind::extended, port_num::com1>(void)
+template <port_num Num>
+struct select_registers<Num, true>
 {
-	static basic_uart<port_kind::extended> port(iocs_registers(&UBRR1H, &UBRR1L, &UCSR1A, &UCSR1B, &UCSR1C, &UDR1));
+	typedef fixed_registers<Num> type;
 
-	return port;
-}
+	static type make(void) { return type(); }
+};
 
-/** Returns a reference to uart2, 9bit max. */
-template <> inline basic_uart<port_kind::extended>& uart_instance<port_kind::extended, port_num::com2>(void)
+/** Returns a reference to the uart of the port, built on the first use. */
+template <typename UartT, port_num Num> inline UartT& port_instance(void)
 {
-	static basic_uart<port_kind::extended> port(iocs_registers(&UBRR2H, &UBRR2L, &UCSR2A, &UCSR2B, &UCSR2C, &UDR2));
+	static UartT port(select_registers<Num, UartT::registers_type::fixed>::make());
 
 	return port;
 }
 
-/** Returns a reference to uart3, 9bit max. */
-template <> inline basic_uart<port_kind::extended>& uart_instance<port_kind::extended, port_num::com3>(void)
+/** Returns a reference to the uart of the port kind with the default buffers. */
+template <port_kind Kind, port_num Num> inline basic_uart<Kind>& uart_instance(void)
 {
-	static basic_uart<port_kind::extended> port(iocs_registers(&UBRR3H, &UBRR3L, &UCSR3A, &UCSR3B, &UCSR3C, &UDR3));
-
-	return port;
+	return port_instance<basic_uart<Kind>, Num>();
 }
 
 } // namespace detail
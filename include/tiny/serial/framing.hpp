@@ -0,0 +1,517 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_FRAMING_HPP_
+#define TINY_SERIAL_FRAMING_HPP_
+
+#include <cstddef>
+#include <stdint.h>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+// Encoders write straight into the free room of a ring and decoders read
+// straight from its filled part, the ring is tiny::queue or basic_uart,
+// anything having writable/commit and readable/consume. Both keep their
+// state between poll calls so a frame may take any number of them.
+
+/** Streaming COBS encoder, the frame is terminated by zero. */
+class cobs_encoder
+{
+public:
+  cobs_encoder(void):
+    _data(nullptr),
+    _size(0),
+    _pos(0),
+    _left(0),
+    _full(false),
+    _state(st_idle)
+  {
+    // empty
+  }
+
+public:
+  /** Starts encoding the frame, the data must live till poll returns true. */
+  void begin(const uint8_t* data, size_t size)
+  {
+    _data  = data;
+    _size  = size;
+    _pos   = 0;
+    _left  = 0;
+    _full  = false;
+    _state = st_code;
+  }
+
+  /** Whether the frame isn't encoded completely yet. */
+  bool busy(void) const { return _state != st_idle; }
+
+  /** Encodes the frame into the buffer.
+   *
+   *  @return The number of the octets written.
+   */
+  size_t encode(uint8_t* out, size_t room)
+  {
+    size_t n = 0;
+
+    while (n < room && _state != st_idle)
+    {
+      switch (_state)
+      {
+      case st_code:
+      {
+        // a full block at the end has no zero to encode
+        if (_pos == _size && _full) { _state = st_end; break; }
+
+        const size_t limit = _size - _pos < 254? _size - _pos: 254;
+        size_t run         = 0;
+        while (run < limit && _data[_pos + run] != 0) { ++run; }
+
+        out[n++] = static_cast<uint8_t>(run + 1);
+        _left    = run;
+        _full    = run == 254;
+        _state   = st_data;
+        break;
+      }
+
+      case st_data:
+      {
+        const size_t chunk = _left < room - n? _left: room - n;
+        for (size_t i = 0; i < chunk; ++i) { out[n++] = _data[_pos++]; }
+        _left -= chunk;
+
+        if (_left != 0) { break; }
+        if (_full) { _state = st_code; break; }
+        if (_pos == _size) { _state = st_end; break; }
+
+        ++_pos; // the zero is encoded by the block code
+        _state = st_code;
+        break;
+      }
+
+      default:
+        out[n++] = 0;
+        _state   = st_idle;
+        break;
+      }
+    }
+
+    return n;
+  }
+
+  /** Encodes into the ring as much as fits.
+   *
+   *  @return True if the whole frame is written.
+   */
+  template <typename RingT>
+  bool poll(RingT& ring)
+  {
+    for (int i = 0; i < 2 && busy(); ++i)
+    {
+      uint8_t* out      = nullptr;
+      const size_t room = ring.writable(out);
+      if (room == 0) { break; }
+      ring.commit(encode(out, room));
+    }
+
+    return !busy();
+  }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  enum state { st_idle, st_code, st_data, st_end };
+
+private:
+  const uint8_t* _data;
+  size_t _size;
+  size_t _pos;
+  size_t _left;
+  bool _full;
+  state _state;
+};
+
+/** Streaming COBS decoder.
+ *
+ *  @tparam MaxFrame The largest decoded frame.
+ *
+ *  Malformed and too long frames are dropped and counted.
+ */
+template <size_t MaxFrame>
+class cobs_decoder
+{
+public:
+  /** The largest decoded frame. */
+  enum { max_frame = MaxFrame };
+
+public:
+  cobs_decoder(void):
+    _size(0),
+    _left(0),
+    _code(0),
+    _zero(false),
+    _error(false),
+    _ready(false),
+    _errors(0)
+  {
+    // empty
+  }
+
+public:
+  /** Decodes the octets till the end of the frame.
+   *
+   *  @return The number of the octets consumed, less than size if a
+   *    frame is ready.
+   */
+  size_t feed(const uint8_t* data, size_t size)
+  {
+    size_t i = 0;
+
+    while (i < size && !_ready)
+    {
+      const uint8_t octet = data[i++];
+
+      if (octet == 0) { end_frame(); continue; }
+
+      if (_left == 0)
+      {
+        // the previous block ends by zero unless it's the last one
+        if (_zero) { put(0); }
+        _code = octet;
+        _left = static_cast<uint8_t>(octet - 1);
+        _zero = octet != 0xff;
+        continue;
+      }
+
+      put(octet);
+      --_left;
+    }
+
+    return i;
+  }
+
+  /** Decodes the octets available in the ring.
+   *
+   *  @return True if a frame is ready.
+   */
+  template <typename RingT>
+  bool poll(RingT& ring)
+  {
+    for (int i = 0; i < 2 && !_ready; ++i)
+    {
+      const uint8_t* data = nullptr;
+      const size_t size   = ring.readable(data);
+      if (size == 0) { break; }
+      ring.consume(feed(data, size));
+    }
+
+    return _ready;
+  }
+
+  /** Whether a frame is ready. */
+  bool ready(void) const { return _ready; }
+
+  /** Returns the frame decoded. */
+  const uint8_t* frame(void) const { return _frame; }
+
+  /** Returns the frame size. */
+  size_t size(void) const { return _size; }
+
+  /** Releases the frame, decoding goes on. */
+  void next(void)
+  {
+    _size  = 0;
+    _ready = false;
+  }
+
+  /** Returns the number of the frames dropped. */
+  size_t errors(void) const { return _errors; }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  void put(uint8_t octet)
+  {
+    if (_size < MaxFrame) { _frame[_size++] = octet; }
+    else { _error = true; }
+  }
+
+  //-----------------------------------------------------------------------------
+  void end_frame(void)
+  {
+    if (_code != 0)
+    {
+      if (_error || _left != 0) { ++_errors; _size = 0; }
+      else { _ready = true; }
+    }
+
+    _left  = 0;
+    _code  = 0;
+    _zero  = false;
+    _error = false;
+  }
+
+private:
+  uint8_t _frame[MaxFrame];
+  size_t _size;
+  uint8_t _left;
+  uint8_t _code;
+  bool _zero;
+  bool _error;
+  bool _ready;
+  size_t _errors;
+};
+
+/** SLIP special octets, RFC 1055. */
+enum slip_octet
+{
+  slip_end     = 0xc0,
+  slip_esc     = 0xdb,
+  slip_esc_end = 0xdc,
+  slip_esc_esc = 0xdd
+};
+
+/** Streaming SLIP encoder, the frame is terminated by END. */
+class slip_encoder
+{
+public:
+  slip_encoder(void):
+    _data(nullptr),
+    _size(0),
+    _pos(0),
+    _escaped(0),
+    _state(st_idle)
+  {
+    // empty
+  }
+
+public:
+  /** Starts encoding the frame, the data must live till poll returns true. */
+  void begin(const uint8_t* data, size_t size)
+  {
+    _data  = data;
+    _size  = size;
+    _pos   = 0;
+    _state = st_data;
+  }
+
+  /** Whether the frame isn't encoded completely yet. */
+  bool busy(void) const { return _state != st_idle; }
+
+  /** Encodes the frame into the buffer.
+   *
+   *  @return The number of the octets written.
+   */
+  size_t encode(uint8_t* out, size_t room)
+  {
+    size_t n = 0;
+
+    while (n < room && _state != st_idle)
+    {
+      switch (_state)
+      {
+      case st_data:
+      {
+        if (_pos == _size) { _state = st_end; break; }
+
+        const uint8_t octet = _data[_pos];
+        if (octet == slip_end || octet == slip_esc)
+        {
+          out[n++] = slip_esc;
+          _escaped = octet == slip_end? slip_esc_end: slip_esc_esc;
+          _state   = st_escape;
+          ++_pos;
+          break;
+        }
+
+        while (n < room && _pos < _size && _data[_pos] != slip_end && _data[_pos] != slip_esc)
+        {
+          out[n++] = _data[_pos++];
+        }
+        break;
+      }
+
+      case st_escape:
+        out[n++] = _escaped;
+        _state   = st_data;
+        break;
+
+      default:
+        out[n++] = slip_end;
+        _state   = st_idle;
+        break;
+      }
+    }
+
+    return n;
+  }
+
+  /** Encodes into the ring as much as fits.
+   *
+   *  @return True if the whole frame is written.
+   */
+  template <typename RingT>
+  bool poll(RingT& ring)
+  {
+    for (int i = 0; i < 2 && busy(); ++i)
+    {
+      uint8_t* out      = nullptr;
+      const size_t room = ring.writable(out);
+      if (room == 0) { break; }
+      ring.commit(encode(out, room));
+    }
+
+    return !busy();
+  }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  enum state { st_idle, st_data, st_escape, st_end };
+
+private:
+  const uint8_t* _data;
+  size_t _size;
+  size_t _pos;
+  uint8_t _escaped;
+  state _state;
+};
+
+/** Streaming SLIP decoder.
+ *
+ *  @tparam MaxFrame The largest decoded frame.
+ *
+ *  Empty frames are skipped, malformed and too long ones are dropped and
+ *  counted.
+ */
+template <size_t MaxFrame>
+class slip_decoder
+{
+public:
+  /** The largest decoded frame. */
+  enum { max_frame = MaxFrame };
+
+public:
+  slip_decoder(void):
+    _size(0),
+    _escape(false),
+    _error(false),
+    _ready(false),
+    _errors(0)
+  {
+    // empty
+  }
+
+public:
+  /** Decodes the octets till the end of the frame.
+   *
+   *  @return The number of the octets consumed, less than size if a
+   *    frame is ready.
+   */
+  size_t feed(const uint8_t* data, size_t size)
+  {
+    size_t i = 0;
+
+    while (i < size && !_ready)
+    {
+      const uint8_t octet = data[i++];
+
+      if (octet == slip_end) { end_frame(); continue; }
+
+      if (_escape)
+      {
+        _escape = false;
+        if (octet == slip_esc_end) { put(slip_end); }
+        else if (octet == slip_esc_esc) { put(slip_esc); }
+        else { _error = true; }
+        continue;
+      }
+
+      if (octet == slip_esc) { _escape = true; }
+      else { put(octet); }
+    }
+
+    return i;
+  }
+
+  /** Decodes the octets available in the ring.
+   *
+   *  @return True if a frame is ready.
+   */
+  template <typename RingT>
+  bool poll(RingT& ring)
+  {
+    for (int i = 0; i < 2 && !_ready; ++i)
+    {
+      const uint8_t* data = nullptr;
+      const size_t size   = ring.readable(data);
+      if (size == 0) { break; }
+      ring.consume(feed(data, size));
+    }
+
+    return _ready;
+  }
+
+  /** Whether a frame is ready. */
+  bool ready(void) const { return _ready; }
+
+  /** Returns the frame decoded. */
+  const uint8_t* frame(void) const { return _frame; }
+
+  /** Returns the frame size. */
+  size_t size(void) const { return _size; }
+
+  /** Releases the frame, decoding goes on. */
+  void next(void)
+  {
+    _size  = 0;
+    _ready = false;
+  }
+
+  /** Returns the number of the frames dropped. */
+  size_t errors(void) const { return _errors; }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  void put(uint8_t octet)
+  {
+    if (_size < MaxFrame) { _frame[_size++] = octet; }
+    else { _error = true; }
+  }
+
+  //-----------------------------------------------------------------------------
+  void end_frame(void)
+  {
+    if (_error || _escape) { ++_errors; _size = 0; }
+    else if (_size != 0) { _ready = true; }
+
+    _escape = false;
+    _error  = false;
+  }
+
+private:
+  uint8_t _frame[MaxFrame];
+  size_t _size;
+  bool _escape;
+  bool _error;
+  bool _ready;
+  size_t _errors;
+};
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_FRAMING_HPP_
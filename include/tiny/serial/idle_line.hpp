@@ -0,0 +1,188 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_IDLE_LINE_HPP_
+#define TINY_SERIAL_IDLE_LINE_HPP_
+
+#include <tiny/container.hpp>
+
+#include <cstddef>
+#include <stdint.h>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** Idle line frame delimiter.
+ *
+ *  @tparam MaxFrames The number of complete frames kept.
+ *  @tparam LengthT Frame length type.
+ *
+ *  Counts the octets buffered by the rx interrupt and records the frame
+ *  length once the line is silent for the threshold. The silence is either
+ *  reported by a hardware receiver timeout (on_idle) or found by comparing
+ *  octet arrival times taken in the interrupt (on_octet(now), poll(now)).
+ *
+ *  If there is no room for the frame length the frame is merged with the
+ *  following one.
+ */
+template <size_t MaxFrames = 4, typename LengthT = uint16_t>
+class idle_line_detector
+{
+public:
+  /** Frame length type. */
+  typedef LengthT length_type;
+
+  /** Time type, e.g. microseconds, wraps around. */
+  typedef uint32_t time_type;
+
+public:
+  /** Creates disabled detector. */
+  idle_line_detector(void):
+    _threshold(0),
+    _octet_time(0),
+    _last(0),
+    _length(0),
+    _enabled(false)
+  {
+    // empty
+  }
+
+public:
+  /** Enables the detector.
+   *
+   *  @param threshold Silence time closing the frame, zero if it's
+   *    measured by hardware.
+   *  @param octet_time The time of an octet on the line, the arrival
+   *    times are taken at the octet end.
+   */
+  void enable(time_type threshold = 0, time_type octet_time = 0)
+  {
+    _threshold  = threshold;
+    _octet_time = octet_time;
+    _enabled   = true;
+    reset();
+  }
+
+  /** Drops the frames recorded and the partial one. */
+  void reset(void)
+  {
+    _length = 0;
+    _frames.clear();
+  }
+
+  /** Disables the detector. */
+  void disable(void) { _enabled = false; }
+
+  /** Whether enabled. */
+  bool enabled(void) const { return _enabled; }
+
+  /** Whether the silence is measured by arrival times. */
+  bool timed(void) const { return _threshold != 0; }
+
+  /** Returns the silence time closing the frame. */
+  time_type threshold(void) const { return _threshold; }
+
+  /** Returns the time left until the silence since the last octet closes
+   *  the frame, zero once it's due.
+   */
+  time_type silence_left(time_type now) const
+  {
+    const time_type gap = now - _last;
+    return gap < _threshold? _threshold - gap: 0;
+  }
+
+  /** Whether a frame is being received, some octets counted. */
+  bool in_frame(void) const { return _length != 0; }
+
+  /** Counts an octet buffered, the interrupt context. */
+  void on_octet(void)
+  {
+    ++_length;
+  }
+
+  /** Counts an octet buffered at the given time, the interrupt context.
+   *
+   *  @return True if the previous frame has been recorded.
+   */
+  bool on_octet(time_type now)
+  {
+    const bool closed = _length != 0 && now - _last >= _threshold + _octet_time && close();
+
+    _last = now;
+    ++_length;
+    return closed;
+  }
+
+  /** Closes the frame on the line silence reported.
+   *
+   *  @return True if a frame has been recorded.
+   */
+  bool on_idle(void)
+  {
+    return _length != 0 && close();
+  }
+
+  /** Closes the trailing frame if the line is silent long enough since
+   *  the last octet. Must not be preempted by on_octet.
+   *
+   *  @return True if a frame has been recorded.
+   */
+  bool poll(time_type now)
+  {
+    return _length != 0 && now - _last >= _threshold && close();
+  }
+
+  /** Whether a complete frame is available. */
+  bool frame_ready(void) const
+  {
+    return !_frames.empty();
+  }
+
+  /** Returns the length of the oldest complete frame and removes it. */
+  length_type pop_frame(void)
+  {
+    return _frames.pop();
+  }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  bool close(void)
+  {
+    const length_type length = _length;
+    if (!_frames.push(length)) { return false; }
+
+    _length = 0;
+    return true;
+  }
+
+private:
+  time_type _threshold;
+  time_type _octet_time;
+  time_type _last;
+  volatile length_type _length;
+  volatile bool _enabled;
+  queue<length_type, MaxFrames + 1> _frames;
+};
+
+/** Returns the time of the bits given at the baud rate in microseconds, at least one. */
+inline uint32_t bit_times_us(unsigned long bits, unsigned long baud_rate)
+{
+  const uint32_t us = static_cast<uint32_t>((bits * 1000000ul + baud_rate - 1) / baud_rate);
+  return us != 0? us: 1;
+}
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_IDLE_LINE_HPP_
@@ -0,0 +1,197 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_LATENCY_HPP_
+#define TINY_SERIAL_LATENCY_HPP_
+
+#include <cstddef>
+#include <stdint.h>
+
+/** Queueing delay statistics of the ports, 0 - off, 1 - on. */
+#ifndef TINY_SERIAL_LATENCY_STATS
+# define TINY_SERIAL_LATENCY_STATS 0
+#endif // TINY_SERIAL_LATENCY_STATS
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** Histogram of the values by powers of two.
+ *
+ *  @tparam Buckets The number of the buckets.
+ *
+ *  Bucket 0 counts zeros, bucket i counts the values of i significant bits,
+ *  [2^(i-1), 2^i), the last one takes everything above too.
+ */
+template <size_t Buckets = 16>
+class log2_histogram
+{
+public:
+  /** The number of the buckets. */
+  enum { buckets = Buckets };
+
+public:
+  log2_histogram(void) { reset(); }
+
+public:
+  /** Counts the value. */
+  void add(uint32_t value)
+  {
+    size_t bucket = 0;
+    for (uint32_t v = value; v != 0 && bucket < Buckets - 1; v >>= 1) { ++bucket; }
+
+    ++_counts[bucket];
+    if (value > _max) { _max = value; }
+  }
+
+  /** Returns the count of the bucket. */
+  uint32_t count(size_t bucket) const { return _counts[bucket]; }
+
+  /** Returns the values counted. */
+  uint32_t total(void) const
+  {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < Buckets; ++i) { sum += _counts[i]; }
+    return sum;
+  }
+
+  /** Returns the largest value counted. */
+  uint32_t max(void) const { return _max; }
+
+  /** Returns the exclusive upper bound of the bucket, the last one has none. */
+  static uint32_t upper(size_t bucket) { return static_cast<uint32_t>(1) << bucket; }
+
+  /** Returns the upper bound of the bucket the given share of the values
+   *  fits into, e.g. 99 per 100, the largest value if it's the last one.
+   */
+  uint32_t percentile(uint32_t part, uint32_t whole = 100) const
+  {
+    const uint32_t total_count = total();
+    uint32_t sum               = 0;
+    for (size_t i = 0; i < Buckets - 1; ++i)
+    {
+      sum += _counts[i];
+      if (static_cast<uint64_t>(sum) * whole >= static_cast<uint64_t>(total_count) * part) { return upper(i); }
+    }
+
+    return _max;
+  }
+
+  /** Clears the counts. */
+  void reset(void)
+  {
+    for (size_t i = 0; i < Buckets; ++i) { _counts[i] = 0; }
+    _max = 0;
+  }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  uint32_t _counts[Buckets];
+  uint32_t _max;
+};
+
+/** Per port latency histogram, clock ticks. */
+typedef log2_histogram<> latency_histogram;
+
+/** Queueing delay probe of a ring buffer.
+ *
+ *  @tparam Enabled Whether the probe is on.
+ *  @tparam Capacity The queue capacity.
+ *  @tparam ClockT Clock having static now().
+ *
+ *  The producer stamps the slot an element is pushed to, the consumer
+ *  counts the time since the stamp of the slot taken. The histogram is
+ *  written by the consumer only.
+ *
+ *  The disabled probe is empty and never reads the clock.
+ */
+template <bool Enabled, size_t Capacity, typename ClockT>
+class latency_probe
+{
+public:
+  /** Whether the probe is on. */
+  static const bool enabled = false;
+
+public:
+  /** Stamps the slot pushed to. */
+  void on_push(size_t) { }
+
+  /** Stamps n slots pushed to from the first one. */
+  void on_push(size_t, size_t) { }
+
+  /** Counts the delay of the slot taken, slots out of range are ignored. */
+  void on_pop(size_t) { }
+
+  /** Counts the delay of n slots taken from the first one. */
+  void on_pop(size_t, size_t) { }
+
+  /** Counts a zero delay, an element passing the queue by. */
+  void on_bypass(void) { }
+};
+
+/** Queueing delay probe, the enabled variant. */
+template <size_t Capacity, typename ClockT>
+class latency_probe<true, Capacity, ClockT>
+{
+public:
+  /** Whether the probe is on. */
+  static const bool enabled = true;
+
+public:
+  /** Stamps the slot pushed to. */
+  void on_push(size_t slot) { _times[slot] = static_cast<uint32_t>(ClockT::now()); }
+
+  /** Stamps n slots pushed to from the first one. */
+  void on_push(size_t first, size_t n)
+  {
+    const uint32_t now = static_cast<uint32_t>(ClockT::now());
+    for (size_t i = 0, slot = first; i < n; ++i, slot = slot + 1 < Capacity? slot + 1: 0) { _times[slot] = now; }
+  }
+
+  /** Counts the delay of the slot taken, slots out of range are ignored. */
+  void on_pop(size_t slot)
+  {
+    if (slot < Capacity) { _histogram.add(static_cast<uint32_t>(ClockT::now()) - _times[slot]); }
+  }
+
+  /** Counts the delay of n slots taken from the first one. */
+  void on_pop(size_t first, size_t n)
+  {
+    const uint32_t now = static_cast<uint32_t>(ClockT::now());
+    for (size_t i = 0, slot = first; i < n; ++i, slot = slot + 1 < Capacity? slot + 1: 0)
+    {
+      _histogram.add(now - _times[slot]);
+    }
+  }
+
+  /** Counts a zero delay, an element passing the queue by. */
+  void on_bypass(void) { _histogram.add(0); }
+
+  /** Returns the delays counted. */
+  const latency_histogram& histogram(void) const { return _histogram; }
+
+  /** Clears the delays counted, the consumer context. */
+  void reset(void) { _histogram.reset(); }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  uint32_t _times[Capacity];
+  latency_histogram _histogram;
+};
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_LATENCY_HPP_
@@ -0,0 +1,427 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_LINK_HPP_
+#define TINY_SERIAL_LINK_HPP_
+
+#include <tiny/serial/blocking.hpp>
+#include <tiny/serial/framing.hpp>
+#include <tiny/container.hpp>
+#include <tiny/crc.hpp>
+#include <tiny/pool.hpp>
+
+#include <cstddef>
+#include <stdint.h>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** Reliable link, selective repeat ARQ over a byte stream.
+ *
+ *  @tparam PortT Port type, basic_uart or any having readable/consume
+ *    and writable/commit.
+ *  @tparam Window The number of the packets sent ahead of the acknowledge,
+ *    a power of two, 1 is stop-and-wait.
+ *  @tparam MaxPayload The largest packet.
+ *  @tparam ClockT Millisecond clock, see default_wait_policy.
+ *
+ *  Packets are COBS framed with a three octets header, the kind, the
+ *  sequence number and the next sequence number expected by the receiver
+ *  (cumulative acknowledge), and CRC-16/CCITT. Every data packet received
+ *  is acknowledged selectively, a gap is reported by NAK of the missing
+ *  one, and a packet is sent again on NAK or timeout only. Packets are
+ *  delivered in order.
+ *
+ *  The packet buffers are taken from the pool of 2 * Window blocks shared
+ *  by the transmit and the receive windows, the payload is copied once on
+ *  send and once on receive. Everything runs in poll.
+ */
+template <typename PortT, size_t Window = 4, size_t MaxPayload = 64,
+          typename ClockT = default_wait_policy>
+class link
+{
+public:
+  /** Port type. */
+  typedef PortT port_type;
+
+  /** Time type. */
+  typedef typename ClockT::time_type time_type;
+
+  enum
+  {
+    window      = Window,    /**< The number of the packets in flight. */
+    max_payload = MaxPayload /**< The largest packet. */
+  };
+
+  static_assert(Window >= 1 && Window <= 64 && (Window & (Window - 1)) == 0,
+                "Window must be a power of two fitting in a half of the sequence space");
+
+public:
+  /** Creates the link.
+   *
+   *  @param timeout Retransmission timeout, longer than the round trip of
+   *    the largest packet.
+   */
+  link(port_type& port, time_type timeout = 200):
+    _port(port),
+    _timeout(timeout),
+    _tx_base(0),
+    _tx_next(0),
+    _rx_base(0),
+    _nak_sent(false),
+    _encoding(false),
+    _encoding_seq(0),
+    _retransmits(0),
+    _errors(0)
+  {
+    for (size_t i = 0; i < Window; ++i)
+    {
+      _tx[i].state  = ss_free;
+      _rx[i].buffer = no_buffer;
+    }
+  }
+
+public:
+  /** Whether a packet can be sent now. */
+  bool can_send(void) const
+  {
+    return static_cast<uint8_t>(_tx_next - _tx_base) < Window;
+  }
+
+  /** Queues the packet, it's sent by poll.
+   *
+   *  @return False if the window is full or the packet is too long.
+   */
+  bool send(const uint8_t* data, size_t size)
+  {
+    if (!can_send() || size > MaxPayload) { return false; }
+
+    tx_slot& slot = _tx[_tx_next % Window];
+    slot.buffer   = _pool.allocate();
+    slot.size     = size;
+    slot.state    = ss_pending;
+
+    uint8_t* payload = _pool.data(slot.buffer) + header_size;
+    for (size_t i = 0; i < size; ++i) { payload[i] = data[i]; }
+
+    ++_tx_next;
+    return true;
+  }
+
+  /** Receives, acknowledges and transmits, call it from the main loop. */
+  void poll(void)
+  {
+    while (_decoder.poll(_port))
+    {
+      receive(_decoder.frame(), _decoder.size());
+      _decoder.next();
+    }
+
+    const time_type now = ClockT::now();
+    expire(now);
+    slide();
+    transmit(now);
+  }
+
+  /** Whether the next packet in order is received. */
+  bool available(void) const
+  {
+    return _rx[_rx_base % Window].buffer != no_buffer;
+  }
+
+  /** Returns the received packet, valid while available. */
+  const uint8_t* packet(void) const
+  {
+    return _pool.data(_rx[_rx_base % Window].buffer) + header_size;
+  }
+
+  /** Returns the received packet size. */
+  size_t size(void) const
+  {
+    return _rx[_rx_base % Window].size;
+  }
+
+  /** Releases the received packet and moves to the next one. */
+  void next(void)
+  {
+    rx_slot& slot = _rx[_rx_base % Window];
+    if (slot.buffer == no_buffer) { return; }
+
+    _pool.free(slot.buffer);
+    slot.buffer = no_buffer;
+    ++_rx_base;
+    _nak_sent = false;
+  }
+
+  /** Whether all the packets sent are acknowledged. */
+  bool idle(void) const
+  {
+    return _tx_base == _tx_next && !_encoder.busy() && _control.empty();
+  }
+
+  /** Returns the number of the retransmissions. */
+  size_t retransmits(void) const { return _retransmits; }
+
+  /** Returns the number of the broken frames. */
+  size_t errors(void) const { return _errors + _decoder.errors(); }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  enum kind { k_data = 1, k_ack = 2, k_nak = 3 };
+
+  enum slot_state { ss_free, ss_pending, ss_sent, ss_acked };
+
+  enum
+  {
+    header_size = 3,
+    crc_size    = 2,
+    frame_size  = header_size + MaxPayload + crc_size,
+    buffers     = 2 * Window
+  };
+
+  typedef pool<frame_size, buffers> pool_type;
+  typedef typename pool_type::handle_type handle_type;
+
+  enum { no_buffer = pool_type::null_handle };
+
+  struct tx_slot
+  {
+    handle_type buffer;
+    size_t size;
+    slot_state state;
+    time_type sent_at;
+  };
+
+  struct rx_slot
+  {
+    handle_type buffer;
+    size_t size;
+  };
+
+  struct control
+  {
+    uint8_t kind;
+    uint8_t seq;
+  };
+
+private:
+  link(const link&); // inhibit copy
+  link& operator=(const link&);
+
+private:
+  static size_t seal(uint8_t* frame, uint8_t kind, uint8_t seq, uint8_t base, size_t payload)
+  {
+    frame[0] = kind;
+    frame[1] = seq;
+    frame[2] = base;
+
+    // big endian leaves zero residue
+    const size_t size  = header_size + payload;
+    const uint16_t crc = crc16_ccitt::compute(frame, size);
+    frame[size]     = static_cast<uint8_t>(crc >> 8);
+    frame[size + 1] = static_cast<uint8_t>(crc);
+    return size + crc_size;
+  }
+
+  //-----------------------------------------------------------------------------
+  void receive(const uint8_t* frame, size_t size)
+  {
+    if (size < header_size + crc_size || crc16_ccitt::compute(frame, size) != 0)
+    {
+      ++_errors;
+      return;
+    }
+
+    const uint8_t seq = frame[1];
+    acknowledge_till(frame[2]);
+
+    switch (frame[0])
+    {
+    case k_data:
+      receive_data(seq, frame + header_size, size - header_size - crc_size);
+      break;
+
+    case k_ack:
+      if (in_flight(seq)) { _tx[seq % Window].state = ss_acked; }
+      break;
+
+    case k_nak:
+      if (in_flight(seq) && _tx[seq % Window].state == ss_sent)
+      {
+        _tx[seq % Window].state = ss_pending;
+        ++_retransmits;
+      }
+      break;
+
+    default:
+      ++_errors;
+      break;
+    }
+  }
+
+  //-----------------------------------------------------------------------------
+  void receive_data(uint8_t seq, const uint8_t* payload, size_t size)
+  {
+    const uint8_t offset = static_cast<uint8_t>(seq - _rx_base);
+
+    // the acknowledge of an old one is lost
+    if (offset >= Window)
+    {
+      if (static_cast<uint8_t>(_rx_base - seq) <= Window) { queue_control(k_ack, seq); }
+      return;
+    }
+
+    rx_slot& slot = _rx[seq % Window];
+    if (slot.buffer == no_buffer)
+    {
+      // never runs out, each window holds Window blocks at most
+      slot.buffer = _pool.allocate();
+      slot.size   = size;
+
+      uint8_t* data = _pool.data(slot.buffer) + header_size;
+      for (size_t i = 0; i < size; ++i) { data[i] = payload[i]; }
+    }
+
+    queue_control(k_ack, seq);
+
+    if (offset != 0 && !available() && !_nak_sent)
+    {
+      _nak_sent = queue_control(k_nak, _rx_base);
+    }
+  }
+
+  //-----------------------------------------------------------------------------
+  bool in_flight(uint8_t seq) const
+  {
+    return static_cast<uint8_t>(seq - _tx_base) < static_cast<uint8_t>(_tx_next - _tx_base);
+  }
+
+  //-----------------------------------------------------------------------------
+  void acknowledge_till(uint8_t base)
+  {
+    if (static_cast<uint8_t>(base - _tx_base) > static_cast<uint8_t>(_tx_next - _tx_base)) { return; }
+
+    for (uint8_t seq = _tx_base; seq != base; ++seq) { _tx[seq % Window].state = ss_acked; }
+  }
+
+  //-----------------------------------------------------------------------------
+  bool queue_control(uint8_t kind, uint8_t seq)
+  {
+    // dropped if full, the sender times out then
+    const control c = { kind, seq };
+    return _control.push(c);
+  }
+
+  //-----------------------------------------------------------------------------
+  void expire(time_type now)
+  {
+    for (uint8_t seq = _tx_base; seq != _tx_next; ++seq)
+    {
+      tx_slot& slot = _tx[seq % Window];
+      if (_encoding && _encoding_seq == seq) { continue; }
+      if (slot.state == ss_sent && now - slot.sent_at >= _timeout)
+      {
+        slot.state = ss_pending;
+        ++_retransmits;
+      }
+    }
+  }
+
+  //-----------------------------------------------------------------------------
+  void slide(void)
+  {
+    while (_tx_base != _tx_next)
+    {
+      tx_slot& slot = _tx[_tx_base % Window];
+      if (slot.state != ss_acked) { break; }
+      // the encoder still reads the buffer
+      if (_encoding && _encoding_seq == _tx_base) { break; }
+
+      _pool.free(slot.buffer);
+      slot.state = ss_free;
+      ++_tx_base;
+    }
+  }
+
+  //-----------------------------------------------------------------------------
+  void transmit(time_type now)
+  {
+    for (;;)
+    {
+      if (_encoder.busy())
+      {
+        if (!_encoder.poll(_port)) { break; }
+
+        // the timeout runs from the end of the frame
+        if (_encoding) { _tx[_encoding_seq % Window].sent_at = now; }
+        _encoding = false;
+      }
+
+      if (!start_frame(now)) { break; }
+    }
+
+    slide();
+  }
+
+  //-----------------------------------------------------------------------------
+  bool start_frame(time_type now)
+  {
+    if (!_control.empty())
+    {
+      const control c = _control.pop();
+      _encoder.begin(_control_frame, seal(_control_frame, c.kind, c.seq, _rx_base, 0));
+      return true;
+    }
+
+    for (uint8_t seq = _tx_base; seq != _tx_next; ++seq)
+    {
+      tx_slot& slot = _tx[seq % Window];
+      if (slot.state != ss_pending) { continue; }
+
+      uint8_t* frame = _pool.data(slot.buffer);
+      _encoder.begin(frame, seal(frame, k_data, seq, _rx_base, slot.size));
+      slot.state    = ss_sent;
+      slot.sent_at  = now;
+      _encoding     = true;
+      _encoding_seq = seq;
+      return true;
+    }
+
+    return false;
+  }
+
+private:
+  port_type& _port;
+  time_type _timeout;
+  cobs_encoder _encoder;
+  cobs_decoder<frame_size> _decoder;
+  pool_type _pool;
+  tx_slot _tx[Window];
+  rx_slot _rx[Window];
+  queue<control, 2 * Window + 2> _control;
+  uint8_t _control_frame[header_size + crc_size];
+  uint8_t _tx_base;
+  uint8_t _tx_next;
+  uint8_t _rx_base;
+  bool _nak_sent;
+  bool _encoding;
+  uint8_t _encoding_seq;
+  size_t _retransmits;
+  size_t _errors;
+};
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_LINK_HPP_
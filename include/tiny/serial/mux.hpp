@@ -0,0 +1,249 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_MUX_HPP_
+#define TINY_SERIAL_MUX_HPP_
+
+#include <tiny/serial/framing.hpp>
+#include <tiny/crc.hpp>
+#include <tiny/pool.hpp>
+
+#include <cstddef>
+#include <stdint.h>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** Virtual channels over a single port.
+ *
+ *  @tparam PortT Port type, basic_uart or any having readable/consume
+ *    and writable/commit.
+ *  @tparam Channels The number of the channels.
+ *  @tparam MaxFrame The largest frame.
+ *  @tparam Frames The number of the frames queued per channel and way.
+ *
+ *  Frames are COBS framed with the channel number ahead and CRC-8 after.
+ *  Each channel has its own transmit queue and priority, the scheduler
+ *  picks the most urgent non-empty queue whenever the previous frame is
+ *  written into the port, so a frame is never interleaved and an urgent
+ *  frame waits for the current one and the port buffer at most. Channels
+ *  of the same priority are served in turn. Inbound frames are routed to
+ *  the channel receive queues. Everything runs in poll.
+ */
+template <typename PortT, size_t Channels, size_t MaxFrame = 32, size_t Frames = 4>
+class mux
+{
+public:
+  /** Port type. */
+  typedef PortT port_type;
+
+  enum
+  {
+    channels  = Channels, /**< The number of the channels. */
+    max_frame = MaxFrame  /**< The largest frame. */
+  };
+
+  static_assert(Channels >= 1 && Channels <= 255, "Up to 255 channels");
+
+public:
+  explicit mux(port_type& port):
+    _port(port),
+    _sending(pool_type::null_handle),
+    _last(Channels - 1),
+    _errors(0),
+    _dropped(0)
+  {
+    for (size_t i = 0; i < Channels; ++i)
+    {
+      _tx[i].attach(_tx_pool);
+      _rx[i].attach(_rx_pool);
+      _priority[i] = static_cast<uint8_t>(i);
+    }
+  }
+
+public:
+  /** Sets the channel priority, 0 is the most urgent, by default the
+   *  channel number.
+   */
+  void priority(size_t channel, uint8_t level) { _priority[channel] = level; }
+
+  /** Returns the channel priority. */
+  uint8_t priority(size_t channel) const { return _priority[channel]; }
+
+  /** Whether the channel can queue a frame. */
+  bool can_send(size_t channel) const
+  {
+    return _tx[channel].can_push() && !_tx_pool.empty();
+  }
+
+  /** Queues the frame on the channel.
+   *
+   *  @return False if the channel queue is full or the frame is too long.
+   */
+  bool send(size_t channel, const uint8_t* data, size_t size)
+  {
+    if (size > MaxFrame || !_tx[channel].can_push()) { return false; }
+
+    const handle_type handle = _tx_pool.allocate();
+    if (handle == pool_type::null_handle) { return false; }
+
+    uint8_t* block = _tx_pool.data(handle);
+    block[0] = static_cast<uint8_t>(channel);
+    for (size_t i = 0; i < size; ++i) { block[i + 1] = data[i]; }
+    block[size + 1] = crc8::compute(block, size + 1);
+
+    _tx[channel].push(handle, size + overhead);
+    return true;
+  }
+
+  /** Whether a frame is received on the channel. */
+  bool available(size_t channel) const { return !_rx[channel].empty(); }
+
+  /** Returns the frame received on the channel, valid while available. */
+  const uint8_t* frame_data(size_t channel) const
+  {
+    return _rx_pool.data(_rx[channel].front()->handle) + 1;
+  }
+
+  /** Returns the received frame size. */
+  size_t frame_size(size_t channel) const
+  {
+    return _rx[channel].front()->size - overhead;
+  }
+
+  /** Releases the received frame of the channel. */
+  void next(size_t channel)
+  {
+    _rx[channel].drop();
+  }
+
+  /** Receives and transmits, call it from the main loop. */
+  void poll(void)
+  {
+    while (_decoder.poll(_port))
+    {
+      route(_decoder.frame(), _decoder.size());
+      _decoder.next();
+    }
+
+    for (;;)
+    {
+      if (_encoder.busy() && !_encoder.poll(_port)) { break; }
+
+      if (_sending != pool_type::null_handle)
+      {
+        _tx_pool.free(_sending);
+        _sending = pool_type::null_handle;
+      }
+
+      if (!start_frame()) { break; }
+    }
+  }
+
+  /** Whether all the frames are written into the port. */
+  bool idle(void) const
+  {
+    for (size_t i = 0; i < Channels; ++i) { if (!_tx[i].empty()) { return false; } }
+    return !_encoder.busy();
+  }
+
+  /** Returns the number of the broken frames received. */
+  size_t errors(void) const { return _errors + _decoder.errors(); }
+
+  /** Returns the number of the frames dropped as the channel receive
+   *  queue is full.
+   */
+  size_t dropped(void) const { return _dropped; }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  enum
+  {
+    overhead   = 2, // channel and CRC
+    block_size = MaxFrame + overhead
+  };
+
+  typedef pool<block_size, Channels * Frames> pool_type;
+  typedef typename pool_type::handle_type handle_type;
+
+  typedef frame_queue<pool_type, Frames + 1> frame_queue_type;
+  typedef typename frame_queue_type::frame frame;
+
+private:
+  mux(const mux&); // inhibit copy
+  mux& operator=(const mux&);
+
+private:
+  bool start_frame(void)
+  {
+    size_t best = Channels;
+    for (size_t i = 1; i <= Channels; ++i)
+    {
+      // starts after the last served for the turns among the equal
+      const size_t channel = (_last + i) % Channels;
+      if (_tx[channel].empty()) { continue; }
+      if (best == Channels || _priority[channel] < _priority[best]) { best = channel; }
+    }
+
+    if (best == Channels) { return false; }
+
+    const frame f = _tx[best].pop();
+    _encoder.begin(_tx_pool.data(f.handle), f.size);
+    _sending = f.handle;
+    _last    = best;
+    return true;
+  }
+
+  //-----------------------------------------------------------------------------
+  void route(const uint8_t* data, size_t size)
+  {
+    if (size < overhead || data[0] >= Channels || crc8::compute(data, size - 1) != data[size - 1])
+    {
+      ++_errors;
+      return;
+    }
+
+    frame_queue_type& q = _rx[data[0]];
+    const handle_type handle = q.can_push()? _rx_pool.allocate(): static_cast<handle_type>(pool_type::null_handle);
+    if (handle == pool_type::null_handle)
+    {
+      ++_dropped;
+      return;
+    }
+
+    uint8_t* block = _rx_pool.data(handle);
+    for (size_t i = 0; i < size; ++i) { block[i] = data[i]; }
+
+    q.push(handle, size);
+  }
+
+private:
+  port_type& _port;
+  cobs_encoder _encoder;
+  cobs_decoder<block_size> _decoder;
+  pool_type _tx_pool;
+  pool_type _rx_pool;
+  frame_queue_type _tx[Channels];
+  frame_queue_type _rx[Channels];
+  uint8_t _priority[Channels];
+  handle_type _sending;
+  size_t _last;
+  size_t _errors;
+  size_t _dropped;
+};
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_MUX_HPP_
@@ -0,0 +1,438 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_NEGOTIATE_HPP_
+#define TINY_SERIAL_NEGOTIATE_HPP_
+
+#include <tiny/serial/blocking.hpp>
+#include <tiny/crc.hpp>
+
+#include <cstddef>
+#include <stdint.h>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** Rate and format negotiation for both sides of a link.
+ *
+ *  @tparam PortT Port type, basic_uart or any having async_write, try_read
+ *    and reconfigure(baud, config, timeout).
+ *  @tparam ClockT Clock, see default_wait_policy.
+ *
+ *  Either side proposes the new settings, the other accepts them if the
+ *  rate is within its limit and both switch by reconfigure, so the octets
+ *  buffered survive. Frames are [0xa5, kind, rate (4, LE), config (4, LE),
+ *  CRC-8]: the request and the answer go at the current settings, then
+ *  the proposing side sends the confirmation at the new ones and the other
+ *  echoes it. A side not confirmed in time returns to the previous
+ *  settings, a lost echo leaves the sides apart though, the application
+ *  falls back to the handshake settings on silence then.
+ *
+ *  The application reads the port through try_read, it takes the frames
+ *  out and hands the other octets over in order, a frame head not
+ *  completed within the timeout included. While negotiating poll takes
+ *  the frames too, up to the first application octet, which waits for
+ *  try_read. Writes queued before propose go out at the current settings,
+ *  reconfigure waits for them. The frames not fitting into the transmit
+ *  buffer are completed by poll, the application writes while writable
+ *  only, so nothing gets between the octets of a frame.
+ */
+template <typename PortT, typename ClockT = default_wait_policy>
+class negotiator
+{
+public:
+  /** Port type. */
+  typedef PortT port_type;
+
+  /** Octet type. */
+  typedef typename port_type::octet_type octet_type;
+
+  /** Time point type. */
+  typedef typename ClockT::time_type time_type;
+
+  /** Negotiation state. */
+  enum state
+  {
+    idle,       /**< Nothing going on, answers the proposals. */
+    proposing,  /**< The request is sent, waiting for the answer. */
+    switching,  /**< Switched, waiting for the confirmation echo. */
+    confirming, /**< Accepted and switched, waiting for the confirmation. */
+    done,       /**< The new settings are on, answers the proposals. */
+    rejected,   /**< The other side rejected the proposal. */
+    failed      /**< No answer, the previous settings are on. */
+  };
+
+public:
+  /** Creates a negotiator.
+   *
+   *  @param port The port opened at the given settings.
+   *  @param max_baud The largest rate accepted.
+   *  @param timeout Answer timeout, the frames are resent on it.
+   */
+  negotiator(port_type& port, unsigned long baud, uint32_t config, unsigned long max_baud,
+             time_type timeout = 100):
+    _port(port),
+    _baud(baud),
+    _config(config),
+    _old_baud(baud),
+    _old_config(config),
+    _max_baud(max_baud),
+    _new_baud(baud),
+    _new_config(config),
+    _timeout(timeout),
+    _sent(0),
+    _heard(0),
+    _tries(0),
+    _state(idle),
+    _pending(false),
+    _held(false),
+    _data(0),
+    _size(0),
+    _spill(0),
+    _out_next(frame_size),
+    _queued(0)
+  {
+    // empty
+  }
+
+public:
+  /** Proposes the new settings.
+   *
+   *  @return False if a negotiation is going on.
+   */
+  bool propose(unsigned long baud, uint32_t config)
+  {
+    if (negotiating()) { return false; }
+
+    _new_baud   = baud;
+    _new_config = config;
+    _tries      = 0;
+    _state      = proposing;
+    send(request);
+    return true;
+  }
+
+  /** Reads an octet of the application, the frames are taken out.
+   *
+   *  @return False if none.
+   */
+  bool try_read(octet_type& octet)
+  {
+    if (_held)
+    {
+      octet = _data;
+      _held = false;
+      return true;
+    }
+
+    return next(octet);
+  }
+
+  /** Sends, switches, resends and receives while negotiating, call it
+   *  from the main loop.
+   */
+  void poll(void)
+  {
+    flush();
+    if (negotiating() && !_held) { _held = next(_data); }
+
+    // the switch waits for the answer to leave the port
+    if (_pending && !sending() && switch_to(_new_baud, _new_config))
+    {
+      _pending = false;
+      if (_state == switching) { send(confirm); }
+    }
+
+    if (_pending || sending() || ClockT::now() - _sent < _timeout) { return; }
+
+    switch (_state)
+    {
+      case proposing:
+        if (++_tries < max_tries) { send(request); }
+        else                      { _state = failed; }
+        break;
+
+      case switching:
+        if (++_tries < max_tries) { send(confirm); }
+        else                      { revert(); }
+        break;
+
+      case confirming:
+        if (++_tries >= max_tries / 2) { revert(); }
+        else                           { _sent = ClockT::now(); }
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  /** Whether the application may write, neither a negotiation nor a frame
+   *  going out.
+   */
+  bool writable(void) const { return !negotiating() && !sending(); }
+
+  /** Returns the negotiation state. */
+  state status(void) const { return _state; }
+
+  /** Returns the current rate. */
+  unsigned long baud(void) const { return _baud; }
+
+  /** Returns the current configuration. */
+  uint32_t config(void) const { return _config; }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  enum
+  {
+    magic       = 0xa5,
+    frame_size  = 11,
+    max_tries   = 4,
+    request     = 'R',
+    accept      = 'A',
+    reject      = 'N',
+    confirm     = 'C'
+  };
+
+private:
+  negotiator(const negotiator&); // inhibit copy
+  negotiator& operator=(const negotiator&);
+
+private:
+  bool negotiating(void) const { return _state == proposing || _state == switching || _state == confirming; }
+
+  //-----------------------------------------------------------------------------
+  bool sending(void) const { return _out_next < frame_size || _queued != 0; }
+
+  //-----------------------------------------------------------------------------
+  // a frame waits for the one going out
+  void send(uint8_t kind)
+  {
+    if (sending())
+    {
+      _queued = kind;
+      return;
+    }
+
+    build(kind);
+    flush();
+  }
+
+  //-----------------------------------------------------------------------------
+  void build(uint8_t kind)
+  {
+    const uint8_t frame[frame_size] =
+    {
+      magic, kind,
+      static_cast<uint8_t>(_new_baud), static_cast<uint8_t>(_new_baud >> 8),
+      static_cast<uint8_t>(_new_baud >> 16), static_cast<uint8_t>(_new_baud >> 24),
+      static_cast<uint8_t>(_new_config), static_cast<uint8_t>(_new_config >> 8),
+      static_cast<uint8_t>(_new_config >> 16), static_cast<uint8_t>(_new_config >> 24), 0
+    };
+    for (size_t i = 0; i < frame_size - 1; ++i) { _out[i] = frame[i]; }
+    _out[frame_size - 1] = crc8::compute(frame, frame_size - 1);
+
+    _out_next = 0;
+    _sent     = ClockT::now();
+  }
+
+  //-----------------------------------------------------------------------------
+  // writes as much of the frames as the transmit buffer takes
+  void flush(void)
+  {
+    for (;;)
+    {
+      for (; _out_next < frame_size; ++_out_next)
+      {
+        if (!_port.async_write(_out[_out_next])) { return; }
+      }
+
+      if (_queued == 0) { return; }
+
+      build(_queued);
+      _queued = 0;
+    }
+  }
+
+  //-----------------------------------------------------------------------------
+  // reads the next octet of the application, the frames are handled
+  bool next(octet_type& octet)
+  {
+    for (;;)
+    {
+      if (_spill != 0)
+      {
+        octet = _frame[0];
+        for (size_t i = 1; i < _size; ++i) { _frame[i - 1] = _frame[i]; }
+        --_size;
+        --_spill;
+        return true;
+      }
+
+      octet_type c;
+      if (!_port.try_read(c))
+      {
+        // a frame head left incomplete is the application's
+        if (_size != 0 && ClockT::now() - _heard >= _timeout) { _spill = _size; continue; }
+        return false;
+      }
+
+      if (_size == 0 && c != magic)
+      {
+        octet = c;
+        return true;
+      }
+
+      _frame[_size++] = c;
+      _heard          = ClockT::now();
+      if (_size == 2 && c != request && c != accept && c != reject && c != confirm) { resync(); }
+      else if (_size == frame_size) { receive(); }
+    }
+  }
+
+  //-----------------------------------------------------------------------------
+  void receive(void)
+  {
+    uint8_t frame[frame_size];
+    for (size_t i = 0; i < frame_size; ++i)
+    {
+      if (static_cast<uint8_t>(_frame[i]) != _frame[i])
+      {
+        resync();
+        return;
+      }
+      frame[i] = static_cast<uint8_t>(_frame[i]);
+    }
+
+    if (crc8::compute(frame, frame_size - 1) != frame[frame_size - 1])
+    {
+      resync();
+      return;
+    }
+
+    _size = 0;
+    handle(frame[1], static_cast<unsigned long>(le32(frame + 2)), le32(frame + 6));
+  }
+
+  //-----------------------------------------------------------------------------
+  // the octets up to the next magic one within go to the application
+  void resync(void)
+  {
+    size_t next = 1;
+    for (; next < _size && _frame[next] != magic; ++next) { }
+    _spill = next;
+  }
+
+  //-----------------------------------------------------------------------------
+  static uint32_t le32(const uint8_t* data)
+  {
+    return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+        static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+  }
+
+  //-----------------------------------------------------------------------------
+  void handle(uint8_t kind, unsigned long baud, uint32_t config)
+  {
+    if (kind == request && _state != proposing && _state != switching)
+    {
+      _new_baud   = baud;
+      _new_config = config;
+      if (baud > _max_baud)
+      {
+        send(reject);
+        return;
+      }
+
+      send(accept);
+      start_switch(confirming);
+      return;
+    }
+
+    if (baud != _new_baud || config != _new_config) { return; }
+
+    if (kind == accept && _state == proposing)
+    {
+      start_switch(switching);
+    } else if (kind == reject && _state == proposing)
+    {
+      _state = rejected;
+    } else if (kind == confirm && _state == confirming)
+    {
+      send(confirm);
+      _state = done;
+    } else if (kind == confirm && _state == switching)
+    {
+      _state = done;
+    }
+  }
+
+  //-----------------------------------------------------------------------------
+  bool switch_to(unsigned long baud, uint32_t config)
+  {
+    if (!_port.reconfigure(baud, static_cast<typename port_type::config_type>(config), 0)) { return false; }
+
+    _baud   = baud;
+    _config = config;
+    _sent   = ClockT::now();
+    return true;
+  }
+
+  //-----------------------------------------------------------------------------
+  void start_switch(state next)
+  {
+    _old_baud   = _baud;
+    _old_config = _config;
+    _tries      = 0;
+    _state      = next;
+    _pending    = true;
+  }
+
+  //-----------------------------------------------------------------------------
+  void revert(void)
+  {
+    _new_baud   = _old_baud;
+    _new_config = _old_config;
+    _state      = failed;
+    _pending    = true;
+  }
+
+private:
+  port_type& _port;
+  unsigned long _baud;
+  uint32_t _config;
+  unsigned long _old_baud;
+  uint32_t _old_config;
+  unsigned long _max_baud;
+  unsigned long _new_baud;
+  uint32_t _new_config;
+  time_type _timeout;
+  time_type _sent;
+  time_type _heard;
+  size_t _tries;
+  state _state;
+  bool _pending;
+  bool _held;
+  octet_type _data;
+  octet_type _frame[frame_size];
+  size_t _size;
+  size_t _spill;
+  uint8_t _out[frame_size];
+  size_t _out_next;
+  uint8_t _queued;
+};
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_NEGOTIATE_HPP_
@@ -0,0 +1,280 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_PORTS_HPP_
+#define TINY_SERIAL_PORTS_HPP_
+
+#include <tiny/serial/rx_stamps.hpp>
+#include <tiny/serial/latency.hpp>
+
+#include <cstddef>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** Port data width, 9 bits take the extended port kind. */
+enum port_width
+{
+  eight_bits = 8,
+  nine_bits  = 9
+};
+
+/** Port features, compiled in only for the ports declaring them. */
+enum port_feature
+{
+  pf_none            = 0x00,
+  pf_octet_stamps    = 0x01, /**< Every octet timestamped, see read_timestamped. */
+  pf_frame_stamps    = 0x02, /**< Idle line frames timestamped, see read_frame. */
+  pf_latency         = 0x04, /**< Queueing delay histograms, see rx_latency. */
+  pf_rx_hooks        = 0x08, /**< Receive hooks, see on_rx and on_match. */
+  pf_fixed_registers = 0x10  /**< Mega, the register addresses fixed at compile time. */
+};
+
+/** Features of the ports not declaring them, the receive hooks and by
+ *  TINY_SERIAL_RX_TIMESTAMPS and TINY_SERIAL_LATENCY_STATS.
+ */
+enum
+{
+  default_port_features = pf_rx_hooks |
+                          (TINY_SERIAL_RX_TIMESTAMPS == 1? pf_octet_stamps :
+                           TINY_SERIAL_RX_TIMESTAMPS == 2? pf_frame_stamps : pf_none) |
+                          (TINY_SERIAL_LATENCY_STATS != 0? pf_latency : pf_none)
+};
+
+/** Returns the receive timestamps mode of the features, see rx_stamp_mode. */
+constexpr int port_stamp_mode(unsigned int features)
+{
+  return (features & pf_octet_stamps) != 0? rx_stamp_octets :
+         (features & pf_frame_stamps) != 0? rx_stamp_frames : rx_stamp_none;
+}
+
+/** Returns the mask of no port numbers. */
+constexpr unsigned int port_mask_of(void)
+{
+  return 0;
+}
+
+/** Returns the mask of the port numbers, bit n for port n. */
+template <typename... NumT>
+constexpr unsigned int port_mask_of(unsigned int num, NumT... rest)
+{
+  return (1u << num) | port_mask_of(rest...);
+}
+
+/** A port of the application, an entry of port_registry.
+ *
+ *  @tparam Num The port number, serialN of the Arduino numbering, 4 is
+ *    the dedicated UART of Due.
+ *  @tparam Width The data bits, nine_bits take the extended port kind.
+ *  @tparam RxSize The receive buffer size, 0 takes
+ *    TINY_SERIAL_DEF_BUF_SIZE. Use pow of two for optimizing indexing.
+ *  @tparam TxSize The transmit buffer size, the receive one by default.
+ *  @tparam Features port_feature flags.
+ */
+template <
+  unsigned int Num,
+  port_width Width = eight_bits,
+  size_t RxSize = 0,
+  size_t TxSize = RxSize,
+  unsigned int Features = default_port_features>
+struct port_decl
+{
+  static_assert(Num < 8, "Port numbers are 0..7");
+  static_assert((Features & (pf_octet_stamps | pf_frame_stamps)) != (pf_octet_stamps | pf_frame_stamps),
+                "Octet and frame timestamps exclude each other");
+
+  enum
+  {
+    number   = Num,
+    width    = Width,
+    wide     = Width == nine_bits,
+    rx_size  = RxSize,
+    tx_size  = TxSize,
+    features = Features
+  };
+
+  /** Returns the port bit of the registry masks. */
+  static constexpr unsigned int bit(void) { return 1u << Num; }
+
+  /** Returns the port bit if it takes 9 bits. */
+  static constexpr unsigned int wide_bit(void) { return Width == nine_bits? bit() : 0; }
+};
+
+namespace detail
+{
+
+/** Bitwise or of no masks. */
+constexpr unsigned int or_masks(void)
+{
+  return 0;
+}
+
+/** Bitwise or of the masks. */
+template <typename... MaskT>
+constexpr unsigned int or_masks(unsigned int mask, MaskT... rest)
+{
+  return mask | or_masks(rest...);
+}
+
+/** Counts the bits set. */
+constexpr unsigned int count_bits(unsigned int mask)
+{
+  return mask == 0? 0 : (mask & 1u) + count_bits(mask >> 1);
+}
+
+/** Finds the declaration of the port number, void if absent. */
+template <unsigned int Num, typename... PortsT>
+struct find_port
+{
+  typedef void type;
+};
+
+/** Takes the port if it matches, otherwise looks into the rest. */
+template <bool Match, unsigned int Num, typename PortT, typename... RestT>
+struct match_port
+{
+  typedef PortT type;
+};
+
+template <unsigned int Num, typename PortT, typename... RestT>
+struct match_port<false, Num, PortT, RestT...>
+{
+  typedef typename find_port<Num, RestT...>::type type;
+};
+
+template <unsigned int Num, typename PortT, typename... RestT>
+struct find_port<Num, PortT, RestT...>
+{
+  typedef typename match_port<static_cast<unsigned int>(PortT::number) == Num, Num, PortT, RestT...>::type type;
+};
+
+} // namespace detail
+
+/** The ports of the application declared in one place, the only ports
+ *  whose instances and interrupt handlers are generated.
+ *
+ *  @tparam PortsT port_decl entries, a port number once.
+ *
+ *  typedef port_registry<port_decl<1, nine_bits, 64, 16>, port_decl<2> > ports;
+ *
+ *  The ports are reached by serial_port<ports, Num> of the target, which
+ *  checks the hardware has the port, TINY_SERIAL_PORTS defines the
+ *  interrupt handlers.
+ */
+template <typename... PortsT>
+struct port_registry
+{
+  static_assert(detail::count_bits(detail::or_masks(PortsT::bit()...)) == sizeof...(PortsT),
+                "A port number is declared twice");
+
+  /** The number of the ports. */
+  enum { size = sizeof...(PortsT) };
+
+  /** Returns the mask of the port numbers. */
+  static constexpr unsigned int mask(void) { return detail::or_masks(PortsT::bit()...); }
+
+  /** Returns the mask of the 9 bit ports. */
+  static constexpr unsigned int wide_mask(void) { return detail::or_masks(PortsT::wide_bit()...); }
+
+  /** Whether the port number is declared. */
+  static constexpr bool has(unsigned int num) { return num < 8 && ((mask() >> num) & 1u) != 0; }
+
+  /** Whether the target has every port declared and 9 bits where asked.
+   *
+   *  @tparam TargetT The target ports, see target_ports, having ports_mask
+   *    and nine_bits_mask constants.
+   */
+  template <typename TargetT>
+  static constexpr bool fits(void)
+  {
+    return (mask() & ~static_cast<unsigned int>(TargetT::ports_mask)) == 0 &&
+           (wide_mask() & ~static_cast<unsigned int>(TargetT::nine_bits_mask)) == 0;
+  }
+
+  /** The declaration of the port number, void if absent. */
+  template <unsigned int Num>
+  struct port
+  {
+    typedef typename detail::find_port<Num, PortsT...>::type type;
+  };
+};
+
+/** A registry port bound to the target, the uart type and the instance.
+ *
+ *  @tparam RegistryT The port registry.
+ *  @tparam Num The port number.
+ *  @tparam TargetT The target ports, see target_ports, having ports_mask
+ *    and nine_bits_mask constants, uart<DeclT>::type and
+ *    instance<UartT, Num>(void).
+ *
+ *  The instance is a function local static of the port, built on the
+ *  first use only.
+ */
+template <typename RegistryT, unsigned int Num, typename TargetT>
+struct registered_port
+{
+  static_assert(RegistryT::has(Num), "The port isn't declared by the registry");
+  static_assert((TargetT::ports_mask & (1u << Num)) != 0, "The target has no such port");
+  static_assert(RegistryT::template fits<TargetT>(), "The registry doesn't fit the target ports");
+
+  /** The port declaration. */
+  typedef typename RegistryT::template port<Num>::type decl_type;
+
+  /** Uart type. */
+  typedef typename TargetT::template uart<decl_type>::type uart_type;
+
+  /** Port number */
+  enum { port_no = Num };
+
+  /** Return the instance of the uart. */
+  static uart_type& instance(void)
+  {
+    return TargetT::template instance<uart_type, Num>();
+  }
+};
+
+} // namespace io
+
+} // namespace tiny
+
+#define TINY_PP_CAT_(a, b) a ## b
+#define TINY_PP_CAT(a, b) TINY_PP_CAT_(a, b)
+#define TINY_PP_COUNT_(_1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+#define TINY_PP_COUNT(...) TINY_PP_COUNT_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define TINY_PP_EACH_1(M, A, x) M(A, x)
+#define TINY_PP_EACH_2(M, A, x, ...) M(A, x) TINY_PP_EACH_1(M, A, __VA_ARGS__)
+#define TINY_PP_EACH_3(M, A, x, ...) M(A, x) TINY_PP_EACH_2(M, A, __VA_ARGS__)
+#define TINY_PP_EACH_4(M, A, x, ...) M(A, x) TINY_PP_EACH_3(M, A, __VA_ARGS__)
+#define TINY_PP_EACH_5(M, A, x, ...) M(A, x) TINY_PP_EACH_4(M, A, __VA_ARGS__)
+#define TINY_PP_EACH_6(M, A, x, ...) M(A, x) TINY_PP_EACH_5(M, A, __VA_ARGS__)
+#define TINY_PP_EACH_7(M, A, x, ...) M(A, x) TINY_PP_EACH_6(M, A, __VA_ARGS__)
+#define TINY_PP_EACH_8(M, A, x, ...) M(A, x) TINY_PP_EACH_7(M, A, __VA_ARGS__)
+/** Expands M(A, x) for every x of the list, 8 at most. */
+#define TINY_PP_EACH(M, A, ...) TINY_PP_CAT(TINY_PP_EACH_, TINY_PP_COUNT(__VA_ARGS__))(M, A, __VA_ARGS__)
+
+/** Handlers of the port number, TINY_SERIAL_PORT_HANDLERS_n are given by
+ *  the target header for its ports.
+ */
+#define TINY_SERIAL_PORT_HANDLERS(RegistryT, Num) TINY_PP_CAT(TINY_SERIAL_PORT_HANDLERS_, Num)(RegistryT)
+
+/** Defines the interrupt handlers of the registry ports, place it once in
+ *  a source file listing the port numbers, e.g. TINY_SERIAL_PORTS(ports, 1, 2).
+ *  The list must match the registry, the numbers are literals. The
+ *  vectors shared by the ports (the idle timer of Mega) are given by
+ *  TINY_SERIAL_TARGET_HANDLERS of the target header.
+ */
+#define TINY_SERIAL_PORTS(RegistryT, ...) \
+  static_assert(RegistryT::mask() == ::tiny::io::port_mask_of(__VA_ARGS__), \
+                "TINY_SERIAL_PORTS must list the ports of " #RegistryT); \
+  TINY_PP_EACH(TINY_SERIAL_PORT_HANDLERS, RegistryT, __VA_ARGS__) \
+  TINY_SERIAL_TARGET_HANDLERS(RegistryT, __VA_ARGS__)
+
+#endif // TINY_SERIAL_PORTS_HPP_
@@ -0,0 +1,187 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_REACTOR_HPP_
+#define TINY_SERIAL_REACTOR_HPP_
+
+#include <tiny/serial/rx_hooks.hpp>
+#include <tiny/detail/interrupts.hpp>
+
+#include <cstddef>
+#include <stdint.h>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** Port events signaled from the interrupts. */
+enum port_event
+{
+  ev_rx_data      = 0x01, /**< Octet buffered. */
+  ev_rx_delimiter = 0x02, /**< Match octet buffered, see basic_uart::on_match. */
+  ev_tx_drained   = 0x04, /**< Transmit buffer became empty. */
+  ev_error        = 0x08, /**< Receive error, e.g. parity or overrun. */
+  ev_all          = 0x0f  /**< Every event, the default interest of a port. */
+};
+
+static_assert(int(ev_rx_data) == int(rx_buffered) && int(ev_rx_delimiter) == int(rx_matched),
+              "Rx dispatch results must map onto port events");
+
+/** Pending events of several ports packed into a single word.
+ *
+ *  Every port owns a nibble (slot) of the word. Ports set their bits from
+ *  the interrupts, the main loop takes the whole word at once so idle
+ *  checking all the ports costs a single load.
+ */
+class event_word
+{
+public:
+  /** The word type. */
+  typedef uint32_t word_type;
+
+  /** Bits per slot and the slots number. */
+  enum { slot_bits = 4, max_slots = sizeof(word_type) * 8 / slot_bits };
+
+  /** Slot mask. */
+  enum { slot_mask = (1 << slot_bits) - 1 };
+
+public:
+  event_word(void): _pending(0) { /* empty */ }
+
+public:
+  /** Signals the events of the slot, safe in the interrupt context. */
+  void signal(size_t slot, unsigned int events)
+  {
+    ::tiny::detail::atomic_fetch_or(_pending, static_cast<word_type>(events & slot_mask) << (slot * slot_bits));
+  }
+
+  /** Takes all the pending events and clears them. */
+  word_type take(void)
+  {
+    return ::tiny::detail::atomic_exchange(_pending, word_type(0));
+  }
+
+  /** Returns pending events without clearing. */
+  word_type pending(void) const { return _pending; }
+
+  /** Sleeps until the next interrupt unless any event pending. */
+  void wait(void) const { ::tiny::detail::wait_for_event(_pending); }
+
+  /** Extracts the events of the slot from the word taken. */
+  static unsigned int slot_events(word_type word, size_t slot)
+  {
+    return (word >> (slot * slot_bits)) & slot_mask;
+  }
+
+private:
+  volatile word_type _pending;
+};
+
+/** Cooperative reactor dispatching port events in the main loop.
+ *
+ *  @tparam Slots The number of the ports served.
+ *
+ *  Bind a port to the reactor event word with basic_uart::bind and attach
+ *  a handler to the same slot. Handlers are called from run_once only for
+ *  the slots having pending events, the ports signal only the events of
+ *  the mask given to bind.
+ */
+template <size_t Slots>
+class reactor
+{
+public:
+  static_assert(Slots <= event_word::max_slots, "Too many reactor slots");
+
+  /** The number of slots. */
+  enum { slots = Slots };
+
+  /** Events handler. */
+  typedef void (*handler_type)(unsigned int events, void* context);
+
+public:
+  reactor(void)
+  {
+    for (size_t i = 0; i < Slots; ++i) { detach(i); }
+  }
+
+public:
+  /** Returns the event word to bind the ports to. */
+  event_word& events(void) { return _events; }
+
+  /** Attaches a handler to the slot. */
+  void attach(size_t slot, handler_type handler, void* context = nullptr)
+  {
+    _handlers[slot].handler = handler;
+    _handlers[slot].context = context;
+  }
+
+  /** Detaches a handler from the slot. */
+  void detach(size_t slot)
+  {
+    attach(slot, nullptr);
+  }
+
+  /** Dispatches pending events.
+   *
+   *  @return The number of the handlers called.
+   */
+  size_t run_once(void)
+  {
+    if (_events.pending() == 0) { return 0; }
+
+    event_word::word_type word = _events.take();
+    size_t dispatched          = 0;
+
+    for (size_t slot = 0; word != 0 && slot < Slots; ++slot, word >>= event_word::slot_bits)
+    {
+      const unsigned int ev = static_cast<unsigned int>(word & event_word::slot_mask);
+
+      if (ev != 0 && _handlers[slot].handler != nullptr)
+      {
+        _handlers[slot].handler(ev, _handlers[slot].context);
+        ++dispatched;
+      }
+    }
+
+    return dispatched;
+  }
+
+  /** Dispatches pending events, if none and idle is true sleeps until
+   *  the next interrupt first.
+   *
+   *  @return The number of the handlers called.
+   */
+  size_t poll(bool idle = false)
+  {
+    if (idle) { _events.wait(); }
+
+    return run_once();
+  }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  struct slot_handler
+  {
+    handler_type handler;
+    void* context;
+  };
+
+private:
+  event_word _events;
+  slot_handler _handlers[Slots];
+};
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_REACTOR_HPP_
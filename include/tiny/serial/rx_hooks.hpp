@@ -0,0 +1,205 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_RX_HOOKS_HPP_
+#define TINY_SERIAL_RX_HOOKS_HPP_
+
+#include <cstddef>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** Receive dispatch results. */
+enum rx_dispatch_result
+{
+  rx_none     = 0x00, /**< Octet consumed by the handler or dropped. */
+  rx_buffered = 0x01, /**< Octet buffered. */
+  rx_matched  = 0x02  /**< Octet equals the match octet. */
+};
+
+/** Receive hooks invoked from the uart rx interrupt.
+ *
+ *  @tparam OctetT The octet type of the port.
+ *
+ *  The octet handler sees every received octet before it is buffered and
+ *  can consume it. Once an octet equal to the match octet is buffered
+ *  the optional match handler is called, e.g. to detect frame delimiters.
+ *
+ *  @note Handlers run in the interrupt context, keep them short.
+ *  @note If no hook is installed dispatching costs a single flag test.
+ */
+template <typename OctetT>
+class rx_hooks
+{
+public:
+  /** Octet type. */
+  typedef OctetT octet_type;
+
+  /** Octet handler, returns true if the octet is consumed and must not be buffered. */
+  typedef bool (*octet_handler)(octet_type octet, void* context);
+
+  /** Match handler, called after the matching octet is buffered. */
+  typedef void (*match_handler)(octet_type octet, void* context);
+
+public:
+  /** Creates hooks with no handlers installed. */
+  rx_hooks(void):
+    _octet_handler(nullptr),
+    _octet_context(nullptr),
+    _match_handler(nullptr),
+    _match_context(nullptr),
+    _match(0),
+    _matching(false),
+    _armed(false)
+  {
+    // empty
+  }
+
+public:
+  /** Installs the octet handler, pass nullptr to remove it. */
+  void on_octet(octet_handler handler, void* context = nullptr)
+  {
+    _octet_handler = handler;
+    _octet_context = context;
+    rearm();
+  }
+
+  /** Enables matching of the octet, the handler is optional. */
+  void on_match(octet_type match, match_handler handler = nullptr, void* context = nullptr)
+  {
+    _match         = match;
+    _match_handler = handler;
+    _match_context = context;
+    _matching      = true;
+    rearm();
+  }
+
+  /** Disables matching and removes the match handler. */
+  void no_match(void)
+  {
+    _match_handler = nullptr;
+    _match_context = nullptr;
+    _matching      = false;
+    rearm();
+  }
+
+  /** Removes all the hooks. */
+  void clear(void)
+  {
+    on_octet(nullptr);
+    no_match();
+  }
+
+  /** Whether any hook installed. */
+  bool armed(void) const { return _armed; }
+
+  /** Passes a received octet through the hooks into the queue.
+   *
+   *  @return Combination of rx_dispatch_result flags.
+   */
+  template <typename QueueT>
+  unsigned int dispatch(octet_type octet, QueueT& queue)
+  {
+    if (!_armed) { return queue.push(octet)? rx_buffered: rx_none; }
+
+    return dispatch_hooked(octet, queue);
+  }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  void rearm(void)
+  {
+    _armed = _octet_handler != nullptr || _matching;
+  }
+
+  //-----------------------------------------------------------------------------
+  template <typename QueueT>
+  unsigned int dispatch_hooked(octet_type octet, QueueT& queue)
+  {
+    if (_octet_handler != nullptr && _octet_handler(octet, _octet_context))
+    {
+      return rx_none;
+    }
+
+    if (!queue.push(octet)) { return rx_none; }
+
+    if (!_matching || octet != _match) { return rx_buffered; }
+
+    if (_match_handler != nullptr)
+    {
+      _match_handler(octet, _match_context);
+    }
+
+    return rx_buffered | rx_matched;
+  }
+
+private:
+  octet_handler _octet_handler;
+  void* _octet_context;
+  match_handler _match_handler;
+  void* _match_context;
+  octet_type _match;
+  bool _matching;
+  volatile bool _armed;
+};
+
+/** Receive hooks compiled out, the port declared without pf_rx_hooks.
+ *
+ *  Empty, dispatching is the queue push alone, not even the flag test.
+ */
+template <typename OctetT>
+class no_rx_hooks
+{
+public:
+  /** Octet type. */
+  typedef OctetT octet_type;
+
+  /** Octet handler, see rx_hooks. */
+  typedef bool (*octet_handler)(octet_type octet, void* context);
+
+  /** Match handler, see rx_hooks. */
+  typedef void (*match_handler)(octet_type octet, void* context);
+
+public:
+  /** Never armed. */
+  bool armed(void) const { return false; }
+
+  /** Pushes a received octet into the queue.
+   *
+   *  @return rx_buffered or rx_none if the queue is full.
+   */
+  template <typename QueueT>
+  unsigned int dispatch(octet_type octet, QueueT& queue)
+  {
+    return queue.push(octet)? rx_buffered: rx_none;
+  }
+};
+
+/** Selects the receive hooks type, rx_hooks if enabled. */
+template <typename OctetT, bool Enabled>
+struct select_rx_hooks
+{
+  typedef rx_hooks<OctetT> type;
+};
+
+template <typename OctetT>
+struct select_rx_hooks<OctetT, false>
+{
+  typedef no_rx_hooks<OctetT> type;
+};
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_RX_HOOKS_HPP_
@@ -0,0 +1,179 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_RX_STAMPS_HPP_
+#define TINY_SERIAL_RX_STAMPS_HPP_
+
+#include <tiny/container.hpp>
+
+#include <cstddef>
+#include <stdint.h>
+
+/** Receive timestamping: 0 - none, 1 - every octet, 2 - the first octet
+ *  of the idle line frames, see rx_stamp_mode.
+ */
+#ifndef TINY_SERIAL_RX_TIMESTAMPS
+# define TINY_SERIAL_RX_TIMESTAMPS 0
+#endif // TINY_SERIAL_RX_TIMESTAMPS
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** Receive timestamping modes. */
+enum rx_stamp_mode
+{
+  rx_stamp_none   = 0, /**< No timestamps, the clock is not read. */
+  rx_stamp_octets = 1, /**< Every octet buffered. */
+  rx_stamp_frames = 2  /**< The first octet of every idle line frame. */
+};
+
+/** Receive timestamps taken by the rx interrupt.
+ *
+ *  @tparam Mode Timestamping mode, see rx_stamp_mode.
+ *  @tparam Capacity The rx queue capacity.
+ *  @tparam ClockT Clock having static now(), read in the interrupt.
+ *  @tparam MaxFrames The number of the frame timestamps kept, as the
+ *    complete frames of idle_line_detector.
+ *
+ *  The octet timestamps are kept by the rx queue slots, so they follow
+ *  every way the octets leave the queue, consume and clear included. The
+ *  interrupt takes the head slot and the time before dispatching the octet
+ *  and stores the time if the octet is buffered, the reader takes the
+ *  time of the tail slot before popping.
+ *
+ *  The frame timestamps are the times of the first octets of the frames
+ *  closed by idle_line_detector, a frame merged with the following one
+ *  keeps the earlier time.
+ *
+ *  The none mode is empty and never reads the clock.
+ */
+template <int Mode, size_t Capacity, typename ClockT, size_t MaxFrames = 4>
+class rx_stamps
+{
+public:
+  /** Time point type. */
+  typedef uint32_t time_type;
+
+  /** Timestamping mode. */
+  static const rx_stamp_mode mode = rx_stamp_none;
+
+public:
+  /** Returns the time for the octet arriving, the interrupt context. */
+  time_type now(void) const { return 0; }
+
+  /** Stores the time of an octet buffered into the slot.
+   *
+   *  @param starts Whether the octet starts a frame.
+   */
+  void on_octet(size_t, time_type, bool) { }
+
+  /** Records the time of the frame closed. */
+  void on_frame(void) { }
+
+  /** Returns the time of the oldest frame and removes it, none kept. */
+  bool pop_frame(time_type&) { return false; }
+
+  /** Drops the frame times. */
+  void reset(void) { }
+};
+
+/** Receive timestamps of every octet. */
+template <size_t Capacity, typename ClockT, size_t MaxFrames>
+class rx_stamps<rx_stamp_octets, Capacity, ClockT, MaxFrames>
+{
+public:
+  /** Time point type. */
+  typedef uint32_t time_type;
+
+  /** Timestamping mode. */
+  static const rx_stamp_mode mode = rx_stamp_octets;
+
+public:
+  /** Returns the time for the octet arriving, the interrupt context. */
+  time_type now(void) const { return static_cast<time_type>(ClockT::now()); }
+
+  /** Stores the time of an octet buffered into the slot. */
+  void on_octet(size_t slot, time_type time, bool) { _times[slot] = time; }
+
+  /** Returns the time of the octet in the slot. */
+  time_type octet(size_t slot) const { return _times[slot]; }
+
+  /** Records the time of the frame closed. */
+  void on_frame(void) { }
+
+  /** Returns the time of the oldest frame and removes it, none kept. */
+  bool pop_frame(time_type&) { return false; }
+
+  /** Drops the frame times. */
+  void reset(void) { }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  time_type _times[Capacity];
+};
+
+/** Receive timestamps of the idle line frames. */
+template <size_t Capacity, typename ClockT, size_t MaxFrames>
+class rx_stamps<rx_stamp_frames, Capacity, ClockT, MaxFrames>
+{
+public:
+  /** Time point type. */
+  typedef uint32_t time_type;
+
+  /** Timestamping mode. */
+  static const rx_stamp_mode mode = rx_stamp_frames;
+
+public:
+  rx_stamps(void): _start(0) { }
+
+public:
+  /** Returns the time for the octet arriving, the interrupt context. */
+  time_type now(void) const { return static_cast<time_type>(ClockT::now()); }
+
+  /** Takes the time of an octet starting a frame. */
+  void on_octet(size_t, time_type time, bool starts)
+  {
+    if (starts) { _start = time; }
+  }
+
+  /** Records the time of the frame closed, must follow the detector. */
+  void on_frame(void) { _frames.push(_start); }
+
+  /** Returns the time of the oldest frame and removes it.
+   *
+   *  @return False if no frame recorded.
+   */
+  bool pop_frame(time_type& time)
+  {
+    if (_frames.empty()) { return false; }
+
+    time = _frames.pop();
+    return true;
+  }
+
+  /** Drops the frame times. */
+  void reset(void) { _frames.clear(); }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  time_type _start;
+  queue<time_type, MaxFrames + 1> _frames;
+};
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_RX_STAMPS_HPP_
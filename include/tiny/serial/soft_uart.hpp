@@ -0,0 +1,502 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_SOFT_UART_HPP_
+#define TINY_SERIAL_SOFT_UART_HPP_
+
+#include <cstddef>
+#include <stdint.h>
+
+#include <tiny/serial.hpp>
+#include <tiny/serial/rx_hooks.hpp>
+#include <tiny/serial/blocking.hpp>
+#include <tiny/container.hpp>
+#include <tiny/detail/interrupts.hpp>
+
+/** Soft uart buffers size. */
+#ifndef TINY_SOFT_UART_BUF_SIZE
+# define TINY_SOFT_UART_BUF_SIZE 16
+#endif // TINY_SOFT_UART_BUF_SIZE
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** Soft uart frame configurations, the values follow the Mega USART
+ *  control register layout as the hardware ports on Mega do.
+ */
+struct soft_uart_traits
+{
+  /** Port configuration. */
+  enum config
+  {
+    _8n1 = 0x06, _8n2 = 0x0e, _9n1 = 0x106, _9n2 = 0x10e,
+    _8e1 = 0x26, _8e2 = 0x2e, _9e1 = 0x126, _9e2 = 0x12e,
+    _8o1 = 0x36, _8o2 = 0x3e, _9o1 = 0x136, _9o2 = 0x13e
+  };
+};
+
+namespace detail
+{
+
+/** Soft uart frame format, the bits are sent LSB first with the start
+ *  bit in the bit 0.
+ */
+class soft_frame
+{
+public:
+  soft_frame(void):
+    _data_bits(8),
+    _parity(0),
+    _stop_bits(1)
+  {
+    // empty
+  }
+
+public:
+  /** Sets the format by soft_uart_traits::config. */
+  void configure(uint32_t config)
+  {
+    _data_bits = static_cast<uint8_t>(((config >> 1) & 0x03) + 5 + ((config & 0x100) != 0));
+    _parity    = static_cast<uint8_t>((config >> 4) & 0x03);
+    _stop_bits = (config & 0x08) != 0? 2: 1;
+  }
+
+  /** Returns the number of the bits sent, the start and stop ones too. */
+  size_t tx_bits(void) const { return 1 + _data_bits + (_parity != 0) + _stop_bits; }
+
+  /** Returns the number of the bits sampled, the first stop bit only. */
+  size_t rx_bits(void) const { return 2 + _data_bits + (_parity != 0); }
+
+  /** Returns the bits to send. */
+  uint16_t encode(uint16_t octet) const
+  {
+    const uint16_t data = static_cast<uint16_t>(octet & mask());
+    uint16_t word = static_cast<uint16_t>(data << 1);
+    size_t bit = 1 + _data_bits;
+    if (_parity != 0) { word = static_cast<uint16_t>(word | parity(data) << bit++); }
+
+    // stop bits and the idle line after them
+    return static_cast<uint16_t>(word | (0xffff << bit));
+  }
+
+  /** Takes the octet out of the bits sampled.
+   *
+   *  @return False on the parity or framing error.
+   */
+  bool decode(uint16_t word, uint16_t& octet) const
+  {
+    octet = static_cast<uint16_t>((word >> 1) & mask());
+    size_t bit = 1 + _data_bits;
+    if (_parity != 0 && ((word >> bit++) & 1) != parity(octet)) { return false; }
+    return ((word >> bit) & 1) != 0;
+  }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  uint16_t mask(void) const { return static_cast<uint16_t>((1u << _data_bits) - 1); }
+
+  //-----------------------------------------------------------------------------
+  unsigned int parity(uint16_t data) const
+  {
+    unsigned int ones = 0;
+    for (; data != 0; data = static_cast<uint16_t>(data & (data - 1))) { ++ones; }
+    // even parity makes the number of ones even, odd makes it odd
+    return (ones & 1) ^ (_parity == 3);
+  }
+
+private:
+  uint8_t _data_bits;
+  uint8_t _parity;    // 0 none, 2 even, 3 odd
+  uint8_t _stop_bits;
+};
+
+/** Receiver bit sampling state machine. */
+class soft_rx
+{
+public:
+  /** Sample results. */
+  enum result
+  {
+    rx_busy,   /**< More bits to sample. */
+    rx_done,   /**< The octet is received. */
+    rx_error,  /**< Parity or framing error. */
+    rx_glitch  /**< The start bit isn't confirmed, noise. */
+  };
+
+public:
+  soft_rx(void):
+    _word(0),
+    _bit(0)
+  {
+    // empty
+  }
+
+public:
+  /** Starts the frame, the start edge is seen. */
+  void begin(void)
+  {
+    _word = 0;
+    _bit  = 0;
+  }
+
+  /** Takes the line level in the middle of the next bit. */
+  result sample(bool level, const soft_frame& frame, uint16_t& octet)
+  {
+    if (_bit == 0 && level) { return rx_glitch; }
+
+    _word = static_cast<uint16_t>(_word | static_cast<uint16_t>(level) << _bit);
+    if (++_bit < frame.rx_bits()) { return rx_busy; }
+
+    return frame.decode(_word, octet)? rx_done: rx_error;
+  }
+
+private:
+  uint16_t _word;
+  uint8_t _bit;
+};
+
+/** Transmitter bit state machine. */
+class soft_tx
+{
+public:
+  soft_tx(void):
+    _word(0),
+    _bits(0)
+  {
+    // empty
+  }
+
+public:
+  /** Starts the frame. */
+  void begin(uint16_t word, size_t bits)
+  {
+    _word = word;
+    _bits = static_cast<uint8_t>(bits);
+  }
+
+  /** Takes the next level to drive.
+   *
+   *  @return False once the frame is over.
+   */
+  bool next(bool& level)
+  {
+    if (_bits == 0) { return false; }
+
+    level = (_word & 1) != 0;
+    _word = static_cast<uint16_t>(_word >> 1);
+    --_bits;
+    return true;
+  }
+
+private:
+  uint16_t _word;
+  uint8_t _bits;
+};
+
+} // namespace detail
+
+/** Software uart on a timer and a pin change interrupt.
+ *
+ *  @tparam HardwareT Timer and pins policy:
+ *    - void open(void), sets the pins and the timer up;
+ *    - unsigned long ticks_per_bit(unsigned long baud) const;
+ *    - bool rx(void) const, the rx pin level;
+ *    - void tx(bool level), drives the tx pin;
+ *    - void start_detect(bool enable), the rx pin change interrupt;
+ *    - void arm_rx(unsigned long delay), the rx compare interrupt after
+ *      the delay in ticks from now, next_rx(period) moves the compare by
+ *      the period from the last one, disarm_rx(void) stops it;
+ *    - arm_tx, next_tx and disarm_tx the same for the tx compare.
+ *  @tparam OctetT Octet type, unsigned char or unsigned short for 9 bits.
+ *  @tparam BufferSize Receive and transmit queue size.
+ *
+ *  The start edge arms the rx compare half a bit later, it confirms the
+ *  start bit and samples the next bits in their middle, the compare moves
+ *  by the bit time from the previous one so the interrupt latency doesn't
+ *  accumulate. The tx compare clocks the bits out. Up to 38400 bps, the
+ *  interrupt latency must stay well below the quarter of a bit.
+ *
+ *  Call handle_start_irq from the pin change interrupt, handle_rx_timer_irq
+ *  and handle_tx_timer_irq from the compare ones. The buffer methods have
+ *  the same contexts as basic_uart ones.
+ */
+template <typename HardwareT, typename OctetT = unsigned char,
+          size_t BufferSize = TINY_SOFT_UART_BUF_SIZE>
+class soft_uart : public serial<OctetT>
+{
+public:
+  /** Timer and pins policy type. */
+  typedef HardwareT hardware_type;
+
+  /** Buffer item type. */
+  typedef OctetT octet_type;
+
+  /** Buffer size. */
+  enum { buffer_size = BufferSize };
+
+  /** Receive hooks type. */
+  typedef rx_hooks<octet_type> hooks_type;
+
+public:
+  /** Creates a closed soft uart. */
+  explicit soft_uart(const hardware_type& hardware = hardware_type()):
+    _hw(hardware),
+    _period(0),
+    _listening(false),
+    _tx_busy(false),
+    _errors(0)
+  {
+    // empty
+  }
+
+  void open(baud_rate baud) override
+  {
+    open(static_cast<unsigned long>(baud), soft_uart_traits::_8n1);
+  }
+
+  /** Available octets in receive buffer. */
+  size_t available(void) const override
+  {
+    return _rx_buffer.size();
+  }
+
+  octet_type read(void) override
+  {
+    return async_read();
+  }
+
+  void write(octet_type b) override
+  {
+    while (!async_write(b)) { default_wait_policy::idle(); }
+  }
+
+public:
+  /** Opens the port, the tx line goes idle and the receiver listens.
+   *
+   *  @param config soft_uart_traits::config value.
+   */
+  void open(unsigned long baud, uint32_t config = soft_uart_traits::_8n1)
+  {
+    close();
+
+    _frame.configure(config);
+    _period = _hw.ticks_per_bit(baud);
+    _hw.open();
+    _hw.tx(true);
+    listen();
+  }
+
+  /** Closes the port dropping the buffered octets. */
+  void close(void)
+  {
+    ::tiny::detail::interrupt_guard guard;
+    _listening = false;
+    _tx_busy   = false;
+    _hw.start_detect(false);
+    _hw.disarm_rx();
+    _hw.disarm_tx();
+    _rx_buffer.clear();
+    _tx_buffer.clear();
+  }
+
+  /** Returns an octet or 0 if none. */
+  octet_type async_read(void)
+  {
+    return _rx_buffer.empty()? 0: _rx_buffer.pop();
+  }
+
+  /** Reads an octet if any.
+   *
+   *  @return False if nothing received.
+   */
+  bool try_read(octet_type& octet)
+  {
+    if (_rx_buffer.empty()) { return false; }
+
+    octet = _rx_buffer.pop();
+    return true;
+  }
+
+  /** Writes an octet asynchronously.
+   *
+   *  @return False if the buffer is full.
+   */
+  bool async_write(octet_type octet)
+  {
+    if (!_tx_buffer.push(octet)) { return false; }
+
+    kick();
+    return true;
+  }
+
+  /** Installs the handler called from the rx interrupt for every octet,
+   *  see basic_uart::on_rx.
+   */
+  void on_rx(typename hooks_type::octet_handler handler, void* context = nullptr)
+  {
+    ::tiny::detail::interrupt_guard guard;
+    _hooks.on_octet(handler, context);
+  }
+
+  /** Returns the contiguous octets received, see basic_uart::readable. */
+  size_t readable(const octet_type*& data) const
+  {
+    return _rx_buffer.readable(data);
+  }
+
+  /** Removes n octets returned by readable. */
+  void consume(size_t n)
+  {
+    _rx_buffer.consume(n);
+  }
+
+  /** Returns the contiguous room in the transmit buffer. */
+  size_t writable(octet_type*& data)
+  {
+    return _tx_buffer.writable(data);
+  }
+
+  /** Sends n octets written into the room returned by writable. */
+  void commit(size_t n)
+  {
+    if (n == 0) { return; }
+
+    _tx_buffer.commit(n);
+    kick();
+  }
+
+  /** Returns the number of the parity and framing errors. */
+  size_t errors(void) const { return _errors; }
+
+  /** Returns the timer and pins policy. */
+  const hardware_type& hardware(void) const { return _hw; }
+
+  /** The rx pin change interrupt handler. */
+  void handle_start_irq(void)
+  {
+    // the pin change vector may be shared with the other pins
+    if (!_listening || _hw.rx()) { return; }
+
+    _listening = false;
+    _hw.start_detect(false);
+    _hw.arm_rx(_period / 2);
+    _rx.begin();
+  }
+
+  /** The rx compare interrupt handler. */
+  void handle_rx_timer_irq(void)
+  {
+    uint16_t octet = 0;
+    switch (_rx.sample(_hw.rx(), _frame, octet))
+    {
+      case detail::soft_rx::rx_busy:
+        _hw.next_rx(_period);
+        return;
+
+      case detail::soft_rx::rx_done:
+        _hooks.dispatch(static_cast<octet_type>(octet), _rx_buffer);
+        break;
+
+      case detail::soft_rx::rx_error:
+        ++_errors;
+        break;
+
+      case detail::soft_rx::rx_glitch:
+        break;
+    }
+
+    // in the middle of the stop bit, the next start edge is ahead
+    _hw.disarm_rx();
+    listen();
+  }
+
+  /** The tx compare interrupt handler. */
+  void handle_tx_timer_irq(void)
+  {
+    bool level = true;
+    if (_tx.next(level))
+    {
+      _hw.tx(level);
+      _hw.next_tx(_period);
+      return;
+    }
+
+    // the last stop bit is over
+    if (_tx_buffer.empty())
+    {
+      _hw.disarm_tx();
+      _tx_busy = false;
+      return;
+    }
+
+    start_octet();
+    _hw.next_tx(_period);
+  }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  typedef queue<octet_type, buffer_size> queue_type;
+
+private:
+  soft_uart(const soft_uart&); // inhibit copy
+  soft_uart& operator=(const soft_uart&);
+
+private:
+  void listen(void)
+  {
+    _listening = true;
+    _hw.start_detect(true);
+  }
+
+  //-----------------------------------------------------------------------------
+  void kick(void)
+  {
+    ::tiny::detail::interrupt_guard guard;
+    if (_tx_busy) { return; }
+
+    _tx_busy = true;
+    start_octet();
+    _hw.arm_tx(_period);
+  }
+
+  //-----------------------------------------------------------------------------
+  void start_octet(void)
+  {
+    _tx.begin(_frame.encode(_tx_buffer.pop()), _frame.tx_bits());
+
+    bool start = false;
+    _tx.next(start);
+    _hw.tx(start);
+  }
+
+private:
+  hardware_type _hw;
+  detail::soft_frame _frame;
+  detail::soft_rx _rx;
+  detail::soft_tx _tx;
+  queue_type _rx_buffer;
+  queue_type _tx_buffer;
+  hooks_type _hooks;
+  unsigned long _period;
+  volatile bool _listening;
+  volatile bool _tx_busy;
+  volatile size_t _errors;
+};
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_SOFT_UART_HPP_
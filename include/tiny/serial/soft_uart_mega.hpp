@@ -0,0 +1,163 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_SOFT_UART_MEGA_HPP_
+#define TINY_SERIAL_SOFT_UART_MEGA_HPP_
+
+#include <tiny/serial/soft_uart.hpp>
+
+#include <Arduino.h>
+#include <avr/io.h>
+
+#include <inttypes.h>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** 16 bit timer registers used by the soft uart. */
+struct soft_timer_registers
+{
+  volatile uint16_t* tcnt;
+  volatile uint16_t* ocra;
+  volatile uint16_t* ocrb;
+  volatile uint8_t* tccra;
+  volatile uint8_t* tccrb;
+  volatile uint8_t* timsk;
+  volatile uint8_t* tifr;
+};
+
+/** Timer and pins of a soft uart on Mega.
+ *
+ *  A 16 bit timer runs free at F_CPU / 8, its compare A samples the rx
+ *  pin and compare B clocks the tx pin, so there is a soft port per timer
+ *  1, 3, 4 and 5, it takes the timer PWM pins over. The rx pin must have
+ *  a pin change interrupt.
+ *
+ *  @code
+ *  typedef tiny::io::soft_uart<tiny::io::soft_port_mega> soft_uart_type;
+ *  soft_uart_type soft1(tiny::io::soft_port_mega(10, 11, tiny::io::soft_port_mega::timer1()));
+ *
+ *  ISR(TIMER1_COMPA_vect) { soft1.handle_rx_timer_irq(); }
+ *  ISR(TIMER1_COMPB_vect) { soft1.handle_tx_timer_irq(); }
+ *  ISR(PCINT0_vect) { soft1.handle_start_irq(); }
+ *  @endcode
+ */
+class soft_port_mega
+{
+public:
+  soft_port_mega(uint8_t rx_pin, uint8_t tx_pin, const soft_timer_registers& timer):
+    _timer(timer),
+    _rx_pin(rx_pin),
+    _tx_pin(tx_pin),
+    _rx_port(portInputRegister(digitalPinToPort(rx_pin))),
+    _rx_mask(digitalPinToBitMask(rx_pin)),
+    _tx_port(portOutputRegister(digitalPinToPort(tx_pin))),
+    _tx_mask(digitalPinToBitMask(tx_pin)),
+    _pcmsk(digitalPinToPCMSK(rx_pin)),
+    _pcmsk_mask(static_cast<uint8_t>(_BV(digitalPinToPCMSKbit(rx_pin))))
+  {
+    // empty
+  }
+
+public:
+  static soft_timer_registers timer1(void)
+  {
+    const soft_timer_registers r = { &TCNT1, &OCR1A, &OCR1B, &TCCR1A, &TCCR1B, &TIMSK1, &TIFR1 };
+    return r;
+  }
+
+#if defined (TCNT3)
+  static soft_timer_registers timer3(void)
+  {
+    const soft_timer_registers r = { &TCNT3, &OCR3A, &OCR3B, &TCCR3A, &TCCR3B, &TIMSK3, &TIFR3 };
+    return r;
+  }
+
+  static soft_timer_registers timer4(void)
+  {
+    const soft_timer_registers r = { &TCNT4, &OCR4A, &OCR4B, &TCCR4A, &TCCR4B, &TIMSK4, &TIFR4 };
+    return r;
+  }
+
+  static soft_timer_registers timer5(void)
+  {
+    const soft_timer_registers r = { &TCNT5, &OCR5A, &OCR5B, &TCCR5A, &TCCR5B, &TIMSK5, &TIFR5 };
+    return r;
+  }
+#endif // TCNT3
+
+  /** Sets the pins and the timer up, after the Arduino init took the timers. */
+  void open(void)
+  {
+    pinMode(_rx_pin, INPUT_PULLUP);
+    digitalWrite(_tx_pin, HIGH);
+    pinMode(_tx_pin, OUTPUT);
+
+    *_timer.tccra = 0;
+    *_timer.tccrb = _BV(CS11); // F_CPU / 8, normal mode
+    *digitalPinToPCICR(_rx_pin) |= static_cast<uint8_t>(_BV(digitalPinToPCICRbit(_rx_pin)));
+  }
+
+  unsigned long ticks_per_bit(unsigned long baud) const { return (F_CPU / 8 + baud / 2) / baud; }
+
+  bool rx(void) const { return (*_rx_port & _rx_mask) != 0; }
+
+  void tx(bool level)
+  {
+    if (level) { *_tx_port |= _tx_mask; }
+    else       { *_tx_port &= static_cast<uint8_t>(~_tx_mask); }
+  }
+
+  void start_detect(bool enable)
+  {
+    if (enable) { *_pcmsk |= _pcmsk_mask; }
+    else        { *_pcmsk &= static_cast<uint8_t>(~_pcmsk_mask); }
+  }
+
+  void arm_rx(unsigned long delay)
+  {
+    *_timer.ocra = static_cast<uint16_t>(*_timer.tcnt + delay);
+    *_timer.tifr = _BV(OCF1A);
+    *_timer.timsk |= _BV(OCIE1A);
+  }
+
+  void next_rx(unsigned long period) { *_timer.ocra = static_cast<uint16_t>(*_timer.ocra + period); }
+
+  void disarm_rx(void) { *_timer.timsk &= static_cast<uint8_t>(~_BV(OCIE1A)); }
+
+  void arm_tx(unsigned long delay)
+  {
+    *_timer.ocrb = static_cast<uint16_t>(*_timer.tcnt + delay);
+    *_timer.tifr = _BV(OCF1B);
+    *_timer.timsk |= _BV(OCIE1B);
+  }
+
+  void next_tx(unsigned long period) { *_timer.ocrb = static_cast<uint16_t>(*_timer.ocrb + period); }
+
+  void disarm_tx(void) { *_timer.timsk &= static_cast<uint8_t>(~_BV(OCIE1B)); }
+
+private:
+  soft_timer_registers _timer;
+  uint8_t _rx_pin;
+  uint8_t _tx_pin;
+  volatile uint8_t* _rx_port;
+  uint8_t _rx_mask;
+  volatile uint8_t* _tx_port;
+  uint8_t _tx_mask;
+  volatile uint8_t* _pcmsk;
+  uint8_t _pcmsk_mask;
+};
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_SOFT_UART_MEGA_HPP_
@@ -0,0 +1,200 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+
+#ifndef TINY_SERIAL_TX_LANES_HPP_
+#define TINY_SERIAL_TX_LANES_HPP_
+
+#include <tiny/container.hpp>
+
+#include <cstddef>
+
+/** Urgent transmit queue size, one less octets. */
+#ifndef TINY_SERIAL_URGENT_BUF_SIZE
+# define TINY_SERIAL_URGENT_BUF_SIZE 4
+#endif // TINY_SERIAL_URGENT_BUF_SIZE
+
+/** The number of the frame marks in the transmit buffer, two per frame. */
+#ifndef TINY_SERIAL_FRAME_MARKS
+# define TINY_SERIAL_FRAME_MARKS 4
+#endif // TINY_SERIAL_FRAME_MARKS
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** Transmit buffer of two lanes, the bulk and the urgent one.
+ *
+ *  @tparam T Octet type.
+ *  @tparam BulkSize Bulk queue size.
+ *  @tparam UrgentSize Urgent queue size.
+ *  @tparam Marks The number of the frame marks.
+ *
+ *  The interrupt handler takes the urgent octets first unless the bulk
+ *  octets around are marked as a frame, then the urgent ones wait till the
+ *  frame end. A frame is marked by begin_frame and end_frame around its
+ *  octets, the marks are the bulk positions.
+ *
+ *  The producer side is the main loop or a single context of not higher
+ *  priority than the port interrupt, the consumer side, pop, is the port
+ *  interrupt handler. The queue interface is the bulk one, so the buffer
+ *  replaces the plain queue.
+ */
+template <typename T, size_t BulkSize, size_t UrgentSize = TINY_SERIAL_URGENT_BUF_SIZE,
+          size_t Marks = TINY_SERIAL_FRAME_MARKS>
+class tx_lanes
+{
+public:
+  /** Bulk queue type. */
+  typedef queue<T, BulkSize> bulk_type;
+
+  /** Item pointer. */
+  typedef typename bulk_type::pointer pointer;
+
+  /** The slot pop reports for the urgent octets. */
+  enum { urgent_slot = BulkSize };
+
+public:
+  tx_lanes(void):
+    _pushed(0),
+    _popped(0),
+    _open(false),
+    _in_frame(false)
+  {
+    // empty
+  }
+
+public:
+  /** Whether both lanes are empty. */
+  bool empty(void) const { return _bulk.empty() && _urgent.empty(); }
+
+  /** Whether room in the bulk lane. */
+  bool can_push(void) const { return _bulk.can_push(); }
+
+  /** Pushes into the bulk lane. */
+  bool push(const T& item)
+  {
+    if (!_bulk.push(item)) { return false; }
+    ++_pushed;
+    return true;
+  }
+
+  /** Returns the bulk slot the next item is pushed to. */
+  size_t head_index(void) const { return _bulk.head_index(); }
+
+  /** Returns the contiguous room in the bulk lane. */
+  size_t writable(pointer& data) { return _bulk.writable(data); }
+
+  /** Pushes n items written into the room returned by writable. */
+  void commit(size_t n)
+  {
+    _bulk.commit(n);
+    _pushed += n;
+  }
+
+  /** Pushes into the urgent lane. */
+  bool push_urgent(const T& item) { return _urgent.push(item); }
+
+  /** Whether a frame is open or its marks aren't passed yet. */
+  bool marked(void) const { return _open || !_marks.empty(); }
+
+  /** Marks the start of the frame at the current bulk position.
+   *
+   *  @return False if a frame is open or there is no room for the marks,
+   *    the frame isn't marked then.
+   */
+  bool begin_frame(void)
+  {
+    if (_open || Marks - _marks.size() < 2) { return false; }
+
+    _marks.push(_pushed);
+    _open = true;
+    return true;
+  }
+
+  /** Marks the end of the frame at the current bulk position. */
+  void end_frame(void)
+  {
+    if (!_open) { return; }
+
+    _marks.push(_pushed);
+    _open = false;
+  }
+
+  /** Takes the next octet to send, the interrupt handler side.
+   *
+   *  @return False if nothing may be sent now.
+   */
+  bool pop(T& item)
+  {
+    size_t slot;
+    return pop(item, slot);
+  }
+
+  /** Takes the next octet to send and its bulk slot, urgent_slot for the
+   *  urgent octets, the interrupt handler side.
+   *
+   *  @return False if nothing may be sent now.
+   */
+  bool pop(T& item, size_t& slot)
+  {
+    // the marks reached switch the frame state, the urgent octets go
+    // first at a boundary, even between the frames back to back
+    for (const size_t* mark = _marks.front(); mark != nullptr && *mark == _popped; mark = _marks.front())
+    {
+      if (!_in_frame && !_urgent.empty()) { break; }
+      _marks.pop();
+      _in_frame = !_in_frame;
+    }
+
+    if (!_in_frame && !_urgent.empty())
+    {
+      item = _urgent.pop();
+      slot = urgent_slot;
+      return true;
+    }
+
+    if (_bulk.empty()) { return false; }
+
+    slot = _bulk.tail_index();
+    item = _bulk.pop();
+    ++_popped;
+    return true;
+  }
+
+  /** Clears both lanes and the marks. */
+  void clear(void)
+  {
+    _bulk.clear();
+    _urgent.clear();
+    _marks.clear();
+    _pushed   = 0;
+    _popped   = 0;
+    _open     = false;
+    _in_frame = false;
+  }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  bulk_type _bulk;
+  queue<T, UrgentSize> _urgent;
+  queue<size_t, Marks + 1> _marks;
+  size_t _pushed; // producer side only
+  size_t _popped; // interrupt side only
+  bool _open;
+  bool _in_frame;
+};
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_TX_LANES_HPP_
@@ -12,6 +12,8 @@
 # include <tiny/serial/uart_mega.hpp>
 #elif defined (TINY_ARDUINO_DUE)
 # include <tiny/serial/uart_due.hpp>
+#elif defined (TINY_HOST)
+# include <tiny/serial/uart_host.hpp>
 #else
 # error "Tiny UART: Unknown Arduino platform!"
 #endif //defined (TINY_ARDUINO_MEGA)
@@ -0,0 +1,895 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+#ifndef TINY_SERIAL_UART_CORE_HPP_
+#define TINY_SERIAL_UART_CORE_HPP_
+
+#include <tiny/serial/rx_hooks.hpp>
+#include <tiny/serial/reactor.hpp>
+#include <tiny/serial/blocking.hpp>
+#include <tiny/serial/idle_line.hpp>
+#include <tiny/serial/tx_lanes.hpp>
+#include <tiny/serial/autobaud.hpp>
+#include <tiny/serial/rx_stamps.hpp>
+#include <tiny/serial/latency.hpp>
+#include <tiny/serial/capture.hpp>
+#include <tiny/serial/ports.hpp>
+
+#include <tiny/detail/interrupts.hpp>
+#include <tiny/container.hpp>
+#include <tiny/basic.hpp>
+#include <tiny/serial.hpp>
+
+#include <assert.h>
+#include <stdint.h>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+/** Buffered interrupt driven serial port, the same code for every target.
+ *
+ *  @tparam HardwareT Peripheral policy, see avr_usart, sam_usart and
+ *    host_usart. Everything is inlined, nothing is virtual:
+ *    - octet_type, config_type and clock_type (the timestamp clock with
+ *      static start and now) types;
+ *    - has_rx_timeout, max_rx_timeout, discards_errors (an octet with an
+ *      error is dropped), clock_in_micros and has_idle_timer constants;
+ *    - static config_type default_config(void);
+ *    - void open(unsigned long baud, config_type config), configures and
+ *      enables the peripheral and the rx interrupt, reconfigure the same
+ *      on the open port, close(void) disables it, bool opened(void) const;
+ *    - bool can_read(void) const, bool can_write(void) const,
+ *      bool drained(void) const, the shift register is empty;
+ *    - octet_type read(void), void write(octet_type);
+ *    - bool rx_error(void) const, void clear_rx_error(void);
+ *    - void enable_rx_irq(bool), void enable_tx_irq(bool),
+ *      bool tx_irq_enabled(void) const;
+ *    - bool rx_idle(void) const, void enable_idle_irq(bool),
+ *      void rx_timeout(unsigned long bits), void start_idle(void), the
+ *      receiver timeout if any;
+ *    - unsigned long autobaud(config_type config, unsigned long timeout),
+ *      the rate of the characters received or zero, returning in a gap
+ *      between the characters of the format;
+ *    - unsigned long char_bits(void) const, the bits of a character on
+ *      the line of the configured format, start, data, parity and stop;
+ *    - uint32_t micros(void) const, the idle line clock;
+ *    - void arm_idle_timer(uint32_t us), a one-shot interrupt in at least
+ *      us microseconds keeping an earlier one armed, and
+ *      bool idle_timer_due(void), whether it fired on the single port
+ *      vector, clearing it, if has_idle_timer.
+ *  @tparam RxSize The size of the receive buffer. Use pow of two for
+ *    optimizing indexing.
+ *  @tparam TxSize The size of the transmit buffer, the receive one by default.
+ *  @tparam Features port_feature flags, the timestamps and the latency
+ *    probes compiled in.
+ *
+ *  Call handle_irq for the single port interrupt vector (SAM), or
+ *  handle_rx_irq and handle_tx_irq for the rx complete and the data
+ *  register empty vectors (AVR), see call_irq_handler, and
+ *  handle_idle_timer_irq for the idle timer vector of its own if any.
+ */
+template <typename HardwareT, size_t RxSize, size_t TxSize = RxSize, unsigned int Features = default_port_features>
+class uart_core : public serial<typename HardwareT::octet_type>
+{
+public:
+  /** Peripheral policy type. */
+  typedef HardwareT hardware_type;
+
+  /** Buffer item type. */
+  typedef typename hardware_type::octet_type octet_type;
+
+  /** Possible port configuration. */
+  typedef typename hardware_type::config_type config_type;
+
+  /** Timestamp clock type. */
+  typedef typename hardware_type::clock_type clock_type;
+
+  /** Buffer sizes, buffer_size is the receive one. */
+  enum
+  {
+    buffer_size    = RxSize,
+    rx_buffer_size = RxSize,
+    tx_buffer_size = TxSize
+  };
+
+  /** Port features, see port_feature. */
+  enum { features = Features };
+
+  /** Receive hooks type, see pf_rx_hooks. */
+  typedef typename select_rx_hooks<octet_type, (Features & pf_rx_hooks) != 0>::type hooks_type;
+
+  /** Idle line frame delimiter type. */
+  typedef idle_line_detector<> idle_line_type;
+
+  /** Receive timestamps type, see pf_octet_stamps and pf_frame_stamps. */
+  typedef rx_stamps<port_stamp_mode(Features), rx_buffer_size, clock_type> stamps_type;
+
+  /** Receive queueing delay probe type, see pf_latency. */
+  typedef latency_probe<(Features & pf_latency) != 0, rx_buffer_size, clock_type> latency_type;
+
+  /** Transmit queueing delay probe type. */
+  typedef latency_probe<(Features & pf_latency) != 0, tx_buffer_size, clock_type> tx_latency_type;
+
+public:
+  /** Creates an uart. */
+  explicit uart_core(const hardware_type& hardware = hardware_type()):
+    _hw(hardware),
+    _baud(static_cast<unsigned long>(baud_rate::br_9600)),
+    _idle_bits(0),
+    _events(nullptr),
+    _slot(0),
+    _event_mask(0),
+    _capture(nullptr)
+  {
+    // empty
+  }
+
+  void open(baud_rate baud) override
+  {
+    open(static_cast<unsigned long>(baud), hardware_type::default_config());
+  }
+
+  /** Available bytes in receive cache. */
+  size_t available(void) const override
+  {
+    rx_lock lock(const_cast<uart_core*>(this));
+    return _rx_buffer.size();
+  }
+
+  octet_type read(void) override
+  {
+    return async_read();
+  }
+
+  void write(octet_type b) override
+  {
+    while (!async_write(b)) { default_wait_policy::idle(); }
+  }
+
+  /** Reads octets sleeping while waiting for them at most timeout ms,
+   *  main loop only.
+   *
+   *  @return Returns the number of octets read, less than size on timeout.
+   */
+  size_t read(octet_type* data, size_t size, unsigned long timeout)
+  {
+    return ::tiny::io::read(*this, data, size, timeout);
+  }
+
+  /** Reads octets until the delimiter (stored as well), size octets read
+   *  or timeout ms elapsed whatever comes first, main loop only.
+   *
+   *  @return Returns the number of octets read.
+   */
+  size_t read_until(octet_type* data, size_t size, octet_type delim, unsigned long timeout)
+  {
+    return ::tiny::io::read_until(*this, data, size, delim, timeout);
+  }
+
+  /** Writes octets sleeping while waiting for the room at most timeout ms,
+   *  main loop only.
+   *
+   *  @return Returns the number of octets written, less than size on timeout.
+   */
+  size_t write(const octet_type* data, size_t size, unsigned long timeout)
+  {
+    return ::tiny::io::write(*this, data, size, timeout);
+  }
+
+  /** Opens port.
+   *
+   *  @param baud Baud rate.
+   *  @param config Remaining port configuration like stop bits, parity and data bits.
+   */
+  void open(unsigned long baud, config_type config = hardware_type::default_config())
+  {
+    close();
+    _baud = baud;
+
+    if (stamps_type::mode != rx_stamp_none || latency_type::enabled) { clock_type::start(); }
+    _hw.open(baud, config);
+
+    idle_frames(_idle_bits);
+  }
+
+  /** Changes the rate and the format of the open port keeping the buffers.
+   *
+   *  Waits for the octets written to be sent at the current rate, the
+   *  transmit buffer and the shift register, then swaps the rate and the
+   *  format with the interrupts masked. The octets received stay in the
+   *  buffer, the one being received at the switch may be broken.
+   *
+   *  @param timeout The time to wait for the transmitter to drain, ms.
+   *  @return False on timeout, nothing is changed then.
+   */
+  bool reconfigure(unsigned long baud, config_type config, unsigned long timeout = 1000)
+  {
+    const default_wait_policy::time_type start = default_wait_policy::now();
+    while (!drained())
+    {
+      if (default_wait_policy::now() - start >= timeout) { return false; }
+      default_wait_policy::idle();
+    }
+
+    {
+      ::tiny::detail::interrupt_guard guard;
+      _hw.reconfigure(baud, config);
+      _baud = baud;
+    }
+
+    if (_idle_bits != 0) { idle_frames(_idle_bits); }
+    return true;
+  }
+
+  /** Whether everything written is sent, the shift register is empty. */
+  bool drained(void) const
+  {
+    tx_lock lock(const_cast<uart_core*>(this));
+    return _tx_buffer.empty() && _hw.drained();
+  }
+
+  /** Opens the port at the rate of the first characters received.
+   *
+   *  The rx pin edges are captured, detect_baud picks the rate. The port
+   *  opens once the line stays high for a character of the format after
+   *  the edges captured, so the next start bit is received, the
+   *  characters captured and the ones till the gap are lost. Rates from
+   *  1200 bps.
+   *
+   *  @param config Port configuration as for open.
+   *  @param timeout The time to wait for the first start bit, ms.
+   *  @return The rate detected or zero, the port stays closed then.
+   */
+  unsigned long open_autobaud(config_type config, unsigned long timeout = 1000)
+  {
+    close();
+
+    const unsigned long baud = _hw.autobaud(config, timeout);
+    if (baud != 0) { open(baud, config); }
+    return baud;
+  }
+
+  /** Opens the port at the rate detected, the default configuration. */
+  unsigned long open_autobaud(void)
+  {
+    return open_autobaud(hardware_type::default_config());
+  }
+
+  /** Closes port. */
+  void close(void)
+  {
+    _hw.close();
+    _rx_buffer.clear();
+    _tx_buffer.clear();
+    _idle.reset();
+    _stamps.reset();
+  }
+
+  /** Whether port opened. */
+  bool opened(void) const
+  {
+    return _hw.opened();
+  }
+
+  /** Returns an octet from the queue and remove it if remove is true.
+   *
+   *  @param remove If true remove octet from queue else leave it.
+   */
+  octet_type async_read(bool remove = true)
+  {
+    rx_lock lock(this);
+    if (_rx_buffer.empty()) { return 0; }
+
+    const typename queue_type::value_type c = *_rx_buffer.front();
+    if (remove) { pop_rx(); }
+    return c;
+  }
+
+  /** Reads an octet if any.
+   *
+   *  @return False if nothing received.
+   */
+  bool try_read(octet_type& octet)
+  {
+    rx_lock lock(this);
+    if (_rx_buffer.empty()) { return false; }
+
+    octet = pop_rx();
+    return true;
+  }
+
+  /** Reads an octet and the timestamp clock value at its interrupt, needs
+   *  pf_octet_stamps.
+   *
+   *  @return False if nothing received.
+   */
+  bool read_timestamped(octet_type& octet, uint32_t& time)
+  {
+    static_assert(stamps_type::mode == rx_stamp_octets, "Octet timestamps are off");
+
+    rx_lock lock(this);
+    if (_rx_buffer.empty()) { return false; }
+
+    time  = _stamps.octet(_rx_buffer.tail_index());
+    octet = pop_rx();
+    return true;
+  }
+
+  /** Installs the handler called from the rx interrupt for every octet.
+   *
+   *  If the handler returns true the octet is consumed and not buffered.
+   *  Pass nullptr to remove the handler.
+   */
+  void on_rx(typename hooks_type::octet_handler handler, void* context = nullptr)
+  {
+    static_assert((Features & pf_rx_hooks) != 0, "Rx hooks are off");
+
+    rx_lock lock(this);
+    _hooks.on_octet(handler, context);
+  }
+
+  /** Enables matching of the octet (e.g. a frame delimiter). Once it is
+   *  buffered the handler, if any, is called from the rx interrupt and
+   *  ev_rx_delimiter is signaled to the bound event word.
+   */
+  void on_match(octet_type match, typename hooks_type::match_handler handler = nullptr,
+                void* context = nullptr)
+  {
+    static_assert((Features & pf_rx_hooks) != 0, "Rx hooks are off");
+
+    rx_lock lock(this);
+    _hooks.on_match(match, handler, context);
+  }
+
+  /** Disables matching. */
+  void no_match(void)
+  {
+    static_assert((Features & pf_rx_hooks) != 0, "Rx hooks are off");
+
+    rx_lock lock(this);
+    _hooks.no_match();
+  }
+
+  /** Enables frame delimiting by the line silence (idle line).
+   *
+   *  A frame ends once the line is silent for the given number of bit
+   *  times, e.g. 3.5 characters of 11 bits (39) for Modbus RTU. The
+   *  peripherals having a receiver timeout (SAM USART) use it, the others
+   *  timestamp octets in the rx interrupt by micros(), 4us steps on Mega.
+   *  The idle timer if any closes the last frame of a burst and signals
+   *  ev_rx_delimiter from the interrupt, otherwise frame_ready finds it.
+   *  Pass zero to disable. The setting survives reopening.
+   *
+   *  Don't mix frame reading with the other rx side methods.
+   */
+  void idle_frames(size_t bit_times)
+  {
+    ::tiny::detail::interrupt_guard guard;
+    _idle_bits = bit_times;
+    _stamps.reset();
+
+    _hw.enable_idle_irq(false);
+    _hw.rx_timeout(0);
+
+    if (bit_times == 0) { _idle.disable(); return; }
+
+    if (hardware_type::has_rx_timeout)
+    {
+      _idle.enable();
+      const unsigned long max_bits = hardware_type::max_rx_timeout;
+      _hw.rx_timeout(bit_times < max_bits? bit_times: max_bits);
+      _hw.start_idle();
+      _hw.enable_idle_irq(true);
+    } else
+    {
+      _idle.enable(bit_times_us(bit_times, _baud), bit_times_us(_hw.char_bits(), _baud));
+    }
+  }
+
+  /** Whether a complete frame is received, see idle_frames. */
+  bool frame_ready(void)
+  {
+    rx_lock lock(this);
+
+    // the idle timer interrupt closes the frames otherwise
+    if (!hardware_type::has_idle_timer && _idle.timed() && _idle.poll(_hw.micros())) { _stamps.on_frame(); }
+    return _idle.frame_ready();
+  }
+
+  /** Reads the oldest complete frame, see idle_frames.
+   *
+   *  @return Returns the number of octets read, zero if no frame. The
+   *    octets not fitting into the buffer are discarded.
+   */
+  size_t read_frame(octet_type* data, size_t size)
+  {
+    uint32_t time;
+    return take_frame(data, size, time);
+  }
+
+  /** Reads the oldest complete frame and the timestamp clock value at its
+   *  first octet, needs pf_frame_stamps, see read_frame.
+   */
+  size_t read_frame(octet_type* data, size_t size, uint32_t& time)
+  {
+    static_assert(stamps_type::mode == rx_stamp_frames, "Frame timestamps are off");
+
+    return take_frame(data, size, time);
+  }
+
+  /** Returns the delays of the octets received from the interrupt to the
+   *  read in the timestamp clock ticks, needs pf_latency.
+   */
+  const latency_histogram& rx_latency(void) const
+  {
+    static_assert(latency_type::enabled, "Latency statistics are off");
+
+    return _rx_latency.histogram();
+  }
+
+  /** Returns the delays of the octets written from the buffer to the data
+   *  register, the urgent ones aren't counted, see rx_latency.
+   */
+  const latency_histogram& tx_latency(void) const
+  {
+    static_assert(latency_type::enabled, "Latency statistics are off");
+
+    return _tx_latency.histogram();
+  }
+
+  /** Clears the latency histograms. */
+  void reset_latency(void)
+  {
+    static_assert(latency_type::enabled, "Latency statistics are off");
+
+    rx_lock rx(this);
+    tx_lock tx(this);
+    _rx_latency.reset();
+    _tx_latency.reset();
+  }
+
+  /** Binds the port to the slot of the event word, see reactor.
+   *
+   *  The interrupts signal port_event flags of the mask to the slot, e.g.
+   *  ev_rx_delimiter only wakes the slot on the match octets, not on every
+   *  octet buffered.
+   */
+  void bind(event_word& events, size_t slot, unsigned int mask = ev_all)
+  {
+    assert(slot < event_word::max_slots && "uart_core::bind - slot is out of the event word");
+
+    ::tiny::detail::interrupt_guard guard;
+    _events     = &events;
+    _slot       = static_cast<uint8_t>(slot);
+    _event_mask = static_cast<uint8_t>(mask & ev_all);
+  }
+
+  /** Unbinds the port from the event word. */
+  void unbind(void)
+  {
+    ::tiny::detail::interrupt_guard guard;
+    _events = nullptr;
+  }
+
+  /** Records every octet received and sent into the log, the timestamp
+   *  clock for the times. Pass nullptr to stop.
+   */
+  void capture(capture_log* log)
+  {
+    ::tiny::detail::interrupt_guard guard;
+    if (log != nullptr) { clock_type::start(); }
+    _capture = log;
+  }
+
+  /** Returns the contiguous octets received, the rest if any follows
+   *  the ring wrap. Lets decoders work on the receive buffer in place.
+   *
+   *  @param data Receives the pointer to the first octet.
+   *  @return The number of the octets, see consume.
+   */
+  size_t readable(const octet_type*& data) const
+  {
+    return _rx_buffer.readable(data);
+  }
+
+  /** Removes n octets returned by readable. */
+  void consume(size_t n)
+  {
+    _rx_latency.on_pop(_rx_buffer.tail_index(), n);
+    _rx_buffer.consume(n);
+  }
+
+  /** Returns the contiguous room in the transmit buffer. Lets encoders
+   *  write into the buffer in place.
+   *
+   *  @param data Receives the pointer to the first free octet.
+   *  @return The number of the octets may be written, see commit.
+   */
+  size_t writable(octet_type*& data)
+  {
+    return _tx_buffer.writable(data);
+  }
+
+  /** Sends n octets written into the room returned by writable. */
+  void commit(size_t n)
+  {
+    if (n == 0) { return; }
+
+    tx_lock lock(this);
+    _tx_latency.on_push(_tx_buffer.head_index(), n);
+    _tx_buffer.commit(n);
+  }
+
+  /** Writes an octet asynchronously.
+   *
+   *  @return If were no write operation due to buffer overflow return false
+   *    else returns true.
+   *
+   *  Note that data is only pushed into the internal buffer and will be
+   *  sent as soon as possible if interrupts allowed. But if they are disabled
+   *  it's necessary to call it in a loop while it returns false.
+   */
+  bool async_write(octet_type octet)
+  {
+    // If the buffer and the data register are empty, just write the octet
+    // to the data register, it saves an interrupt per octet at high rates.
+    // Not within the marked frames, the marks count the buffered octets.
+    tx_lock lock(this);
+    if (_tx_buffer.empty() && !_tx_buffer.marked() && _hw.can_write())
+    {
+      write_port(octet);
+      _tx_latency.on_bypass();
+      return true;
+    }
+
+    if (!_tx_buffer.can_push()) { return false; }
+
+    _tx_latency.on_push(_tx_buffer.head_index());
+    _tx_buffer.push(octet);
+
+    return true;
+  }
+
+  /** Writes an octet ahead of the buffered ones, e.g. an acknowledge or
+   *  a flow control octet. It waits for the end of the frame being sent
+   *  if the frames are marked, see begin_frame.
+   *
+   *  @return False if the urgent queue is full.
+   */
+  bool async_write_urgent(octet_type octet)
+  {
+    tx_lock lock(this);
+    if (_tx_buffer.empty() && !_tx_buffer.marked() && _hw.can_write())
+    {
+      write_port(octet);
+      return true;
+    }
+
+    return _tx_buffer.push_urgent(octet);
+  }
+
+  /** Marks the start of a frame, the octets written till end_frame
+   *  aren't split by the urgent ones.
+   *
+   *  @return False if there is no room for the marks, the frame isn't
+   *    marked then.
+   */
+  bool begin_frame(void)
+  {
+    tx_lock lock(this);
+    return _tx_buffer.begin_frame();
+  }
+
+  /** Marks the end of the frame. */
+  void end_frame(void)
+  {
+    tx_lock lock(this);
+    _tx_buffer.end_frame();
+  }
+
+  /** Returns the peripheral policy. */
+  hardware_type& hardware(void) { return _hw; }
+
+  /** Returns the peripheral policy. */
+  const hardware_type& hardware(void) const { return _hw; }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  typedef queue<octet_type, rx_buffer_size> queue_type;
+  typedef tx_lanes<octet_type, tx_buffer_size> tx_buffer_type;
+
+private:
+  uart_core(const uart_core&); // inhibit copy
+  uart_core& operator=(const uart_core&);
+
+private:
+  //-----------------------------------------------------------------------------
+  // the capture records in the line order, so the access, the clock and
+  // the record go masked, a direct write or a nested handler may come
+  inline octet_type read_port(void)
+  {
+    if (_capture == nullptr) { return _hw.read(); }
+
+    ::tiny::detail::interrupt_guard guard;
+    const octet_type octet = _hw.read();
+    _capture->record(capture_log::rx, octet, clock_type::now());
+    return octet;
+  }
+
+  //-----------------------------------------------------------------------------
+  inline void write_port(octet_type word)
+  {
+    if (_capture == nullptr)
+    {
+      _hw.write(word);
+      return;
+    }
+
+    ::tiny::detail::interrupt_guard guard;
+    _hw.write(word);
+    _capture->record(capture_log::tx, word, clock_type::now());
+  }
+
+  //-----------------------------------------------------------------------------
+  inline void enable_rx_int(void) { _hw.enable_rx_irq(true); }
+
+  //-----------------------------------------------------------------------------
+  inline void disable_rx_int(void) { _hw.enable_rx_irq(false); }
+
+  //-----------------------------------------------------------------------------
+  inline void enable_tx_int(void) { _hw.enable_tx_irq(true); }
+
+  //-----------------------------------------------------------------------------
+  inline void disable_tx_int(void) { _hw.enable_tx_irq(false); }
+
+  //-----------------------------------------------------------------------------
+  inline void notify(unsigned int events)
+  {
+    if (_events != nullptr && (events & _event_mask) != 0) { _events->signal(_slot, events & _event_mask); }
+  }
+
+  //-----------------------------------------------------------------------------
+  octet_type pop_rx(void)
+  {
+    _rx_latency.on_pop(_rx_buffer.tail_index());
+    return _rx_buffer.pop();
+  }
+
+  //-----------------------------------------------------------------------------
+  size_t take_frame(octet_type* data, size_t size, uint32_t& time)
+  {
+    if (!frame_ready()) { return 0; }
+
+    rx_lock lock(this);
+    const size_t length = _idle.pop_frame();
+    size_t n            = 0;
+    _stamps.pop_frame(time);
+
+    for (size_t i = 0; i < length && !_rx_buffer.empty(); ++i)
+    {
+      const octet_type c = pop_rx();
+      if (n < size) { data[n++] = c; }
+    }
+
+    return n;
+  }
+
+  //-----------------------------------------------------------------------------
+  // interrupt handlers
+  void handle_rx_irq(void)
+  {
+    if (hardware_type::discards_errors && _hw.rx_error())
+    {
+      // discard the octet, e.g. of a parity error
+      read_port();
+      notify(ev_error);
+      return;
+    }
+
+    // the timestamp slot and the frame start, constant if timestamps are off
+    const uint32_t now = _stamps.now();
+    const size_t slot  = stamps_type::mode == rx_stamp_octets || latency_type::enabled?
+                         _rx_buffer.head_index(): 0;
+    bool starts        = stamps_type::mode == rx_stamp_frames && !_idle.in_frame();
+
+    // the slot is stamped before the octet is published
+    _rx_latency.on_push(slot);
+
+    // rx dispatch results are the same as ev_rx_data and ev_rx_delimiter
+    const octet_type c     = read_port();
+    const unsigned int res = _hooks.dispatch(c, _rx_buffer);
+    if (res != rx_none) { notify(res); }
+
+    if ((res & rx_buffered) == 0) { return; }
+
+    if (_idle.enabled())
+    {
+      // the timestamp clock counting microseconds is read once
+      const bool same_clock = hardware_type::clock_in_micros && stamps_type::mode != rx_stamp_none;
+      if (!_idle.timed()) { _idle.on_octet(); }
+      else
+      {
+        const uint32_t time = same_clock? now: _hw.micros();
+        const bool opens    = !_idle.in_frame();
+        const bool closed   = _idle.on_octet(time);
+        if (closed)
+        {
+          _stamps.on_frame();
+          starts = true;
+          notify(ev_rx_delimiter);
+        }
+
+        // a frame opened, the timer re-arms itself till the silence
+        if (hardware_type::has_idle_timer && (opens || closed)) { _hw.arm_idle_timer(_idle.silence_left(time)); }
+      }
+    }
+
+    _stamps.on_octet(slot, now, starts);
+  }
+
+  //-----------------------------------------------------------------------------
+  void handle_rx_idle_irq(void)
+  {
+    // re-arm, the counter starts again on the next octet
+    _hw.start_idle();
+    if (_idle.on_idle())
+    {
+      _stamps.on_frame();
+      notify(ev_rx_delimiter);
+    }
+  }
+
+  //-----------------------------------------------------------------------------
+  void handle_idle_timer_irq(void)
+  {
+    if (!_idle.enabled() || !_idle.timed()) { return; }
+
+    const uint32_t now = _hw.micros();
+    if (_idle.poll(now))
+    {
+      _stamps.on_frame();
+      notify(ev_rx_delimiter);
+    } else if (_idle.in_frame())
+    {
+      // octets came meanwhile, or no room for the frame length, retry
+      const uint32_t left = _idle.silence_left(now);
+      _hw.arm_idle_timer(left != 0? left: _idle.threshold());
+    }
+  }
+
+  //-----------------------------------------------------------------------------
+  void handle_tx_irq(void)
+  {
+    octet_type octet;
+    size_t slot;
+    if (_tx_buffer.pop(octet, slot))
+    {
+      write_port(octet);
+      _tx_latency.on_pop(slot);
+      if (!_tx_buffer.empty()) { return; }
+    }
+
+    // nothing to send now, urgent octets may wait for the frame end
+    disable_tx_int();
+    if (_tx_buffer.empty()) { notify(ev_tx_drained); }
+  }
+
+  //-----------------------------------------------------------------------------
+  void handle_irq(void)
+  {
+    if (!hardware_type::discards_errors && _hw.rx_error())
+    {
+      _hw.clear_rx_error();
+      notify(ev_error);
+    }
+
+    // the silence closes the frame before the next octet is counted
+    if (hardware_type::has_rx_timeout && _idle.enabled() && _hw.rx_idle())
+    {
+      handle_rx_idle_irq();
+    }
+
+    if (hardware_type::has_idle_timer && _hw.idle_timer_due())
+    {
+      handle_idle_timer_irq();
+    }
+
+    if (_hw.can_read())
+    {
+      handle_rx_irq();
+    }
+
+    if (_hw.tx_irq_enabled() && _hw.can_write())
+    {
+      handle_tx_irq();
+    }
+  }
+
+private:
+  ////////////////////////////////////////////////////////////////////////
+  // classes
+  struct rx_lock
+  {
+    rx_lock(uart_core* uart): _uart(uart) { _uart->disable_rx_int(); }
+    ~rx_lock(void) { _uart->enable_rx_int(); }
+
+  private:
+    uart_core* _uart;
+  };
+
+  struct tx_lock
+  {
+    tx_lock(uart_core* uart): _uart(uart) { _uart->disable_tx_int(); }
+    ~tx_lock(void) { _uart->enable_tx_int(); }
+
+  private:
+    uart_core* _uart;
+  };
+
+private:
+  ////////////////////////////////////////////////////////////////////////
+  // friends
+  template <typename UartT> friend inline void call_irq_handler(UartT& uart);
+  template <typename UartT> friend inline void call_rx_handler(UartT& uart);
+  template <typename UartT> friend inline void call_tx_handler(UartT& uart);
+  template <typename UartT> friend inline void call_idle_timer_handler(UartT& uart);
+
+private:
+  hardware_type _hw;
+  queue_type _rx_buffer;
+  tx_buffer_type _tx_buffer;
+  unsigned long _baud;
+  size_t _idle_bits;
+  idle_line_type _idle;
+  stamps_type _stamps;
+  latency_type _rx_latency;
+  tx_latency_type _tx_latency;
+  event_word* _events;
+  uint8_t _slot;
+  uint8_t _event_mask;
+  hooks_type _hooks; // next to the slot, the empty no_rx_hooks takes its padding
+  capture_log* _capture;
+};
+
+/** Runs the port interrupt handler, for the single port vector. */
+template <typename UartT>
+inline void call_irq_handler(UartT& uart)
+{
+  uart.handle_irq();
+}
+
+/** Runs the rx complete handler, for the separate rx vector. */
+template <typename UartT>
+inline void call_rx_handler(UartT& uart)
+{
+  uart.handle_rx_irq();
+}
+
+/** Runs the data register empty handler, for the separate tx vector. */
+template <typename UartT>
+inline void call_tx_handler(UartT& uart)
+{
+  uart.handle_tx_irq();
+}
+
+/** Runs the idle timer handler, for the separate idle timer vector. */
+template <typename UartT>
+inline void call_idle_timer_handler(UartT& uart)
+{
+  uart.handle_idle_timer_irq();
+}
+
+} // namespace io
+
+} // namespace tiny
+
+#endif // TINY_SERIAL_UART_CORE_HPP_
@@ -8,9 +8,9 @@
 
 #include <tiny/serial/detail/uart_due_defs.hpp>
 
-#include <tiny/container.hpp>
+#include <tiny/serial/uart_core.hpp>
+
 #include <tiny/basic.hpp>
-#include <tiny/serial.hpp>
 
 #include <Arduino.h>
 
@@ -29,12 +29,151 @@ namespace io
 /** The type of the uart. */
 enum port_kind
 {
-  usual,   /**< Usual com port.*/
-  extended /**< 9bit supporting uart.*/
+  usual,    /**< Usual com port.*/
+  extended, /**< 9bit supporting uart.*/
+  lite      /**< Dedicated UART peripheral, 8 bits only, no USART features.*/
 };
 
-/** Comport number. */
-enum port_num { com0, com1, com2, com3 };
+/** Comport number, com4 is the dedicated UART peripheral. */
+enum port_num { com0, com1, com2, com3, com4 };
+
+namespace detail
+{
+
+/** USART peripheral register access. */
+struct usart_peripheral
+{
+  /** Registers bundle type. */
+  typedef Usart registers_type;
+
+  /** Status and interrupt bits. */
+  typedef mask_field<uint32_t, US_CSR_RXRDY> rx_ready;
+  typedef mask_field<uint32_t, US_CSR_TXRDY> tx_ready;
+  typedef mask_field<uint32_t, US_CSR_TXEMPTY> tx_empty;
+  typedef mask_field<uint32_t, US_CSR_OVRE | US_CSR_FRAME | US_CSR_PARE> rx_errors;
+  typedef mask_field<uint32_t, US_CSR_TIMEOUT> rx_idle;
+
+  /** Whether the receiver timeout is supported. */
+  enum { has_rx_timeout = 1, max_rx_timeout = US_RTOR_TO_Msk };
+
+  /** Control commands. */
+  enum
+  {
+    cr_enable       = US_CR_RXEN | US_CR_TXEN,
+    cr_reset        = US_CR_RSTRX | US_CR_RSTTX | US_CR_RXDIS | US_CR_TXDIS,
+    cr_disable      = US_CR_RXDIS | US_CR_TXDIS,
+    cr_reset_status = US_CR_RSTSTA,
+    cr_start_idle   = US_CR_STTTO
+  };
+
+  static uint32_t status(const registers_type* r) { return r->US_CSR; }
+  static uint32_t read(const registers_type* r) { return r->US_RHR; }
+  static void write(registers_type* r, uint32_t v) { r->US_THR = v; }
+  static void enable_irq(registers_type* r, uint32_t m) { r->US_IER = m; }
+  static void disable_irq(registers_type* r, uint32_t m) { r->US_IDR = m; }
+  static uint32_t irq_mask(const registers_type* r) { return r->US_IMR; }
+  static void control(registers_type* r, uint32_t v) { r->US_CR = v; }
+  static void rx_timeout(registers_type* r, uint32_t bits) { r->US_RTOR = bits; }
+
+  /** Returns the bits of a character of the port mode. */
+  static unsigned long char_bits(const registers_type* r) { return mode_bits(r->US_MR); }
+
+  /** Returns the bits of a character of the mode, 1.5 stop bits count 2. */
+  static unsigned long mode_bits(uint32_t mode)
+  {
+    const unsigned long data   = (mode & US_MR_MODE9) != 0? 9: ((mode & US_MR_CHRL_Msk) >> US_MR_CHRL_Pos) + 5;
+    const unsigned long parity = (mode & US_MR_PAR_Msk) != US_MR_PAR_NO;
+    const unsigned long stop   = (mode & US_MR_NBSTOP_Msk) != US_MR_NBSTOP_1_BIT? 2: 1;
+    return 1 + data + parity + stop;
+  }
+
+  /** Disables PDC channel and configures mode and baud rate divisor. */
+  static void configure(registers_type* r, uint32_t mode, uint32_t brgr)
+  {
+    r->US_PTCR = US_PTCR_RXTDIS | US_PTCR_TXTDIS;
+    r->US_MR   = mode;
+    r->US_BRGR = brgr;
+  }
+
+  /** Whether the receiver or the transmitter enabled. */
+  static bool opened(const registers_type* r)
+  {
+    typedef mask_field<uint32_t, US_CR_RXEN> rxen;
+    typedef mask_field<uint32_t, US_CR_RXDIS> rxdis;
+    typedef mask_field<uint32_t, US_CR_TXEN> txen;
+    typedef mask_field<uint32_t, US_CR_TXDIS> txdis;
+
+    const uint32_t cr = r->US_CR;
+    return (rxen::is_set(cr) && !rxdis::is_set(cr)) || (txen::is_set(cr) && !txdis::is_set(cr));
+  }
+};
+
+/** UART peripheral register access. */
+struct uart_peripheral
+{
+  /** Registers bundle type. */
+  typedef Uart registers_type;
+
+  /** Status and interrupt bits. */
+  typedef mask_field<uint32_t, UART_SR_RXRDY> rx_ready;
+  typedef mask_field<uint32_t, UART_SR_TXRDY> tx_ready;
+  typedef mask_field<uint32_t, UART_SR_TXEMPTY> tx_empty;
+  typedef mask_field<uint32_t, UART_SR_OVRE | UART_SR_FRAME | UART_SR_PARE> rx_errors;
+  typedef mask_field<uint32_t, 0> rx_idle;
+
+  /** Whether the receiver timeout is supported. */
+  enum { has_rx_timeout = 0, max_rx_timeout = 0 };
+
+  /** Control commands. */
+  enum
+  {
+    cr_enable       = UART_CR_RXEN | UART_CR_TXEN,
+    cr_reset        = UART_CR_RSTRX | UART_CR_RSTTX | UART_CR_RXDIS | UART_CR_TXDIS,
+    cr_disable      = UART_CR_RXDIS | UART_CR_TXDIS,
+    cr_reset_status = UART_CR_RSTSTA,
+    cr_start_idle   = 0
+  };
+
+  static uint32_t status(const registers_type* r) { return r->UART_SR; }
+  static uint32_t read(const registers_type* r) { return r->UART_RHR; }
+  static void write(registers_type* r, uint32_t v) { r->UART_THR = v; }
+  static void enable_irq(registers_type* r, uint32_t m) { r->UART_IER = m; }
+  static void disable_irq(registers_type* r, uint32_t m) { r->UART_IDR = m; }
+  static uint32_t irq_mask(const registers_type* r) { return r->UART_IMR; }
+  static void control(registers_type* r, uint32_t v) { r->UART_CR = v; }
+  static void rx_timeout(registers_type*, uint32_t) { /* no receiver timeout */ }
+
+  /** Returns the bits of a character of the port mode. */
+  static unsigned long char_bits(const registers_type* r) { return mode_bits(r->UART_MR); }
+
+  /** Returns the bits of a character of the mode, 8 data and 1 stop bits. */
+  static unsigned long mode_bits(uint32_t mode)
+  {
+    return (mode & UART_MR_PAR_Msk) != UART_MR_PAR_NO? 11: 10;
+  }
+
+  /** Disables PDC channel and configures mode and baud rate divisor. */
+  static void configure(registers_type* r, uint32_t mode, uint32_t brgr)
+  {
+    r->UART_PTCR = UART_PTCR_RXTDIS | UART_PTCR_TXTDIS;
+    r->UART_MR   = mode;
+    r->UART_BRGR = brgr;
+  }
+
+  /** Whether the receiver or the transmitter enabled. */
+  static bool opened(const registers_type* r)
+  {
+    typedef mask_field<uint32_t, UART_CR_RXEN> rxen;
+    typedef mask_field<uint32_t, UART_CR_RXDIS> rxdis;
+    typedef mask_field<uint32_t, UART_CR_TXEN> txen;
+    typedef mask_field<uint32_t, UART_CR_TXDIS> txdis;
+
+    const uint32_t cr = r->UART_CR;
+    return (rxen::is_set(cr) && !rxdis::is_set(cr)) || (txen::is_set(cr) && !txdis::is_set(cr));
+  }
+};
+
+} // namespace detail
 
 /** Port type traits, just a generic declaration. */
 template <port_kind> struct port_kind_traits;
@@ -49,6 +188,9 @@ struct port_kind_traits<usual>
   /** The octet_type to be used. */
   typedef unsigned char octet_type;
 
+  /** Peripheral register access. */
+  typedef detail::usart_peripheral peripheral_type;
+
   /** Port configuration. */
   enum config
   {
@@ -71,6 +213,9 @@ struct port_kind_traits<extended>
   /** The octet_type to be used. */
   typedef unsigned short octet_type;
 
+  /** Peripheral register access. */
+  typedef detail::usart_peripheral peripheral_type;
+
   /** Port configuration. */
   enum config
   {
@@ -83,13 +228,49 @@ struct port_kind_traits<extended>
   };
 };
 
+/** Dedicated UART variant, 8 bits, parity or mark/space only. */
+template <>
+struct port_kind_traits<lite>
+{
+  /** Current port kind. */
+  enum { kind_of_port = static_cast<unsigned int>(lite) };
+
+  /** The octet_type to be used. */
+  typedef unsigned char octet_type;
+
+  /** Peripheral register access. */
+  typedef detail::uart_peripheral peripheral_type;
+
+  /** Port configuration. */
+  enum config
+  {
+    _8n1 = UART_MR_PAR_NO | UART_MR_CHMODE_NORMAL,
+    _8e1 = UART_MR_PAR_EVEN | UART_MR_CHMODE_NORMAL,
+    _8o1 = UART_MR_PAR_ODD | UART_MR_CHMODE_NORMAL,
+    _8m1 = UART_MR_PAR_MARK | UART_MR_CHMODE_NORMAL,
+    _8s1 = UART_MR_PAR_SPACE | UART_MR_CHMODE_NORMAL
+  };
+};
+
 /** Usual port traits type. */
 typedef port_kind_traits<usual> usual_port_traits;
 
 /** Extended port traits type. */
 typedef port_kind_traits<extended> extended_port_traits;
 
-/** Uart i/o control status registers bundle. */
+/** Dedicated UART traits type. */
+typedef port_kind_traits<lite> lite_port_traits;
+
+/** Sets the NVIC priority grouping, i.e. how many priority bits are the
+ *  preemption priority and how many are the sub-priority. Applies to all
+ *  the interrupts, call it before opening ports.
+ */
+inline void set_priority_grouping(uint32_t group)
+{
+  NVIC_SetPriorityGrouping(group);
+}
+
+/** Usart i/o control status registers bundle. */
 typedef Usart iocs_registers;
 
 /** Irq number type. */
@@ -106,41 +287,62 @@ typedef IRQn_Type irqn_type;
 # pragma message "Tiny serial buffer size is " XSTRINGIFY(TINY_SERIAL_DEF_BUF_SIZE)
 #endif // __GNUG__
 
-/** Serial port.
+/** Receive timestamp clock, the core cycle counter. */
+struct cycle_clock
+{
+  /** Enables the counter. */
+  static void start(void)
+  {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+
+  /** Returns the cycles counted, SystemCoreClock per second. */
+  static uint32_t now(void) { return DWT->CYCCNT; }
+};
+
+/** USART and UART peripheral policy of uart_core, see uart_core for the
+ *  interface.
  *
- *  @tparam Kind The type of port whether usual or extended see port_kind.
- *  @tparam BufferSize The size of the internal buffer. Use pow of two for
- *    optimizing indexing.
- *  @tparam PortKindTraits Port kind traits.
+ *  @tparam PortKindTraitsT Port kind traits.
  */
-template<
-  port_kind Kind,
-  size_t BufferSize = TINY_SERIAL_DEF_BUF_SIZE,
-  typename PortKindTraitsT = port_kind_traits<Kind> >
-class basic_uart : public serial<typename port_kind_traits<Kind>::octet_type>
+template <typename PortKindTraitsT>
+class sam_usart
 {
 public:
   /** Port kind traits type. */
   typedef PortKindTraitsT kind_traits_type;
 
-  /** Control and status register type. */
-  typedef ::tiny::register_type register_type;
+  /** Peripheral register access type. */
+  typedef typename kind_traits_type::peripheral_type peripheral_type;
 
-  /** Pointer to control and status register type. */
-  typedef register_type* /*const*/ register_ptr;
+  /** I/o control status registers bundle. */
+  typedef typename peripheral_type::registers_type iocs_registers;
 
   /** Buffer item type. */
   typedef typename kind_traits_type::octet_type octet_type;
 
-  /** Possible port configuration. */
-  typedef typename kind_traits_type::config config_type;
+  /** Possible port configuration, the mode register value. */
+  typedef uint32_t config_type;
 
-  /** Buffer size. */
-  enum { buffer_size = BufferSize };
+  /** Timestamp clock type. */
+  typedef cycle_clock clock_type;
+
+  /** The errors are reported, the octets are kept. No idle timer, the
+   *  UART frames are closed by the next octet or by frame_ready.
+   */
+  enum
+  {
+    has_rx_timeout  = peripheral_type::has_rx_timeout,
+    max_rx_timeout  = peripheral_type::max_rx_timeout,
+    discards_errors = 0,
+    clock_in_micros = 0,
+    has_idle_timer  = 0
+  };
 
 public:
-  /** Creates an uart. */
-  basic_uart(iocs_registers* regs, irqn_type irqn, uint32_t component_id):
+  /** Creates the policy over the peripheral. */
+  sam_usart(iocs_registers* regs, irqn_type irqn, uint32_t component_id):
     _regs(regs),
     _irqn(irqn),
     _comp_id(component_id)
@@ -148,274 +350,270 @@ public:
     // empty
   }
 
-  void open(baud_rate baud) override
-  {
-    open(static_cast<unsigned long>(baud), kind_traits_type::_8n1);
-  }
-
-  /** Available bytes in receive cache. */
-  size_t available(void) const override
-  {
-    rx_lock lock(const_cast<basic_uart*>(this));
-    return _rx_buffer.size();
-  }
-
-  octet_type read(void) override
-  {
-    return async_read();
-  }
-
-  void write(octet_type b) override
-  {
-    while (!async_write(b));
-  }
+  static config_type default_config(void) { return kind_traits_type::_8n1; }
 
-  /** Opens port.
-   *
-   *  @param baud_rate Baud rate.
-   *  @param Remaining port configuration like stop bits, parity and data bits.
-   */
-  void open(unsigned long baud_rate = baud_rate::br_9600, /*config_type*/uint32_t config = kind_traits_type::_8n1)
+  void open(unsigned long baud_rate, config_type config)
   {
-    close();
-    // baud rate settings
     // Configure PMC
     pmc_enable_periph_clk(_comp_id);
 
-    // Disable PDC channel
-    _regs->US_PTCR = US_PTCR_RXTDIS | US_PTCR_TXTDIS ;
-
-    // Configure mode
-    _regs->US_MR = config;
-
-    // Configure baudrate, asynchronous no oversampling
-    _regs->US_BRGR = (SystemCoreClock / baud_rate) / 16 ;
-//    USART_Configure(_regs, config, baud_rate, SystemCoreClock);
+    // Disable PDC channel, configure mode and baudrate,
+    // asynchronous no oversampling
+    peripheral_type::configure(_regs, config, (SystemCoreClock / baud_rate) / 16);
 
     // Configure interrupts
-    _regs->US_IDR = 0xffffffff;
-    _regs->US_IER = US_IER_RXRDY;// | US_IER_OVRE | US_IER_FRAME;
+    peripheral_type::disable_irq(_regs, 0xffffffff);
+    peripheral_type::enable_irq(_regs, peripheral_type::rx_ready::mask());
 
     // Enable UART interrupt in NVIC
     NVIC_EnableIRQ(_irqn);
 
     // Enable receiver and transmitter
-    _regs->US_CR = US_CR_RXEN | US_CR_TXEN;
+    peripheral_type::control(_regs, peripheral_type::cr_enable);
   }
 
-  /** Closes port. */
-  void close(void)
+  void reconfigure(unsigned long baud_rate, config_type config)
   {
-    // Reset and disable receiver and transmitter
-    _regs->US_CR = US_CR_RSTRX | US_CR_RSTTX | US_CR_RXDIS | US_CR_TXDIS;
-    _rx_buffer.clear();
-    _tx_buffer.clear();
+    peripheral_type::control(_regs, peripheral_type::cr_disable);
+    peripheral_type::configure(_regs, config, (SystemCoreClock / baud_rate) / 16);
+    peripheral_type::control(_regs, peripheral_type::cr_enable);
   }
 
-  /** Whether port opened. */
-  bool opened(void) const
+  /** Resets and disables receiver and transmitter. */
+  void close(void) { peripheral_type::control(_regs, peripheral_type::cr_reset); }
+
+  bool opened(void) const { return peripheral_type::opened(_regs); }
+
+  bool can_read(void) const { return peripheral_type::rx_ready::is_set(status()); }
+  bool can_write(void) const { return peripheral_type::tx_ready::is_set(status()); }
+  bool drained(void) const { return peripheral_type::tx_empty::is_set(status()); }
+
+  /** Whether overrun, framing or parity error occurred. */
+  bool rx_error(void) const { return peripheral_type::rx_errors::is_set(status()); }
+  void clear_rx_error(void) { peripheral_type::control(_regs, peripheral_type::cr_reset_status); }
+
+  /** Whether the receiver timed out, i.e. the line is idle. */
+  bool rx_idle(void) const { return peripheral_type::rx_idle::is_set(status()); }
+
+  octet_type read(void) const { return peripheral_type::read(_regs); }
+  void write(octet_type octet) { peripheral_type::write(_regs, octet); }
+
+  void enable_rx_irq(bool state) { irq(peripheral_type::rx_ready::mask(), state); }
+  void enable_tx_irq(bool state) { irq(peripheral_type::tx_ready::mask(), state); }
+  void enable_idle_irq(bool state) { irq(peripheral_type::rx_idle::mask(), state); }
+
+  bool tx_irq_enabled(void) const
   {
-    return (is_bit(_regs->US_CR, US_CR_RXEN) && !is_bit(_regs->US_CR, US_CR_RXDIS)) ||
-        (is_bit(_regs->US_CR, US_CR_TXEN) && !is_bit(_regs->US_CR, US_CR_TXDIS));
+    return peripheral_type::tx_ready::is_set(peripheral_type::irq_mask(_regs));
   }
 
-  /** Returns an octet from the queue and remove it if remove is true.
-   *
-   *  @param remove If true remove octet from queue else leave it.
-   */
-  octet_type async_read(bool remove = true)
-  {
-    rx_lock lock(this);
-    if (_rx_buffer.empty()) { return 0; }
+  void rx_timeout(unsigned long bits) { peripheral_type::rx_timeout(_regs, bits); }
+  void start_idle(void) { peripheral_type::control(_regs, peripheral_type::cr_start_idle); }
 
-    const typename queue_type::value_type c = *_rx_buffer.front();
-    if (remove) { _rx_buffer.pop(); }
-    return c;
-  }
+  unsigned long char_bits(void) const { return peripheral_type::char_bits(_regs); }
 
-  /** Writes an octet asynchronously.
+  uint32_t micros(void) const { return ::micros(); }
+  void arm_idle_timer(uint32_t) { /* no idle timer */ }
+  bool idle_timer_due(void) { return false; }
+
+  /** Captures the edges of the first characters received.
    *
-   *  @return If were no write operation due to buffer overflow return false
-   *    else returns true.
+   *  The rx pin is polled with the interrupts masked, the edges are
+   *  timestamped by the cycle counter and detect_baud picks the rate. It
+   *  returns once the line stays high for a character of the format, in
+   *  a gap, polled with the interrupts on.
    *
-   *  Note that data is only pushed into the internal buffer and will be
-   *  sent as soon as possible if interrupts allowed. But if they are disabled
-   *  it's necessary to call it in a loop while it returns false.
+   *  @return The rate detected or zero.
    */
-  bool async_write(octet_type octet)
+  unsigned long autobaud(config_type config, unsigned long timeout)
   {
-    tx_lock lock(this);
-    if (_tx_buffer.empty() && can_write())
+    Pio* pio      = nullptr;
+    uint32_t mask = 0;
+    rx_pin(pio, mask);
+
+    cycle_clock::start();
+
+    const unsigned long start = millis();
+    while ((pio->PIO_PDSR & mask) != 0)
     {
-      write_port(octet);
-      return true;
+      if (millis() - start >= timeout) { return 0; }
     }
 
-    if (!_tx_buffer.can_push()) { return false; }
+    uint32_t edges[TINY_SERIAL_AUTOBAUD_EDGES];
+    size_t n = 0;
+    {
+      ::tiny::detail::interrupt_guard guard;
+
+      // a character at 1200 bps fits into the idle limit of 10 ms
+      const uint32_t idle = SystemCoreClock / 100;
+      bool level          = false;
+      edges[n++]          = DWT->CYCCNT;
+      for (uint32_t last = edges[0]; n < TINY_SERIAL_AUTOBAUD_EDGES && DWT->CYCCNT - last < idle; )
+      {
+        if (((pio->PIO_PDSR & mask) != 0) == level) { continue; }
+
+        last       = DWT->CYCCNT;
+        level      = !level;
+        edges[n++] = last;
+      }
+    }
 
-    _tx_buffer.push(octet);
+    const unsigned long baud = detect_baud(edges, n, SystemCoreClock);
+    if (baud != 0)
+    {
+      const uint32_t gap = idle_gap(baud, peripheral_type::mode_bits(config), SystemCoreClock);
+      const unsigned long end = millis();
+      for (uint32_t last = DWT->CYCCNT; DWT->CYCCNT - last < gap && millis() - end < timeout; )
+      {
+        if ((pio->PIO_PDSR & mask) == 0) { last = DWT->CYCCNT; }
+      }
+    }
 
-    return true;
+    return baud;
   }
 
-//  /** Returns currently configured stop bits. */
-//  size_t stop_bits(void) const {}
-//
-//  /** Returns currently set parity mode. */
-//  parity_t parity(void) const {}
-//
-//  /** Returns the data bits currently set. */
-//  size_t data_bits(void) const {}
+  /** Sets the port interrupt priority. */
+  void priority(uint32_t preempt, uint32_t sub)
+  {
+    NVIC_SetPriority(_irqn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), preempt, sub));
+  }
 
   /** Returns registers bundle associated with the uart. */
   const iocs_registers* registers(void) const { return _regs; }
   irqn_type irq_num(void) const { return _irqn; }
   uint32_t component_id(void) const { return _comp_id; }
 
-
 //////////////////////////////////////////////////////////////////////////
 // private stuff
 
 private:
-  typedef queue<octet_type, buffer_size> queue_type;
-  typedef basic_uart<Kind, buffer_size, kind_traits_type> this_type;
-
-private:
-  basic_uart(const this_type&); // inhibit copy
-  this_type& operator=(const this_type&);
-
-private:
-  /** Whether receiver available for read. */
-  bool can_read(void) const
-  {
-    return is_bit(_regs->US_CSR, US_CSR_RXRDY);
-  }
-
-  /** Whether transmitter available for write. */
-  bool can_write(void) const
-  {
-    return is_bit(_regs->US_CSR, US_CSR_TXRDY);
-  }
-
   //-----------------------------------------------------------------------------
-  inline void write_octet(octet_type octet) const
-  {
-    _regs->US_THR = octet;
-  }
+  inline uint32_t status(void) const { return peripheral_type::status(_regs); }
 
   //-----------------------------------------------------------------------------
-  inline octet_type read_octet(void) const
+  inline void irq(uint32_t mask, bool state)
   {
-    return _regs->US_RHR;
+    if (state) { peripheral_type::enable_irq(_regs, mask); } else { peripheral_type::disable_irq(_regs, mask); }
   }
 
   //-----------------------------------------------------------------------------
-  inline octet_type read_port(void) const
+  void rx_pin(Pio*& pio, uint32_t& mask) const
   {
-    return read_octet();
+    switch (_comp_id)
+    {
+      case ID_USART0: pio = PIOA; mask = PIO_PA10A_RXD0; break;
+      case ID_USART1: pio = PIOA; mask = PIO_PA12A_RXD1; break;
+      case ID_USART2: pio = PIOB; mask = PIO_PB21A_RXD2; break;
+      case ID_USART3: pio = PIOD; mask = PIO_PD5B_RXD3;  break;
+      default:        pio = PIOA; mask = PIO_PA8A_URXD;  break;
+    }
   }
 
-  //-----------------------------------------------------------------------------
-  inline void write_port(octet_type word) const
-  {
-    write_octet(word);
-  }
+private:
+  iocs_registers* _regs;
+  irqn_type _irqn;
+  uint32_t _comp_id;
+};
 
-  //-----------------------------------------------------------------------------
-  inline void enable_rx_int(void) /*const*/
-  {
-    set_bit(_regs->US_IER, US_IER_RXRDY);
-  }
+/** Serial port.
+ *
+ *  @tparam Kind The type of port whether usual or extended see port_kind.
+ *  @tparam BufferSize The size of the internal buffer. Use pow of two for
+ *    optimizing indexing.
+ *  @tparam PortKindTraits Port kind traits.
+ *  @tparam TxBufferSize The size of the transmit buffer, BufferSize is the
+ *    receive one.
+ *  @tparam Features port_feature flags.
+ *
+ *  The buffers, the hooks and the interrupt handler are uart_core, this
+ *  is the peripheral policy and the NVIC priority.
+ *
+ *  Interrupt safety. The rx and the tx buffers are single producer, single
+ *  consumer rings shared with the port interrupt handler, the locks mask
+ *  the port interrupt source only. So:
+ *  - non-blocking rx side methods (available, async_read, try_read,
+ *    readable, consume, frame_ready, read_frame) may be called from a
+ *    single context at a time, the main loop or an interrupt of any
+ *    priority, including higher than the port one;
+ *  - non-blocking tx side methods (async_write, async_write_urgent,
+ *    writable, commit, begin_frame, end_frame) may be called from a single
+ *    context at a time whose priority is not higher than the port one,
+ *    otherwise it can interfere with the handler writing to THR;
+ *  - the blocking read, read_until and write are for the main loop only,
+ *    they sleep in WFI until the port handler runs, which never comes
+ *    from an interrupt it can't preempt;
+ *  - open, close, reconfiguration and hooks installation are for the main
+ *    loop only.
+ */
+template<
+  port_kind Kind,
+  size_t BufferSize = TINY_SERIAL_DEF_BUF_SIZE,
+  typename PortKindTraitsT = port_kind_traits<Kind>,
+  size_t TxBufferSize = BufferSize,
+  unsigned int Features = default_port_features>
+class basic_uart : public uart_core<sam_usart<PortKindTraitsT>, BufferSize, TxBufferSize, Features>
+{
+public:
+  /** Port kind traits type. */
+  typedef PortKindTraitsT kind_traits_type;
 
-  //-----------------------------------------------------------------------------
-  // enables/disables tx complete interrupt
-  inline void enable_tx_int(void) /*const*/
-  {
-    set_bit(_regs->US_IER, US_IER_TXRDY);
-  }
+  /** The core type. */
+  typedef uart_core<sam_usart<kind_traits_type>, BufferSize, TxBufferSize, Features> base_type;
 
-  //-----------------------------------------------------------------------------
-  // fixme: check interrupt control
-  inline void disable_rx_int(void) /*const*/
-  {
-    set_bit(_regs->US_IDR, US_IER_RXRDY);
-  }
+  /** Peripheral register access type. */
+  typedef typename kind_traits_type::peripheral_type peripheral_type;
 
-  //-----------------------------------------------------------------------------
-  inline void disable_tx_int(void) /*const*/
-  {
-    set_bit(_regs->US_IDR, US_IER_TXRDY);
-  }
+  /** I/o control status registers bundle. */
+  typedef typename peripheral_type::registers_type iocs_registers;
 
-  //-----------------------------------------------------------------------------
-  // interrupt handlers
-  void handle_rx_ready_irq(void)
-  {
-    // read after
-    const octet_type c = read_port();
-    // No Parity error, read byte and store it in the buffer if there is room
-    _rx_buffer.push(c);
-  }
+  /** Control and status register type. */
+  typedef ::tiny::register_type register_type;
 
-  //-----------------------------------------------------------------------------
-  void handle_tx_ready_irq(void)
-  {
-    if (_tx_buffer.empty())
-    {
-      // Buffer empty, so disable interrupts
-      disable_tx_int();
-    } else
-    {
-      write_port(_tx_buffer.pop());
-    }
-  }
+  /** Pointer to control and status register type. */
+  typedef register_type* /*const*/ register_ptr;
 
-  //-----------------------------------------------------------------------------
-  void handle_irq(void)
+public:
+  /** Creates an uart. */
+  basic_uart(iocs_registers* regs, irqn_type irqn, uint32_t component_id):
+    base_type(typename base_type::hardware_type(regs, irqn, component_id))
   {
-    if (can_read())
-    {
-      handle_rx_ready_irq();
-    }
-
-    if (can_write())
-    {
-      handle_tx_ready_irq();
-    }
+    // empty
   }
 
-private:
-  ////////////////////////////////////////////////////////////////////////
-  // classes
-  struct rx_lock
-  {
-    rx_lock(basic_uart* uart): _uart(uart) { _uart->disable_rx_int(); }
-    ~rx_lock(void) { _uart->enable_rx_int(); }
-
-  private:
-    basic_uart* _uart;
-  };
+  using base_type::open;
 
-  struct tx_lock
+  /** Opens port with the given interrupt priority.
+   *
+   *  @param baud_rate Baud rate.
+   *  @param config Remaining port configuration like stop bits, parity and data bits.
+   *  @param preempt Preemption priority, lower value is higher priority.
+   *  @param sub Sub-priority, see set_priority_grouping.
+   */
+  void open(unsigned long baud_rate, uint32_t config, uint32_t preempt, uint32_t sub = 0)
   {
-    tx_lock(basic_uart* uart): _uart(uart) { _uart->disable_tx_int(); }
-    ~tx_lock(void) { _uart->enable_tx_int(); }
+    priority(preempt, sub);
+    base_type::open(baud_rate, config);
+  }
 
-  private:
-    basic_uart* _uart;
-  };
+  /** Sets the port interrupt priority, see open. */
+  void priority(uint32_t preempt, uint32_t sub = 0)
+  {
+    this->hardware().priority(preempt, sub);
+  }
 
-private:
-  ////////////////////////////////////////////////////////////////////////
-  // friends
-  template <typename UartT> friend inline void call_irq_handler(UartT& uart);
+//  /** Returns currently configured stop bits. */
+//  size_t stop_bits(void) const {}
+//
+//  /** Returns currently set parity mode. */
+//  parity_t parity(void) const {}
+//
+//  /** Returns the data bits currently set. */
+//  size_t data_bits(void) const {}
 
-private:
-  iocs_registers* _regs;
-  irqn_type _irqn;
-  uint32_t _comp_id;
-  queue_type _rx_buffer;
-  queue_type _tx_buffer;
+  /** Returns registers bundle associated with the uart. */
+  const iocs_registers* registers(void) const { return this->hardware().registers(); }
+  irqn_type irq_num(void) const { return this->hardware().irq_num(); }
+  uint32_t component_id(void) const { return this->hardware().component_id(); }
 };
 
 /** Usual com port type declaration. */
@@ -424,79 +622,64 @@ typedef basic_uart<usual> usual_uart;
 /** Usual com port type declaration. */
 typedef basic_uart<extended> extended_uart;
 
+/** Dedicated UART type declaration. */
+typedef basic_uart<lite> lite_uart;
+
 namespace detail
 {
 
-/** Generic instance factory declaration. */
-template <port_kind Kind, port_num Num> inline basic_uart<Kind>& uart_instance(void);
-
-// <=8 bit
+/** The peripheral of the port, its registers, vector and component id. */
+template <port_num Num> struct port_peripheral;
 
-/** Returns a reference to uart0, 8bit max. */
-template <> inline basic_uart<usual>& uart_instance<usual, com0>(void)
+template <> struct port_peripheral<com0>
 {
-  //static basic_uart<port_kind::usual> port(UART, UART_IRQn, ID_UART);
-  static basic_uart<usual> port(USART0, USART0_IRQn, ID_USART0);
-
-  return port;
-}
-
-/** Returns a reference to uart1, 8bit max. */
-template <> inline basic_uart<usual>& uart_instance<usual, com1>(void)
-{
-  static basic_uart<usual> port(USART1, USART1_IRQn, ID_USART1);
-
-  return port;
-}
+  static Usart* registers(void) { return USART0; }
+  static irqn_type irq_num(void) { return USART0_IRQn; }
+  enum { component_id = ID_USART0 };
+};
 
-/** Returns a reference to uart2, 8bit max. */
-template <> inline basic_uart<usual>& uart_instance<usual, com2>(void)
+template <> struct port_peripheral<com1>
 {
-  static basic_uart<usual> port(USART2, USART2_IRQn, ID_USART2);
-
-  return port;
-}
+  static Usart* registers(void) { return USART1; }
+  static irqn_type irq_num(void) { return USART1_IRQn; }
+  enum { component_id = ID_USART1 };
+};
 
-/** Returns a reference to uart3, 8bit max. */
-template <> inline basic_uart<usual>& uart_instance<usual, com3>(void)
+template <> struct port_peripheral<com2>
 {
-  static basic_uart<usual> port(USART3, USART3_IRQn, ID_USART3);
-
-  return port;
-}
-
-// 9 bit
+  static Usart* registers(void) { return USART2; }
+  static irqn_type irq_num(void) { return USART2_IRQn; }
+  enum { component_id = ID_USART2 };
+};
 
-/** Returns a reference to uart0, 9bit max. */
-template <> inline basic_uart<extended>& uart_instance<extended, com0>(void)
+template <> struct port_peripheral<com3>
 {
-  static basic_uart<extended> port(USART0, USART0_IRQn, ID_USART0);
-
-  return port;
-}
+  static Usart* registers(void) { return USART3; }
+  static irqn_type irq_num(void) { return USART3_IRQn; }
+  enum { component_id = ID_USART3 };
+};
 
-/** Returns a reference to uart1, 9bit max. */
-template <> inline basic_uart<extended>& uart_instance<extended, com1>(void)
+/** The dedicated UART. */
+template <> struct port_peripheral<com4>
 {
-  static basic_uart<extended> port(USART1, USART1_IRQn, ID_USART1);
-
-  return port;
-}
+  static Uart* registers(void) { return UART; }
+  static irqn_type irq_num(void) { return UART_IRQn; }
+  enum { component_id = ID_UART };
+};
 
-/** Returns a reference to uart2, 9bit max. */
-template <> inline basic_uart<extended>& uart_instance<extended, com2>(void)
+/** Returns a reference to the uart of the port, built on the first use. */
+template <typename UartT, port_num Num> inline UartT& port_instance(void)
 {
-  static basic_uart<extended> port(USART2, USART2_IRQn, ID_USART2);
+  typedef port_peripheral<Num> peripheral;
+  static UartT port(peripheral::registers(), peripheral::irq_num(), peripheral::component_id);
 
   return port;
 }
 
-/** Returns a reference to uart3, 9bit max. */
-template <> inline basic_uart<extended>& uart_instance<extended, com3>(void)
+/** Returns a reference to the uart of the port kind with the default buffers. */
+template <port_kind Kind, port_num Num> inline basic_uart<Kind>& uart_instance(void)
 {
-  static basic_uart<extended> port(USART3, USART3_IRQn, ID_USART3);
-
-  return port;
+  return port_instance<basic_uart<Kind>, Num>();
 }
 
 } // namespace detail
@@ -546,56 +729,139 @@ typedef com_port<extended, com2> extended_port2;
 /** 9bit max, com3 type. */
 typedef com_port<extended, com3> extended_port3;
 
-// Serial 0 Arduino doesn't provide it at all, but we do.
-// Note that not all of the SAM MCU have four ports
-// For this port pins 52 and 11 on Arduino board are used
-#ifdef TINY_HAS_HWSERIAL0
-  inline void init_serial0(void)
+/** Dedicated UART, 8bit max, com4 type. */
+typedef com_port<lite, com4> lite_port4;
+
+/** The peripheral of the registry port number, Arduino numbering:
+ *  serial0 is USART2, serial1 USART0, serial2 USART1, serial3 USART3 and
+ *  4 is the dedicated UART.
+ */
+constexpr port_num port_of_serial(unsigned int num)
+{
+  return num == 0? com2 : num == 1? com0 : num == 2? com1 : num == 3? com3 : com4;
+}
+
+#if defined(TINY_HAS_HWSERIAL1)
+# define TINY_DUE_CORE_DROPPED_1 true
+#else
+# define TINY_DUE_CORE_DROPPED_1 false
+#endif
+#if defined(TINY_HAS_HWSERIAL2)
+# define TINY_DUE_CORE_DROPPED_2 true
+#else
+# define TINY_DUE_CORE_DROPPED_2 false
+#endif
+#if defined(TINY_HAS_HWSERIAL3)
+# define TINY_DUE_CORE_DROPPED_3 true
+#else
+# define TINY_DUE_CORE_DROPPED_3 false
+#endif
+#if defined(TINY_HAS_HWUART)
+# define TINY_DUE_CORE_DROPPED_4 true
+#else
+# define TINY_DUE_CORE_DROPPED_4 false
+#endif
+
+namespace detail
+{
+
+/** Whether the Arduino core object and handler of the registry port are
+ *  dropped by arduino-patch/variant.patch, the TINY_HAS_HWSERIALn and
+ *  TINY_HAS_HWUART defines of the build. The core has no serial0.
+ */
+constexpr bool core_port_dropped[] =
+{
+  true, TINY_DUE_CORE_DROPPED_1, TINY_DUE_CORE_DROPPED_2, TINY_DUE_CORE_DROPPED_3, TINY_DUE_CORE_DROPPED_4
+};
+
+} // namespace detail
+
+#undef TINY_DUE_CORE_DROPPED_1
+#undef TINY_DUE_CORE_DROPPED_2
+#undef TINY_DUE_CORE_DROPPED_3
+#undef TINY_DUE_CORE_DROPPED_4
+
+/** Due ports of port_registry, serial0..3 of 9 bits and the 8 bit
+ *  dedicated UART as 4.
+ */
+struct target_ports
+{
+  enum
+  {
+    ports_mask     = 0x1f,
+    nine_bits_mask = 0x0f
+  };
+
+  /** The uart type of the port declaration. */
+  template <typename DeclT>
+  struct uart
   {
-    const PinDescription desc = {
-        // USART2 (serial0) all pins
-        PIOB, PIO_PB20A_TXD2 | PIO_PB21A_RXD2, ID_PIOB, PIO_PERIPH_A, PIO_DEFAULT, (PIN_ATTR_DIGITAL|PIN_ATTR_COMBO), NO_ADC, NO_ADC, NOT_ON_PWM, NOT_ON_TIMER
-    };
+    static const port_kind kind = DeclT::number == 4? lite : DeclT::wide? extended : usual;
+
+    typedef basic_uart<
+      kind,
+      DeclT::rx_size != 0? DeclT::rx_size : TINY_SERIAL_DEF_BUF_SIZE,
+      port_kind_traits<kind>,
+      DeclT::tx_size != 0? DeclT::tx_size : TINY_SERIAL_DEF_BUF_SIZE,
+      DeclT::features> type;
+  };
 
-    PIO_Configure(desc.pPort, desc.ulPinType, desc.ulPin, desc.ulPinConfiguration);
+  /** Returns the instance of the port number. */
+  template <typename UartT, unsigned int Num>
+  static UartT& instance(void)
+  {
+    return detail::port_instance<UartT, port_of_serial(Num)>();
   }
+};
 
-# if (TINY_HAS_HWSERIAL0 == 9)
-  extended_uart& serial0(void);
-# else
-  usual_uart& serial0(void);
-# endif // TINY_HAS_HWSERIAL0 == 9
-#endif // TINY_HAS_HWSERIAL0
-
-// Serial 1
-#ifdef TINY_HAS_HWSERIAL1
-# if TINY_HAS_HWSERIAL1 == 9
-  extended_uart& serial1(void);
-# else
-  usual_uart& serial1(void);
-# endif // TINY_HAS_HWSERIAL1 == 9
-#endif // TINY_HAS_HWSERIAL1
-
-// Serial 2
-#ifdef TINY_HAS_HWSERIAL2
-# if TINY_HAS_HWSERIAL2 == 9
-  extended_uart& serial2(void);
-# else
-  usual_uart& serial2(void);
-# endif // TINY_HAS_HWSERIAL2 == 9
-#endif // TINY_HAS_HWSERIAL2
-
-// Serial 3
-#ifdef TINY_HAS_HWSERIAL3
-# if TINY_HAS_HWSERIAL3 == 9
-  extended_uart& serial3(void);
-# else
-  usual_uart& serial3(void);
-# endif // TINY_HAS_HWSERIAL3 == 9
-#endif // TINY_HAS_HWSERIAL3
+/** The port of the registry, see port_registry.
+ *
+ *  typedef port_registry<port_decl<1, nine_bits>, port_decl<4> > ports;
+ *  serial_port<ports, 1>::instance().open(19200, extended_port_traits::_9n1);
+ */
+template <typename RegistryT, unsigned int Num>
+using serial_port = registered_port<RegistryT, Num, target_ports>;
+
+// Serial 0 Arduino doesn't provide it at all, but we do.
+// Note that not all of the SAM MCU have four ports
+// For this port pins 52 and 11 on Arduino board are used
+inline void init_serial0(void)
+{
+  const PinDescription desc = {
+      // USART2 (serial0) all pins
+      PIOB, PIO_PB20A_TXD2 | PIO_PB21A_RXD2, ID_PIOB, PIO_PERIPH_A, PIO_DEFAULT, (PIN_ATTR_DIGITAL|PIN_ATTR_COMBO), NO_ADC, NO_ADC, NOT_ON_PWM, NOT_ON_TIMER
+  };
+
+  PIO_Configure(desc.pPort, desc.ulPinType, desc.ulPin, desc.ulPinConfiguration);
+}
 
 } // namespace io
 
 } // namespace tiny
 
+/** The handler of the port, TINY_SERIAL_PORTS defines it. */
+#define TINY_DUE_PORT_HANDLER(RegistryT, Num, Handler) \
+  void Handler(void) \
+  { \
+    ::tiny::io::call_irq_handler(::tiny::io::serial_port<RegistryT, Num>::instance()); \
+  }
+
+/** The handler of the port the Arduino core has, its object must be
+ *  dropped or the linker finds the handler twice.
+ */
+#define TINY_DUE_CORE_PORT_HANDLER(RegistryT, Num, Handler, Define) \
+  static_assert(::tiny::io::detail::core_port_dropped[Num], \
+                "The Arduino core keeps " #Handler " of port " #Num ": apply arduino-patch/variant.patch " \
+                "and define " Define " on the command line of the whole build, the core included"); \
+  TINY_DUE_PORT_HANDLER(RegistryT, Num, Handler)
+
+#define TINY_SERIAL_PORT_HANDLERS_0(RegistryT) TINY_DUE_PORT_HANDLER(RegistryT, 0, USART2_Handler)
+#define TINY_SERIAL_PORT_HANDLERS_1(RegistryT) TINY_DUE_CORE_PORT_HANDLER(RegistryT, 1, USART0_Handler, "TINY_HAS_HWSERIAL1")
+#define TINY_SERIAL_PORT_HANDLERS_2(RegistryT) TINY_DUE_CORE_PORT_HANDLER(RegistryT, 2, USART1_Handler, "TINY_HAS_HWSERIAL2")
+#define TINY_SERIAL_PORT_HANDLERS_3(RegistryT) TINY_DUE_CORE_PORT_HANDLER(RegistryT, 3, USART3_Handler, "TINY_HAS_HWSERIAL3")
+#define TINY_SERIAL_PORT_HANDLERS_4(RegistryT) TINY_DUE_CORE_PORT_HANDLER(RegistryT, 4, UART_Handler, "TINY_HAS_HWUART")
+
+/** No vectors shared by the ports. */
+#define TINY_SERIAL_TARGET_HANDLERS(RegistryT, ...)
+
 #endif // TINY_SERIAL_UART_ARDUINO_DUE_HPP_
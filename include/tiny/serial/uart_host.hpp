@@ -0,0 +1,318 @@
+// Arduino async serial port library with nine data bits support.
+//
+// 2015, (c) Gk Ltd.
+// MIT License
+
+#ifndef TINY_SERIAL_UART_HOST_HPP_
+#define TINY_SERIAL_UART_HOST_HPP_
+
+#include <tiny/serial/uart_core.hpp>
+
+#include <stdint.h>
+
+/** Library root namespace. */
+namespace tiny
+{
+
+/** IO Library root namespace. */
+namespace io
+{
+
+#ifndef TINY_SERIAL_DEF_BUF_SIZE
+# define TINY_SERIAL_DEF_BUF_SIZE 32
+#endif // TINY_SERIAL_DEF_BUF_SIZE
+
+/** Host timestamp clock, microseconds set by the test. */
+struct host_clock
+{
+  /** Nothing to enable. */
+  static void start(void) {}
+
+  /** Returns the microseconds passed. */
+  static uint32_t now(void) { return ticks(); }
+
+  /** Returns the clock value to set or to advance. */
+  static uint32_t& ticks(void)
+  {
+    static uint32_t value = 0;
+    return value;
+  }
+};
+
+/** Host USART model, a SAM alike peripheral with a single interrupt
+ *  vector. The test plays the line side by shift_in and shift_out and
+ *  calls the handler while irq_pending. The idle timer fires once
+ *  host_clock reaches the deadline.
+ */
+struct host_usart_registers
+{
+  host_usart_registers(void):
+    rx_data(0), rx_ready(false), tx_data(0), tx_ready(true), tx_empty(true),
+    rx_error(false), rx_idle(false), rx_irq(false), tx_irq(false), idle_irq(false),
+    enabled(false), baud(0), config(0), rx_timeout(0), idle_timer(false), idle_deadline(0),
+    on_write(nullptr), context(nullptr)
+  {
+    // empty
+  }
+
+  /** Receives the octet, an overrun if the previous one isn't read. */
+  void shift_in(uint16_t octet)
+  {
+    if (rx_ready) { rx_error = true; }
+    rx_data  = octet;
+    rx_ready = true;
+  }
+
+  /** Sends the octet of the data register if any. */
+  bool shift_out(uint16_t& octet)
+  {
+    if (tx_ready) { return false; }
+
+    octet    = tx_data;
+    tx_ready = true;
+    tx_empty = true;
+    return true;
+  }
+
+  /** Whether the idle timer is armed and its deadline passed. */
+  bool idle_timer_due(void) const
+  {
+    return idle_timer && static_cast<int32_t>(host_clock::now() - idle_deadline) >= 0;
+  }
+
+  /** Whether an enabled interrupt source is active. */
+  bool irq_pending(void) const
+  {
+    return enabled && ((rx_irq && (rx_ready || rx_error)) || (tx_irq && tx_ready) || (idle_irq && rx_idle) ||
+                       idle_timer_due());
+  }
+
+  uint16_t rx_data;
+  bool rx_ready;
+  uint16_t tx_data;
+  bool tx_ready;
+  bool tx_empty;
+  bool rx_error;
+  bool rx_idle;
+  bool rx_irq;
+  bool tx_irq;
+  bool idle_irq;
+  bool enabled;
+  unsigned long baud;
+  uint32_t config;
+  unsigned long rx_timeout;
+  bool idle_timer;
+  uint32_t idle_deadline;
+
+  /** Called on the data register write, the test plays an interrupt
+   *  coming right then.
+   */
+  void (*on_write)(void* context);
+  void* context;
+};
+
+/** Host peripheral policy of uart_core over host_usart_registers.
+ *
+ *  @tparam OctetT Octet type, 9 bits fit into uint16_t.
+ *  @tparam RxTimeout Whether the receiver timeout delimits idle frames,
+ *    otherwise the octets are timestamped by host_clock.
+ */
+template <typename OctetT, bool RxTimeout = true>
+class host_usart
+{
+public:
+  typedef OctetT octet_type;
+  typedef uint32_t config_type;
+  typedef host_clock clock_type;
+
+  enum
+  {
+    has_rx_timeout  = RxTimeout,
+    max_rx_timeout  = 0xffff,
+    discards_errors = 0,
+    clock_in_micros = 1,
+    has_idle_timer  = 1
+  };
+
+  /** Creates the policy over the registers. */
+  explicit host_usart(host_usart_registers* regs = nullptr): _regs(regs) {}
+
+  static config_type default_config(void) { return 0x06; }
+
+  void open(unsigned long baud, config_type config)
+  {
+    reconfigure(baud, config);
+    _regs->rx_irq  = true;
+    _regs->tx_irq  = false;
+    _regs->enabled = true;
+  }
+
+  void reconfigure(unsigned long baud, config_type config)
+  {
+    _regs->baud   = baud;
+    _regs->config = config;
+  }
+
+  void close(void)
+  {
+    _regs->enabled    = false;
+    _regs->rx_ready   = false;
+    _regs->rx_error   = false;
+    _regs->idle_timer = false;
+  }
+
+  bool opened(void) const { return _regs->enabled; }
+  bool can_read(void) const { return _regs->rx_ready; }
+  bool can_write(void) const { return _regs->tx_ready; }
+  bool drained(void) const { return _regs->tx_empty; }
+  bool rx_error(void) const { return _regs->rx_error; }
+  void clear_rx_error(void) { _regs->rx_error = false; }
+  bool rx_idle(void) const { return _regs->rx_idle; }
+
+  octet_type read(void)
+  {
+    _regs->rx_ready = false;
+    return static_cast<octet_type>(_regs->rx_data);
+  }
+
+  void write(octet_type octet)
+  {
+    _regs->tx_data  = octet;
+    _regs->tx_ready = false;
+    _regs->tx_empty = false;
+    if (_regs->on_write != nullptr) { _regs->on_write(_regs->context); }
+  }
+
+  void enable_rx_irq(bool state) { _regs->rx_irq = state; }
+  void enable_tx_irq(bool state) { _regs->tx_irq = state; }
+  bool tx_irq_enabled(void) const { return _regs->tx_irq; }
+  void enable_idle_irq(bool state) { _regs->idle_irq = state; }
+  void rx_timeout(unsigned long bits) { _regs->rx_timeout = bits; }
+  void start_idle(void) { _regs->rx_idle = false; }
+
+  /** No rx pin to poll on host. */
+  unsigned long autobaud(config_type, unsigned long) { return 0; }
+
+  /** The config is the AVR UCSRnC layout, 0x100 for 9 data bits. */
+  unsigned long char_bits(void) const
+  {
+    const uint32_t config      = _regs->config;
+    const unsigned long data   = ((config >> 1) & 0x03) + 5 + ((config & 0x100) != 0);
+    const unsigned long parity = ((config >> 4) & 0x03) != 0;
+    return 1 + data + parity + ((config & 0x08) != 0? 2: 1);
+  }
+
+  uint32_t micros(void) const { return host_clock::now(); }
+
+  void arm_idle_timer(uint32_t us)
+  {
+    const uint32_t deadline = host_clock::now() + us;
+    if (!_regs->idle_timer || static_cast<int32_t>(deadline - _regs->idle_deadline) < 0)
+    {
+      _regs->idle_deadline = deadline;
+      _regs->idle_timer    = true;
+    }
+  }
+
+  bool idle_timer_due(void)
+  {
+    if (!_regs->idle_timer_due()) { return false; }
+
+    _regs->idle_timer = false;
+    return true;
+  }
+
+  /** Returns the registers. */
+  host_usart_registers* registers(void) const { return _regs; }
+
+private:
+  host_usart_registers* _regs;
+};
+
+/** Host uart, the same core as the Mega and the Due ones. */
+template <
+  typename OctetT,
+  size_t BufferSize = TINY_SERIAL_DEF_BUF_SIZE,
+  bool RxTimeout = true,
+  size_t TxBufferSize = BufferSize,
+  unsigned int Features = default_port_features>
+class host_uart : public uart_core<host_usart<OctetT, RxTimeout>, BufferSize, TxBufferSize, Features>
+{
+public:
+  typedef uart_core<host_usart<OctetT, RxTimeout>, BufferSize, TxBufferSize, Features> base_type;
+  typedef typename base_type::hardware_type hardware_type;
+
+  /** Creates an uart over the registers. */
+  explicit host_uart(host_usart_registers& regs): base_type(hardware_type(&regs)) {}
+
+  /** Runs the interrupt handler while an enabled source is active. */
+  void service(void)
+  {
+    while (this->hardware().registers()->irq_pending()) { call_irq_handler(*this); }
+  }
+};
+
+/** Returns the registers of the host port number, the line of the test. */
+template <unsigned int Num>
+host_usart_registers& host_port_registers(void)
+{
+  static host_usart_registers regs;
+  return regs;
+}
+
+/** Host octet type of the port width. */
+template <bool Wide> struct host_octet { typedef uint8_t type; };
+template <> struct host_octet<true> { typedef uint16_t type; };
+
+/** Host ports of port_registry, Due alike: 0..3 of 9 bits, 4 of 8 bits. */
+struct target_ports
+{
+  enum
+  {
+    ports_mask     = 0x1f,
+    nine_bits_mask = 0x0f
+  };
+
+  /** The uart type of the port declaration. */
+  template <typename DeclT>
+  struct uart
+  {
+    typedef host_uart<
+      typename host_octet<DeclT::wide != 0>::type,
+      DeclT::rx_size != 0? DeclT::rx_size : TINY_SERIAL_DEF_BUF_SIZE,
+      true,
+      DeclT::tx_size != 0? DeclT::tx_size : TINY_SERIAL_DEF_BUF_SIZE,
+      DeclT::features> type;
+  };
+
+  /** Returns the instance of the port number over host_port_registers. */
+  template <typename UartT, unsigned int Num>
+  static UartT& instance(void)
+  {
+    static UartT port(host_port_registers<Num>());
+    return port;
+  }
+};
+
+/** The port of the registry, see port_registry. */
+template <typename RegistryT, unsigned int Num>
+using serial_port = registered_port<RegistryT, Num, target_ports>;
+
+} // namespace io
+
+} // namespace tiny
+
+/** No vectors shared by the host ports. */
+#define TINY_SERIAL_TARGET_HANDLERS(RegistryT, ...)
+
+/** Host handlers, tiny_host_serialN_handler(void) runs the port interrupts. */
+#define TINY_HOST_PORT_HANDLER(RegistryT, Num) \
+  void tiny_host_serial ## Num ## _handler(void) { ::tiny::io::serial_port<RegistryT, Num>::instance().service(); }
+
+#define TINY_SERIAL_PORT_HANDLERS_0(RegistryT) TINY_HOST_PORT_HANDLER(RegistryT, 0)
+#define TINY_SERIAL_PORT_HANDLERS_1(RegistryT) TINY_HOST_PORT_HANDLER(RegistryT, 1)
+#define TINY_SERIAL_PORT_HANDLERS_2(RegistryT) TINY_HOST_PORT_HANDLER(RegistryT, 2)
+#define TINY_SERIAL_PORT_HANDLERS_3(RegistryT) TINY_HOST_PORT_HANDLER(RegistryT, 3)
+#define TINY_SERIAL_PORT_HANDLERS_4(RegistryT) TINY_HOST_PORT_HANDLER(RegistryT, 4)
+
+#endif // TINY_SERIAL_UART_HOST_HPP_
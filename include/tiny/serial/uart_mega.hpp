@@ -9,7 +9,8 @@
 #include <tiny/serial/detail/uart_defs.hpp>
 #include <tiny/serial/detail/defs.hpp>
 
-#include <tiny/container.hpp>
+#include <tiny/serial/uart_core.hpp>
+
 #include <tiny/basic.hpp>
 
 #include <avr/io.h>
@@ -123,6 +124,91 @@ struct iocs_registers
   register_ptr ubrrh, ubrrl, ucsra, ucsrb, ucsrc, udr;
 };
 
+/** The registers of a port given at run time, the ports of a kind share
+ *  the code of the uart, every access loads the address first.
+ */
+class runtime_registers
+{
+public:
+  enum { fixed = 0 };
+
+public:
+  explicit runtime_registers(const iocs_registers& regs): _regs(regs) {}
+
+  register_ptr ubrrh(void) const { return _regs.ubrrh; }
+  register_ptr ubrrl(void) const { return _regs.ubrrl; }
+  register_ptr ucsra(void) const { return _regs.ucsra; }
+  register_ptr ucsrb(void) const { return _regs.ucsrb; }
+  register_ptr ucsrc(void) const { return _regs.ucsrc; }
+  register_ptr udr(void) const { return _regs.udr; }
+
+  /** Returns the registers bundle. */
+  const iocs_registers& bundle(void) const { return _regs; }
+
+private:
+  iocs_registers _regs;
+};
+
+/** The registers of the port fixed at compile time, see pf_fixed_registers:
+ *  the field accesses fold into lds/sts of the addresses, the port gets
+ *  the code of its own.
+ */
+template <port_num Num> struct fixed_registers;
+
+/** Defines fixed_registers of the port. */
+#define TINY_MEGA_FIXED_REGISTERS(Num, Ubrrh, Ubrrl, Ucsra, Ucsrb, Ucsrc, Udr) \
+  template <> \
+  struct fixed_registers<port_num::Num> \
+  { \
+    enum { fixed = 1 }; \
+ \
+    static register_ptr ubrrh(void) { return &Ubrrh; } \
+    static register_ptr ubrrl(void) { return &Ubrrl; } \
+    static register_ptr ucsra(void) { return &Ucsra; } \
+    static register_ptr ucsrb(void) { return &Ucsrb; } \
+    static register_ptr ucsrc(void) { return &Ucsrc; } \
+    static register_ptr udr(void) { return &Udr; } \
+    static iocs_registers bundle(void) { return iocs_registers(ubrrh(), ubrrl(), ucsra(), ucsrb(), ucsrc(), udr()); } \
+  };
+
+#if defined(UBRRH) && defined(UBRRL)
+TINY_MEGA_FIXED_REGISTERS(com0, UBRRH, UBRRL, UCSRA, UCSRB, UCSRC, UDR)
+#elif defined(UBRR0H)
+TINY_MEGA_FIXED_REGISTERS(com0, UBRR0H, UBRR0L, UCSR0A, UCSR0B, UCSR0C, UDR0)
+#endif
+#if defined(UBRR1H)
+TINY_MEGA_FIXED_REGISTERS(com1, UBRR1H, UBRR1L, UCSR1A, UCSR1B, UCSR1C, UDR1)
+#endif
+#if defined(UBRR2H)
+TINY_MEGA_FIXED_REGISTERS(com2, UBRR2H, UBRR2L, UCSR2A, UCSR2B, UCSR2C, UDR2)
+#endif
+#if defined(UBRR3H)
+TINY_MEGA_FIXED_REGISTERS(com3, UBRR3H, UBRR3L, UCSR3A, UCSR3B, UCSR3C, UDR3)
+#endif
+
+#undef TINY_MEGA_FIXED_REGISTERS
+
+/** USART control and status register fields, all the ports alike. */
+namespace usart
+{
+
+typedef field<reg_type, RXC0> rxc;       /**< UCSRnA receive complete. */
+typedef field<reg_type, TXC0> txc;       /**< UCSRnA transmit complete. */
+typedef field<reg_type, UDRE0> udre;     /**< UCSRnA data register empty. */
+typedef field<reg_type, UPE0> upe;       /**< UCSRnA parity error. */
+typedef field<reg_type, RXCIE0> rxcie;   /**< UCSRnB receive complete interrupt. */
+typedef field<reg_type, UDRIE0> udrie;   /**< UCSRnB data register empty interrupt. */
+typedef field<reg_type, RXEN0> rxen;     /**< UCSRnB receiver enable. */
+typedef field<reg_type, TXEN0> txen;     /**< UCSRnB transmitter enable. */
+typedef field<reg_type, UCSZ02> ucsz2;   /**< UCSRnB character size, 9 bits. */
+typedef field<reg_type, RXB80> rxb8;     /**< UCSRnB 9th bit received. */
+typedef field<reg_type, TXB80> txb8;     /**< UCSRnB 9th bit to send. */
+typedef field<reg_type, UPM00, 2> upm;   /**< UCSRnC parity mode. */
+typedef field<reg_type, USBS0> usbs;     /**< UCSRnC stop bits. */
+typedef field<reg_type, UCSZ00, 2> ucsz; /**< UCSRnC character size. */
+
+} // namespace usart
+
 #ifndef TINY_SERIAL_DEF_BUF_SIZE
 # define TINY_SERIAL_DEF_BUF_SIZE 16
 #endif // TINY_SERIAL_DEF_BUF_SIZE
@@ -134,28 +220,188 @@ struct iocs_registers
 # pragma message "Tiny serial buffer size is " XSTRINGIFY(TINY_SERIAL_DEF_BUF_SIZE)
 #endif // __GNUG__
 
-/** Serial port.
+/** Receive timestamp clock, micros() of the core timer 0, 4us steps at 16MHz. */
+struct micros_clock
+{
+  /** Nothing to enable, the core runs the timer. */
+  static void start(void) {}
+
+  /** Returns the microseconds passed. */
+  static uint32_t now(void) { return micros(); }
+};
+
+#if defined(TIMER0_COMPB_vect) && !defined(TINY_MEGA_IDLE_TIMER)
+# define TINY_MEGA_IDLE_TIMER 1
+#elif !defined(TINY_MEGA_IDLE_TIMER)
+# define TINY_MEGA_IDLE_TIMER 0
+#endif
+
+namespace detail
+{
+
+/** The one-shot idle timer closing the idle line frames, the compare B of
+ *  the core timer 0 counting micros() by 64 cycles.
  *
- *  @tparam Kind The type of port whether usual or extended see port_kind.
- *  @tparam BufferSize The size of the internal buffer. Use pow of two for
- *    optimizing indexing.
- *  @tparam PortKindTraits Port kind traits.
+ *  The ports share it: an earlier deadline armed is kept, the vector
+ *  disarms it and runs the handler of every port, the ones still waiting
+ *  for the silence re-arm it. Don't use PWM on the OC0B pin along with
+ *  idle frames, define TINY_MEGA_IDLE_TIMER 0 to leave the compare alone,
+ *  frame_ready finds the frames then.
  */
-template<
-  port_kind Kind,
-  size_t BufferSize = TINY_SERIAL_DEF_BUF_SIZE,
-  typename PortKindTraitsT = port_kind_traits<Kind> >
-class basic_uart : public serial<typename port_kind_traits<Kind>::octet_type>
+struct idle_timer
+{
+  /** Arms the compare in at least us microseconds, 255 ticks at most, the
+   *  interrupts masked.
+   */
+  static void arm(uint32_t us)
+  {
+#if TINY_MEGA_IDLE_TIMER
+    const uint32_t ticks = (us < 0xffff? us: 0xffff) * (F_CPU / 1000000ul) / 64 + 1;
+    const uint8_t delta  = ticks < 0xff? static_cast<uint8_t>(ticks): 0xff;
+    const uint8_t now    = TCNT0;
+
+    // a pending match runs all the handlers anyway
+    if ((TIMSK0 & _BV(OCIE0B)) != 0 &&
+        ((TIFR0 & _BV(OCF0B)) != 0 || static_cast<uint8_t>(OCR0B - now) <= delta)) { return; }
+
+    OCR0B   = static_cast<uint8_t>(now + delta);
+    TIFR0   = _BV(OCF0B);
+    TIMSK0 |= _BV(OCIE0B);
+#else
+    (void)us;
+#endif // TINY_MEGA_IDLE_TIMER
+  }
+
+  /** Disarms the compare. */
+  static void stop(void)
+  {
+#if TINY_MEGA_IDLE_TIMER
+    TIMSK0 &= static_cast<uint8_t>(~_BV(OCIE0B));
+#endif // TINY_MEGA_IDLE_TIMER
+  }
+};
+
+#if !defined(TINY_MEGA_AUTOBAUD)
+# define TINY_MEGA_AUTOBAUD 0
+#endif
+
+static_assert(TINY_SERIAL_AUTOBAUD_EDGES <= 0xff, "Up to 255 autobaud edges on Mega");
+
+/** The rx pin edges of the baud rate detection, stamped by the pin
+ *  interrupt of TINY_SERIAL_TARGET_HANDLERS on the timer 1 counting
+ *  F_CPU / 8, the timer 0 of millis keeps running. A port detects at a
+ *  time, the stamps are relative to the first falling edge.
+ */
+struct autobaud_edges
+{
+  /** Stamps the edge, the pin interrupt handler. */
+  static void on_edge(void)
+  {
+    autobaud_edges& s  = state();
+    const uint16_t now = TCNT1;
+    const uint8_t n    = s.count;
+
+    // the capture starts at a start bit, the stamps after the end only
+    // tell the last edge
+    if (!s.done && n < TINY_SERIAL_AUTOBAUD_EDGES && (n != 0 || (*s.pin & s.mask) == 0))
+    {
+      s.edges[n] = n == 0? 0: s.edges[n - 1] + static_cast<uint16_t>(now - s.last);
+      s.count    = n + 1;
+    }
+    s.last = now;
+  }
+
+  /** Returns the capture state. */
+  static autobaud_edges& state(void)
+  {
+    static autobaud_edges s;
+    return s;
+  }
+
+  uint32_t edges[TINY_SERIAL_AUTOBAUD_EDGES];
+  volatile uint8_t count;
+  volatile bool done;
+  volatile uint16_t last;
+  volatile uint8_t* pin;
+  uint8_t mask;
+};
+
+/** Runs the timer 1 at F_CPU / 8 for the edge stamps while alive.
+ *
+ *  A timer already counting so in the normal mode (Servo, the soft uart
+ *  of soft_uart_mega) is shared as is. Otherwise it's taken over, its
+ *  interrupts masked, and the counter, the mode and the interrupts are
+ *  restored after, its users pause meanwhile (PWM on the timer 1 pins,
+ *  tone).
+ */
+class autobaud_timer
+{
+public:
+  autobaud_timer(void):
+    _tccra(TCCR1A),
+    _tccrb(TCCR1B),
+    _timsk(TIMSK1),
+    _tcnt(0),
+    _shared(_tccra == 0 && _tccrb == _BV(CS11))
+  {
+    if (_shared) { return; }
+
+    ::tiny::detail::interrupt_guard guard;
+    _tcnt  = TCNT1;
+    TIMSK1 = 0;
+    TCCR1B = 0;
+    TCCR1A = 0;
+    TCCR1B = _BV(CS11);
+  }
+
+  ~autobaud_timer(void)
+  {
+    if (_shared) { return; }
+
+    ::tiny::detail::interrupt_guard guard;
+    TCCR1B = 0;
+    TCNT1  = _tcnt;
+    TIFR1  = 0xff; // the flags raised meanwhile aren't the users' ones
+    TCCR1A = _tccra;
+    TIMSK1 = _timsk;
+    TCCR1B = _tccrb;
+  }
+
+  /** Returns the ticks since the stamp, below 32 ms. */
+  static uint16_t since(uint16_t stamp)
+  {
+    ::tiny::detail::interrupt_guard guard;
+    return static_cast<uint16_t>(TCNT1 - stamp);
+  }
+
+private:
+  autobaud_timer(const autobaud_timer&); // inhibit copy
+  autobaud_timer& operator=(const autobaud_timer&);
+
+private:
+  const uint8_t _tccra;
+  const uint8_t _tccrb;
+  const uint8_t _timsk;
+  uint16_t _tcnt;
+  const bool _shared;
+};
+
+} // namespace detail
+
+/** USART peripheral policy of uart_core, see uart_core for the interface.
+ *
+ *  @tparam PortKindTraitsT Port kind traits.
+ *  @tparam RegistersT The registers, runtime_registers or fixed_registers.
+ */
+template <typename PortKindTraitsT, typename RegistersT = runtime_registers>
+class avr_usart
 {
 public:
   /** Port kind traits type. */
   typedef PortKindTraitsT kind_traits_type;
 
-  /** Control and status register type. */
-  typedef ::tiny::register_type register_type;
-
-  /** Pointer to control and status register type. */
-  typedef register_type* /*const*/ register_ptr;
+  /** Registers type. */
+  typedef RegistersT registers_type;
 
   /** Buffer item type. */
   typedef typename kind_traits_type::octet_type octet_type;
@@ -163,15 +409,22 @@ public:
   /** Possible port configuration. */
   typedef typename kind_traits_type::config config_type;
 
-  /** Buffer size. */
-  enum { buffer_size = BufferSize };
+  /** Timestamp clock type. */
+  typedef micros_clock clock_type;
 
-//  /** Port kind. */
-//  enum { kind_of_port = kind_traits_type::kind_of_port };
+  /** No receiver timeout, the octets with parity errors are dropped. */
+  enum
+  {
+    has_rx_timeout  = 0,
+    max_rx_timeout  = 0,
+    discards_errors = 1,
+    clock_in_micros = 1,
+    has_idle_timer  = TINY_MEGA_IDLE_TIMER
+  };
 
 public:
-  /** Creates an uart. */
-  basic_uart(const iocs_registers& regs):
+  /** Creates the policy over the registers. */
+  explicit avr_usart(const registers_type& regs):
     _regs(regs),
     _written(false),
     _is_9_bits(false)
@@ -179,196 +432,263 @@ public:
     // empty
   }
 
-  void open(baud_rate baud) override
-  {
-    open(static_cast<unsigned long>(baud), kind_traits_type::_8n1);
-  }
-
-  /** Available bytes in receive cache. */
-  size_t available(void) const override
-  {
-    rx_lock lock(const_cast<basic_uart*>(this));
-    return _rx_buffer.size();
-  }
+  static config_type default_config(void) { return config_type::_8n1; }
 
-  octet_type read(void) override
+  void open(unsigned long baud_rate, config_type config)
   {
-    return async_read();
-  }
+    _written = false;
+    reconfigure(baud_rate, config);
 
-  void write(octet_type b) override
-  {
-    while (!async_write(b));
+    // the data register empty interrupt stays disabled
+    *_regs.ucsrb() |= fields_mask<usart::rxen, usart::txen, usart::rxcie>();
   }
 
-  /** Opens port.
-   *
-   *  @param baud_rate Baud rate.
-   *  @param Remaining port configuration like stop bits, parity and data bits.
-   */
-  void open(unsigned long baud_rate = br_9600, config_type config = config_type::_8n1)
+  void reconfigure(unsigned long baud_rate, config_type config)
   {
-    _written = false;
     // baud rate settings
     const unsigned short ubrr = (F_CPU / (16 * baud_rate)) - 1;
-    *_regs.ubrrh              = ubrr >> 8 & 0xff;
-    *_regs.ubrrl              = ubrr & 0xff;
+    *_regs.ubrrh()              = ubrr >> 8 & 0xff;
+    *_regs.ubrrl()              = ubrr & 0xff;
 
-    unsigned short tmp_conf = static_cast<unsigned short>(config);
+    unsigned short conf = static_cast<unsigned short>(config);
     //set the data bits, parity, and stop bits
  #if defined(__AVR_ATmega8__)
-    tmp_conf |= 0x80; // select UCSRC register (shared with UBRRH)
+    conf |= 0x80; // select UCSRC register (shared with UBRRH)
  #endif
 
-    close();
-
-    _is_9_bits = (tmp_conf & 0x100) != 0;
-    if (_is_9_bits)
-    {
-      set_bit(_regs.ucsrb, UCSZ2);
-    }
-
-    *_regs.ucsrc = tmp_conf & 0xff;
-
-    set_bit(_regs.ucsrb, RXEN);
-    set_bit(_regs.ucsrb, TXEN);
-    set_bit(_regs.ucsrb, RXCIE);
-    //clear_bit(_regs.ucsrb, UDRIE); // disable DR empty interrupt
+    _is_9_bits = (conf & 0x100) != 0;
+    usart::ucsz2::assign(_regs.ucsrb(), _is_9_bits);
+    *_regs.ucsrc() = conf & 0xff;
   }
 
-  /** Closes port. */
-  void close(void)
+  void close(void) { *_regs.ucsrb() = 0; }
+
+  bool opened(void) const
   {
-    *_regs.ucsrb = 0;
-    _rx_buffer.clear();
-    _tx_buffer.clear();
+    return (*_regs.ucsrb() & fields_mask<usart::rxen, usart::txen>()) != 0;
   }
 
-  /** Whether port opened. */
-  bool opened(void) const
+  bool can_read(void) const { return usart::rxc::is_set(*_regs.ucsra()); }
+  bool can_write(void) const { return usart::udre::is_set(*_regs.ucsra()); }
+
+  /** TXC is cleared by every write, so it's set once the shift register is empty. */
+  bool drained(void) const { return !_written || usart::txc::is_set(*_regs.ucsra()); }
+
+  bool rx_error(void) const { return usart::upe::is_set(*_regs.ucsra()); }
+  void clear_rx_error(void) { /* cleared by reading UDR */ }
+  bool rx_idle(void) const { return false; }
+
+  octet_type read(void) const
   {
-    return is_bit(_regs.ucsrb, RXEN) || is_bit(_regs.ucsrb, TXEN);
+    return _is_9_bits? read_ninetet(): read_octet();
   }
 
-  /** Returns an octet from the queue and remove it if remove is true.
-   *
-   *  @param remove If true remove octet from queue else leave it.
-   */
-  octet_type async_read(bool remove = true)
+  void write(octet_type word)
   {
-    rx_lock lock(this);
-    if (_rx_buffer.empty()) { return 0; }
+    _is_9_bits? write_ninetet(word): write_octet(word);
 
-    const typename queue_type::value_type c = *_rx_buffer.front();
-    if (remove) { _rx_buffer.pop(); }
-    return c;
+    // clear the TXC bit -- "can be cleared by writing a one to its bit
+    // location". This makes sure drained() won't return true until the
+    // bytes actually got written
+    usart::txc::set(_regs.ucsra());
+    _written = true;
   }
 
-  /** Writes an octet asynchronously.
+  void enable_rx_irq(bool state) { usart::rxcie::assign(_regs.ucsrb(), state); }
+  void enable_tx_irq(bool state) { usart::udrie::assign(_regs.ucsrb(), state); }
+  bool tx_irq_enabled(void) const { return usart::udrie::is_set(*_regs.ucsrb()); }
+  void enable_idle_irq(bool) { /* no receiver timeout */ }
+  void rx_timeout(unsigned long) { /* no receiver timeout */ }
+  void start_idle(void) { /* no receiver timeout */ }
+
+  uint32_t micros(void) const { return ::micros(); }
+  void arm_idle_timer(uint32_t us) { detail::idle_timer::arm(us); }
+  bool idle_timer_due(void) { return false; /* the vector of its own */ }
+
+  /** Captures the edges of the first characters received.
    *
-   *  @return If were no write operation due to buffer overflow return false
-   *    else returns true.
+   *  The rx pin edge interrupt stamps the edges by the timer 1, see
+   *  detail::autobaud_timer, detect_baud picks the rate and it returns
+   *  once the line stays high for a character of the format, in a gap.
+   *  Needs TINY_MEGA_AUTOBAUD 1 for the pin interrupt vectors, INT2 of
+   *  serial1, PCINT1 of serial0 and serial3 on ATmega2560 and PCINT2 on
+   *  ATmega328P, serial2 has no edge interrupt on its rx pin. The timer 0
+   *  interrupt may delay a stamp by a few us, the mean bit cell of
+   *  detect_baud takes it up to 115200 bps.
    *
-   *  Note that data is only pushed into the internal buffer and will be
-   *  sent as soon as possible if interrupts allowed. But if they are disabled
-   *  it's necessary to call it in a loop while it returns false.
+   *  @return The rate detected or zero.
    */
-  bool async_write(octet_type octet)
-  {
-    // If the buffer and the data register is empty, just write the byte
-    // to the data register and be done. This shortcut helps
-    // significantly improve the effective datarate at high (>
-    // 500kbit/s) bitrates, where interrupt overhead becomes a slowdown.
-    tx_lock lock(this);
-    if (_tx_buffer.empty() && can_write())
-    {
-      // fixme: 9bit resolve statically
-      write_port(octet);
-      set_bit(_regs.ucsra, TXC0);
-      return true;
-    }
+  unsigned long autobaud(config_type config, unsigned long timeout)
+  {
+    static_assert(TINY_MEGA_AUTOBAUD != 0 || sizeof(config_type) == 0,
+                  "Define TINY_MEGA_AUTOBAUD 1 for the rx pin edge interrupts of the baud rate detection");
 
-    // fixme: If interrupts disabled it won't work
+    detail::autobaud_edges& edges = detail::autobaud_edges::state();
+    edges.count = 0;
+    edges.done  = false;
+    rx_pin(edges.pin, edges.mask);
 
-    // We don't wait for the room in the buffer (unlike original code)
-    // and just returns 0 (zero). If client would like to wait
-    // it can do it by itself using the loop: while (!async_write(x));
+    detail::autobaud_timer timer;
+    if (!rx_edge_irq(true)) { return 0; }
 
-    if (!_tx_buffer.can_push()) { return false; }
+    const unsigned long start = millis();
+    while (edges.count == 0)
+    {
+      if (millis() - start >= timeout)
+      {
+        rx_edge_irq(false);
+        return 0;
+      }
+    }
 
-    _tx_buffer.push(octet);
-    _written = true;
+    // a character at 1200 bps fits into the idle limit of 10 ms
+    const uint16_t idle = F_CPU / 8 / 100;
+    while (edges.count < TINY_SERIAL_AUTOBAUD_EDGES && timer.since(edges.last) < idle) { }
+    edges.done = true;
 
-    return true;
+    const unsigned long baud = detect_baud(edges.edges, edges.count, F_CPU / 8);
+    if (baud != 0)
+    {
+      // the stamps wrap at 32 ms, 13 bits at 1200 bps are 11 ms
+      const uint32_t gap  = idle_gap(baud, format_bits(config), F_CPU / 8);
+      const uint16_t wait = gap < 0xf000? static_cast<uint16_t>(gap): 0xf000;
+      const unsigned long end = millis();
+      while (((*edges.pin & edges.mask) == 0 || timer.since(edges.last) < wait) && millis() - end < timeout) { }
+    }
+
+    rx_edge_irq(false);
+    return baud;
   }
 
   /** Returns currently configured stop bits. */
   size_t stop_bits(void) const
   {
-    return int(is_bit(_regs.ucsrc, USBS)) + 1;
+    return usart::usbs::read(_regs.ucsrc()) + 1;
   }
 
-  /** Returns currently set parity mode. */
-  //parity_t parity(void) const {}
-
   /** Returns the data bits currently set. */
   size_t data_bits(void) const
   {
-    return (*_regs.ucsrc & (mask(UCSZ0) | mask(UCSZ1)))
-      | (*_regs.ucsrb & mask(UCSZ2)) + 5;
+    // UCSZ 0..3 are 5..8 bits, 7 is 9 bits
+    const size_t size = usart::ucsz::read(_regs.ucsrc()) | usart::ucsz2::read(_regs.ucsrb()) << 2;
+    return size == 7? 9: size + 5;
   }
 
-//////////////////////////////////////////////////////////////////////////
-// private stuff
+  /** Returns the bits of a character, start, data, parity and stop. */
+  unsigned long char_bits(void) const
+  {
+    return 1 + data_bits() + (usart::upm::read(_regs.ucsrc()) != 0) + stop_bits();
+  }
 
-private:
-  typedef queue<octet_type, buffer_size> queue_type;
-  typedef basic_uart<Kind, buffer_size, kind_traits_type> this_type;
+  /** Returns the bits of a character of the configuration. */
+  static unsigned long format_bits(config_type config)
+  {
+    const unsigned short conf  = static_cast<unsigned short>(config);
+    const unsigned long data   = ((conf >> 1) & 0x03) + 5 + ((conf & 0x100) != 0);
+    const unsigned long parity = ((conf >> 4) & 0x03) != 0;
+    return 1 + data + parity + ((conf & 0x08) != 0? 2: 1);
+  }
 
-private:
-  basic_uart(const this_type&); // inhibit copy
-  this_type& operator=(const this_type&);
+  /** Returns registers bundle associated with the uart. */
+  iocs_registers registers(void) const { return _regs.bundle(); }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
 
 private:
-  /** Returns registers bundle associated with the uart. */
-  const iocs_registers& registers(void) const { return _regs; }
+  //-----------------------------------------------------------------------------
+  // the rx pin input register of the port, RXDn pins of ATmega328P and ATmega2560
+  void rx_pin(volatile uint8_t*& pin, uint8_t& mask) const
+  {
+#if defined(UCSR1A)
+    if (_regs.ucsra() == &UCSR1A) { pin = &PIND; mask = _BV(2); return; }
+#endif // UCSR1A
+#if defined(UCSR2A)
+    if (_regs.ucsra() == &UCSR2A) { pin = &PINH; mask = _BV(0); return; }
+#endif // UCSR2A
+#if defined(UCSR3A)
+    if (_regs.ucsra() == &UCSR3A) { pin = &PINJ; mask = _BV(0); return; }
+#endif // UCSR3A
+#if defined(PINE)
+    pin = &PINE; mask = _BV(0);
+#else
+    pin = &PIND; mask = _BV(0);
+#endif // PINE
+  }
 
-  /** Whether receiver available for read. */
-  bool can_read(void) const
+  //-----------------------------------------------------------------------------
+  // the edge interrupt of the rx pin, INT2 of RXD1, PCINT8 and PCINT9 of
+  // RXD0 and RXD3 of ATmega2560, PCINT16 of RXD of ATmega328P, false if
+  // the pin has none (RXD2)
+  bool rx_edge_irq(bool state) const
   {
-    //UCSRA & 1 << RXC
-    return is_bit(_regs.ucsra, RXC);
+#if defined(UCSR1A) && defined(INT2)
+    if (_regs.ucsra() == &UCSR1A)
+    {
+      ::tiny::detail::interrupt_guard guard;
+      if (state)
+      {
+        EICRA = static_cast<uint8_t>((EICRA & ~(_BV(ISC21) | _BV(ISC20))) | _BV(ISC20)); // any edge
+        EIFR  = _BV(INTF2);
+        EIMSK |= _BV(INT2);
+      } else { EIMSK &= static_cast<uint8_t>(~_BV(INT2)); }
+      return true;
+    }
+#endif // UCSR1A
+#if defined(UCSR2A)
+    if (_regs.ucsra() == &UCSR2A) { return false; }
+#endif // UCSR2A
+#if defined(UCSR3A) && defined(PCINT9)
+    if (_regs.ucsra() == &UCSR3A) { return pin_change_irq(PCMSK1, _BV(PCINT9), _BV(PCIE1), state); }
+    return pin_change_irq(PCMSK1, _BV(PCINT8), _BV(PCIE1), state);
+#elif defined(PCINT16)
+    return pin_change_irq(PCMSK2, _BV(PCINT16), _BV(PCIE2), state);
+#else
+    (void)state;
+    return false;
+#endif // UCSR3A
   }
 
-  /** Whether transmitter available for write. */
-  bool can_write(void) const
+  //-----------------------------------------------------------------------------
+  // the pin change group stays enabled for its other pins
+  static bool pin_change_irq(volatile uint8_t& pcmsk, uint8_t pin, uint8_t group, bool state)
   {
-    // UCSRA & 1 << UDRE
-    return is_bit(_regs.ucsra, UDRE);
+    ::tiny::detail::interrupt_guard guard;
+    if (state)
+    {
+      pcmsk |= pin;
+      PCIFR  = group;
+      PCICR |= group;
+    } else
+    {
+      pcmsk &= static_cast<uint8_t>(~pin);
+      if (pcmsk == 0) { PCICR &= static_cast<uint8_t>(~group); }
+    }
+    return true;
   }
 
   //-----------------------------------------------------------------------------
   inline void write_octet(octet_type octet) const
   {
-    *_regs.udr = octet;
+    *_regs.udr() = octet;
   }
 
   //-----------------------------------------------------------------------------
   inline octet_type read_octet(void) const
   {
-    return *_regs.udr;
+    return *_regs.udr();
   }
 
   //-----------------------------------------------------------------------------
   inline void write_ninth_bit(bool value) const
   {
-    set_bit(_regs.ucsrb, TXB8, value);
+    usart::txb8::assign(_regs.ucsrb(), value);
   }
 
   //-----------------------------------------------------------------------------
   inline bool read_ninth_bit(void) const
   {
-    return is_bit(_regs.ucsrb, RXB8);
+    return usart::rxb8::is_set(*_regs.ucsrb());
   }
 
   //-----------------------------------------------------------------------------
@@ -379,7 +699,7 @@ private:
 
     if (!n) { return octet; }
 
-    return octet | mask<octet_type>(8);
+    return static_cast<octet_type>(octet | 0x100);
   }
 
   //-----------------------------------------------------------------------------
@@ -389,141 +709,90 @@ private:
     write_octet(ninetet & 0xff);
   }
 
-  //-----------------------------------------------------------------------------
-  inline octet_type read_port(void) const
-  {
-    return _is_9_bits? read_ninetet(): read_octet();
-  }
-
-  //-----------------------------------------------------------------------------
-  inline void write_port(octet_type word) const
-  {
-    _is_9_bits? write_ninetet(word): write_octet(word);
-  }
+private:
+  registers_type _regs;
+  bool _written; // fixme: remove written
+  bool _is_9_bits; // fixme: resolve statically
+};
 
-  //-----------------------------------------------------------------------------
-  inline void enable_rx_int(bool state = true) const
-  {
-    set_bit(_regs.ucsrb, RXCIE, state);
-  }
+/** Serial port.
+ *
+ *  @tparam Kind The type of port whether usual or extended see port_kind.
+ *  @tparam BufferSize The size of the internal buffer. Use pow of two for
+ *    optimizing indexing.
+ *  @tparam PortKindTraits Port kind traits.
+ *  @tparam TxBufferSize The size of the transmit buffer, BufferSize is the
+ *    receive one.
+ *  @tparam Features port_feature flags.
+ *  @tparam RegistersT The registers, runtime_registers or fixed_registers
+ *    of the port, see pf_fixed_registers.
+ *
+ *  The buffers, the hooks and the interrupt handlers are uart_core, this
+ *  is the USART policy and the port specific extras.
+ *
+ *  Interrupt safety. The rx and the tx buffers are single producer, single
+ *  consumer rings shared with the port interrupt handler, the locks mask
+ *  the port interrupt source only. AVR has no interrupt priorities and
+ *  handlers aren't nested, so non-blocking rx side methods (available,
+ *  async_read, try_read, readable, consume, frame_ready, read_frame) and
+ *  tx side methods (async_write, async_write_urgent, writable, commit,
+ *  begin_frame, end_frame) may be called each from a single context at a
+ *  time, the main loop or an interrupt handler. The blocking read,
+ *  read_until and write are for the main loop only, they sleep until the
+ *  port handler runs, which never comes within another handler. open,
+ *  close, reconfiguration and hooks installation are for the main loop
+ *  only.
+ */
+template<
+  port_kind Kind,
+  size_t BufferSize = TINY_SERIAL_DEF_BUF_SIZE,
+  typename PortKindTraitsT = port_kind_traits<Kind>,
+  size_t TxBufferSize = BufferSize,
+  unsigned int Features = default_port_features,
+  typename RegistersT = runtime_registers>
+class basic_uart : public uart_core<avr_usart<PortKindTraitsT, RegistersT>, BufferSize, TxBufferSize, Features>
+{
+public:
+  /** Port kind traits type. */
+  typedef PortKindTraitsT kind_traits_type;
 
-  //-----------------------------------------------------------------------------
-  inline void disable_rx_int(void) const
-  {
-    enable_rx_int(false);
-  }
+  /** Registers type. */
+  typedef RegistersT registers_type;
 
-  //-----------------------------------------------------------------------------
-  // enables/disables tx complete interrupt
-  inline void enable_tx_int(bool state = true) const
-  {
-    set_bit(_regs.ucsrb, UDRIE, state);
-  }
+  /** The core type. */
+  typedef uart_core<avr_usart<kind_traits_type, registers_type>, BufferSize, TxBufferSize, Features> base_type;
 
-  //-----------------------------------------------------------------------------
-  inline void disable_tx_int(void) const
-  {
-    enable_tx_int(false);
-  }
+  /** Control and status register type. */
+  typedef ::tiny::register_type register_type;
 
-  //-----------------------------------------------------------------------------
-  inline bool is_parity_ok(void) const
-  {
-    return !is_bit(_regs.ucsra, UPE0);
-  }
+  /** Pointer to control and status register type. */
+  typedef register_type* /*const*/ register_ptr;
 
-  //-----------------------------------------------------------------------------
-  // interrupt handlers
-  void handle_rx_complete_irq(void)
+public:
+  /** Creates an uart. */
+  basic_uart(const iocs_registers& regs):
+    base_type(typename base_type::hardware_type(registers_type(regs)))
   {
-    // first check for parity error
-    if (is_parity_ok())
-    {
-      // read after
-      const octet_type c = read_port();
-      // No Parity error, read byte and store it in the buffer if there is room
-      _rx_buffer.push(c);
-    } else
-    {
-      // discard byte if parity error
-      read_port();
-    }
+    // empty
   }
 
-  //-----------------------------------------------------------------------------
-  void handle_tx_udr_empty_irq(void)
+  /** Creates an uart over the registers policy. */
+  explicit basic_uart(const registers_type& regs):
+    base_type(typename base_type::hardware_type(regs))
   {
-    // If interrupts are enabled, there must be more data in the output
-    // buffer. Send the next byte.
-    assert(!_tx_buffer.empty() && " - Tx buffer can't be empty!");
-
-    //if (_tx_buffer.empty()) { return; }
-
-    write_port(_tx_buffer.pop());
-
-    // clear the TXC bit -- "can be cleared by writing a one to its bit
-    // location". This makes sure flush() won't return until the bytes
-    // actually got written
-    clear_bit(_regs.ucsra, TXC);
-
-    if (_tx_buffer.empty())
-    {
-      // Buffer empty, so disable interrupts
-      disable_tx_int();
-    }
+    // empty
   }
 
-// original declaration
-
-//  extern "C" void __vector_25 (void) __attribute__ ((signal,used, externally_visible));
-//  void __vector_25 (void)
-//  {
-//  }
+  using base_type::open;
 
-//  static void __vector_25 (void) __attribute__ ((signal, used, externally_visible))
-//  {
-//    typedef basic_uart<Kind, BufferSize, PortKindTraitsT> this_type;
-//    this_type* thiz = 0;
-//
-//    thiz->handle_rx_complete_irq();
-//  }
-
-//  template <port_num PortNum>
-//  static void vector_25(void) __attribute__ ((signal, used, externally_visible));
-
-private:
-  ////////////////////////////////////////////////////////////////////////
-  // classes
-  struct rx_lock
-  {
-	  rx_lock(basic_uart* uart): _uart(uart) { _uart->disable_rx_int(); }
-	  ~rx_lock(void) { _uart->enable_rx_int(); }
-
-  private:
-	  basic_uart* _uart;
-  };
-
-  struct tx_lock
-  {
-	  tx_lock(basic_uart* uart): _uart(uart) { _uart->disable_tx_int(); }
-	  ~tx_lock(void) { _uart->enable_tx_int(); }
-
-  private:
-	  basic_uart* _uart;
-  };
+  /** Returns currently configured stop bits. */
+  size_t stop_bits(void) const { return this->hardware().stop_bits(); }
 
-private:
-  ////////////////////////////////////////////////////////////////////////
-  // friends
-  template <typename UartT> friend inline void call_rx_handler(UartT& uart);
-  template <typename UartT> friend inline void call_tx_handler(UartT& uart);
+  /** Returns currently set parity mode. */
+  //parity_t parity(void) const {}
 
-private:
-  iocs_registers _regs;
-  bool _written; // fixme: remove written
-  bool _is_9_bits; // fixme: resolve statically
-  queue_type _rx_buffer;
-  queue_type _tx_buffer;
+  /** Returns the data bits currently set. */
+  size_t data_bits(void) const { return this->hardware().data_bits(); }
 };
 
 /** Usual com port type declaration. */
@@ -532,15 +801,6 @@ typedef basic_uart<port_kind::usual> usual_uart;
 /** Usual com port type declaration. */
 typedef basic_uart<port_kind::extended> extended_uart;
 
-namespace detail
-{
-
-// forward for eclipse syntax parser
-/** Generic instance factory declaration. */
-template <port_kind Kind, port_num Num> inline basic_uart<Kind>& uart_instance(void);
-
-} // namespace detail
-
 #include <tiny/serial/detail/uart.ipp>
 
 /** Comport definition.
@@ -588,57 +848,58 @@ typedef com_port<port_kind::extended, port_num::com2> extended_port2;
 /** 9bit max, com3 type. */
 typedef com_port<port_kind::extended, port_num::com3> extended_port3;
 
-// Serial 0
-#ifdef TINY_HAS_HWSERIAL0
-# if !defined(UBRRH) && !defined(UBRR0H)
-#   error "It seems there is no hardware uart0 available"
-# endif // !defined(UBRRH) && !defined(UBRR0H)
-
-# if (TINY_HAS_HWSERIAL0 == 9)
-  extended_uart& serial0(void);
-# else
-  usual_uart& serial0(void);
-# endif // TINY_HAS_HWSERIAL0 == 9
-#endif // TINY_HAS_HWSERIAL0
-
-// Serial 1
-#ifdef TINY_HAS_HWSERIAL1
-# if !defined(UBRR1H)
-#   error "It seems there is no hardware uart1 available"
-# endif // !defined(UBRR1H)
-
-# if TINY_HAS_HWSERIAL1 == 9
-  extended_uart& serial1(void);
-# else
-  usual_uart& serial1(void);
-# endif // TINY_HAS_HWSERIAL1 == 9
-#endif // TINY_HAS_HWSERIAL1
-
-// Serial 2
-#ifdef TINY_HAS_HWSERIAL2
-# if !defined(UBRR2H)
-#   error "It seems there is no hardware uart2 available"
-# endif // !defined(UBRR2H)
-
-# if TINY_HAS_HWSERIAL2 == 9
-  extended_uart& serial2(void);
-# else
-  usual_uart& serial2(void);
-# endif // TINY_HAS_HWSERIAL2 == 9
-#endif // TINY_HAS_HWSERIAL2
-
-// Serial 3
-#ifdef TINY_HAS_HWSERIAL3
-# if !defined(UBRR3H)
-#   error "It seems there is no hardware uart3 available"
-# endif // !defined(UBRR3H)
-
-# if TINY_HAS_HWSERIAL3 == 9
-  extended_uart& serial3(void);
-# else
-  usual_uart& serial3(void);
-# endif // TINY_HAS_HWSERIAL3 == 9
-#endif // TINY_HAS_HWSERIAL3
+/** Mega ports of port_registry, the USARTs the MCU has, all of 9 bits. */
+struct target_ports
+{
+  enum
+  {
+    ports_mask = 0
+#if defined(UBRRH) || defined(UBRR0H)
+      | 0x01
+#endif
+#if defined(UBRR1H)
+      | 0x02
+#endif
+#if defined(UBRR2H)
+      | 0x04
+#endif
+#if defined(UBRR3H)
+      | 0x08
+#endif
+    , nine_bits_mask = ports_mask
+  };
+
+  /** The uart type of the port declaration. */
+  template <typename DeclT>
+  struct uart
+  {
+    static const port_kind kind = DeclT::wide? port_kind::extended : port_kind::usual;
+
+    typedef basic_uart<
+      kind,
+      DeclT::rx_size != 0? DeclT::rx_size : TINY_SERIAL_DEF_BUF_SIZE,
+      port_kind_traits<kind>,
+      DeclT::tx_size != 0? DeclT::tx_size : TINY_SERIAL_DEF_BUF_SIZE,
+      DeclT::features,
+      typename detail::select_registers<
+        static_cast<port_num>(DeclT::number), (DeclT::features & pf_fixed_registers) != 0>::type> type;
+  };
+
+  /** Returns the instance of the port number. */
+  template <typename UartT, unsigned int Num>
+  static UartT& instance(void)
+  {
+    return detail::port_instance<UartT, static_cast<port_num>(Num)>();
+  }
+};
+
+/** The port of the registry, see port_registry.
+ *
+ *  typedef port_registry<port_decl<1, nine_bits>, port_decl<2> > ports;
+ *  serial_port<ports, 1>::instance().open(19200, extended_port_traits::_9n1);
+ */
+template <typename RegistryT, unsigned int Num>
+using serial_port = registered_port<RegistryT, Num, target_ports>;
 
 } // namespace io
 
@@ -646,4 +907,115 @@ typedef com_port<port_kind::extended, port_num::com3> extended_port3;
 
 //extern void serialEventRun(void) __attribute__((weak));
 
+// The vectors of the ports, TINY_SERIAL_PORTS defines the handlers.
+
+#if defined(USART_RX_vect)
+# define TINY_USART0_RX_vect USART_RX_vect
+#elif defined(USART0_RX_vect)
+# define TINY_USART0_RX_vect USART0_RX_vect
+#elif defined(USART_RXC_vect)
+# define TINY_USART0_RX_vect USART_RXC_vect // ATmega8
+#endif
+
+#if defined(UART0_UDRE_vect)
+# define TINY_USART0_UDRE_vect UART0_UDRE_vect
+#elif defined(UART_UDRE_vect)
+# define TINY_USART0_UDRE_vect UART_UDRE_vect
+#elif defined(USART0_UDRE_vect)
+# define TINY_USART0_UDRE_vect USART0_UDRE_vect
+#elif defined(USART_UDRE_vect)
+# define TINY_USART0_UDRE_vect USART_UDRE_vect
+#endif
+
+#if defined(UART1_RX_vect)
+# define TINY_USART1_RX_vect UART1_RX_vect
+#elif defined(USART1_RX_vect)
+# define TINY_USART1_RX_vect USART1_RX_vect
+#endif
+
+#if defined(UART1_UDRE_vect)
+# define TINY_USART1_UDRE_vect UART1_UDRE_vect
+#elif defined(USART1_UDRE_vect)
+# define TINY_USART1_UDRE_vect USART1_UDRE_vect
+#endif
+
+#if defined(USART2_RX_vect)
+# define TINY_USART2_RX_vect USART2_RX_vect
+# define TINY_USART2_UDRE_vect USART2_UDRE_vect
+#endif
+
+#if defined(USART3_RX_vect)
+# define TINY_USART3_RX_vect USART3_RX_vect
+# define TINY_USART3_UDRE_vect USART3_UDRE_vect
+#endif
+
+/** The rx complete and the data register empty handlers of the port. */
+#define TINY_MEGA_PORT_HANDLERS(RegistryT, Num, RxVect, UdreVect) \
+  ISR(RxVect) \
+  { \
+    ::tiny::io::call_rx_handler(::tiny::io::serial_port<RegistryT, Num>::instance()); \
+  } \
+  ISR(UdreVect) \
+  { \
+    ::tiny::io::call_tx_handler(::tiny::io::serial_port<RegistryT, Num>::instance()); \
+  }
+
+#if defined(TINY_USART0_RX_vect) && defined(TINY_USART0_UDRE_vect)
+# define TINY_SERIAL_PORT_HANDLERS_0(RegistryT) TINY_MEGA_PORT_HANDLERS(RegistryT, 0, TINY_USART0_RX_vect, TINY_USART0_UDRE_vect)
+#else
+# define TINY_SERIAL_PORT_HANDLERS_0(RegistryT) static_assert(false, "Can't define uart0 interrupt handlers!");
+#endif
+
+#if defined(TINY_USART1_RX_vect) && defined(TINY_USART1_UDRE_vect)
+# define TINY_SERIAL_PORT_HANDLERS_1(RegistryT) TINY_MEGA_PORT_HANDLERS(RegistryT, 1, TINY_USART1_RX_vect, TINY_USART1_UDRE_vect)
+#else
+# define TINY_SERIAL_PORT_HANDLERS_1(RegistryT) static_assert(false, "Can't define uart1 interrupt handlers!");
+#endif
+
+#if defined(TINY_USART2_RX_vect)
+# define TINY_SERIAL_PORT_HANDLERS_2(RegistryT) TINY_MEGA_PORT_HANDLERS(RegistryT, 2, TINY_USART2_RX_vect, TINY_USART2_UDRE_vect)
+#else
+# define TINY_SERIAL_PORT_HANDLERS_2(RegistryT) static_assert(false, "Can't define uart2 interrupt handlers!");
+#endif
+
+#if defined(TINY_USART3_RX_vect)
+# define TINY_SERIAL_PORT_HANDLERS_3(RegistryT) TINY_MEGA_PORT_HANDLERS(RegistryT, 3, TINY_USART3_RX_vect, TINY_USART3_UDRE_vect)
+#else
+# define TINY_SERIAL_PORT_HANDLERS_3(RegistryT) static_assert(false, "Can't define uart3 interrupt handlers!");
+#endif
+
+#define TINY_SERIAL_PORT_HANDLERS_4(RegistryT) static_assert(false, "The dedicated UART is available on Arduino Due only");
+
+#if TINY_MEGA_IDLE_TIMER
+/** The idle timer vector, the handlers of all the ports re-arm it. */
+# define TINY_MEGA_IDLE_TIMER_HANDLER(RegistryT, Num) \
+  ::tiny::io::call_idle_timer_handler(::tiny::io::serial_port<RegistryT, Num>::instance());
+# define TINY_MEGA_IDLE_TIMER_VECTOR(RegistryT, ...) \
+  ISR(TIMER0_COMPB_vect) \
+  { \
+    ::tiny::io::detail::idle_timer::stop(); \
+    TINY_PP_EACH(TINY_MEGA_IDLE_TIMER_HANDLER, RegistryT, __VA_ARGS__) \
+  }
+#else
+# define TINY_MEGA_IDLE_TIMER_VECTOR(RegistryT, ...)
+#endif // TINY_MEGA_IDLE_TIMER
+
+/** The rx pin edge vectors of the baud rate detection, they take the pin
+ *  change groups over, don't use them along with SoftwareSerial.
+ */
+#if TINY_MEGA_AUTOBAUD && defined(UCSR3A)
+# define TINY_MEGA_AUTOBAUD_VECTORS \
+  ISR(INT2_vect) { ::tiny::io::detail::autobaud_edges::on_edge(); } \
+  ISR(PCINT1_vect) { ::tiny::io::detail::autobaud_edges::on_edge(); }
+#elif TINY_MEGA_AUTOBAUD
+# define TINY_MEGA_AUTOBAUD_VECTORS \
+  ISR(PCINT2_vect) { ::tiny::io::detail::autobaud_edges::on_edge(); }
+#else
+# define TINY_MEGA_AUTOBAUD_VECTORS
+#endif // TINY_MEGA_AUTOBAUD
+
+#define TINY_SERIAL_TARGET_HANDLERS(RegistryT, ...) \
+  TINY_MEGA_IDLE_TIMER_VECTOR(RegistryT, __VA_ARGS__) \
+  TINY_MEGA_AUTOBAUD_VECTORS
+
 #endif // TINY_SERIAL_UART_ARDUINO_MEGA_HPP_
@@ -0,0 +1,140 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/autobaud.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+/** Synthetic trace of the line edges of 8n1 characters. */
+struct trace
+{
+  trace(unsigned long ticks_per_second, double baud, double jitter = 0, double gap = 0):
+    cell(ticks_per_second / baud),
+    jitter(jitter),
+    gap(gap),
+    time(1000),
+    level(true),
+    random(7)
+  {
+    // empty
+  }
+
+  void add(const std::string& text)
+  {
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+      const unsigned bits = (static_cast<unsigned char>(text[i]) << 1) | 0x200;
+      for (size_t b = 0; b < 10; ++b) { line(((bits >> b) & 1) != 0); }
+      time += gap * cell;
+    }
+  }
+
+  void line(bool bit)
+  {
+    std::uniform_real_distribution<double> noise(-jitter, jitter);
+    if (bit != level)
+    {
+      edges.push_back(static_cast<uint32_t>(time + noise(random) * cell));
+      level = bit;
+    }
+    time += cell;
+  }
+
+  unsigned long detect(unsigned long ticks_per_second) const
+  {
+    return tiny::io::detect_baud(edges.data(), edges.size(), ticks_per_second);
+  }
+
+  double cell;
+  double jitter;
+  double gap;
+  double time;
+  bool level;
+  std::mt19937 random;
+  std::vector<uint32_t> edges;
+};
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(autobaud_test, must_detect_every_rate_by_sync_character)
+{
+  const unsigned long rates[] = { 1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200 };
+  for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); ++i)
+  {
+    trace due(84000000, rates[i]);
+    due.add("UU");
+    ASSERT_EQ(due.detect(84000000), rates[i]);
+
+    trace mega(16000000, rates[i]);
+    mega.add("UU");
+    ASSERT_EQ(mega.detect(16000000), rates[i]);
+  }
+}
+
+//------------------------------------------------------------------------
+TEST(autobaud_test, must_detect_by_text_with_skew_jitter_and_gaps)
+{
+  trace t(16000000, 19200 * 1.02, 0.05, 3.5);
+  t.add("Hello, world");
+  ASSERT_EQ(t.detect(16000000), 19200u);
+
+  trace slow(84000000, 9600 * 0.98, 0.1, 0.5);
+  slow.add("AT\r\n");
+  ASSERT_EQ(slow.detect(84000000), 9600u);
+}
+
+//------------------------------------------------------------------------
+TEST(autobaud_test, must_tell_close_rates_apart)
+{
+  trace mdb(16000000, 8738);
+  mdb.add("U0");
+  ASSERT_EQ(mdb.detect(16000000), 8738u);
+
+  trace fast(84000000, 128000);
+  fast.add("U");
+  ASSERT_EQ(fast.detect(84000000), 128000u);
+}
+
+//------------------------------------------------------------------------
+TEST(autobaud_test, must_reject_odd_rates_and_short_traces)
+{
+  trace odd(16000000, 14400);
+  odd.add("UU");
+  ASSERT_EQ(odd.detect(16000000), 0u);
+
+  const uint32_t two[] = { 100, 200 };
+  ASSERT_EQ(tiny::io::detect_baud(two, 2, 16000000), 0u);
+}
+
+//------------------------------------------------------------------------
+TEST(autobaud_test, must_find_the_gap_between_characters_only)
+{
+  // the Mega edge clock, F_CPU / 8
+  const uint32_t gap = tiny::io::idle_gap(9600, 10, 2000000);
+  ASSERT_EQ(gap, 2084u);
+
+  // back to back 8n1 characters stay high shorter, 0xff the longest
+  trace packed(2000000, 9600);
+  packed.add("\xff\x7f\xff\x01");
+  for (size_t i = 2; i < packed.edges.size(); i += 2) { ASSERT_LT(packed.edges[i] - packed.edges[i - 1], gap); }
+
+  trace spaced(2000000, 9600, 0, 1.5);
+  spaced.add("\xff\xff");
+  ASSERT_GE(spaced.edges[2] - spaced.edges[1], gap);
+
+  ASSERT_EQ(tiny::io::idle_gap(115200, 13, 84000000), 9480u);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,158 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/blocking.hpp>
+#include <tiny/container.hpp>
+
+#include <deque>
+#include <utility>
+
+namespace
+{
+
+/** Fake port, the "interrupt" delivers scripted octets at given times. */
+struct fake_uart
+{
+  typedef uint8_t octet_type;
+
+  bool try_read(octet_type& octet)
+  {
+    if (rx.empty()) { return false; }
+    octet = rx.pop();
+    return true;
+  }
+
+  bool async_write(octet_type octet)
+  {
+    return tx.push(octet);
+  }
+
+  tiny::queue<octet_type, 8> rx;
+  tiny::queue<octet_type, 4> tx;
+};
+
+fake_uart uart;
+std::deque<std::pair<unsigned long, uint8_t> > script;
+size_t tx_drain_period = 0;
+
+/** Virtual time, every idle is one millisecond. */
+struct virtual_wait_policy
+{
+  typedef unsigned long time_type;
+
+  static time_type now(void) { return time; }
+
+  static void idle(void)
+  {
+    ++time;
+    ++idles;
+    while (!script.empty() && script.front().first <= time)
+    {
+      uart.rx.push(script.front().second);
+      script.pop_front();
+    }
+    if (tx_drain_period != 0 && time % tx_drain_period == 0) { uart.tx.pop(); }
+  }
+
+  static time_type time;
+  static size_t idles;
+};
+
+virtual_wait_policy::time_type virtual_wait_policy::time = 0;
+size_t virtual_wait_policy::idles = 0;
+
+//------------------------------------------------------------------------
+void reset(unsigned long start = 1000)
+{
+  uart.rx.clear();
+  uart.tx.clear();
+  script.clear();
+  tx_drain_period          = 0;
+  virtual_wait_policy::time  = start;
+  virtual_wait_policy::idles = 0;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(blocking_test, read_must_return_at_once_if_data_available)
+{
+  reset();
+  uart.rx.push(1);
+  uart.rx.push(2);
+  uint8_t buf[2] = {0};
+  ASSERT_EQ((tiny::io::read<virtual_wait_policy>(uart, buf, 2, 10)), 2u);
+  ASSERT_EQ(buf[0], 1);
+  ASSERT_EQ(buf[1], 2);
+  ASSERT_EQ(virtual_wait_policy::idles, 0u);
+}
+
+//------------------------------------------------------------------------
+TEST(blocking_test, read_must_wait_for_late_octets)
+{
+  reset();
+  script.push_back(std::make_pair(1003ul, uint8_t(7)));
+  script.push_back(std::make_pair(1008ul, uint8_t(8)));
+  uint8_t buf[2] = {0};
+  ASSERT_EQ((tiny::io::read<virtual_wait_policy>(uart, buf, 2, 10)), 2u);
+  ASSERT_EQ(buf[0], 7);
+  ASSERT_EQ(buf[1], 8);
+  ASSERT_EQ(virtual_wait_policy::time, 1008u);
+}
+
+//------------------------------------------------------------------------
+TEST(blocking_test, read_must_return_partial_count_on_timeout)
+{
+  reset();
+  script.push_back(std::make_pair(1002ul, uint8_t(7)));
+  script.push_back(std::make_pair(1020ul, uint8_t(8)));
+  uint8_t buf[2] = {0};
+  ASSERT_EQ((tiny::io::read<virtual_wait_policy>(uart, buf, 2, 10)), 1u);
+  ASSERT_EQ(buf[0], 7);
+  ASSERT_EQ(virtual_wait_policy::time, 1010u);
+}
+
+//------------------------------------------------------------------------
+TEST(blocking_test, read_must_handle_clock_wrap_around)
+{
+  reset(static_cast<unsigned long>(-3));
+  uint8_t buf[1] = {0};
+  ASSERT_EQ((tiny::io::read<virtual_wait_policy>(uart, buf, 1, 5)), 0u);
+  ASSERT_EQ(virtual_wait_policy::idles, 5u);
+}
+
+//------------------------------------------------------------------------
+TEST(blocking_test, read_until_must_stop_after_delimiter)
+{
+  reset();
+  const char line[] = "ab\ncd";
+  for (size_t i = 0; i < sizeof(line) - 1; ++i)
+  {
+    script.push_back(std::make_pair(1001ul + i, uint8_t(line[i])));
+  }
+  uint8_t buf[8] = {0};
+  ASSERT_EQ((tiny::io::read_until<virtual_wait_policy>(uart, buf, sizeof(buf), uint8_t('\n'), 100)), 3u);
+  ASSERT_EQ(buf[2], '\n');
+  ASSERT_EQ((tiny::io::read_until<virtual_wait_policy>(uart, buf, sizeof(buf), uint8_t('\n'), 10)), 2u);
+  ASSERT_EQ(buf[0], 'c');
+  ASSERT_EQ(buf[1], 'd');
+}
+
+//------------------------------------------------------------------------
+TEST(blocking_test, write_must_wait_for_room_and_time_out)
+{
+  reset();
+  const uint8_t data[] = {1, 2, 3, 4, 5, 6};
+  tx_drain_period = 4;
+  // 3 octets fit at once, then one more every 4 ms
+  ASSERT_EQ((tiny::io::write<virtual_wait_policy>(uart, data, sizeof(data), 10)), 5u);
+  ASSERT_EQ(virtual_wait_policy::time, 1010u);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,195 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/bridge.hpp>
+
+#include "sim_wire.hpp"
+
+#include <deque>
+#include <string>
+
+namespace
+{
+
+typedef sim::uart<uint8_t, 8> uart8;
+typedef sim::uart<uint16_t, 8> uart9;
+
+//------------------------------------------------------------------------
+std::string transmitted(uart8& port)
+{
+  std::string result;
+  while (!port.tx.empty()) { result += static_cast<char>(port.tx.pop()); }
+  return result;
+}
+
+//------------------------------------------------------------------------
+bool data_only(uint16_t octet, uint8_t& out, void*)
+{
+  // the 9th bit marks an address octet
+  out = static_cast<uint8_t>(octet);
+  return (octet & 0x100) == 0;
+}
+
+/** Latency in octet times from the octet received at the source to its
+ *  start on the destination line, the line moves an octet per tick both
+ *  ways and the main loop comes every period ticks.
+ */
+struct latency
+{
+  latency(void): total(0), worst(0), count(0) { }
+
+  double mean(void) const { return static_cast<double>(total) / count; }
+
+  template <typename ForwardT>
+  void run(size_t octets, size_t period, ForwardT forward)
+  {
+    std::deque<size_t> received;
+    for (size_t t = 0; count < octets; ++t)
+    {
+      if (t < octets)
+      {
+        received.push_back(t);
+        from.receive(static_cast<uint8_t>(t));
+      }
+
+      if (t % period == 0) { forward(); }
+
+      if (!to.tx.empty())
+      {
+        to.tx.pop();
+        const size_t ticks = t - received.front();
+        received.pop_front();
+        total += ticks;
+        worst = ticks > worst? ticks: worst;
+        ++count;
+      }
+    }
+  }
+
+  uart8 from;
+  uart8 to;
+  size_t total;
+  size_t worst;
+  size_t count;
+};
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(bridge_test, must_forward_in_rx_interrupt)
+{
+  uart8 a, b;
+  tiny::io::bridge<uart8, uart8> sut(a, b);
+  sut.open();
+
+  a.receive('x');
+  a.receive('y');
+  ASSERT_EQ(a.available(), 0u);
+  ASSERT_EQ(transmitted(b), "xy");
+  ASSERT_FALSE(sut.stalled());
+
+  sut.close();
+  a.receive('z');
+  ASSERT_EQ(a.available(), 1u);
+  ASSERT_EQ(transmitted(b), "");
+}
+
+//------------------------------------------------------------------------
+TEST(bridge_test, must_hold_back_and_keep_order_when_destination_is_full)
+{
+  uart8 a, b;
+  tiny::io::bridge<uart8, uart8> sut(a, b);
+  sut.open();
+
+  const std::string text = "abcdefghij";
+  for (size_t i = 0; i < text.size(); ++i) { a.receive(text[i]); }
+  ASSERT_TRUE(sut.stalled());
+  ASSERT_EQ(a.available(), 3u);
+  ASSERT_FALSE(sut.poll());
+
+  std::string result = transmitted(b);
+  ASSERT_TRUE(sut.poll());
+  ASSERT_EQ(a.available(), 0u);
+
+  // the next octet goes straight again
+  a.receive('k');
+  ASSERT_FALSE(sut.stalled());
+  result += transmitted(b);
+  ASSERT_EQ(result, "abcdefghijk");
+}
+
+//------------------------------------------------------------------------
+TEST(bridge_test, must_not_pass_the_backlog_before_poll)
+{
+  uart8 a, b;
+  tiny::io::bridge<uart8, uart8> sut(a, b);
+
+  a.receive('a'); // buffered while closed
+  sut.open();
+  a.receive('b');
+  ASSERT_EQ(transmitted(b), "");
+
+  ASSERT_TRUE(sut.poll());
+  a.receive('c');
+  ASSERT_EQ(transmitted(b), "abc");
+}
+
+//------------------------------------------------------------------------
+TEST(bridge_test, must_translate_and_filter_nine_bits)
+{
+  uart9 a;
+  uart8 b;
+  tiny::io::bridge<uart9, uart8> sut(a, b);
+  sut.filter(data_only);
+  sut.open();
+
+  a.receive(0x10b);
+  a.receive('o');
+  a.receive('k');
+  a.receive(0x1aa);
+  ASSERT_EQ(transmitted(b), "ok");
+  ASSERT_EQ(sut.dropped(), 2u);
+
+  uart8 c;
+  uart9 d;
+  tiny::io::bridge<uart8, uart9> up(c, d);
+  up.open();
+  c.receive(0xff);
+  ASSERT_EQ(d.tx.pop(), 0xff);
+}
+
+//------------------------------------------------------------------------
+TEST(bridge_test, must_beat_main_loop_pump_latency)
+{
+  const size_t octets = 1000;
+  const size_t period = 5; // the main loop busy with other things
+
+  latency pumped;
+  pumped.run(octets, period, [&pumped]
+  {
+    while (pumped.from.available() && pumped.to.tx.can_push())
+    {
+      pumped.to.async_write(pumped.from.async_read());
+    }
+  });
+
+  latency bridged;
+  tiny::io::bridge<uart8, uart8> sut(bridged.from, bridged.to);
+  sut.open();
+  bridged.run(octets, period, [&sut] { sut.poll(); });
+
+  ::testing::Test::RecordProperty("pump_mean_x100", static_cast<int>(pumped.mean() * 100));
+  ::testing::Test::RecordProperty("bridge_mean_x100", static_cast<int>(bridged.mean() * 100));
+
+  ASSERT_EQ(bridged.worst, 0u);
+  ASSERT_GE(pumped.worst, period - 1);
+  ASSERT_LT(bridged.mean(), pumped.mean());
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
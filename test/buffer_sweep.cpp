@@ -0,0 +1,70 @@
+// Buffer size planning. Sweeps the line rates, the frame formats, the
+// main loop service intervals and their jitter on the line model of a host
+// port and prints CSV: the most octets waiting seen on the largest rings
+// and the smallest power of two TINY_SERIAL_DEF_BUF_SIZE dropping nothing.
+// With echo the main loop writes the octets read back, the tx ring fills
+// too.
+//
+//   buffer_sweep [octets per run [load % [burst [echo]]]]
+
+#include "line_model.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+
+struct format
+{
+  const char* name;
+  uint32_t config;
+};
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  typedef tiny::io::soft_uart_traits traits;
+
+  const unsigned long octets = argc > 1? std::strtoul(argv[1], nullptr, 10): 20000;
+  const double load          = argc > 2? std::atof(argv[2]) / 100: 1.0;
+  const unsigned long burst  = argc > 3? std::strtoul(argv[3], nullptr, 10): 64;
+  const bool echo            = argc > 4 && std::atoi(argv[4]) != 0;
+
+  const unsigned long bauds[] = { 9600, 19200, 38400, 57600, 115200, 250000 };
+  const format formats[]      = { { "8n1", traits::_8n1 }, { "8e1", traits::_8e1 }, { "9n1", traits::_9n1 },
+                                  { "9e2", traits::_9e2 } };
+  const double services[]     = { 100, 250, 500, 1000, 2000, 5000 };
+  const double jitters[]      = { 0, 0.25, 0.5 }; // of the interval
+
+  std::printf("baud,format,load,burst,echo,service_us,jitter_us,frame_us,max_fill,tx_max_fill,buffer_size\n");
+  for (size_t b = 0; b < sizeof(bauds) / sizeof(bauds[0]); ++b)
+  {
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); ++f)
+    {
+      for (size_t s = 0; s < sizeof(services) / sizeof(services[0]); ++s)
+      {
+        for (size_t j = 0; j < sizeof(jitters) / sizeof(jitters[0]); ++j)
+        {
+          const sim::line_profile profile =
+          {
+            bauds[b], formats[f].config, load, burst, services[s], services[s] * jitters[j], octets, echo
+          };
+
+          sim::line_model<sim::max_ring> largest(profile);
+          const sim::line_result result = largest.run();
+          const size_t size             = sim::ring_sweep<>::smallest(profile, 1);
+
+          std::printf("%lu,%s,%.2f,%lu,%d,%.0f,%.0f,%.1f,%lu,%lu,%lu\n", bauds[b], formats[f].name, load, burst,
+                      echo? 1: 0, profile.service_us, profile.jitter_us,
+                      sim::frame_ns(bauds[b], formats[f].config) / 1000, static_cast<unsigned long>(result.max_fill),
+                      static_cast<unsigned long>(result.tx_max_fill), static_cast<unsigned long>(size));
+        }
+      }
+    }
+  }
+
+  return 0;
+}
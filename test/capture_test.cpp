@@ -0,0 +1,251 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/capture.hpp>
+#include <tiny/serial/uart_host.hpp>
+
+#include "sim_wire.hpp"
+
+#include <vector>
+
+namespace
+{
+
+typedef tiny::io::capture_log log_type;
+
+//------------------------------------------------------------------------
+std::vector<uint8_t> dump(log_type& log)
+{
+  std::vector<uint8_t> result;
+  const uint8_t* data = nullptr;
+  for (size_t n = log.readable(data); n != 0; n = log.readable(data))
+  {
+    result.insert(result.end(), data, data + n);
+    log.consume(n);
+  }
+  return result;
+}
+
+//------------------------------------------------------------------------
+std::vector<tiny::io::capture_event> decode(const std::vector<uint8_t>& octets)
+{
+  std::vector<tiny::io::capture_event> result;
+  tiny::io::capture_reader reader;
+  tiny::io::capture_event event;
+  for (size_t i = 0; i < octets.size(); ++i)
+  {
+    if (reader.feed(octets[i], event)) { result.push_back(event); }
+  }
+  return result;
+}
+
+/** Echoes the octets received upper case, the application under replay. */
+struct upper_echo
+{
+  void poll(void)
+  {
+    while (port.available() != 0)
+    {
+      const uint8_t octet = port.async_read();
+      port.async_write(octet >= 'a' && octet <= 'z'? static_cast<uint8_t>(octet - 'a' + 'A'): octet);
+    }
+  }
+
+  sim::uart<> port;
+};
+
+typedef tiny::io::host_uart<uint8_t, 16> host_port;
+
+/** The rx interrupt coming on every data register write, held while the
+ *  interrupts are masked as the target does.
+ */
+struct rx_preemption
+{
+  rx_preemption(tiny::io::host_usart_registers& r, host_port& p): regs(r), port(p), octet(0), pending(false), held(0)
+  {
+    regs.on_write = on_write;
+    regs.context  = this;
+  }
+
+  static void on_write(void* context)
+  {
+    rx_preemption* self = static_cast<rx_preemption*>(context);
+    if (!tiny::detail::interrupt_guard::masked()) { self->deliver(); return; }
+
+    self->pending = true;
+    ++self->held;
+  }
+
+  void deliver(void)
+  {
+    regs.shift_in(octet++);
+    port.service();
+    pending = false;
+  }
+
+  tiny::io::host_usart_registers& regs;
+  host_port& port;
+  uint8_t octet;
+  bool pending;
+  size_t held;
+};
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(capture_test, must_encode_compact_records_and_decode_them)
+{
+  tiny::io::capture_ring<64> log;
+
+  log.record(log_type::rx, 0x41, 1000);     // first, no time
+  log.record(log_type::tx, 0x1a5, 1000);    // 9th bit, no time
+  log.record(log_type::rx, 0x42, 1200);     // 1 octet
+  log.record(log_type::rx, 0x43, 61200);    // 2 octets
+  log.record(log_type::tx, 0x44, 161200);   // 4 octets
+
+  const std::vector<uint8_t> octets = dump(log);
+  ASSERT_EQ(octets.size(), 2u + 2u + 3u + 4u + 6u);
+
+  const std::vector<tiny::io::capture_event> events = decode(octets);
+  ASSERT_EQ(events.size(), 5u);
+  ASSERT_EQ(events[0].time, 0u);
+  ASSERT_EQ(events[0].octet, 0x41);
+  ASSERT_EQ(events[0].dir, log_type::rx);
+  ASSERT_EQ(events[1].octet, 0x1a5);
+  ASSERT_EQ(events[1].dir, log_type::tx);
+  ASSERT_EQ(events[2].time, 200u);
+  ASSERT_EQ(events[3].time, 60200u);
+  ASSERT_EQ(events[4].time, 160200u);
+  ASSERT_FALSE(events[4].lost);
+}
+
+//------------------------------------------------------------------------
+TEST(capture_test, must_keep_records_whole_and_mark_lost)
+{
+  tiny::io::capture_ring<16> log;
+
+  // 7 records of 2 octets fit into 15
+  for (uint8_t i = 0; i < 10; ++i) { log.record(log_type::rx, i, 0); }
+  ASSERT_EQ(log.lost(), 3u);
+
+  std::vector<uint8_t> octets = dump(log);
+  ASSERT_EQ(octets.size(), 14u);
+
+  // the ring wraps, the next record tells about the lost ones
+  log.record(log_type::tx, 0x55, 300);
+  log.record(log_type::tx, 0x56, 300);
+  ASSERT_EQ(log.lost(), 0u);
+
+  const std::vector<uint8_t> more = dump(log);
+  octets.insert(octets.end(), more.begin(), more.end());
+
+  const std::vector<tiny::io::capture_event> events = decode(octets);
+  ASSERT_EQ(events.size(), 9u);
+  ASSERT_EQ(events[6].octet, 6);
+  ASSERT_TRUE(events[7].lost);
+  ASSERT_EQ(events[7].octet, 0x55);
+  ASSERT_EQ(events[7].time, 300u);
+  ASSERT_FALSE(events[8].lost);
+}
+
+//------------------------------------------------------------------------
+TEST(capture_test, must_replay_with_original_and_accelerated_timing)
+{
+  tiny::io::capture_ring<64> log;
+  for (uint32_t i = 0; i < 5; ++i) { log.record(log_type::rx, static_cast<uint16_t>('a' + i), 1000 * i); }
+  const std::vector<uint8_t> octets = dump(log);
+
+  sim::uart<> port;
+  tiny::io::replayer<sim::uart<> > original(port, octets.data(), octets.size());
+  ASSERT_EQ(original.poll(0), 1u);
+  ASSERT_EQ(original.poll(999), 0u);
+  ASSERT_EQ(original.poll(2000), 2u);
+  ASSERT_EQ(original.next_time(), 3000u);
+  ASSERT_EQ(original.poll(5000), 2u);
+  ASSERT_TRUE(original.done());
+  ASSERT_EQ(port.available(), 5u);
+
+  sim::uart<> fast_port;
+  tiny::io::replayer<sim::uart<> > fast(fast_port, octets.data(), octets.size(), 10);
+  ASSERT_EQ(fast.poll(250), 3u);
+  ASSERT_EQ(fast.poll(400), 2u);
+
+  sim::uart<> burst_port;
+  tiny::io::replayer<sim::uart<> > burst(burst_port, octets.data(), octets.size(), 0);
+  ASSERT_EQ(burst.poll(0), 5u);
+}
+
+//------------------------------------------------------------------------
+TEST(capture_test, must_check_sent_octets_against_log)
+{
+  // the production session: "hi" answered "HI", then "ok" answered "OK"
+  tiny::io::capture_ring<64> log;
+  const char* session = "hHiIoOkK";
+  for (uint32_t i = 0; session[i] != 0; ++i)
+  {
+    log.record(i % 2 == 0? log_type::rx: log_type::tx, static_cast<uint8_t>(session[i]), 100 * i);
+  }
+  const std::vector<uint8_t> octets = dump(log);
+
+  upper_echo app;
+  tiny::io::replayer<sim::uart<> > sut(app.port, octets.data(), octets.size(), 0);
+  while (!sut.done() || !app.port.tx.empty())
+  {
+    sut.poll(0);
+    app.poll();
+    while (!app.port.tx.empty()) { ASSERT_TRUE(sut.check(app.port.tx.pop())); }
+  }
+  ASSERT_EQ(sut.delivered(), 4u);
+  ASSERT_EQ(sut.mismatches(), 0u);
+
+  // a regression answering lower case
+  sim::uart<> broken;
+  tiny::io::replayer<sim::uart<> > again(broken, octets.data(), octets.size(), 0);
+  again.poll(0);
+  ASSERT_FALSE(again.check('h'));
+  ASSERT_EQ(again.mismatches(), 1u);
+}
+
+//------------------------------------------------------------------------
+TEST(capture_test, must_record_in_line_order_when_rx_preempts_tx)
+{
+  tiny::io::host_usart_registers regs;
+  host_port port(regs);
+  tiny::io::capture_ring<64> log;
+  port.open(9600);
+  port.capture(&log);
+  rx_preemption rx(regs, port);
+
+  for (uint8_t i = 0; i < 5; ++i)
+  {
+    tiny::io::host_clock::ticks() += 100;
+    ASSERT_TRUE(port.async_write(static_cast<uint8_t>('a' + i)));
+    tiny::io::host_clock::ticks() += 10;
+    if (rx.pending) { rx.deliver(); }
+
+    uint16_t sent;
+    ASSERT_TRUE(regs.shift_out(sent));
+  }
+  ASSERT_EQ(rx.held, 5u);
+
+  const std::vector<tiny::io::capture_event> events = decode(dump(log));
+  ASSERT_EQ(events.size(), 10u);
+  for (size_t i = 0; i < events.size(); ++i)
+  {
+    ASSERT_EQ(events[i].dir, i % 2 == 0? log_type::tx: log_type::rx);
+    ASSERT_EQ(events[i].octet, i % 2 == 0? 'a' + i / 2: i / 2);
+    ASSERT_EQ(events[i].time, i / 2 * 110 + i % 2 * 10);
+  }
+
+  uint8_t octet;
+  ASSERT_TRUE(port.try_read(octet));
+  ASSERT_EQ(octet, 0);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -5,6 +5,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <functional>
 
 TEST(array_test, must_create_array_using_iterators_pair)
 {
@@ -138,6 +139,188 @@ TEST(queue_test, must_push_items_and_overwrite_tail_if_overflow_occurs_and_then_
   ASSERT_EQ(sut.pop(), 0);
 }
 
+namespace
+{
+
+/** Queue element running the other side of the queue whenever it is
+ *  copied, before taking the value: the interrupt coming in the middle of
+ *  push or pop, between the element access and the index store.
+ */
+struct preempting_item
+{
+  preempting_item(void): value(0) {}
+  preempting_item(uint32_t v): value(v) {}
+  preempting_item(const preempting_item& other): value(0) { preempt(); value = other.value; }
+  preempting_item& operator=(const preempting_item& other) { preempt(); value = other.value; return *this; }
+
+  static void preempt(void)
+  {
+    // the preempting side doesn't nest
+    if (preemption && !preempting)
+    {
+      preempting = true;
+      preemption();
+      preempting = false;
+    }
+  }
+
+  uint32_t value;
+
+  static std::function<void(void)> preemption;
+  static bool preempting;
+};
+
+std::function<void(void)> preempting_item::preemption;
+bool preempting_item::preempting = false;
+
+/** The port handler pushes between the steps of every pop. */
+template <size_t Capacity>
+void producer_preempts_consumer(void)
+{
+  constexpr uint32_t count = 1000;
+  tiny::queue<preempting_item, Capacity> sut;
+  uint32_t pushed = 0;
+  preempting_item::preemption = [&]() {
+    if (pushed < count && sut.push(preempting_item(pushed + 1))) { ++pushed; }
+  };
+
+  for (uint32_t expected = 1; expected <= count; )
+  {
+    if (sut.empty()) { preempting_item::preempt(); continue; }
+    ASSERT_LT(sut.size(), Capacity);
+    ASSERT_EQ(sut.pop().value, expected++);
+  }
+
+  preempting_item::preemption = nullptr;
+  ASSERT_EQ(pushed, count);
+  ASSERT_TRUE(sut.empty());
+}
+
+/** The reading interrupt drains the queue between the steps of every push. */
+template <size_t Capacity>
+void consumer_preempts_producer(void)
+{
+  constexpr uint32_t count = 1000;
+  tiny::queue<preempting_item, Capacity> sut;
+  uint32_t expected = 1;
+  preempting_item::preemption = [&]() {
+    while (!sut.empty()) { ASSERT_EQ(sut.pop().value, expected++); }
+  };
+
+  for (uint32_t i = 1; i <= count; ++i)
+  {
+    ASSERT_TRUE(sut.push(preempting_item(i)));
+  }
+
+  preempting_item::preempt();
+  preempting_item::preemption = nullptr;
+  ASSERT_EQ(expected, count + 1);
+  ASSERT_TRUE(sut.empty());
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(queue_test, must_keep_order_when_producer_preempts_consumer)
+{
+  producer_preempts_consumer<16>();
+}
+
+//------------------------------------------------------------------------
+TEST(queue_test, must_keep_order_for_non_power_of_two_capacity_when_producer_preempts)
+{
+  producer_preempts_consumer<7>();
+}
+
+//------------------------------------------------------------------------
+TEST(queue_test, must_hide_the_element_until_pushed_when_consumer_preempts_producer)
+{
+  consumer_preempts_producer<16>();
+  consumer_preempts_producer<7>();
+}
+
+//------------------------------------------------------------------------
+TEST(queue_test, spans_must_cover_the_ring_around_the_wrap)
+{
+  tiny::queue<uint8_t, 8> sut;
+  uint8_t* out = nullptr;
+  const uint8_t* in = nullptr;
+
+  ASSERT_EQ(sut.writable(out), 7u);
+  ASSERT_EQ(sut.readable(in), 0u);
+
+  for (uint8_t i = 0; i < 5; ++i) { out[i] = i; }
+  sut.commit(5);
+  ASSERT_EQ(sut.size(), 5u);
+  ASSERT_EQ(sut.readable(in), 5u);
+  ASSERT_EQ(in[4], 4);
+  sut.consume(5);
+  ASSERT_TRUE(sut.empty());
+
+  // head at 5, the room runs to the end and continues from the start
+  ASSERT_EQ(sut.writable(out), 3u);
+  for (uint8_t i = 0; i < 3; ++i) { out[i] = static_cast<uint8_t>(10 + i); }
+  sut.commit(3);
+  ASSERT_EQ(sut.writable(out), 4u);
+  out[0] = 13;
+  sut.commit(1);
+
+  ASSERT_EQ(sut.readable(in), 3u);
+  sut.consume(3);
+  ASSERT_EQ(sut.readable(in), 1u);
+  ASSERT_EQ(in[0], 13);
+  ASSERT_EQ(sut.pop(), 13);
+}
+
+//------------------------------------------------------------------------
+TEST(queue_test, byte_indices_must_wrap_as_wide_ones)
+{
+  // the AVR default, one store publishes an index
+  tiny::queue<int, 200, uint8_t> sut;
+  int* out = nullptr;
+
+  for (int i = 0; i < 150; ++i) { ASSERT_TRUE(sut.push(i)); }
+  for (int i = 0; i < 150; ++i) { ASSERT_EQ(sut.pop(), i); }
+
+  // 50 to the end and 100 over the wrap, the sum overflows a byte
+  ASSERT_EQ(sut.writable(out), 50u);
+  sut.commit(50);
+  ASSERT_EQ(sut.writable(out), 149u);
+  sut.commit(100);
+  ASSERT_EQ(sut.head_index(), 100u);
+  ASSERT_EQ(sut.size(), 150u);
+  sut.consume(50);
+  sut.consume(100);
+  ASSERT_EQ(sut.tail_index(), 100u);
+  ASSERT_TRUE(sut.empty());
+
+  tiny::queue<int, 256, uint8_t> full_range;
+  for (int i = 0; i < 1000; ++i)
+  {
+    ASSERT_TRUE(full_range.push(i));
+    ASSERT_EQ(full_range.pop(), i);
+  }
+}
+
+//------------------------------------------------------------------------
+TEST(queue_test, spans_must_interoperate_with_push_and_pop)
+{
+  tiny::queue<uint8_t, 5> sut;
+  uint8_t* out = nullptr;
+
+  ASSERT_TRUE(sut.push(1));
+  ASSERT_TRUE(sut.push(2));
+  ASSERT_EQ(sut.pop(), 1);
+  ASSERT_EQ(sut.writable(out), 3u);
+  out[0] = 3;
+  out[1] = 4;
+  out[2] = 5;
+  sut.commit(3);
+  ASSERT_FALSE(sut.can_push());
+  ASSERT_EQ(sut.writable(out), 0u);
+  for (uint8_t i = 2; i <= 5; ++i) { ASSERT_EQ(sut.pop(), i); }
+}
+
 //------------------------------------------------------------------------
 TEST(bitset_test, must_initialize_and_return_bits_properly)
 {
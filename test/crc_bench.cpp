@@ -0,0 +1,100 @@
+// CRC throughput, bitwise per octet as the protocols had it against the
+// single table and slicing-by-4, on a buffer in cache.
+
+#include <tiny/crc.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#if defined (__x86_64__) || defined (__i386__)
+# include <x86intrin.h>
+# define BENCH_HAS_TSC
+#endif // __x86_64__ || __i386__
+
+namespace
+{
+
+typedef std::chrono::steady_clock clock_type;
+
+enum { block = 4096, rounds = 5000 };
+
+/** Bitwise reference, what the protocol code did per octet. */
+struct bitwise_crc32
+{
+  static uint32_t compute(const uint8_t* data, size_t size)
+  {
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; ++i)
+    {
+      crc ^= data[i];
+      for (int j = 0; j < 8; ++j) { crc = (crc & 1) != 0? (crc >> 1) ^ 0xedb88320: crc >> 1; }
+    }
+    return crc ^ 0xffffffff;
+  }
+};
+
+/** Bitwise reference of CRC-16/MODBUS. */
+struct bitwise_crc16
+{
+  static uint16_t compute(const uint8_t* data, size_t size)
+  {
+    uint16_t crc = 0xffff;
+    for (size_t i = 0; i < size; ++i)
+    {
+      crc ^= data[i];
+      for (int j = 0; j < 8; ++j) { crc = (crc & 1) != 0? (crc >> 1) ^ 0xa001: crc >> 1; }
+    }
+    return crc;
+  }
+};
+
+typedef tiny::crc<uint32_t, 0x04c11db7, 0xffffffff, true, 0xffffffff, 1> crc32_table;
+typedef tiny::crc<uint32_t, 0x04c11db7, 0xffffffff, true, 0xffffffff, 4> crc32_sliced;
+typedef tiny::crc<uint16_t, 0x8005, 0xffff, true, 0x0000, 1> crc16_table;
+typedef tiny::crc<uint16_t, 0x8005, 0xffff, true, 0x0000, 4> crc16_sliced;
+
+//------------------------------------------------------------------------
+template <typename CrcT>
+void run(const char* name, const std::vector<uint8_t>& data)
+{
+  unsigned long sink = 0;
+  const size_t octets = size_t(rounds) * data.size();
+
+#ifdef BENCH_HAS_TSC
+  const unsigned long long c0 = __rdtsc();
+#endif // BENCH_HAS_TSC
+  const auto t0 = clock_type::now();
+  for (size_t i = 0; i < rounds; ++i) { sink += CrcT::compute(data.data(), data.size()); }
+  const auto t1 = clock_type::now();
+#ifdef BENCH_HAS_TSC
+  const unsigned long long c1 = __rdtsc();
+#endif // BENCH_HAS_TSC
+
+  const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+  std::cout << "  " << name << ": " << ns / octets << " ns/octet";
+#ifdef BENCH_HAS_TSC
+  std::cout << ", " << double(c1 - c0) / octets << " ticks/octet";
+#endif // BENCH_HAS_TSC
+  std::cout << " (" << (sink & 1) << ")" << std::endl;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main(void)
+{
+  std::vector<uint8_t> data(block);
+  for (size_t i = 0; i < data.size(); ++i) { data[i] = static_cast<uint8_t>(std::rand()); }
+
+  std::cout << "crc, " << int(block) << " octets block" << std::endl;
+  run<bitwise_crc32>("crc32 bitwise        ", data);
+  run<crc32_table>("crc32 table          ", data);
+  run<crc32_sliced>("crc32 slicing-by-4   ", data);
+  run<bitwise_crc16>("crc16/modbus bitwise ", data);
+  run<crc16_table>("crc16/modbus table   ", data);
+  run<crc16_sliced>("crc16/modbus slicing ", data);
+
+  return 0;
+}
@@ -0,0 +1,154 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/crc.hpp>
+#include <tiny/container.hpp>
+
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+
+constexpr char check_string[] = "123456789";
+
+// the check values are computed bitwise at compile time
+static_assert(tiny::crc32::of(check_string, 9) == 0xcbf43926, "CRC-32 check value");
+static_assert(tiny::crc16_modbus::of(check_string, 9) == 0x4b37, "CRC-16/MODBUS check value");
+
+typedef tiny::crc<uint32_t, 0x04c11db7, 0xffffffff, true, 0xffffffff, 4> crc32_sliced;
+typedef tiny::crc<uint16_t, 0x8005, 0xffff, true, 0x0000, 4> crc16_modbus_sliced;
+typedef tiny::crc<uint16_t, 0x1021, 0xffff, false, 0x0000, 4> crc16_ccitt_sliced;
+typedef tiny::crc<uint8_t, 0x31, 0x00, true, 0x00, 4> crc8_maxim_sliced;
+
+//------------------------------------------------------------------------
+const uint8_t* check_data(void)
+{
+  return reinterpret_cast<const uint8_t*>(check_string);
+}
+
+//------------------------------------------------------------------------
+template <typename CrcT>
+void assert_check_value(typename CrcT::value_type expected)
+{
+  ASSERT_EQ(CrcT::compute(check_data(), 9), expected);
+  ASSERT_EQ(CrcT::of(check_string, 9), expected);
+
+  CrcT sut;
+  for (size_t i = 0; i < 9; ++i) { sut.update(check_data()[i]); }
+  ASSERT_EQ(sut.value(), expected);
+}
+
+//------------------------------------------------------------------------
+template <typename CrcT>
+void assert_matches_bitwise(const std::vector<uint8_t>& data)
+{
+  const std::vector<char> chars(data.begin(), data.end());
+  ASSERT_EQ(CrcT::compute(data.data(), data.size()), CrcT::of(chars.data(), chars.size()));
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(crc_test, must_match_catalogue_check_values)
+{
+  assert_check_value<tiny::crc8>(0xf4);
+  assert_check_value<tiny::crc8_maxim>(0xa1);
+  assert_check_value<tiny::crc16_modbus>(0x4b37);
+  assert_check_value<tiny::crc16_ccitt>(0x29b1);
+  assert_check_value<tiny::crc16_xmodem>(0x31c3);
+  assert_check_value<tiny::crc16_kermit>(0x2189);
+  assert_check_value<tiny::crc32>(0xcbf43926);
+  assert_check_value<tiny::crc32c>(0xe3069283);
+}
+
+//------------------------------------------------------------------------
+TEST(crc_test, slicing_must_match_single_table)
+{
+  assert_check_value<crc32_sliced>(0xcbf43926);
+  assert_check_value<crc16_modbus_sliced>(0x4b37);
+  assert_check_value<crc16_ccitt_sliced>(0x29b1);
+  assert_check_value<crc8_maxim_sliced>(0xa1);
+
+  std::srand(1);
+  std::vector<uint8_t> data;
+  for (size_t i = 0; i < 1000; ++i) { data.push_back(static_cast<uint8_t>(std::rand())); }
+
+  for (size_t size = 0; size < data.size(); size += 37)
+  {
+    ASSERT_EQ(crc32_sliced::compute(data.data(), size), tiny::crc32::compute(data.data(), size));
+    ASSERT_EQ(crc16_modbus_sliced::compute(data.data(), size), tiny::crc16_modbus::compute(data.data(), size));
+    ASSERT_EQ(crc8_maxim_sliced::compute(data.data(), size), tiny::crc8_maxim::compute(data.data(), size));
+  }
+}
+
+//------------------------------------------------------------------------
+TEST(crc_test, must_match_bitwise_on_random_data)
+{
+  std::srand(2);
+  std::vector<uint8_t> data;
+  for (size_t i = 0; i < 200; ++i) { data.push_back(static_cast<uint8_t>(std::rand())); }
+
+  assert_matches_bitwise<tiny::crc8>(data);
+  assert_matches_bitwise<tiny::crc16_ccitt>(data);
+  assert_matches_bitwise<tiny::crc16_kermit>(data);
+  assert_matches_bitwise<crc32_sliced>(data);
+  assert_matches_bitwise<tiny::crc32c>(data);
+}
+
+//------------------------------------------------------------------------
+TEST(crc_test, must_update_incrementally)
+{
+  crc32_sliced sut;
+  sut.update(check_data(), 2);
+  sut.update(check_data()[2]);
+  sut.update(check_data() + 3, 6);
+  ASSERT_EQ(sut.value(), 0xcbf43926u);
+
+  sut.reset();
+  ASSERT_EQ(sut.raw(), crc32_sliced::initial());
+  ASSERT_EQ(sut.value(), 0u);
+}
+
+//------------------------------------------------------------------------
+TEST(crc_test, must_leave_zero_residue_after_modbus_crc)
+{
+  uint8_t frame[] = { 1, 3, 0, 0, 0, 10, 0, 0 };
+  const uint16_t crc = tiny::crc16_modbus::compute(frame, 6);
+  frame[6] = static_cast<uint8_t>(crc);
+  frame[7] = static_cast<uint8_t>(crc >> 8);
+
+  tiny::crc16_modbus sut;
+  sut.update(frame, sizeof(frame));
+  ASSERT_EQ(sut.raw(), 0);
+}
+
+//------------------------------------------------------------------------
+TEST(crc_test, must_digest_ring_spans)
+{
+  tiny::queue<uint8_t, 8> ring;
+  tiny::crc32 sut;
+
+  // the ring wraps a few times over the check string
+  for (size_t pos = 0; pos < 9; )
+  {
+    for (; pos < 9 && ring.can_push(); ++pos) { ring.push(check_data()[pos]); }
+
+    const uint8_t* data = nullptr;
+    for (size_t size = ring.readable(data); size != 0; size = ring.readable(data))
+    {
+      sut.update(data, size);
+      ring.consume(size);
+    }
+  }
+
+  ASSERT_EQ(sut.value(), 0xcbf43926u);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
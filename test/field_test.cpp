@@ -0,0 +1,88 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/basic.hpp>
+
+namespace
+{
+
+typedef tiny::field<uint8_t, 1, 2> ucsz;   // UCSRnC character size alike
+typedef tiny::field<uint8_t, 2> ucsz2;     // UCSRnB 9 bits alike
+typedef tiny::field<uint8_t, 0, 8> whole;
+typedef tiny::field<uint32_t, 31> msb;
+typedef tiny::mask_field<uint32_t, 0xe0> errors;
+typedef tiny::mask_field<uint32_t, 0> none;
+
+// the masks, the values and the helpers fold at compile time
+static_assert(ucsz::mask() == 0x06, "ucsz mask");
+static_assert(ucsz2::mask() == 0x04, "ucsz2 mask");
+static_assert(whole::mask() == 0xff, "whole mask");
+static_assert(msb::mask() == 0x80000000u, "msb mask");
+static_assert(errors::offset == 5 && errors::width == 3 && errors::mask() == 0xe0, "errors field");
+static_assert(none::mask() == 0 && !none::is_set(0xffffffffu), "no field");
+static_assert(ucsz::value(3) == 0x06 && ucsz::value(5) == 0x02, "ucsz value");
+static_assert(ucsz::get(0x36) == 3, "ucsz get");
+static_assert(ucsz::replace(0xff, 0) == 0xf9, "ucsz replace");
+static_assert(tiny::fields_mask<ucsz, tiny::field<uint8_t, 7>, tiny::field<uint8_t, 0> >() == 0x87, "masks union");
+static_assert(tiny::mask<uint16_t>(8) == 0x100, "mask");
+static_assert(tiny::mask(7) == 0x80, "register mask");
+static_assert(tiny::bits_value(0x36, 0x06) == 3, "bits value");
+static_assert(tiny::bits_value(0x80, 0x80) == 1, "bits value of msb");
+static_assert(tiny::bits_value(0xff, 0) == 0, "bits value of no bits");
+static_assert(tiny::bit(0x04, 2) == 0x04 && tiny::is_bit(0x04, 2) && !tiny::is_bit(0x04, 1), "bit");
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(field_test, must_read_modify_write_only_the_field)
+{
+  volatile uint8_t reg = 0xa1;
+
+  ucsz::write(&reg, 3);
+  ASSERT_EQ(reg, 0xa7);
+  ASSERT_EQ(ucsz::read(&reg), 3);
+
+  ucsz::write(&reg, 0x0e); // cut to the width
+  ASSERT_EQ(reg, 0xa5);
+
+  ucsz2::clear(&reg);
+  ASSERT_EQ(reg, 0xa1);
+  ucsz2::set(&reg);
+  ASSERT_EQ(reg, 0xa5);
+
+  ucsz2::assign(&reg, false);
+  ASSERT_EQ(reg, 0xa1);
+  ucsz2::assign(&reg, true);
+  ASSERT_TRUE(ucsz2::is_set(reg));
+
+  volatile uint32_t status = 0x40;
+  ASSERT_TRUE(errors::is_set(status));
+  none::set(&status);
+  ASSERT_EQ(status, 0x40u);
+}
+
+//------------------------------------------------------------------------
+TEST(field_test, must_keep_the_runtime_helpers)
+{
+  volatile uint8_t reg = 0;
+  tiny::register_ptr r  = &reg;
+
+  tiny::set_bit(r, 3);
+  ASSERT_TRUE(tiny::is_bit(r, 3));
+  tiny::set_bit(r, 0, true);
+  ASSERT_EQ(reg, 0x09);
+  tiny::clear_bit(r, 3);
+  ASSERT_EQ(reg, 0x01);
+
+  reg = 0x36;
+  ASSERT_EQ(tiny::bits_value(r, tiny::register_bits_type(0x30)), 3u);
+  ASSERT_EQ(tiny::bits_value(static_cast<uint8_t>(0x36), tiny::register_bits_type(0x06)), 3u);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,109 @@
+// COBS and SLIP encode/decode throughput through a ring, streaming codecs
+// working on the ring spans versus encoding into a temporary array and
+// pushing/popping octet by octet.
+
+#include <tiny/serial/framing.hpp>
+#include <tiny/container.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+typedef std::chrono::steady_clock clock_type;
+typedef tiny::queue<uint8_t, 256> ring_type;
+
+enum { frame_size = 200, frames = 200000 };
+
+//------------------------------------------------------------------------
+double mb_per_s(clock_type::duration d)
+{
+  const double bytes = double(frame_size) * frames;
+  return bytes / std::chrono::duration<double>(d).count() / 1e6;
+}
+
+//------------------------------------------------------------------------
+template <typename EncoderT, typename DecoderT>
+double streaming(const std::vector<uint8_t>& frame)
+{
+  ring_type ring;
+  EncoderT encoder;
+  DecoderT decoder;
+  size_t total = 0;
+
+  const auto t0 = clock_type::now();
+  for (size_t i = 0; i < frames; ++i)
+  {
+    encoder.begin(frame.data(), frame.size());
+    while (!decoder.ready())
+    {
+      encoder.poll(ring);
+      decoder.poll(ring);
+    }
+    total += decoder.size();
+    decoder.next();
+  }
+  const auto t1 = clock_type::now();
+
+  if (total != frame.size() * frames) { std::cerr << "size mismatch" << std::endl; }
+  return mb_per_s(t1 - t0);
+}
+
+//------------------------------------------------------------------------
+template <typename EncoderT, typename DecoderT>
+double naive(const std::vector<uint8_t>& frame)
+{
+  ring_type ring;
+  EncoderT encoder;
+  DecoderT decoder;
+  tiny::array<uint8_t, frame_size * 2 + 8> encoded;
+  size_t total = 0;
+
+  const auto t0 = clock_type::now();
+  for (size_t i = 0; i < frames; ++i)
+  {
+    // encode into a temporary array, then push octet by octet
+    encoder.begin(frame.data(), frame.size());
+    const size_t size = encoder.encode(&encoded[0], encoded.size);
+
+    for (size_t pos = 0; pos < size || !decoder.ready(); )
+    {
+      while (pos < size && ring.push(encoded[pos])) { ++pos; }
+      while (!ring.empty() && !decoder.ready())
+      {
+        const uint8_t octet = ring.pop();
+        decoder.feed(&octet, 1);
+      }
+    }
+    total += decoder.size();
+    decoder.next();
+  }
+  const auto t1 = clock_type::now();
+
+  if (total != frame.size() * frames) { std::cerr << "size mismatch" << std::endl; }
+  return mb_per_s(t1 - t0);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main(void)
+{
+  std::vector<uint8_t> frame;
+  std::srand(1);
+  for (size_t i = 0; i < frame_size; ++i) { frame.push_back(static_cast<uint8_t>(std::rand())); }
+
+  typedef tiny::io::cobs_decoder<frame_size> cobs_decoder;
+  typedef tiny::io::slip_decoder<frame_size> slip_decoder;
+
+  std::cout << "encode + decode through a 256 octet ring, " << int(frame_size) << " octet frames" << std::endl;
+  std::cout << "  cobs, streaming on spans: " << streaming<tiny::io::cobs_encoder, cobs_decoder>(frame) << " MB/s" << std::endl;
+  std::cout << "  cobs, naive byte loop:    " << naive<tiny::io::cobs_encoder, cobs_decoder>(frame) << " MB/s" << std::endl;
+  std::cout << "  slip, streaming on spans: " << streaming<tiny::io::slip_encoder, slip_decoder>(frame) << " MB/s" << std::endl;
+  std::cout << "  slip, naive byte loop:    " << naive<tiny::io::slip_encoder, slip_decoder>(frame) << " MB/s" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,221 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/framing.hpp>
+#include <tiny/container.hpp>
+
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+
+typedef std::vector<uint8_t> bytes;
+
+//------------------------------------------------------------------------
+template <typename EncoderT>
+bytes encode(const bytes& frame)
+{
+  EncoderT encoder;
+  bytes out(frame.size() * 2 + 8);
+  encoder.begin(frame.data(), frame.size());
+  out.resize(encoder.encode(out.data(), out.size()));
+  return out;
+}
+
+//------------------------------------------------------------------------
+template <typename DecoderT>
+std::vector<bytes> decode(const bytes& line, size_t chunk = 1)
+{
+  DecoderT decoder;
+  std::vector<bytes> frames;
+
+  for (size_t pos = 0; pos < line.size(); )
+  {
+    const size_t size = line.size() - pos < chunk? line.size() - pos: chunk;
+    pos += decoder.feed(line.data() + pos, size);
+    if (decoder.ready())
+    {
+      frames.push_back(bytes(decoder.frame(), decoder.frame() + decoder.size()));
+      decoder.next();
+    }
+  }
+
+  return frames;
+}
+
+//------------------------------------------------------------------------
+bytes sequence(size_t size, uint8_t first = 1)
+{
+  bytes result;
+  for (size_t i = 0; i < size; ++i) { result.push_back(static_cast<uint8_t>(first + i)); }
+  return result;
+}
+
+//------------------------------------------------------------------------
+bytes random_frame(size_t size)
+{
+  bytes result;
+  for (size_t i = 0; i < size; ++i)
+  {
+    // plenty of special octets
+    const int r = std::rand() % 8;
+    uint8_t octet = static_cast<uint8_t>(std::rand());
+    if (r == 0) { octet = 0; }
+    if (r == 1) { octet = tiny::io::slip_end; }
+    if (r == 2) { octet = tiny::io::slip_esc; }
+    result.push_back(octet);
+  }
+  return result;
+}
+
+//------------------------------------------------------------------------
+bytes concat(bytes a, const bytes& b)
+{
+  a.insert(a.end(), b.begin(), b.end());
+  return a;
+}
+
+typedef tiny::io::cobs_decoder<300> cobs_decoder;
+typedef tiny::io::slip_decoder<300> slip_decoder;
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(framing_test, cobs_must_encode_reference_vectors)
+{
+  using tiny::io::cobs_encoder;
+  ASSERT_EQ(encode<cobs_encoder>({}), (bytes{ 0x01, 0x00 }));
+  ASSERT_EQ(encode<cobs_encoder>({ 0x00 }), (bytes{ 0x01, 0x01, 0x00 }));
+  ASSERT_EQ(encode<cobs_encoder>({ 0x00, 0x00 }), (bytes{ 0x01, 0x01, 0x01, 0x00 }));
+  ASSERT_EQ(encode<cobs_encoder>({ 0x11, 0x22, 0x00, 0x33 }), (bytes{ 0x03, 0x11, 0x22, 0x02, 0x33, 0x00 }));
+  ASSERT_EQ(encode<cobs_encoder>({ 0x11, 0x00, 0x00, 0x00 }), (bytes{ 0x02, 0x11, 0x01, 0x01, 0x01, 0x00 }));
+
+  // 254 non-zero octets take a full block without the trailing code
+  ASSERT_EQ(encode<cobs_encoder>(sequence(254)), concat(concat({ 0xff }, sequence(254)), { 0x00 }));
+
+  // 255 ones split after 254
+  ASSERT_EQ(encode<cobs_encoder>(sequence(255)),
+            concat(concat(concat({ 0xff }, sequence(254)), { 0x02, 0xff }), { 0x00 }));
+
+  // leading zero then 254 octets
+  ASSERT_EQ(encode<cobs_encoder>(concat({ 0x00 }, sequence(254))),
+            concat(concat({ 0x01, 0xff }, sequence(254)), { 0x00 }));
+}
+
+//------------------------------------------------------------------------
+TEST(framing_test, slip_must_escape_special_octets)
+{
+  using tiny::io::slip_encoder;
+  ASSERT_EQ(encode<slip_encoder>({ 0x01, 0xc0, 0x02, 0xdb }), (bytes{ 0x01, 0xdb, 0xdc, 0x02, 0xdb, 0xdd, 0xc0 }));
+  ASSERT_EQ(encode<slip_encoder>({}), (bytes{ 0xc0 }));
+}
+
+//------------------------------------------------------------------------
+TEST(framing_test, decoders_must_round_trip_in_any_chunks)
+{
+  std::srand(1);
+  for (size_t size = 0; size < 600; size += 37)
+  {
+    const bytes frame = random_frame(size % 300);
+
+    for (size_t chunk = 1; chunk < 40; chunk += 13)
+    {
+      const std::vector<bytes> cobs = decode<cobs_decoder>(encode<tiny::io::cobs_encoder>(frame), chunk);
+      ASSERT_EQ(cobs.size(), 1u);
+      ASSERT_EQ(cobs[0], frame);
+
+      if (frame.empty()) { continue; } // SLIP skips empty frames
+      const std::vector<bytes> slip = decode<slip_decoder>(encode<tiny::io::slip_encoder>(frame), chunk);
+      ASSERT_EQ(slip.size(), 1u);
+      ASSERT_EQ(slip[0], frame);
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+TEST(framing_test, decoders_must_stop_at_frame_end)
+{
+  const bytes line = concat(encode<tiny::io::cobs_encoder>({ 1, 2 }), encode<tiny::io::cobs_encoder>({ 3 }));
+  cobs_decoder sut;
+
+  ASSERT_EQ(sut.feed(line.data(), line.size()), 4u);
+  ASSERT_TRUE(sut.ready());
+  ASSERT_EQ(sut.feed(line.data() + 4, line.size() - 4), 0u);
+  sut.next();
+  ASSERT_EQ(sut.feed(line.data() + 4, line.size() - 4), 3u);
+  ASSERT_EQ(sut.size(), 1u);
+  ASSERT_EQ(sut.frame()[0], 3);
+}
+
+//------------------------------------------------------------------------
+TEST(framing_test, decoders_must_drop_malformed_and_long_frames)
+{
+  // truncated block then a good frame
+  const std::vector<bytes> cobs = decode<cobs_decoder>({ 0x05, 0x01, 0x00, 0x02, 0x07, 0x00 });
+  ASSERT_EQ(cobs, (std::vector<bytes>{ { 0x07 } }));
+
+  const std::vector<bytes> slip = decode<slip_decoder>({ 0x01, 0xdb, 0x02, 0xc0, 0x03, 0xc0 });
+  ASSERT_EQ(slip, (std::vector<bytes>{ { 0x03 } }));
+
+  tiny::io::cobs_decoder<4> small;
+  const bytes line = concat(encode<tiny::io::cobs_encoder>(sequence(5)), encode<tiny::io::cobs_encoder>(sequence(4)));
+  size_t pos = small.feed(line.data(), line.size());
+  ASSERT_TRUE(small.ready());
+  ASSERT_EQ(small.size(), 4u);
+  ASSERT_EQ(small.errors(), 1u);
+  small.next();
+  ASSERT_EQ(pos, line.size());
+}
+
+//------------------------------------------------------------------------
+TEST(framing_test, codecs_must_stream_through_small_rings)
+{
+  tiny::queue<uint8_t, 16> ring;
+  tiny::io::cobs_encoder encoder;
+  cobs_decoder decoder;
+
+  std::srand(2);
+  const bytes frame = random_frame(250);
+  encoder.begin(frame.data(), frame.size());
+
+  size_t polls = 0;
+  while (!decoder.ready())
+  {
+    encoder.poll(ring);
+    decoder.poll(ring);
+    ++polls;
+  }
+
+  ASSERT_FALSE(encoder.busy());
+  ASSERT_GT(polls, 16u);
+  ASSERT_EQ(bytes(decoder.frame(), decoder.frame() + decoder.size()), frame);
+  ASSERT_TRUE(ring.empty());
+}
+
+//------------------------------------------------------------------------
+TEST(framing_test, slip_must_stream_through_small_rings)
+{
+  tiny::queue<uint8_t, 5> ring;
+  tiny::io::slip_encoder encoder;
+  slip_decoder decoder;
+
+  const bytes frame = { 0xc0, 0xdb, 0xc0, 0x01, 0xdb, 0xdb, 0x02, 0x03, 0x04, 0xc0 };
+  encoder.begin(frame.data(), frame.size());
+
+  while (!decoder.ready())
+  {
+    encoder.poll(ring);
+    decoder.poll(ring);
+  }
+
+  ASSERT_EQ(bytes(decoder.frame(), decoder.frame() + decoder.size()), frame);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
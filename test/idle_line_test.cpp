@@ -0,0 +1,184 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/idle_line.hpp>
+#include <tiny/container.hpp>
+
+#include <vector>
+
+namespace
+{
+
+typedef tiny::io::idle_line_detector<4> detector_type;
+typedef detector_type::time_type time_type;
+
+/** Simulated line, octets arrive back to back at the baud rate unless a
+ *  gap is injected, the detector is fed the way the rx interrupt does.
+ */
+struct line_sim
+{
+  line_sim(detector_type& detector, unsigned long baud, time_type start = 0):
+    detector(detector),
+    octet_time(tiny::io::bit_times_us(10, baud)),
+    now(start),
+    delimited(0)
+  {
+    // empty
+  }
+
+  void send(size_t count, time_type gap = 0)
+  {
+    now += gap;
+    for (size_t i = 0; i < count; ++i)
+    {
+      now += octet_time;
+      rx.push(static_cast<uint8_t>(rx.size()));
+      if (detector.on_octet(now)) { ++delimited; }
+    }
+  }
+
+  void idle(time_type time) { now += time; }
+
+  std::vector<size_t> frames(void)
+  {
+    std::vector<size_t> result;
+    while (detector.frame_ready()) { result.push_back(detector.pop_frame()); }
+    return result;
+  }
+
+  detector_type& detector;
+  time_type octet_time;
+  time_type now;
+  size_t delimited;
+  tiny::queue<uint8_t, 64> rx;
+};
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(idle_line_test, must_compute_bit_times)
+{
+  ASSERT_EQ(tiny::io::bit_times_us(10, 9600), 1042u);
+  ASSERT_EQ(tiny::io::bit_times_us(39, 19200), 2032u);
+  ASSERT_EQ(tiny::io::bit_times_us(1, 2000000), 1u);
+}
+
+//------------------------------------------------------------------------
+TEST(idle_line_test, must_be_disabled_by_default)
+{
+  detector_type sut;
+  ASSERT_FALSE(sut.enabled());
+  ASSERT_FALSE(sut.frame_ready());
+}
+
+//------------------------------------------------------------------------
+TEST(idle_line_test, must_delimit_frames_by_gaps)
+{
+  detector_type sut;
+  line_sim line(sut, 9600);
+  sut.enable(tiny::io::bit_times_us(35, 9600), line.octet_time);
+
+  line.send(8);
+  line.send(5, 4000);
+  line.send(3, 4000);
+  ASSERT_EQ(line.delimited, 2u);
+
+  line.idle(3000);
+  ASSERT_FALSE(sut.poll(line.now));
+  line.idle(1000);
+  ASSERT_TRUE(sut.poll(line.now));
+
+  ASSERT_EQ(line.frames(), (std::vector<size_t>{ 8, 5, 3 }));
+}
+
+//------------------------------------------------------------------------
+TEST(idle_line_test, must_not_split_frames_on_short_gaps)
+{
+  detector_type sut;
+  line_sim line(sut, 9600);
+  sut.enable(tiny::io::bit_times_us(35, 9600), line.octet_time);
+
+  line.send(4);
+  line.send(4, 3500); // a bit less than 3.5 octets
+  line.idle(10000);
+  ASSERT_TRUE(sut.poll(line.now));
+  ASSERT_FALSE(sut.poll(line.now));
+
+  ASSERT_EQ(line.frames(), (std::vector<size_t>{ 8 }));
+}
+
+//------------------------------------------------------------------------
+TEST(idle_line_test, must_delimit_across_clock_wrap_around)
+{
+  detector_type sut;
+  line_sim line(sut, 115200, 0xffffff00u);
+  sut.enable(tiny::io::bit_times_us(35, 115200), line.octet_time);
+
+  line.send(6);
+  line.send(2, 1000);
+  line.idle(1000);
+  sut.poll(line.now);
+
+  ASSERT_LT(line.now, 0xffffff00u);
+  ASSERT_EQ(line.frames(), (std::vector<size_t>{ 6, 2 }));
+}
+
+//------------------------------------------------------------------------
+TEST(idle_line_test, must_delimit_by_hardware_timeout)
+{
+  detector_type sut;
+  sut.enable();
+  ASSERT_FALSE(sut.timed());
+
+  ASSERT_FALSE(sut.on_idle());
+  sut.on_octet();
+  sut.on_octet();
+  ASSERT_TRUE(sut.on_idle());
+  ASSERT_FALSE(sut.on_idle());
+  sut.on_octet();
+  ASSERT_TRUE(sut.on_idle());
+
+  ASSERT_EQ(sut.pop_frame(), 2u);
+  ASSERT_EQ(sut.pop_frame(), 1u);
+  ASSERT_FALSE(sut.frame_ready());
+}
+
+//------------------------------------------------------------------------
+TEST(idle_line_test, must_merge_frames_when_lengths_full)
+{
+  tiny::io::idle_line_detector<2> sut;
+  sut.enable();
+
+  for (size_t i = 1; i <= 4; ++i)
+  {
+    for (size_t j = 0; j < i; ++j) { sut.on_octet(); }
+    sut.on_idle();
+  }
+
+  ASSERT_EQ(sut.pop_frame(), 1u);
+  ASSERT_EQ(sut.pop_frame(), 2u);
+  ASSERT_FALSE(sut.frame_ready());
+  ASSERT_TRUE(sut.on_idle());
+  ASSERT_EQ(sut.pop_frame(), 7u);
+}
+
+//------------------------------------------------------------------------
+TEST(idle_line_test, reset_must_drop_frames)
+{
+  detector_type sut;
+  sut.enable();
+  sut.on_octet();
+  sut.on_idle();
+  sut.on_octet();
+  sut.reset();
+  ASSERT_FALSE(sut.frame_ready());
+  ASSERT_FALSE(sut.on_idle());
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,148 @@
+// Queueing delay histograms of a simulated port echoing what it receives.
+// The line carries octets at the load given, the main loop polls the port
+// between jobs of random length and writes every octet read back, the tx
+// interrupt sends the buffered octets at the line rate. The probes are the
+// ones basic_uart uses with TINY_SERIAL_LATENCY_STATS, on a virtual
+// microsecond clock.
+//
+//   latency_bench [baud [load % [mean job us]]]
+
+#include <tiny/serial/latency.hpp>
+#include <tiny/serial/tx_lanes.hpp>
+#include <tiny/container.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "virtual_clock.hpp"
+
+namespace
+{
+
+typedef sim::us_clock virtual_clock;
+
+enum { buffer_size = 32, seconds = 2 };
+
+typedef tiny::io::latency_probe<true, buffer_size, virtual_clock> probe_type;
+
+/** The port rings and probes, rx and tx interrupts at the line rate. */
+struct echo_port
+{
+  echo_port(unsigned long baud, unsigned load, unsigned long job_us):
+    octet_us(10000000ul / baud),
+    load(load),
+    job(1.0 / job_us),
+    random(7),
+    next_rx(0),
+    next_tx(0),
+    next_poll(0),
+    dropped(0)
+  {
+    // empty
+  }
+
+  void run(uint32_t duration)
+  {
+    std::uniform_int_distribution<unsigned> percent(0, 99);
+    for (virtual_clock::us = 0; virtual_clock::us < duration; ++virtual_clock::us)
+    {
+      const uint32_t now = virtual_clock::us;
+
+      // rx interrupt, an octet time slot is busy by the load
+      if (now >= next_rx)
+      {
+        next_rx += octet_us;
+        if (percent(random) < load)
+        {
+          rx_probe.on_push(rx.head_index());
+          if (!rx.push(static_cast<uint8_t>(now))) { ++dropped; }
+        }
+      }
+
+      // tx interrupt, the data register frees once per octet time
+      if (now >= next_tx)
+      {
+        uint8_t octet;
+        size_t slot;
+        if (tx.pop(octet, slot))
+        {
+          tx_probe.on_pop(slot);
+          next_tx = now + octet_us;
+        }
+      }
+
+      // the main loop echoes between the jobs
+      if (now >= next_poll)
+      {
+        while (!rx.empty() && tx.can_push())
+        {
+          rx_probe.on_pop(rx.tail_index());
+          tx_probe.on_push(tx.head_index());
+          tx.push(rx.pop());
+        }
+        next_poll = now + 1 + static_cast<uint32_t>(job(random));
+      }
+    }
+  }
+
+  uint32_t octet_us;
+  unsigned load;
+  std::exponential_distribution<double> job;
+  std::mt19937 random;
+  uint32_t next_rx;
+  uint32_t next_tx;
+  uint32_t next_poll;
+  size_t dropped;
+  tiny::queue<uint8_t, buffer_size> rx;
+  tiny::io::tx_lanes<uint8_t, buffer_size> tx;
+  probe_type rx_probe;
+  probe_type tx_probe;
+};
+
+//------------------------------------------------------------------------
+void print(const char* name, const tiny::io::latency_histogram& h)
+{
+  std::printf("  %s: %lu octets, p50 < %lu us, p99 < %lu us, max %lu us\n", name,
+              static_cast<unsigned long>(h.total()), static_cast<unsigned long>(h.percentile(50)),
+              static_cast<unsigned long>(h.percentile(99)), static_cast<unsigned long>(h.max()));
+
+  for (size_t i = 0; i < h.buckets; ++i)
+  {
+    if (h.count(i) == 0) { continue; }
+
+    const unsigned long low = i == 0? 0: h.upper(i - 1);
+    std::printf("    %7lu us+ %8lu\n", low, static_cast<unsigned long>(h.count(i)));
+  }
+}
+
+//------------------------------------------------------------------------
+void run(unsigned long baud, unsigned load, unsigned long job_us)
+{
+  echo_port port(baud, load, job_us);
+  port.run(seconds * 1000000);
+
+  std::printf("%lu bps, %u%% load, %lu us mean job, %lu octets dropped\n", baud, load, job_us,
+              static_cast<unsigned long>(port.dropped));
+  print("rx", port.rx_probe.histogram());
+  print("tx", port.tx_probe.histogram());
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  if (argc > 1)
+  {
+    run(std::strtoul(argv[1], nullptr, 10), argc > 2? static_cast<unsigned>(std::atoi(argv[2])): 50,
+        argc > 3? std::strtoul(argv[3], nullptr, 10): 200);
+    return 0;
+  }
+
+  const unsigned loads[] = { 25, 50, 90 };
+  for (size_t i = 0; i < sizeof(loads) / sizeof(loads[0]); ++i) { run(115200, loads[i], 200); }
+  run(115200, 90, 1000);
+
+  return 0;
+}
@@ -0,0 +1,158 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/latency.hpp>
+#include <tiny/serial/tx_lanes.hpp>
+#include <tiny/container.hpp>
+
+#include "virtual_clock.hpp"
+
+namespace
+{
+
+typedef sim::us_clock virtual_clock;
+
+typedef tiny::io::latency_probe<true, 16, virtual_clock> probe_type;
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(latency_test, must_bucket_by_powers_of_two)
+{
+  tiny::io::log2_histogram<8> sut;
+
+  const uint32_t values[] = { 0, 1, 2, 3, 4, 7, 8, 100, 1000000 };
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) { sut.add(values[i]); }
+
+  ASSERT_EQ(sut.count(0), 1u);
+  ASSERT_EQ(sut.count(1), 1u);
+  ASSERT_EQ(sut.count(2), 2u);
+  ASSERT_EQ(sut.count(3), 2u);
+  ASSERT_EQ(sut.count(4), 1u);
+  ASSERT_EQ(sut.count(7), 2u); // 100 and above
+  ASSERT_EQ(sut.total(), 9u);
+  ASSERT_EQ(sut.max(), 1000000u);
+  ASSERT_EQ(sut.upper(3), 8u);
+
+  sut.reset();
+  ASSERT_EQ(sut.total(), 0u);
+  ASSERT_EQ(sut.max(), 0u);
+}
+
+//------------------------------------------------------------------------
+TEST(latency_test, must_give_percentile_bucket_bounds)
+{
+  tiny::io::log2_histogram<> sut;
+
+  for (size_t i = 0; i < 99; ++i) { sut.add(20); }
+  sut.add(5000);
+
+  ASSERT_EQ(sut.percentile(50), 32u);
+  ASSERT_EQ(sut.percentile(99), 32u);
+  ASSERT_EQ(sut.percentile(100), 8192u);
+}
+
+//------------------------------------------------------------------------
+TEST(latency_test, must_measure_delay_by_queue_slot)
+{
+  probe_type probe;
+  tiny::queue<uint8_t, 16> q;
+
+  // pushed 10us apart, read in a burst at 200us, across the ring wrap
+  for (size_t round = 0; round < 3; ++round)
+  {
+    virtual_clock::us = 1000 * static_cast<uint32_t>(round);
+    for (uint8_t i = 0; i < 10; ++i, virtual_clock::us += 10)
+    {
+      probe.on_push(q.head_index());
+      q.push(i);
+    }
+
+    virtual_clock::us = 1000 * static_cast<uint32_t>(round) + 200;
+    while (!q.empty())
+    {
+      probe.on_pop(q.tail_index());
+      q.pop();
+    }
+  }
+
+  // delays 200 down to 110
+  ASSERT_EQ(probe.histogram().total(), 30u);
+  ASSERT_EQ(probe.histogram().count(7), 6u);  // 110 and 120
+  ASSERT_EQ(probe.histogram().count(8), 24u); // 130 to 200
+  ASSERT_EQ(probe.histogram().max(), 200u);
+}
+
+//------------------------------------------------------------------------
+TEST(latency_test, must_measure_committed_and_consumed_runs)
+{
+  probe_type probe;
+  tiny::queue<uint8_t, 16> q;
+
+  virtual_clock::us = 100;
+  q.push(0); q.pop(); // moves the slots off zero
+
+  uint8_t* room = nullptr;
+  const size_t n = q.writable(room);
+  ASSERT_EQ(n, 15u);
+  probe.on_push(q.head_index(), n);
+  q.commit(n);
+
+  virtual_clock::us = 103;
+  const uint8_t* data = nullptr;
+  const size_t first  = q.readable(data);
+  probe.on_pop(q.tail_index(), first);
+  q.consume(first);
+
+  ASSERT_EQ(probe.histogram().total(), first);
+  ASSERT_EQ(probe.histogram().count(2), first);
+}
+
+//------------------------------------------------------------------------
+TEST(latency_test, must_skip_urgent_octets)
+{
+  probe_type probe;
+  tiny::io::tx_lanes<uint8_t, 16> lanes;
+
+  virtual_clock::us = 0;
+  probe.on_push(lanes.head_index());
+  lanes.push(1);
+  lanes.push_urgent(2);
+
+  virtual_clock::us = 50;
+  uint8_t octet = 0;
+  size_t slot   = 0;
+  ASSERT_TRUE(lanes.pop(octet, slot));
+  ASSERT_EQ(octet, 2);
+  ASSERT_EQ(slot, static_cast<size_t>(lanes.urgent_slot));
+  probe.on_pop(slot);
+
+  ASSERT_TRUE(lanes.pop(octet, slot));
+  ASSERT_EQ(octet, 1);
+  probe.on_pop(slot);
+
+  ASSERT_EQ(probe.histogram().total(), 1u);
+  ASSERT_EQ(probe.histogram().max(), 50u);
+}
+
+//------------------------------------------------------------------------
+TEST(latency_test, must_not_read_clock_when_off)
+{
+  tiny::io::latency_probe<false, 16, virtual_clock> sut;
+
+  virtual_clock::reads = 0;
+  sut.on_push(0);
+  sut.on_push(0, 4);
+  sut.on_pop(0);
+  sut.on_pop(0, 4);
+  sut.on_bypass();
+  ASSERT_EQ(virtual_clock::reads, 0u);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
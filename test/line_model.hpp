@@ -0,0 +1,188 @@
+// Discrete event model of a serial line feeding a host port and of the
+// main loop serving it, in virtual nanoseconds, for the buffer size
+// planning.
+
+#ifndef TINY_TEST_LINE_MODEL_HPP_
+#define TINY_TEST_LINE_MODEL_HPP_
+
+#include <tiny/serial/uart_host.hpp>
+#include <tiny/serial/soft_uart.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+
+namespace sim
+{
+
+/** The line and the main loop settings. */
+struct line_profile
+{
+  unsigned long baud;      /**< Line rate. */
+  uint32_t config;         /**< Frame format, soft_uart_traits::config (AVR layout). */
+  double load;             /**< The share of the line time carrying octets, 0..1. */
+  unsigned long burst;     /**< Octets sent back to back, the gaps keep the load. */
+  double service_us;       /**< Main loop interval between the port reads. */
+  double jitter_us;        /**< The interval varies uniformly by up to this. */
+  unsigned long octets;    /**< Octets sent in the run. */
+  bool echo;               /**< The main loop writes the octets read back. */
+};
+
+/** Returns the time of a frame on the line, ns. */
+inline double frame_ns(unsigned long baud, uint32_t config)
+{
+  tiny::io::detail::soft_frame frame;
+  frame.configure(config);
+  return 1e9 * static_cast<double>(frame.tx_bits()) / static_cast<double>(baud);
+}
+
+/** Result of a model run. */
+struct line_result
+{
+  unsigned long received;   /**< Octets read by the main loop. */
+  unsigned long dropped;    /**< Octets not buffered as the receive ring was full. */
+  size_t max_fill;          /**< The most octets waiting in the receive ring. */
+  unsigned long echoed;     /**< Octets sent back on the line. */
+  unsigned long tx_dropped; /**< Octets not fitting into the transmit ring. */
+  size_t tx_max_fill;       /**< The most octets waiting in the transmit ring. */
+};
+
+/** Line model over host_uart, the line shifts the octets into
+ *  host_usart_registers and the port interrupt buffers them, the main loop
+ *  reads everything available every service interval and writes it back
+ *  if echoing, the line takes the octets sent at the line rate.
+ *
+ *  @tparam Capacity The rx and tx ring capacity, a queue holds one less.
+ */
+template <size_t Capacity>
+class line_model
+{
+public:
+  /** The port type, both rings of the capacity. */
+  typedef tiny::io::host_uart<uint8_t, Capacity> uart_type;
+
+public:
+  explicit line_model(const line_profile& profile, unsigned seed = 1):
+    _profile(profile),
+    _random(seed),
+    _uart(_regs)
+  {
+    _uart.open(_profile.baud, _profile.config);
+  }
+
+public:
+  /** Runs the traffic through and returns the counts. */
+  line_result run(void)
+  {
+    const double never       = std::numeric_limits<double>::infinity();
+    const double octet       = frame_ns(_profile.baud, _profile.config);
+    const double burst_time  = octet * static_cast<double>(_profile.burst);
+    const double gap         = _profile.load >= 1? 0: burst_time * (1 - _profile.load) / _profile.load;
+    std::uniform_real_distribution<double> jitter(-_profile.jitter_us, _profile.jitter_us);
+
+    line_result result   = { 0, 0, 0, 0, 0, 0 };
+    double arrival       = octet; // the rx interrupt comes at the stop bit
+    double service       = next_service(0, jitter);
+    double shifted       = never; // the end of the octet in the tx shift register
+    unsigned long sent   = 0;
+    unsigned long queued = 0;     // octets written, not in the shift register yet
+
+    while (sent < _profile.octets || _uart.available() != 0 || shifted != never)
+    {
+      const double now = sent < _profile.octets? std::min(arrival, std::min(service, shifted)):
+                                                 std::min(service, shifted);
+      tiny::io::host_clock::ticks() = static_cast<uint32_t>(now / 1000);
+
+      if (now == shifted)
+      {
+        // the line took the octet, the tx interrupt loads the next one
+        uint16_t out = 0;
+        _regs.shift_out(out);
+        ++result.echoed;
+        _uart.service();
+        shifted = _regs.tx_ready? never: now + octet;
+        if (!_regs.tx_ready) { --queued; }
+      } else if (now == service)
+      {
+        // the main loop takes everything available
+        uint8_t c = 0;
+        while (_uart.try_read(c))
+        {
+          ++result.received;
+          if (!_profile.echo) { continue; }
+
+          if (!_uart.async_write(c)) { ++result.tx_dropped; }
+          else if (shifted == never && !_regs.tx_ready) { shifted = now + octet; } // bypassed the ring
+          else { ++queued; }
+        }
+        if (queued > result.tx_max_fill) { result.tx_max_fill = queued; }
+        service = next_service(service, jitter);
+      } else
+      {
+        const size_t before = _uart.available();
+        _regs.shift_in(static_cast<uint8_t>(sent));
+        _uart.service();
+        const size_t after = _uart.available();
+        if (after == before && before == Capacity - 1) { ++result.dropped; }
+        if (after > result.max_fill) { result.max_fill = after; }
+
+        ++sent;
+        arrival += octet;
+        if (sent % _profile.burst == 0) { arrival += gap; }
+      }
+    }
+
+    return result;
+  }
+
+  /** The port, e.g. to model octets taken in the interrupt by on_rx. */
+  uart_type& port(void) { return _uart; }
+
+//////////////////////////////////////////////////////////////////////////
+// private stuff
+
+private:
+  line_model(const line_model&); // inhibit copy
+  line_model& operator=(const line_model&);
+
+private:
+  double next_service(double now, std::uniform_real_distribution<double>& jitter)
+  {
+    const double interval = _profile.service_us + (_profile.jitter_us != 0? jitter(_random): 0);
+    return now + 1000 * (interval > 0? interval: 0);
+  }
+
+private:
+  line_profile _profile;
+  std::mt19937 _random;
+  tiny::io::host_usart_registers _regs;
+  uart_type _uart;
+};
+
+/** The ring sizes tried, powers of two for the fast indexing. */
+enum { min_ring = 8, max_ring = 1024 };
+
+/** Runs the profile on the rings from min_ring up and returns the first
+ *  size dropping no octets either way, zero if even max_ring drops.
+ */
+template <size_t Capacity = min_ring>
+struct ring_sweep
+{
+  static size_t smallest(const line_profile& profile, unsigned seed)
+  {
+    line_model<Capacity> model(profile, seed);
+    const line_result result = model.run();
+    if (result.dropped == 0 && result.tx_dropped == 0) { return Capacity; }
+    return ring_sweep<Capacity * 2>::smallest(profile, seed);
+  }
+};
+
+template <>
+struct ring_sweep<max_ring * 2>
+{
+  static size_t smallest(const line_profile&, unsigned) { return 0; }
+};
+
+} // namespace sim
+
+#endif // TINY_TEST_LINE_MODEL_HPP_
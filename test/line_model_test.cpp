@@ -0,0 +1,111 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "line_model.hpp"
+
+namespace
+{
+
+typedef tiny::io::soft_uart_traits traits;
+
+//------------------------------------------------------------------------
+sim::line_profile profile(unsigned long baud, double service_us, double jitter_us = 0, bool echo = false)
+{
+  const sim::line_profile result = { baud, traits::_8n1, 1.0, 64, service_us, jitter_us, 10000, echo };
+  return result;
+}
+
+//------------------------------------------------------------------------
+bool take_all(uint8_t, void*)
+{
+  return true;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(line_model_test, must_time_frames_by_format)
+{
+  ASSERT_NEAR(sim::frame_ns(9600, traits::_8n1), 1e9 * 10 / 9600, 1);
+  ASSERT_NEAR(sim::frame_ns(9600, traits::_8e1), 1e9 * 11 / 9600, 1);
+  ASSERT_NEAR(sim::frame_ns(115200, traits::_9e2), 1e9 * 13 / 115200, 1);
+}
+
+//------------------------------------------------------------------------
+TEST(line_model_test, must_fill_by_octets_per_service_interval)
+{
+  // 1000 us hold 11.52 octets at 115200 8n1
+  sim::line_model<64> model(profile(115200, 1000));
+  const sim::line_result result = model.run();
+  ASSERT_EQ(result.dropped, 0u);
+  ASSERT_EQ(result.received, 10000u);
+  ASSERT_TRUE(result.max_fill == 11 || result.max_fill == 12);
+
+  sim::line_model<8> small(profile(115200, 1000));
+  ASSERT_GT(small.run().dropped, 0u);
+
+  ASSERT_EQ(sim::ring_sweep<>::smallest(profile(115200, 1000), 1), 16u);
+  ASSERT_EQ(sim::ring_sweep<>::smallest(profile(9600, 1000), 1), 8u);
+}
+
+//------------------------------------------------------------------------
+TEST(line_model_test, must_need_more_room_with_jitter_and_less_with_gaps)
+{
+  sim::line_model<256> steady(profile(115200, 2000));
+  sim::line_model<256> jittery(profile(115200, 2000, 1000));
+  ASSERT_GT(jittery.run().max_fill, steady.run().max_fill);
+
+  sim::line_profile light = profile(115200, 2000);
+  light.load              = 0.25;
+  light.burst             = 4;
+  sim::line_model<256> gaps(light);
+  ASSERT_LT(gaps.run().max_fill, 10u);
+}
+
+//------------------------------------------------------------------------
+TEST(line_model_test, must_not_fill_with_octets_taken_by_hooks)
+{
+  sim::line_model<8> model(profile(115200, 5000));
+  model.port().on_rx(&take_all, nullptr);
+
+  const sim::line_result result = model.run();
+  ASSERT_EQ(result.max_fill, 0u);
+  ASSERT_EQ(result.received, 0u);
+  ASSERT_EQ(result.dropped, 0u);
+}
+
+//------------------------------------------------------------------------
+TEST(line_model_test, must_send_back_at_the_line_rate)
+{
+  // the reads of a service interval wait in the tx ring behind the last
+  // octet of the previous ones still on the line
+  sim::line_model<64> model(profile(115200, 1000, 0, true));
+  const sim::line_result result = model.run();
+  ASSERT_EQ(result.dropped, 0u);
+  ASSERT_EQ(result.tx_dropped, 0u);
+  ASSERT_EQ(result.echoed, 10000u);
+  ASSERT_TRUE(result.tx_max_fill == 11 || result.tx_max_fill == 12);
+
+  // the line takes the octets back as fast as they come, no more room
+  sim::line_model<64> jittery(profile(115200, 1000, 500, true));
+  const sim::line_result spread = jittery.run();
+  ASSERT_EQ(spread.tx_dropped, 0u);
+  ASSERT_EQ(spread.echoed, spread.received);
+  ASSERT_LE(spread.tx_max_fill, spread.max_fill);
+
+  ASSERT_EQ(sim::ring_sweep<>::smallest(profile(115200, 1000, 0, true), 1), 16u);
+}
+
+//------------------------------------------------------------------------
+TEST(line_model_test, must_find_no_size_for_never_served_port)
+{
+  ASSERT_EQ(sim::ring_sweep<>::smallest(profile(250000, 1e9), 1), 0u);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,72 @@
+// Link goodput over a simulated 9600 baud wire, an octet per millisecond,
+// with the line turnaround delay and random bit errors. Window 1 is the
+// stop-and-wait the protocols had.
+
+#include <tiny/serial/link.hpp>
+
+#include "sim_wire.hpp"
+
+#include <iostream>
+
+namespace
+{
+
+enum { packets = 2000, payload = 32, delay = 5, timeout = 150 };
+
+typedef sim::port<32> port_type;
+typedef sim::wire<port_type> wire_type;
+
+//------------------------------------------------------------------------
+template <size_t Window>
+void run(double error_rate)
+{
+  typedef tiny::io::link<port_type, Window, payload, sim::clock> link_type;
+
+  port_type a_port;
+  port_type b_port;
+  wire_type ab(a_port, b_port, error_rate, delay, 1);
+  wire_type ba(b_port, a_port, error_rate, delay, 2);
+  link_type a(a_port, timeout);
+  link_type b(b_port, timeout);
+
+  uint8_t data[payload] = {};
+  size_t sent     = 0;
+  size_t received = 0;
+  const sim::clock::time_type start = sim::clock::ms;
+
+  while (received < packets)
+  {
+    while (sent < packets && a.can_send()) { a.send(data, sizeof(data)); ++sent; }
+
+    a.poll();
+    b.poll();
+    ab.tick();
+    ba.tick();
+    ++sim::clock::ms;
+
+    for (; b.available(); b.next()) { ++received; }
+  }
+
+  const double ms = double(sim::clock::ms - start);
+  std::cout << "  window " << Window << ": " << 100.0 * packets * payload / ms << "% of the line, "
+            << a.retransmits() << " retransmits" << std::endl;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main(void)
+{
+  const double error_rates[] = { 0, 0.0001, 0.001, 0.005 };
+
+  std::cout << "link goodput, " << int(payload) << " octets packets, " << int(delay) << " ms turnaround" << std::endl;
+  for (size_t i = 0; i < sizeof(error_rates) / sizeof(error_rates[0]); ++i)
+  {
+    std::cout << " octet error rate " << error_rates[i] << std::endl;
+    run<1>(error_rates[i]);
+    run<4>(error_rates[i]);
+    run<8>(error_rates[i]);
+  }
+
+  return 0;
+}
@@ -0,0 +1,184 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/link.hpp>
+
+#include "sim_wire.hpp"
+
+#include <vector>
+
+namespace
+{
+
+typedef sim::port<32> port_type;
+typedef sim::wire<port_type> wire_type;
+typedef std::vector<uint8_t> bytes;
+
+/** Two links back to back over the wire, an octet per millisecond each way. */
+template <size_t Window>
+struct bench
+{
+  typedef tiny::io::link<port_type, Window, 64, sim::clock> link_type;
+
+  bench(double error_rate = 0, sim::clock::time_type timeout = 100):
+    ab(a_port, b_port, error_rate, 2, 1),
+    ba(b_port, a_port, error_rate, 2, 2),
+    a(a_port, timeout),
+    b(b_port, timeout)
+  {
+    // empty
+  }
+
+  void tick(void)
+  {
+    a.poll();
+    b.poll();
+    ab.tick();
+    ba.tick();
+    ++sim::clock::ms;
+
+    while (b.available())
+    {
+      received.push_back(bytes(b.packet(), b.packet() + b.size()));
+      b.next();
+    }
+  }
+
+  port_type a_port;
+  port_type b_port;
+  wire_type ab;
+  wire_type ba;
+  link_type a;
+  link_type b;
+  std::vector<bytes> received;
+};
+
+//------------------------------------------------------------------------
+bytes packet(size_t n)
+{
+  bytes result;
+  for (size_t i = 0; i < 1 + n % 40; ++i) { result.push_back(static_cast<uint8_t>(n + i)); }
+  return result;
+}
+
+//------------------------------------------------------------------------
+template <size_t Window>
+void transfer(bench<Window>& b, size_t packets, size_t max_ticks)
+{
+  size_t sent = 0;
+  for (size_t t = 0; t < max_ticks && b.received.size() < packets; ++t)
+  {
+    while (sent < packets && b.a.can_send())
+    {
+      const bytes p = packet(sent);
+      ASSERT_TRUE(b.a.send(p.data(), p.size()));
+      ++sent;
+    }
+    b.tick();
+  }
+
+  ASSERT_EQ(b.received.size(), packets);
+  for (size_t i = 0; i < packets; ++i) { ASSERT_EQ(b.received[i], packet(i)) << i; }
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(link_test, must_deliver_in_order_on_clean_wire)
+{
+  bench<4> b;
+  transfer(b, 300, 100000);
+  ASSERT_EQ(b.a.retransmits(), 0u);
+  ASSERT_EQ(b.b.errors(), 0u);
+
+  for (size_t t = 0; t < 100 && !b.a.idle(); ++t) { b.tick(); }
+  ASSERT_TRUE(b.a.idle());
+}
+
+//------------------------------------------------------------------------
+TEST(link_test, must_limit_packets_in_flight_by_window)
+{
+  bench<4> b;
+  const bytes p = packet(1);
+
+  for (size_t i = 0; i < 4; ++i) { ASSERT_TRUE(b.a.send(p.data(), p.size())); }
+  ASSERT_FALSE(b.a.can_send());
+  ASSERT_FALSE(b.a.send(p.data(), p.size()));
+
+  bytes large(65);
+  bench<4> c;
+  ASSERT_FALSE(c.a.send(large.data(), large.size()));
+}
+
+//------------------------------------------------------------------------
+TEST(link_test, must_recover_lost_packets_on_lossy_wire)
+{
+  bench<8> b(0.005);
+  transfer(b, 500, 1000000);
+  ASSERT_GT(b.ab.corrupted(), 0u);
+  ASSERT_GT(b.a.retransmits(), 0u);
+  ASSERT_GT(b.b.errors(), 0u);
+}
+
+//------------------------------------------------------------------------
+TEST(link_test, must_work_as_stop_and_wait)
+{
+  bench<1> b(0.002);
+  transfer(b, 100, 1000000);
+}
+
+//------------------------------------------------------------------------
+TEST(link_test, must_retransmit_on_nak_before_timeout)
+{
+  bench<4> b(0, 100000);
+  b.ab.corrupt_at(3); // the first packet is broken
+
+  transfer(b, 3, 1000);
+  ASSERT_EQ(b.a.retransmits(), 1u);
+  ASSERT_EQ(b.b.errors(), 1u);
+}
+
+//------------------------------------------------------------------------
+TEST(link_test, must_retransmit_on_timeout_when_the_last_is_lost)
+{
+  bench<4> b(0, 300);
+  b.ab.corrupt_at(3);
+
+  const sim::clock::time_type start = sim::clock::ms;
+  transfer(b, 1, 10000);
+  ASSERT_EQ(b.a.retransmits(), 1u);
+  ASSERT_GE(sim::clock::ms - start, 300u);
+}
+
+//------------------------------------------------------------------------
+TEST(link_test, must_recover_lost_ack_by_cumulative_one)
+{
+  bench<4> b(0, 300);
+  b.ba.corrupt_at(2); // the first ack is broken
+
+  transfer(b, 4, 10000);
+  for (size_t t = 0; t < 1000 && !b.a.idle(); ++t) { b.tick(); }
+  ASSERT_TRUE(b.a.idle());
+  ASSERT_EQ(b.a.retransmits(), 0u);
+}
+
+//------------------------------------------------------------------------
+TEST(link_test, must_drop_duplicate_and_ack_it_again)
+{
+  bench<4> b(0, 300);
+  b.ba.corrupt_at(2);
+
+  transfer(b, 1, 10000);
+  for (size_t t = 0; t < 1000 && !b.a.idle(); ++t) { b.tick(); }
+  ASSERT_TRUE(b.a.idle());
+  ASSERT_EQ(b.a.retransmits(), 1u);
+  ASSERT_EQ(b.received.size(), 1u);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
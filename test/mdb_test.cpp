@@ -0,0 +1,329 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/mdb/master.hpp>
+#include <tiny/mdb/peripheral.hpp>
+
+#include <deque>
+#include <vector>
+
+#include "virtual_clock.hpp"
+
+namespace
+{
+
+using namespace tiny::mdb;
+
+typedef sim::ms_clock virtual_clock;
+
+/** Simulated extended port, the words written are delivered to the peers
+ *  rx hooks by pump as their interrupts do.
+ */
+struct sim_port
+{
+  typedef unsigned short octet_type;
+  typedef bool (*octet_handler)(octet_type, void*);
+
+  sim_port(void): handler(nullptr), context(nullptr), corrupt(0), sent(0) {}
+
+  void on_rx(octet_handler h, void* ctx = nullptr)
+  {
+    handler = h;
+    context = ctx;
+  }
+
+  bool async_write(octet_type word)
+  {
+    tx.push_back(word);
+    ++sent;
+    return true;
+  }
+
+  void write(octet_type word) { async_write(word); }
+
+  octet_handler handler;
+  void* context;
+  std::vector<sim_port*> peers;
+  size_t corrupt; // corrupts the n-th word delivered, 1 based
+  size_t sent;
+  std::deque<octet_type> tx;
+};
+
+//------------------------------------------------------------------------
+void wire(sim_port& a, sim_port& b)
+{
+  a.peers.push_back(&b);
+  b.peers.push_back(&a);
+}
+
+//------------------------------------------------------------------------
+bool deliver(sim_port& from)
+{
+  if (from.tx.empty()) { return false; }
+
+  sim_port::octet_type word = from.tx.front();
+  from.tx.pop_front();
+  virtual_clock::us += word_time_us;
+
+  if (from.corrupt != 0 && --from.corrupt == 0) { word ^= 0x01; }
+  for (size_t i = 0; i < from.peers.size(); ++i)
+  {
+    sim_port& to = *from.peers[i];
+    if (to.handler != nullptr) { to.handler(word, to.context); }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------
+void pump(sim_port& a, sim_port& b, sim_port* c = nullptr)
+{
+  while (deliver(a) || deliver(b) || (c != nullptr && deliver(*c))) {}
+}
+
+/** Peripheral application, command 2 polls pending data, command 3 with
+ *  two data octets answers their sum.
+ */
+struct application
+{
+  application(void): pending_size(0), polls(0) {}
+
+  uint8_t pending[max_block];
+  size_t pending_size;
+  size_t polls;
+};
+
+//------------------------------------------------------------------------
+size_t command_length(const uint8_t* block, size_t, void*)
+{
+  return (block[0] & command_mask) == 3? 4: 2;
+}
+
+//------------------------------------------------------------------------
+void handle_command(const uint8_t* block, size_t, uint8_t* response, size_t& response_size, void* context)
+{
+  application& app = *static_cast<application*>(context);
+
+  if ((block[0] & command_mask) == 3)
+  {
+    response[0]   = static_cast<uint8_t>(block[1] + block[2]);
+    response_size = 1;
+    return;
+  }
+
+  ++app.polls;
+  for (size_t i = 0; i < app.pending_size; ++i) { response[i] = app.pending[i]; }
+  response_size    = app.pending_size;
+  app.pending_size = 0;
+}
+
+typedef master<sim_port, virtual_clock> master_type;
+typedef peripheral<sim_port> peripheral_type;
+
+/** Master and cashless peripheral (0x10) wired together. */
+struct bus
+{
+  bus(void):
+    vmc(vmc_port),
+    cashless(dev_port, 0x10, command_length, handle_command, &app)
+  {
+    wire(vmc_port, dev_port);
+    vmc.start();
+    cashless.start();
+  }
+
+  sim_port vmc_port;
+  sim_port dev_port;
+  application app;
+  master_type vmc;
+  peripheral_type cashless;
+};
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(mdb_test, checksum_must_be_sum_modulo_256)
+{
+  const uint8_t data[] = { 0x13, 0x00, 0xff, 0xee };
+  ASSERT_EQ(checksum(data, sizeof(data)), 0x00);
+  ASSERT_EQ(words_time_ms(4), 5u);
+}
+
+//------------------------------------------------------------------------
+TEST(mdb_test, peripheral_must_ack_poll_without_data)
+{
+  bus b;
+  ASSERT_TRUE(b.vmc.send(0x12));
+  ASSERT_EQ(b.vmc_port.tx, (std::deque<unsigned short>{ 0x112, 0x12 }));
+  ASSERT_FALSE(b.vmc.send(0x12));
+
+  pump(b.vmc_port, b.dev_port);
+  ASSERT_EQ(b.vmc.poll(), ts_ack);
+  ASSERT_EQ(b.app.polls, 1u);
+}
+
+//------------------------------------------------------------------------
+TEST(mdb_test, peripheral_must_respond_from_the_interrupt)
+{
+  bus b;
+  b.vmc.send(0x12);
+  deliver(b.vmc_port);
+  ASSERT_TRUE(b.dev_port.tx.empty());
+  deliver(b.vmc_port);
+  // the response is queued while handling the checksum octet
+  ASSERT_EQ(b.dev_port.tx, (std::deque<unsigned short>{ 0x100 }));
+}
+
+//------------------------------------------------------------------------
+TEST(mdb_test, master_must_ack_data_response)
+{
+  bus b;
+  const uint8_t data[] = { 2, 3 };
+  b.vmc.send(0x13, data, sizeof(data));
+  pump(b.vmc_port, b.dev_port);
+
+  ASSERT_EQ(b.vmc.poll(), ts_data);
+  ASSERT_EQ(b.vmc.response_size(), 1u);
+  ASSERT_EQ(b.vmc.response()[0], 5);
+  ASSERT_EQ(b.dev_port.sent, 2u); // data and checksum with the mode bit
+  ASSERT_EQ(b.vmc_port.sent, 5u); // command and ack
+}
+
+//------------------------------------------------------------------------
+TEST(mdb_test, master_must_request_retransmission_on_bad_checksum)
+{
+  bus b;
+  b.app.pending[0]    = 0x07;
+  b.app.pending[1]    = 0x08;
+  b.app.pending_size  = 2;
+  b.dev_port.corrupt  = 2;
+
+  b.vmc.send(0x12);
+  pump(b.vmc_port, b.dev_port);
+
+  ASSERT_EQ(b.vmc.poll(), ts_data);
+  ASSERT_EQ(b.vmc.response_size(), 2u);
+  ASSERT_EQ(b.vmc.response()[1], 0x08);
+  ASSERT_EQ(b.app.polls, 1u);
+  ASSERT_EQ(b.dev_port.sent, 6u);
+}
+
+//------------------------------------------------------------------------
+TEST(mdb_test, peripheral_must_nak_bad_command)
+{
+  bus b;
+  b.vmc_port.corrupt = 2;
+  b.vmc.send(0x12);
+  pump(b.vmc_port, b.dev_port);
+
+  ASSERT_EQ(b.vmc.poll(), ts_nak);
+  ASSERT_EQ(b.cashless.errors(), 1u);
+  ASSERT_EQ(b.app.polls, 0u);
+}
+
+//------------------------------------------------------------------------
+TEST(mdb_test, master_must_retransmit_and_time_out)
+{
+  bus b;
+  b.vmc.send(0x0b); // changer isn't there
+  pump(b.vmc_port, b.dev_port);
+  ASSERT_EQ(b.vmc.poll(), ts_busy);
+
+  for (size_t i = 0; i < 2; ++i)
+  {
+    virtual_clock::us += (t_response + 3) * 1000;
+    ASSERT_EQ(b.vmc.poll(), ts_busy);
+    ASSERT_EQ(b.vmc_port.tx.size(), 2u);
+    pump(b.vmc_port, b.dev_port);
+  }
+
+  virtual_clock::us += (t_response + 3) * 1000;
+  ASSERT_EQ(b.vmc.poll(), ts_timeout);
+  ASSERT_EQ(b.vmc_port.sent, 6u);
+  ASSERT_EQ(b.dev_port.sent, 0u);
+}
+
+//------------------------------------------------------------------------
+TEST(mdb_test, master_must_wait_for_the_command_transmission)
+{
+  bus b;
+  uint8_t data[max_block] = {};
+  b.vmc.send(0x17, data, sizeof(data));
+  virtual_clock::us += (t_response + 1) * 1000;
+  ASSERT_EQ(b.vmc.poll(), ts_busy);
+  ASSERT_EQ(b.vmc_port.sent, max_block + 2u);
+}
+
+//------------------------------------------------------------------------
+namespace
+{
+
+struct result
+{
+  size_t index;
+  transfer_status status;
+  std::vector<uint8_t> data;
+};
+
+//------------------------------------------------------------------------
+void collect(size_t index, transfer_status status, const uint8_t* data, size_t size, void* context)
+{
+  const result r = { index, status, std::vector<uint8_t>(data, data + size) };
+  static_cast<std::vector<result>*>(context)->push_back(r);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(mdb_test, scheduler_must_poll_round_robin_with_commands_first)
+{
+  sim_port vmc_port;
+  sim_port cashless_port;
+  sim_port changer_port;
+  wire(vmc_port, cashless_port);
+  wire(vmc_port, changer_port);
+
+  application app1;
+  application app2;
+  peripheral_type cashless(cashless_port, 0x10, command_length, handle_command, &app1);
+  peripheral_type changer(changer_port, 0x08, command_length, handle_command, &app2);
+  cashless.start();
+  changer.start();
+
+  master_type vmc(vmc_port);
+  vmc.start();
+  scheduler<master_type, 2> sut(vmc);
+  std::vector<result> results;
+  sut.attach(0, 0x12, collect, &results);
+  sut.attach(1, 0x0a, collect, &results);
+
+  const uint8_t data[] = { 1, 2 };
+  ASSERT_TRUE(sut.submit(1, 0x0b, data, sizeof(data)));
+  ASSERT_FALSE(sut.submit(1, 0x0b, data, sizeof(data)));
+
+  for (size_t i = 0; i < 4; ++i)
+  {
+    sut.poll();
+    pump(vmc_port, cashless_port, &changer_port);
+  }
+  ASSERT_TRUE(sut.poll());
+
+  ASSERT_EQ(results.size(), 4u);
+  ASSERT_EQ(results[0].index, 0u);
+  ASSERT_EQ(results[0].status, ts_ack);
+  ASSERT_EQ(results[1].index, 1u);
+  ASSERT_EQ(results[1].status, ts_data);
+  ASSERT_EQ(results[1].data, (std::vector<uint8_t>{ 3 }));
+  ASSERT_EQ(results[2].index, 0u);
+  ASSERT_EQ(results[3].index, 1u);
+  ASSERT_EQ(results[3].status, ts_ack);
+  ASSERT_EQ(app1.polls, 2u);
+  ASSERT_EQ(app2.polls, 1u);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
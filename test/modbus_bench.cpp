@@ -0,0 +1,129 @@
+// Modbus RTU slave throughput, requests are fed octet by octet through the
+// rx hook as the interrupt does and responses go to a discarding port.
+
+#include <tiny/modbus/rtu.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+typedef std::chrono::steady_clock clock_type;
+
+enum { requests = 200000, registers = 32 };
+
+/** Virtual microsecond clock advanced by the line. */
+struct bench_clock
+{
+  typedef uint32_t time_type;
+
+  static time_type now(void) { return time; }
+
+  static time_type time;
+};
+
+bench_clock::time_type bench_clock::time = 0;
+
+/** Port discarding the responses. */
+struct null_port
+{
+  typedef uint8_t octet_type;
+  typedef bool (*octet_handler)(octet_type, void*);
+
+  null_port(void): handler(nullptr), context(nullptr), written(0) {}
+
+  void on_rx(octet_handler h, void* ctx = nullptr)
+  {
+    handler = h;
+    context = ctx;
+  }
+
+  size_t writable(octet_type*& data)
+  {
+    data = buffer;
+    return sizeof(buffer);
+  }
+
+  void commit(size_t n) { written += n; }
+
+  octet_handler handler;
+  void* context;
+  size_t written;
+  octet_type buffer[256];
+};
+
+uint16_t regs[registers];
+
+//------------------------------------------------------------------------
+uint8_t access(tiny::modbus::register_space, bool write, uint16_t address,
+               uint16_t* values, uint16_t count, void*)
+{
+  for (uint16_t i = 0; i < count; ++i)
+  {
+    if (write) { regs[address + i] = values[i]; }
+    else { values[i] = regs[address + i]; }
+  }
+  return tiny::modbus::ex_none;
+}
+
+//------------------------------------------------------------------------
+std::vector<uint8_t> request(uint8_t fc)
+{
+  std::vector<uint8_t> adu;
+  if (fc == tiny::modbus::fc_write_multiple_registers)
+  {
+    adu = { 1, fc, 0, 0, 0, registers, registers * 2 };
+    for (size_t i = 0; i < registers * 2; ++i) { adu.push_back(static_cast<uint8_t>(i)); }
+  } else
+  {
+    adu = { 1, fc, 0, 0, 0, registers };
+  }
+  const uint16_t crc = tiny::modbus::crc16(adu.data(), adu.size());
+  adu.push_back(static_cast<uint8_t>(crc));
+  adu.push_back(static_cast<uint8_t>(crc >> 8));
+  return adu;
+}
+
+//------------------------------------------------------------------------
+void run(const char* name, uint8_t fc)
+{
+  null_port port;
+  tiny::modbus::rtu_slave<null_port, bench_clock> slave(port, 1, access);
+  const tiny::modbus::rtu_timing timing = tiny::modbus::rtu_timing::for_baud(115200);
+  const std::vector<uint8_t> adu = request(fc);
+
+  slave.start(115200);
+
+  size_t served = 0;
+  const auto t0 = clock_type::now();
+  for (size_t i = 0; i < requests; ++i)
+  {
+    for (size_t j = 0; j < adu.size(); ++j)
+    {
+      bench_clock::time += timing.octet;
+      port.handler(adu[j], port.context);
+    }
+    bench_clock::time += timing.t35;
+    served += slave.poll();
+  }
+  const auto t1 = clock_type::now();
+
+  const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+  const double octets = double(requests) * adu.size() + double(port.written);
+  std::cout << "  " << name << ": " << ns / requests << " ns/request, "
+            << ns / octets << " ns/octet, " << served << " served" << std::endl;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main(void)
+{
+  std::cout << "modbus rtu slave, " << int(registers) << " registers" << std::endl;
+  run("read holding registers   ", tiny::modbus::fc_read_holding_registers);
+  run("write multiple registers ", tiny::modbus::fc_write_multiple_registers);
+
+  return 0;
+}
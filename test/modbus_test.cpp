@@ -0,0 +1,372 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/modbus/rtu.hpp>
+
+#include <vector>
+
+#include "virtual_clock.hpp"
+
+namespace
+{
+
+typedef sim::us_clock virtual_clock;
+
+/** Fake port, the line delivers octets to the rx hook as the interrupt
+ *  does, the transmit buffer has room octets free.
+ */
+struct fake_port
+{
+  typedef uint8_t octet_type;
+  typedef bool (*octet_handler)(octet_type, void*);
+
+  fake_port(void): handler(nullptr), context(nullptr), room(sizeof(buffer)) {}
+
+  void on_rx(octet_handler h, void* ctx = nullptr)
+  {
+    handler = h;
+    context = ctx;
+  }
+
+  size_t writable(octet_type*& data)
+  {
+    data = buffer;
+    return room;
+  }
+
+  void commit(size_t n)
+  {
+    tx.insert(tx.end(), buffer, buffer + n);
+    room -= n;
+  }
+
+  octet_handler handler;
+  void* context;
+  std::vector<uint8_t> tx;
+  octet_type buffer[256];
+  size_t room;
+};
+
+typedef tiny::modbus::rtu_slave<fake_port, virtual_clock> slave_type;
+
+const unsigned long baud = 19200;
+const tiny::modbus::rtu_timing timing = tiny::modbus::rtu_timing::for_baud(baud);
+
+/** Register map of 16 holding and 16 input registers. */
+struct register_map
+{
+  register_map(void)
+  {
+    for (uint16_t i = 0; i < 16; ++i)
+    {
+      holding[i] = i;
+      input[i]   = static_cast<uint16_t>(0x100 + i);
+    }
+  }
+
+  uint16_t holding[16];
+  uint16_t input[16];
+};
+
+//------------------------------------------------------------------------
+uint8_t access(tiny::modbus::register_space space, bool write, uint16_t address,
+               uint16_t* values, uint16_t count, void* context)
+{
+  register_map& map = *static_cast<register_map*>(context);
+  uint16_t* regs    = space == tiny::modbus::holding_registers? map.holding: map.input;
+
+  if (address + count > 16) { return tiny::modbus::ex_illegal_data_address; }
+  for (uint16_t i = 0; i < count; ++i)
+  {
+    if (write) { regs[address + i] = values[i]; }
+    else { values[i] = regs[address + i]; }
+  }
+  return tiny::modbus::ex_none;
+}
+
+//------------------------------------------------------------------------
+std::vector<uint8_t> with_crc(std::vector<uint8_t> pdu)
+{
+  const uint16_t crc = tiny::modbus::crc16(pdu.data(), pdu.size());
+  pdu.push_back(static_cast<uint8_t>(crc));
+  pdu.push_back(static_cast<uint8_t>(crc >> 8));
+  return pdu;
+}
+
+//------------------------------------------------------------------------
+void send(fake_port& port, const std::vector<uint8_t>& frame, size_t gap_at = 0, uint32_t gap = 0)
+{
+  for (size_t i = 0; i < frame.size(); ++i)
+  {
+    virtual_clock::us += timing.octet + (i == gap_at? gap: 0);
+    port.handler(frame[i], port.context);
+  }
+}
+
+//------------------------------------------------------------------------
+void silence(uint32_t time = timing.t35)
+{
+  virtual_clock::us += time;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(modbus_test, crc_must_match_reference)
+{
+  const uint8_t data[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0a };
+  ASSERT_EQ(tiny::modbus::crc16(data, sizeof(data)), 0xcdc5);
+}
+
+//------------------------------------------------------------------------
+TEST(modbus_test, timing_must_be_fixed_above_19200)
+{
+  ASSERT_EQ(timing.t35, 2006u);
+  ASSERT_EQ(tiny::modbus::rtu_timing::for_baud(115200).t15, 750u);
+  ASSERT_EQ(tiny::modbus::rtu_timing::for_baud(115200).t35, 1750u);
+}
+
+//------------------------------------------------------------------------
+TEST(modbus_test, must_read_holding_registers)
+{
+  fake_port port;
+  register_map map;
+  slave_type sut(port, 7, access, &map);
+  sut.start(baud);
+
+  send(port, with_crc({ 7, 3, 0, 2, 0, 3 }));
+  ASSERT_FALSE(sut.poll());
+  silence();
+  ASSERT_TRUE(sut.poll());
+  ASSERT_EQ(port.tx, with_crc({ 7, 3, 6, 0, 2, 0, 3, 0, 4 }));
+  ASSERT_EQ(sut.served(), 1u);
+}
+
+//------------------------------------------------------------------------
+TEST(modbus_test, must_read_input_registers)
+{
+  fake_port port;
+  register_map map;
+  slave_type sut(port, 7, access, &map);
+  sut.start(baud);
+
+  send(port, with_crc({ 7, 4, 0, 15, 0, 1 }));
+  silence();
+  ASSERT_TRUE(sut.poll());
+  ASSERT_EQ(port.tx, with_crc({ 7, 4, 2, 1, 15 }));
+}
+
+//------------------------------------------------------------------------
+TEST(modbus_test, must_write_single_register)
+{
+  fake_port port;
+  register_map map;
+  slave_type sut(port, 7, access, &map);
+  sut.start(baud);
+
+  send(port, with_crc({ 7, 6, 0, 1, 0x12, 0x34 }));
+  silence();
+  ASSERT_TRUE(sut.poll());
+  ASSERT_EQ(map.holding[1], 0x1234);
+  ASSERT_EQ(port.tx, with_crc({ 7, 6, 0, 1, 0x12, 0x34 }));
+}
+
+//------------------------------------------------------------------------
+TEST(modbus_test, must_write_multiple_registers)
+{
+  fake_port port;
+  register_map map;
+  slave_type sut(port, 7, access, &map);
+  sut.start(baud);
+
+  send(port, with_crc({ 7, 16, 0, 4, 0, 2, 4, 0xab, 0xcd, 0x01, 0x02 }));
+  silence();
+  ASSERT_TRUE(sut.poll());
+  ASSERT_EQ(map.holding[4], 0xabcd);
+  ASSERT_EQ(map.holding[5], 0x0102);
+  ASSERT_EQ(port.tx, with_crc({ 7, 16, 0, 4, 0, 2 }));
+}
+
+//------------------------------------------------------------------------
+TEST(modbus_test, must_respond_with_exceptions)
+{
+  fake_port port;
+  register_map map;
+  slave_type sut(port, 7, access, &map);
+  sut.start(baud);
+
+  send(port, with_crc({ 7, 5, 0, 1, 0xff, 0 }));
+  silence();
+  ASSERT_TRUE(sut.poll());
+  ASSERT_EQ(port.tx, with_crc({ 7, 0x85, tiny::modbus::ex_illegal_function }));
+
+  port.tx.clear();
+  send(port, with_crc({ 7, 3, 0, 15, 0, 2 }));
+  silence();
+  ASSERT_TRUE(sut.poll());
+  ASSERT_EQ(port.tx, with_crc({ 7, 0x83, tiny::modbus::ex_illegal_data_address }));
+
+  port.tx.clear();
+  send(port, with_crc({ 7, 3, 0, 0, 0, 126 }));
+  silence();
+  ASSERT_TRUE(sut.poll());
+  ASSERT_EQ(port.tx, with_crc({ 7, 0x83, tiny::modbus::ex_illegal_data_value }));
+}
+
+//------------------------------------------------------------------------
+TEST(modbus_test, must_ignore_other_slaves_and_bad_crc)
+{
+  fake_port port;
+  register_map map;
+  slave_type sut(port, 7, access, &map);
+  sut.start(baud);
+
+  send(port, with_crc({ 8, 3, 0, 0, 0, 1 }));
+  silence();
+  ASSERT_FALSE(sut.poll());
+
+  std::vector<uint8_t> frame = with_crc({ 7, 3, 0, 0, 0, 1 });
+  frame.back() ^= 1;
+  send(port, frame);
+  silence();
+  ASSERT_FALSE(sut.poll());
+  ASSERT_EQ(sut.errors(), 1u);
+  ASSERT_TRUE(port.tx.empty());
+}
+
+//------------------------------------------------------------------------
+TEST(modbus_test, must_serve_broadcast_writes_silently)
+{
+  fake_port port;
+  register_map map;
+  slave_type sut(port, 7, access, &map);
+  sut.start(baud);
+
+  send(port, with_crc({ 0, 6, 0, 3, 0, 9 }));
+  silence();
+  ASSERT_TRUE(sut.poll());
+  ASSERT_EQ(map.holding[3], 9);
+  ASSERT_TRUE(port.tx.empty());
+}
+
+//------------------------------------------------------------------------
+TEST(modbus_test, must_drop_frames_with_t15_gaps)
+{
+  fake_port port;
+  register_map map;
+  slave_type sut(port, 7, access, &map);
+  sut.start(baud);
+
+  send(port, with_crc({ 7, 3, 0, 0, 0, 1 }), 3, timing.t15 + 100);
+  silence();
+  ASSERT_FALSE(sut.poll());
+  ASSERT_EQ(sut.errors(), 1u);
+
+  // a gap under t1.5 is fine
+  send(port, with_crc({ 7, 3, 0, 0, 0, 1 }), 3, timing.t15 - 100);
+  silence();
+  ASSERT_TRUE(sut.poll());
+}
+
+//------------------------------------------------------------------------
+TEST(modbus_test, must_keep_the_next_frame_while_one_waits_for_poll)
+{
+  fake_port port;
+  register_map map;
+  slave_type sut(port, 7, access, &map);
+  sut.start(baud);
+
+  // the first frame isn't polled in time, the second one is kept
+  send(port, with_crc({ 7, 6, 0, 0, 0, 1 }));
+  send(port, with_crc({ 7, 6, 0, 1, 0, 2 }), 0, timing.t35);
+  ASSERT_TRUE(sut.poll());
+  ASSERT_EQ(map.holding[0], 1);
+  ASSERT_EQ(map.holding[1], 1);
+
+  silence();
+  ASSERT_TRUE(sut.poll());
+  ASSERT_EQ(map.holding[1], 2);
+  ASSERT_EQ(sut.served(), 2u);
+}
+
+//------------------------------------------------------------------------
+TEST(modbus_test, must_drop_the_third_frame_and_resync)
+{
+  fake_port port;
+  register_map map;
+  slave_type sut(port, 7, access, &map);
+  sut.start(baud);
+
+  // both buffers wait for poll, the third frame is dropped
+  send(port, with_crc({ 7, 6, 0, 0, 0, 1 }));
+  send(port, with_crc({ 7, 6, 0, 1, 0, 2 }), 0, timing.t35);
+  send(port, with_crc({ 7, 6, 0, 2, 0, 3 }), 0, timing.t35);
+  ASSERT_TRUE(sut.poll());
+  ASSERT_TRUE(sut.poll());
+  ASSERT_FALSE(sut.poll());
+  ASSERT_EQ(map.holding[1], 2);
+  ASSERT_EQ(map.holding[2], 2);
+
+  // the tail of the dropped frame is skipped until t3.5 silence
+  send(port, { 1, 2, 3 });
+  silence();
+  send(port, with_crc({ 7, 6, 0, 2, 0, 3 }));
+  silence();
+  ASSERT_TRUE(sut.poll());
+  ASSERT_EQ(map.holding[2], 3);
+  ASSERT_EQ(sut.errors(), 0u);
+}
+
+//------------------------------------------------------------------------
+TEST(modbus_test, must_write_the_response_by_the_transmit_buffer_room)
+{
+  fake_port port;
+  register_map map;
+  slave_type sut(port, 7, access, &map);
+  sut.start(baud);
+
+  // 25 octets of the response, 8 fit at once
+  port.room = 8;
+  send(port, with_crc({ 7, 3, 0, 0, 0, 10 }));
+  silence();
+  ASSERT_TRUE(sut.poll());
+  ASSERT_TRUE(sut.responding());
+  ASSERT_EQ(port.tx.size(), 8u);
+
+  // the next request waits for the response to go out
+  send(port, with_crc({ 7, 6, 0, 1, 0, 9 }), 0, timing.t35);
+  silence();
+  ASSERT_FALSE(sut.poll());
+  ASSERT_EQ(map.holding[1], 1);
+
+  port.room = 10;
+  ASSERT_FALSE(sut.poll());
+  port.room = 64;
+  ASSERT_TRUE(sut.poll());
+  ASSERT_FALSE(sut.responding());
+  ASSERT_EQ(map.holding[1], 9);
+
+  const std::vector<uint8_t> first = with_crc({ 7, 3, 20, 0, 0, 0, 1, 0, 2, 0, 3, 0, 4, 0, 5, 0, 6, 0, 7, 0, 8, 0, 9 });
+  ASSERT_EQ(std::vector<uint8_t>(port.tx.begin(), port.tx.begin() + first.size()), first);
+  ASSERT_EQ(std::vector<uint8_t>(port.tx.begin() + first.size(), port.tx.end()), with_crc({ 7, 6, 0, 1, 0, 9 }));
+}
+
+//------------------------------------------------------------------------
+TEST(modbus_test, stop_must_release_the_port)
+{
+  fake_port port;
+  register_map map;
+  slave_type sut(port, 7, access, &map);
+  sut.start(baud);
+  ASSERT_TRUE(port.handler != nullptr);
+  sut.stop();
+  ASSERT_TRUE(port.handler == nullptr);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
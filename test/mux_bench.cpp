@@ -0,0 +1,82 @@
+// Mux latency per priority over a simulated 9600 baud wire, an octet per
+// millisecond: debug saturates the line, telemetry and control frames are
+// sent periodically. Without priorities control waits behind debug.
+
+#include <tiny/serial/mux.hpp>
+
+#include "sim_wire.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+typedef sim::port<32> port_type;
+typedef sim::wire<port_type> wire_type;
+typedef tiny::io::mux<port_type, 3, 32, 4> mux_type;
+
+enum { control, telemetry, debug, ticks = 200000 };
+
+//------------------------------------------------------------------------
+void report(const char* name, std::vector<size_t> latency)
+{
+  std::sort(latency.begin(), latency.end());
+  std::cout << "  " << name << ": median " << latency[latency.size() / 2] << " ms, 99% "
+            << latency[latency.size() * 99 / 100] << " ms, max " << latency.back() << " ms" << std::endl;
+}
+
+//------------------------------------------------------------------------
+void run(const char* title, bool prioritized)
+{
+  port_type a_port;
+  port_type b_port;
+  wire_type ab(a_port, b_port);
+  mux_type a(a_port);
+  mux_type b(b_port);
+
+  if (!prioritized)
+  {
+    for (size_t i = 0; i < 3; ++i) { a.priority(i, 0); }
+  }
+
+  const uint8_t bulk[32]  = {};
+  const uint8_t small[4]  = {};
+  std::vector<size_t> sent[3];
+  std::vector<size_t> latency[3];
+  size_t received[3] = {};
+
+  for (size_t t = 0; t < ticks; ++t)
+  {
+    if (a.send(debug, bulk, sizeof(bulk))) { sent[debug].push_back(sim::clock::ms); }
+    if (t % 100 == 0 && a.send(telemetry, bulk, 16)) { sent[telemetry].push_back(sim::clock::ms); }
+    if (t % 250 == 0 && a.send(control, small, sizeof(small))) { sent[control].push_back(sim::clock::ms); }
+
+    a.poll();
+    b.poll();
+    ab.tick();
+    ++sim::clock::ms;
+
+    for (size_t c = 0; c < 3; ++c)
+    {
+      for (; b.available(c); b.next(c)) { latency[c].push_back(sim::clock::ms - sent[c][received[c]++]); }
+    }
+  }
+
+  std::cout << title << std::endl;
+  report("control  ", latency[control]);
+  report("telemetry", latency[telemetry]);
+  report("debug    ", latency[debug]);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main(void)
+{
+  run("mux latency, equal priorities", false);
+  run("mux latency, control > telemetry > debug", true);
+
+  return 0;
+}
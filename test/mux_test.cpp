@@ -0,0 +1,176 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/mux.hpp>
+
+#include "sim_wire.hpp"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+
+typedef sim::port<32> port_type;
+typedef sim::wire<port_type> wire_type;
+typedef tiny::io::mux<port_type, 3, 32, 4> mux_type;
+
+enum { control, telemetry, debug };
+
+/** Two muxes back to back, an octet per millisecond each way. */
+struct bench
+{
+  bench(double error_rate = 0):
+    ab(a_port, b_port, error_rate, 0, 1),
+    ba(b_port, a_port, error_rate, 0, 2),
+    a(a_port),
+    b(b_port)
+  {
+    // empty
+  }
+
+  void tick(void)
+  {
+    a.poll();
+    b.poll();
+    ab.tick();
+    ba.tick();
+    ++sim::clock::ms;
+  }
+
+  std::string take(mux_type& m, size_t channel)
+  {
+    if (!m.available(channel)) { return std::string(); }
+    const std::string result(m.frame_data(channel), m.frame_data(channel) + m.frame_size(channel));
+    m.next(channel);
+    return result;
+  }
+
+  port_type a_port;
+  port_type b_port;
+  wire_type ab;
+  wire_type ba;
+  mux_type a;
+  mux_type b;
+};
+
+//------------------------------------------------------------------------
+bool send(mux_type& m, size_t channel, const std::string& s)
+{
+  return m.send(channel, reinterpret_cast<const uint8_t*>(s.data()), s.size());
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(mux_test, must_route_frames_to_channels_both_ways)
+{
+  bench b;
+  ASSERT_TRUE(send(b.a, telemetry, "t1"));
+  ASSERT_TRUE(send(b.a, debug, "d1"));
+  ASSERT_TRUE(send(b.b, control, "c1"));
+  ASSERT_TRUE(send(b.a, control, ""));
+
+  for (size_t t = 0; t < 100; ++t) { b.tick(); }
+
+  ASSERT_TRUE(b.b.available(control));
+  ASSERT_EQ(b.take(b.b, control), "");
+  ASSERT_EQ(b.take(b.b, telemetry), "t1");
+  ASSERT_EQ(b.take(b.b, debug), "d1");
+  ASSERT_EQ(b.take(b.a, control), "c1");
+  ASSERT_FALSE(b.b.available(control));
+  ASSERT_TRUE(b.a.idle());
+}
+
+//------------------------------------------------------------------------
+TEST(mux_test, must_send_in_priority_order_at_frame_granularity)
+{
+  port_type port;
+  mux_type sut(port);
+  tiny::io::cobs_decoder<40> decoder;
+
+  send(sut, debug, "d1");
+  send(sut, debug, "d2");
+  send(sut, telemetry, "t1");
+  send(sut, control, "c1");
+  sut.priority(debug, 0);
+  sut.priority(control, 1);
+
+  std::vector<std::string> order;
+  for (size_t t = 0; t < 100; ++t)
+  {
+    sut.poll();
+    while (!port.tx.empty()) { port.rx.push(port.tx.pop()); }
+    while (decoder.poll(port))
+    {
+      order.push_back(std::string(decoder.frame() + 1, decoder.frame() + decoder.size() - 1));
+      decoder.next();
+    }
+  }
+
+  ASSERT_EQ(order, (std::vector<std::string>{ "d1", "d2", "c1", "t1" }));
+}
+
+//------------------------------------------------------------------------
+TEST(mux_test, must_keep_urgent_latency_under_bulk_load)
+{
+  bench b;
+  const std::string bulk(32, 'x');
+  size_t sent_at = 0;
+  std::vector<size_t> control_latency;
+  std::vector<size_t> debug_latency;
+  std::vector<size_t> debug_sent;
+
+  for (size_t t = 0; t < 5000; ++t)
+  {
+    // debug saturates the line
+    while (b.a.can_send(debug) && send(b.a, debug, bulk)) { debug_sent.push_back(sim::clock::ms); }
+    if (t % 200 == 0 && send(b.a, control, "stop")) { sent_at = sim::clock::ms; }
+
+    b.tick();
+
+    if (b.b.available(control))
+    {
+      control_latency.push_back(sim::clock::ms - sent_at);
+      b.b.next(control);
+    }
+    while (b.b.available(debug))
+    {
+      debug_latency.push_back(sim::clock::ms - debug_sent[debug_latency.size()]);
+      b.b.next(debug);
+    }
+  }
+
+  ASSERT_EQ(control_latency.size(), 25u);
+  ASSERT_GT(debug_latency.size(), 100u);
+
+  // the port buffer and the current frame ahead at most
+  for (size_t i = 0; i < control_latency.size(); ++i) { ASSERT_LE(control_latency[i], 32u + 36u + 8u); }
+  ASSERT_GT(debug_latency.back(), 100u);
+}
+
+//------------------------------------------------------------------------
+TEST(mux_test, must_drop_broken_and_overflowing_frames)
+{
+  bench b(0.02);
+  const std::string s(20, 'y');
+
+  for (size_t t = 0; t < 20000; ++t)
+  {
+    send(b.a, telemetry, s);
+    b.tick();
+    // nobody reads the receiving side till the end
+  }
+
+  ASSERT_GT(b.b.errors(), 0u);
+  ASSERT_GT(b.b.dropped(), 0u);
+  for (size_t i = 0; b.b.available(telemetry); ++i) { ASSERT_EQ(b.take(b.b, telemetry), s) << i; }
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
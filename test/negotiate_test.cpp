@@ -0,0 +1,194 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/negotiate.hpp>
+#include <tiny/serial/uart_host.hpp>
+
+#include "sim_wire.hpp"
+
+#include <string>
+
+namespace
+{
+
+// the transmit buffer takes less than a frame
+typedef tiny::io::host_uart<uint8_t, 64, true, 8> uart_type;
+typedef tiny::io::negotiator<uart_type, sim::clock> negotiator_type;
+
+/** A side of the link, the application writes and reads the port. */
+struct link_end
+{
+  link_end(unsigned long max_baud):
+    port(regs),
+    side(port, 9600, 0x06, max_baud)
+  {
+    port.open(9600, 0x06);
+  }
+
+  /** Writes the text left while the negotiator lets it. */
+  void write(void)
+  {
+    while (!out.empty() && side.writable() && port.async_write(static_cast<uint8_t>(out[0]))) { out.erase(0, 1); }
+  }
+
+  /** Reads everything through the negotiator. */
+  void read(void)
+  {
+    uint8_t octet;
+    while (side.try_read(octet)) { in += static_cast<char>(octet); }
+  }
+
+  tiny::io::host_usart_registers regs;
+  uart_type port;
+  negotiator_type side;
+  std::string out;
+  std::string in;
+};
+
+/** Both ways an octet per millisecond, broken if the settings differ. */
+struct rate_link
+{
+  rate_link(unsigned long max_baud = 1000000):
+    a(max_baud),
+    b(max_baud),
+    cut_ab(false),
+    cut_ba(false)
+  {
+    // empty
+  }
+
+  void move(link_end& from, link_end& to, bool cut)
+  {
+    uint16_t octet;
+    if (!from.regs.shift_out(octet)) { return; }
+
+    from.port.service();
+    if (cut) { return; }
+
+    const bool same = from.regs.baud == to.regs.baud && from.regs.config == to.regs.config;
+    to.regs.shift_in(same? octet: static_cast<uint16_t>(octet ^ 0x3c));
+    to.port.service();
+  }
+
+  void tick(void)
+  {
+    a.write();
+    b.write();
+    a.side.poll();
+    b.side.poll();
+    a.read();
+    b.read();
+    move(a, b, cut_ab);
+    move(b, a, cut_ba);
+    ++sim::clock::ms;
+  }
+
+  void run(size_t ticks)
+  {
+    for (size_t t = 0; t < ticks; ++t) { tick(); }
+  }
+
+  link_end a;
+  link_end b;
+  bool cut_ab;
+  bool cut_ba;
+};
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(negotiate_test, must_switch_both_sides_and_lose_nothing)
+{
+  rate_link sut;
+
+  // queued at the handshake rate both ways before the proposal
+  sut.a.out = "handshake done";
+  sut.b.out = "ready";
+  sut.a.write();
+  sut.b.write();
+  ASSERT_FALSE(sut.a.out.empty());
+  ASSERT_TRUE(sut.a.side.propose(115200, 0x26));
+
+  sut.run(1000);
+  ASSERT_EQ(sut.a.side.status(), negotiator_type::done);
+  ASSERT_EQ(sut.b.side.status(), negotiator_type::done);
+  ASSERT_EQ(sut.a.regs.baud, 115200u);
+  ASSERT_EQ(sut.b.regs.baud, 115200u);
+  ASSERT_EQ(sut.b.regs.config, 0x26u);
+  ASSERT_EQ(sut.b.side.baud(), 115200u);
+  ASSERT_EQ(sut.b.in, "handshake done");
+  ASSERT_EQ(sut.a.in, "ready");
+
+  sut.a.out = "bulk transfer";
+  sut.b.out = "\xa5 ack";
+  sut.run(100);
+  ASSERT_EQ(sut.b.in, "handshake donebulk transfer");
+  ASSERT_EQ(sut.a.in, "ready\xa5 ack");
+}
+
+//------------------------------------------------------------------------
+TEST(negotiate_test, must_pass_octets_like_frame_head_after_timeout)
+{
+  rate_link sut;
+
+  sut.a.out = "\xa5R";
+  sut.run(50);
+  ASSERT_EQ(sut.b.in, "");
+  sut.run(100);
+  ASSERT_EQ(sut.b.in, "\xa5R");
+  ASSERT_EQ(sut.b.side.status(), negotiator_type::idle);
+}
+
+//------------------------------------------------------------------------
+TEST(negotiate_test, must_reject_rate_over_limit)
+{
+  rate_link sut(57600);
+
+  ASSERT_TRUE(sut.a.side.propose(115200, 0x06));
+  sut.run(1000);
+  ASSERT_EQ(sut.a.side.status(), negotiator_type::rejected);
+  ASSERT_EQ(sut.a.regs.baud, 9600u);
+  ASSERT_EQ(sut.b.regs.baud, 9600u);
+  ASSERT_EQ(sut.a.in, "");
+  ASSERT_EQ(sut.b.in, "");
+}
+
+//------------------------------------------------------------------------
+TEST(negotiate_test, must_resend_lost_request)
+{
+  rate_link sut;
+  sut.cut_ab = true;
+
+  ASSERT_TRUE(sut.a.side.propose(57600, 0x06));
+  sut.run(50);
+  sut.cut_ab = false;
+
+  sut.run(1000);
+  ASSERT_EQ(sut.a.side.status(), negotiator_type::done);
+  ASSERT_EQ(sut.b.regs.baud, 57600u);
+}
+
+//------------------------------------------------------------------------
+TEST(negotiate_test, must_revert_when_not_confirmed)
+{
+  rate_link sut;
+
+  ASSERT_TRUE(sut.a.side.propose(57600, 0x06));
+  for (size_t t = 0; t < 1000 && sut.a.side.status() == negotiator_type::proposing; ++t) { sut.tick(); }
+  ASSERT_EQ(sut.a.side.status(), negotiator_type::switching);
+
+  sut.cut_ab = true; // the confirmation is lost
+  sut.run(1000);
+  ASSERT_EQ(sut.a.side.status(), negotiator_type::failed);
+  ASSERT_EQ(sut.b.side.status(), negotiator_type::failed);
+  ASSERT_EQ(sut.a.regs.baud, 9600u);
+  ASSERT_EQ(sut.b.regs.baud, 9600u);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
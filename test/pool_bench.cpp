@@ -0,0 +1,61 @@
+// Pool allocate/free latency against new/delete of the same size, a
+// burst of blocks is taken and returned in a different order.
+
+#include <tiny/pool.hpp>
+
+#include <chrono>
+#include <iostream>
+
+namespace
+{
+
+typedef std::chrono::steady_clock clock_type;
+
+enum { block = 64, burst = 16, rounds = 1000000 };
+
+typedef tiny::pool<block, burst> pool_type;
+
+//------------------------------------------------------------------------
+void report(const char* name, clock_type::time_point t0, clock_type::time_point t1, unsigned long sink)
+{
+  const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+  std::cout << "  " << name << ": " << ns / (double(rounds) * burst) << " ns per allocate and free ("
+            << (sink & 1) << ")" << std::endl;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main(void)
+{
+  std::cout << "pool, " << int(block) << " octets blocks, bursts of " << int(burst) << std::endl;
+
+  {
+    pool_type pool;
+    pool_type::handle_type handles[burst];
+    unsigned long sink = 0;
+
+    const auto t0 = clock_type::now();
+    for (size_t r = 0; r < rounds; ++r)
+    {
+      for (size_t i = 0; i < burst; ++i) { handles[i] = pool.allocate(); pool.data(handles[i])[0] = 1; }
+      for (size_t i = 0; i < burst; ++i) { sink += pool.data(handles[(i * 7) % burst])[0]; pool.free(handles[(i * 7) % burst]); }
+    }
+    report("pool      ", t0, clock_type::now(), sink);
+  }
+
+  {
+    uint8_t* blocks[burst];
+    unsigned long sink = 0;
+
+    const auto t0 = clock_type::now();
+    for (size_t r = 0; r < rounds; ++r)
+    {
+      for (size_t i = 0; i < burst; ++i) { blocks[i] = new uint8_t[block]; blocks[i][0] = 1; }
+      for (size_t i = 0; i < burst; ++i) { sink += blocks[(i * 7) % burst][0]; delete[] blocks[(i * 7) % burst]; }
+    }
+    report("new/delete", t0, clock_type::now(), sink);
+  }
+
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/pool.hpp>
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+typedef tiny::pool<30, 8> pool_type;
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(pool_test, must_allocate_all_blocks_once)
+{
+  pool_type sut;
+  std::set<pool_type::handle_type> handles;
+
+  for (size_t i = 0; i < 8; ++i)
+  {
+    ASSERT_FALSE(sut.empty());
+    const pool_type::handle_type h = sut.allocate();
+    ASSERT_NE(h, pool_type::null_handle);
+    ASSERT_TRUE(handles.insert(h).second);
+  }
+
+  ASSERT_TRUE(sut.empty());
+  ASSERT_EQ(sut.allocate(), pool_type::null_handle);
+
+  sut.free(3);
+  ASSERT_EQ(sut.allocate(), 3);
+}
+
+//------------------------------------------------------------------------
+TEST(pool_test, blocks_must_be_aligned_and_disjoint)
+{
+  pool_type sut;
+  const pool_type::handle_type a = sut.allocate();
+  const pool_type::handle_type b = sut.allocate();
+
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(sut.data(a)) % 4, 0u);
+  ASSERT_GE(static_cast<size_t>(std::abs(sut.data(b) - sut.data(a))), 30u);
+  ASSERT_EQ(sut.handle(sut.data(a)), a);
+  ASSERT_EQ(sut.handle(sut.data(b)), b);
+}
+
+//------------------------------------------------------------------------
+TEST(pool_test, frame_queue_must_hand_over_blocks)
+{
+  pool_type blocks;
+  tiny::frame_queue<pool_type, 4> sut(blocks);
+
+  const pool_type::handle_type h = blocks.allocate();
+  blocks.data(h)[0] = 0x55;
+  ASSERT_TRUE(sut.push(h, 1));
+  ASSERT_EQ(sut.front()->handle, h);
+
+  const tiny::frame_queue<pool_type, 4>::frame f = sut.pop();
+  ASSERT_TRUE(sut.empty());
+  ASSERT_EQ(f.size, 1u);
+  ASSERT_EQ(blocks.data(f.handle)[0], 0x55);
+  blocks.free(f.handle);
+
+  // dropped frames return the blocks
+  for (size_t i = 0; i < 3; ++i) { ASSERT_TRUE(sut.push(blocks.allocate(), 0)); }
+  ASSERT_FALSE(sut.can_push());
+  ASSERT_FALSE(sut.push(0, 0));
+  for (size_t i = 0; i < 3; ++i) { sut.drop(); }
+  for (size_t i = 0; i < 8; ++i) { ASSERT_NE(blocks.allocate(), pool_type::null_handle); }
+}
+
+//------------------------------------------------------------------------
+TEST(pool_test, frame_queue_must_drop_into_the_attached_pool)
+{
+  pool_type blocks;
+  tiny::frame_queue<pool_type, 2> queues[2];
+  for (size_t i = 0; i < 2; ++i) { queues[i].attach(blocks); }
+
+  ASSERT_TRUE(queues[1].push(blocks.allocate(), 0));
+  ASSERT_EQ(&queues[1].blocks(), &blocks);
+  queues[1].drop();
+  for (size_t i = 0; i < 8; ++i) { ASSERT_NE(blocks.allocate(), pool_type::null_handle); }
+}
+
+//------------------------------------------------------------------------
+TEST(pool_test, must_not_hand_out_a_block_twice_under_contention)
+{
+  typedef tiny::pool<sizeof(unsigned), 16> small_pool;
+  small_pool sut;
+  std::atomic<bool> failed(false);
+  std::vector<std::thread> threads;
+
+  for (unsigned t = 0; t < 4; ++t)
+  {
+    threads.push_back(std::thread([&sut, &failed, t]()
+    {
+      for (unsigned i = 0; i < 200000 && !failed; ++i)
+      {
+        const small_pool::handle_type h = sut.allocate();
+        if (h == small_pool::null_handle) { continue; }
+
+        // the owner is the only writer
+        volatile unsigned* owner = reinterpret_cast<unsigned*>(sut.data(h));
+        *owner = t;
+        for (int j = 0; j < 10; ++j) { if (*owner != t) { failed = true; } }
+        sut.free(h);
+      }
+    }));
+  }
+
+  for (size_t i = 0; i < threads.size(); ++i) { threads[i].join(); }
+  ASSERT_FALSE(failed);
+
+  std::set<small_pool::handle_type> handles;
+  for (size_t i = 0; i < 16; ++i) { ASSERT_TRUE(handles.insert(sut.allocate()).second); }
+  ASSERT_TRUE(sut.empty());
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
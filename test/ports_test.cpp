@@ -0,0 +1,124 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/uart_host.hpp>
+
+namespace
+{
+
+using tiny::io::port_decl;
+using tiny::io::port_registry;
+
+typedef port_registry<
+  port_decl<1, tiny::io::nine_bits, 64, 16>,
+  port_decl<2, tiny::io::eight_bits, 0, 8, tiny::io::pf_octet_stamps | tiny::io::pf_latency>,
+  port_decl<4> > ports;
+
+typedef tiny::io::serial_port<ports, 1> port1;
+typedef tiny::io::serial_port<ports, 2> port2;
+typedef tiny::io::serial_port<ports, 4> port4;
+
+/** Target with the ports 0 and 1 only, 9 bits on 1. */
+struct small_target
+{
+  enum
+  {
+    ports_mask     = 0x03,
+    nine_bits_mask = 0x02
+  };
+};
+
+// the registry folds at compile time
+static_assert(ports::size == 3, "size");
+static_assert(ports::mask() == 0x16, "mask");
+static_assert(ports::wide_mask() == 0x02, "wide mask");
+static_assert(ports::has(1) && ports::has(4) && !ports::has(0) && !ports::has(3) && !ports::has(31), "has");
+static_assert(ports::fits<tiny::io::target_ports>(), "fits the host");
+static_assert(!ports::fits<small_target>(), "no port 2 and 4");
+static_assert(port_registry<port_decl<0>, port_decl<1, tiny::io::nine_bits> >::fits<small_target>(), "fits");
+static_assert(!port_registry<port_decl<0, tiny::io::nine_bits> >::fits<small_target>(), "no 9 bits on 0");
+static_assert(port_registry<>::mask() == 0 && port_registry<>::size == 0, "no ports");
+static_assert(tiny::io::port_mask_of(1, 2, 4) == ports::mask(), "mask of the numbers");
+static_assert(tiny::io::port_stamp_mode(tiny::io::pf_frame_stamps) == tiny::io::rx_stamp_frames, "stamp mode");
+
+// the declarations give the uart types
+static_assert(sizeof(port1::uart_type::octet_type) == 2, "9 bits");
+static_assert(port1::uart_type::rx_buffer_size == 64 && port1::uart_type::tx_buffer_size == 16, "sizes");
+static_assert(!port1::uart_type::latency_type::enabled, "no latency");
+static_assert(port1::uart_type::stamps_type::mode == tiny::io::rx_stamp_none, "no stamps");
+static_assert(sizeof(port2::uart_type::octet_type) == 1, "8 bits");
+static_assert(port2::uart_type::rx_buffer_size == TINY_SERIAL_DEF_BUF_SIZE, "default size");
+static_assert(port2::uart_type::tx_buffer_size == 8, "tx size");
+static_assert(port2::uart_type::latency_type::enabled && port2::uart_type::tx_latency_type::enabled, "latency");
+static_assert(port2::uart_type::stamps_type::mode == tiny::io::rx_stamp_octets, "stamps");
+static_assert(port4::uart_type::rx_buffer_size == TINY_SERIAL_DEF_BUF_SIZE, "defaults");
+
+} // namespace
+
+// the handlers of the registry ports, tiny_host_serialN_handler
+TINY_SERIAL_PORTS(ports, 1, 2, 4)
+
+//------------------------------------------------------------------------
+TEST(ports_test, must_find_the_declarations)
+{
+  typedef ports::port<1>::type decl1;
+  ASSERT_EQ(decl1::number, 1);
+  ASSERT_EQ(decl1::width, tiny::io::nine_bits);
+  ASSERT_EQ(decl1::rx_size, 64);
+  ASSERT_EQ(decl1::tx_size, 16);
+
+  typedef ports::port<4>::type decl4;
+  ASSERT_EQ(decl4::number, 4);
+  ASSERT_EQ(decl4::width, tiny::io::eight_bits);
+  ASSERT_EQ(decl4::features, tiny::io::default_port_features);
+}
+
+//------------------------------------------------------------------------
+TEST(ports_test, must_build_one_instance_per_port)
+{
+  ASSERT_EQ(&port1::instance(), &port1::instance());
+  ASSERT_NE(static_cast<void*>(&port2::instance()), static_cast<void*>(&port4::instance()));
+  ASSERT_EQ(port1::instance().hardware().registers(), &tiny::io::host_port_registers<1>());
+  ASSERT_EQ(port4::instance().hardware().registers(), &tiny::io::host_port_registers<4>());
+}
+
+//------------------------------------------------------------------------
+TEST(ports_test, must_run_the_generated_handlers)
+{
+  tiny::io::host_usart_registers& regs1 = tiny::io::host_port_registers<1>();
+  tiny::io::host_usart_registers& regs2 = tiny::io::host_port_registers<2>();
+  port1::instance().open(9600, 0x106);
+  port2::instance().open(9600);
+
+  regs1.shift_in(0x1a5);
+  tiny_host_serial1_handler();
+  regs2.shift_in('x');
+  tiny_host_serial2_handler();
+
+  ASSERT_EQ(port1::instance().read(), 0x1a5);
+  ASSERT_EQ(port2::instance().available(), 1u);
+
+  uint8_t octet = 0;
+  uint32_t time = 0;
+  ASSERT_TRUE(port2::instance().read_timestamped(octet, time));
+  ASSERT_EQ(octet, 'x');
+
+  ASSERT_TRUE(port2::instance().async_write('y'));
+  uint16_t out = 0;
+  ASSERT_TRUE(regs2.shift_out(out));
+  ASSERT_EQ(out, 'y');
+  tiny_host_serial2_handler();
+  ASSERT_TRUE(port2::instance().drained());
+  ASSERT_EQ(port2::instance().tx_latency().count(0), 1u); // the octet passed the buffer by
+
+  port1::instance().close();
+  port2::instance().close();
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
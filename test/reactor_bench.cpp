@@ -0,0 +1,137 @@
+// Idle loop cost and wake-up latency of round-robin polling versus the
+// reactor event word, using simulated ports.
+
+#include <tiny/serial/reactor.hpp>
+#include <tiny/container.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+
+typedef std::chrono::steady_clock clock_type;
+
+enum { ports = 4, idle_iterations = 10000000, wakeups = 2000 };
+
+/** Simulated port, the interrupt mask register is touched on every check
+ *  as basic_uart::available does with rx_lock.
+ */
+struct sim_port
+{
+  sim_port(void): imr(1) {}
+
+  size_t available(void)
+  {
+    imr = imr & ~1u; // rx_lock
+    const size_t n = rx.size();
+    imr = imr | 1u;  // ~rx_lock
+    return n;
+  }
+
+  void isr_push(uint8_t octet, tiny::io::event_word* events, size_t slot)
+  {
+    rx.push(octet);
+    if (events != nullptr) { events->signal(slot, tiny::io::ev_rx_data); }
+  }
+
+  volatile uint32_t imr;
+  tiny::queue<uint8_t, 32> rx;
+};
+
+sim_port sim[ports];
+
+//------------------------------------------------------------------------
+double idle_polling(void)
+{
+  size_t found  = 0;
+  const auto t0 = clock_type::now();
+  for (size_t i = 0; i < idle_iterations; ++i)
+  {
+    for (size_t p = 0; p < ports; ++p) { found += sim[p].available(); }
+  }
+  const auto t1 = clock_type::now();
+  if (found != 0) { std::cerr << "unexpected data" << std::endl; }
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / idle_iterations;
+}
+
+//------------------------------------------------------------------------
+void on_events(unsigned int, void* context)
+{
+  ++*static_cast<size_t*>(context);
+}
+
+//------------------------------------------------------------------------
+double idle_reactor(tiny::io::reactor<ports>& r)
+{
+  const auto t0 = clock_type::now();
+  for (size_t i = 0; i < idle_iterations; ++i) { r.run_once(); }
+  const auto t1 = clock_type::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / idle_iterations;
+}
+
+//------------------------------------------------------------------------
+template <typename WaitT>
+double wakeup_latency(tiny::io::event_word* events, WaitT wait)
+{
+  std::atomic<long long> stamp(0);
+  std::atomic<bool> done(false);
+  double total = 0;
+
+  std::thread isr([&]() {
+    for (size_t i = 0; i < wakeups; ++i)
+    {
+      while (stamp.load() != 0) { std::this_thread::yield(); }
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+      stamp = clock_type::now().time_since_epoch().count();
+      sim[ports - 1].isr_push(0x55, events, ports - 1);
+    }
+    done = true;
+  });
+
+  for (size_t i = 0; i < wakeups; ++i)
+  {
+    wait();
+    const long long now = clock_type::now().time_since_epoch().count();
+    total += std::chrono::duration<double, std::nano>(clock_type::duration(now - stamp.load())).count();
+    sim[ports - 1].rx.pop();
+    stamp = 0;
+  }
+
+  isr.join();
+  return total / wakeups;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main(void)
+{
+  tiny::io::reactor<ports> r;
+  size_t dispatched = 0;
+  for (size_t p = 0; p < ports; ++p) { r.attach(p, on_events, &dispatched); }
+
+  std::cout << "idle loop, " << ports << " ports" << std::endl;
+  std::cout << "  round-robin available(): " << idle_polling() << " ns/iteration" << std::endl;
+  std::cout << "  reactor run_once():      " << idle_reactor(r) << " ns/iteration" << std::endl;
+
+  const double polling = wakeup_latency(nullptr, []() {
+    for (;;)
+    {
+      for (size_t p = 0; p < ports; ++p) { if (sim[p].available()) { return; } }
+    }
+  });
+
+  const double reactor = wakeup_latency(&r.events(), [&]() {
+    const size_t before = dispatched;
+    while (dispatched == before) { r.poll(true); }
+  });
+
+  std::cout << "wake-up latency" << std::endl;
+  std::cout << "  round-robin available(): " << polling << " ns" << std::endl;
+  std::cout << "  reactor poll():          " << reactor << " ns" << std::endl;
+
+  return 0;
+}
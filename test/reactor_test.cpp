@@ -0,0 +1,92 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/reactor.hpp>
+
+#include <vector>
+#include <utility>
+
+namespace
+{
+
+typedef std::vector<std::pair<int, unsigned int> > calls_type;
+
+calls_type calls;
+
+//------------------------------------------------------------------------
+void record(unsigned int events, void* context)
+{
+  calls.push_back(std::make_pair(*static_cast<int*>(context), events));
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(event_word_test, must_pack_events_into_slots_and_clear_on_take)
+{
+  tiny::io::event_word sut;
+  ASSERT_EQ(sut.pending(), 0u);
+  sut.signal(0, tiny::io::ev_rx_data);
+  sut.signal(2, tiny::io::ev_tx_drained | tiny::io::ev_error);
+  sut.signal(2, tiny::io::ev_rx_data);
+  const tiny::io::event_word::word_type word = sut.take();
+  ASSERT_EQ(sut.pending(), 0u);
+  ASSERT_EQ(tiny::io::event_word::slot_events(word, 0), unsigned(tiny::io::ev_rx_data));
+  ASSERT_EQ(tiny::io::event_word::slot_events(word, 1), 0u);
+  ASSERT_EQ(tiny::io::event_word::slot_events(word, 2),
+            unsigned(tiny::io::ev_rx_data | tiny::io::ev_tx_drained | tiny::io::ev_error));
+}
+
+//------------------------------------------------------------------------
+TEST(event_word_test, must_not_leak_events_into_neighbour_slot)
+{
+  tiny::io::event_word sut;
+  sut.signal(1, 0xff);
+  const tiny::io::event_word::word_type word = sut.take();
+  ASSERT_EQ(tiny::io::event_word::slot_events(word, 1), 0x0fu);
+  ASSERT_EQ(tiny::io::event_word::slot_events(word, 2), 0u);
+}
+
+//------------------------------------------------------------------------
+TEST(reactor_test, must_dispatch_only_to_slots_with_pending_events)
+{
+  tiny::io::reactor<4> sut;
+  int ids[] = {0, 1, 2, 3};
+  for (int i = 0; i < 4; ++i) { sut.attach(i, record, &ids[i]); }
+
+  calls.clear();
+  ASSERT_EQ(sut.run_once(), 0u);
+  ASSERT_TRUE(calls.empty());
+
+  sut.events().signal(1, tiny::io::ev_rx_data);
+  sut.events().signal(3, tiny::io::ev_rx_delimiter);
+  ASSERT_EQ(sut.poll(true), 2u);
+  ASSERT_EQ(calls, calls_type({std::make_pair(1, unsigned(tiny::io::ev_rx_data)),
+                               std::make_pair(3, unsigned(tiny::io::ev_rx_delimiter))}));
+
+  calls.clear();
+  ASSERT_EQ(sut.run_once(), 0u);
+  ASSERT_TRUE(calls.empty());
+}
+
+//------------------------------------------------------------------------
+TEST(reactor_test, must_drop_events_of_detached_slots)
+{
+  tiny::io::reactor<2> sut;
+  int id = 0;
+  sut.attach(0, record, &id);
+  sut.detach(0);
+  sut.events().signal(0, tiny::io::ev_rx_data);
+  calls.clear();
+  ASSERT_EQ(sut.run_once(), 0u);
+  ASSERT_TRUE(calls.empty());
+  ASSERT_EQ(sut.events().pending(), 0u);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
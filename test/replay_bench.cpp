@@ -0,0 +1,183 @@
+// Capture and replay of port traffic. Without arguments a request and
+// response session is captured from a simulated port into a capture ring,
+// dumped into a file and replayed from it through a simulated port at the
+// original timing, accelerated and as fast as the application takes, the
+// application handling time and the answers differing are reported. With
+// a file argument the log given is replayed.
+//
+//   replay_bench [log file [ticks per second]]
+
+#include <tiny/serial/capture.hpp>
+
+#include "sim_wire.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+typedef tiny::io::capture_log log_type;
+typedef sim::uart<uint8_t, 256> port_type;
+
+enum { requests = 2000, request_size = 8, response_size = 24 };
+
+/** The application: answers every request frame of request_size octets
+ *  by response_size octets derived from it.
+ */
+struct responder
+{
+  responder(port_type& port): port(port), size(0) { }
+
+  void poll(void)
+  {
+    while (port.available() != 0)
+    {
+      request[size++] = port.async_read();
+      if (size < request_size) { continue; }
+
+      uint8_t sum = 0;
+      for (size_t i = 0; i < request_size; ++i) { sum = static_cast<uint8_t>(sum * 31 + request[i]); }
+      for (size_t i = 0; i < response_size; ++i) { port.async_write(static_cast<uint8_t>(sum + i)); }
+      size = 0;
+    }
+  }
+
+  port_type& port;
+  uint8_t request[request_size];
+  size_t size;
+};
+
+//------------------------------------------------------------------------
+void dump(log_type& log, std::FILE* file)
+{
+  const uint8_t* data = nullptr;
+  for (size_t n = log.readable(data); n != 0; n = log.readable(data))
+  {
+    std::fwrite(data, 1, n, file);
+    log.consume(n);
+  }
+}
+
+//------------------------------------------------------------------------
+/** Captures a session at 115200 bps, microsecond ticks, requests at random. */
+bool capture(const char* path)
+{
+  std::FILE* file = std::fopen(path, "wb");
+  if (file == nullptr) { return false; }
+
+  static tiny::io::capture_ring<4096> log;
+  port_type port;
+  responder app(port);
+  std::mt19937 random(3);
+  std::exponential_distribution<double> gap(1.0 / 3000);
+
+  const uint32_t octet_us = 87;
+  uint32_t now            = 0;
+  for (size_t r = 0; r < requests; ++r)
+  {
+    now += static_cast<uint32_t>(gap(random));
+    for (size_t i = 0; i < request_size; ++i, now += octet_us)
+    {
+      const uint8_t octet = static_cast<uint8_t>(random());
+      log.record(log_type::rx, octet, now);
+      port.receive(octet);
+    }
+
+    app.poll();
+    while (!port.tx.empty())
+    {
+      log.record(log_type::tx, port.tx.pop(), now);
+      now += octet_us;
+    }
+
+    // the host drains the ring to the file as the target would dump it
+    dump(log, file);
+  }
+
+  std::fclose(file);
+  return true;
+}
+
+//------------------------------------------------------------------------
+bool load(const char* path, std::vector<uint8_t>& octets)
+{
+  std::FILE* file = std::fopen(path, "rb");
+  if (file == nullptr) { return false; }
+
+  uint8_t chunk[512];
+  for (size_t n = std::fread(chunk, 1, sizeof(chunk), file); n != 0; n = std::fread(chunk, 1, sizeof(chunk), file))
+  {
+    octets.insert(octets.end(), chunk, chunk + n);
+  }
+
+  std::fclose(file);
+  return true;
+}
+
+//------------------------------------------------------------------------
+void replay(const std::vector<uint8_t>& octets, uint32_t speedup, unsigned long ticks_per_second)
+{
+  typedef std::chrono::steady_clock clock_type;
+
+  port_type port;
+  responder app(port);
+  tiny::io::replayer<port_type> player(port, octets.data(), octets.size(), speedup);
+
+  // the virtual time jumps to the next octet due, the handling is timed
+  clock_type::duration handling = clock_type::duration::zero();
+  size_t sent                   = 0;
+  while (!player.done() || port.available() != 0)
+  {
+    const uint32_t elapsed = speedup == 0? 0: player.next_time() / speedup;
+    player.poll(elapsed);
+
+    const clock_type::time_point start = clock_type::now();
+    app.poll();
+    handling += clock_type::now() - start;
+
+    for (; !port.tx.empty(); ++sent) { player.check(port.tx.pop()); }
+  }
+
+  const double last = static_cast<double>(player.next_time()) / ticks_per_second;
+  std::printf("  speedup %4lu: %6lu octets in, %6lu out, %lu differ, %lu lost, %.1f s of traffic, handling %.0f ns per octet\n",
+              static_cast<unsigned long>(speedup), static_cast<unsigned long>(player.delivered()),
+              static_cast<unsigned long>(sent), static_cast<unsigned long>(player.mismatches()),
+              static_cast<unsigned long>(player.lost()), speedup == 0? 0: last / speedup,
+              std::chrono::duration<double, std::nano>(handling).count() /
+                  (player.delivered() != 0? player.delivered(): 1));
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  const char* path                    = argc > 1? argv[1]: "replay_bench.log";
+  const unsigned long ticks_per_second = argc > 2? std::strtoul(argv[2], nullptr, 10): 1000000;
+
+  if (argc == 1 && !capture(path))
+  {
+    std::fprintf(stderr, "can't write %s\n", path);
+    return 1;
+  }
+
+  std::vector<uint8_t> octets;
+  if (!load(path, octets))
+  {
+    std::fprintf(stderr, "can't read %s\n", path);
+    return 1;
+  }
+
+  std::printf("%s: %lu octets of log\n", path, static_cast<unsigned long>(octets.size()));
+  const uint32_t speedups[] = { 1, 10, 0 };
+  for (size_t i = 0; i < sizeof(speedups) / sizeof(speedups[0]); ++i)
+  {
+    replay(octets, speedups[i], ticks_per_second);
+  }
+
+  return 0;
+}
@@ -0,0 +1,162 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/rx_hooks.hpp>
+#include <tiny/serial/uart_host.hpp>
+#include <tiny/container.hpp>
+
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+
+typedef tiny::io::rx_hooks<uint8_t> hooks_type;
+typedef tiny::queue<uint8_t, 16> queue_type;
+typedef tiny::io::host_uart<uint8_t, 16, true, 16, tiny::io::pf_rx_hooks> hooked_uart;
+typedef tiny::io::host_uart<uint8_t, 16, true, 16, tiny::io::pf_none> bare_uart;
+
+// the port declared without hooks keeps no hook state at all
+static_assert(std::is_empty<tiny::io::no_rx_hooks<uint8_t> >::value, "no hook state");
+static_assert(sizeof(hooked_uart) - sizeof(bare_uart) == sizeof(hooks_type), "no hook state in the uart");
+
+//------------------------------------------------------------------------
+bool consume_odd(uint8_t octet, void* context)
+{
+  static_cast<std::vector<uint8_t>*>(context)->push_back(octet);
+  return (octet & 1) != 0;
+}
+
+//------------------------------------------------------------------------
+void count_match(uint8_t, void* context)
+{
+  ++*static_cast<int*>(context);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(rx_hooks_test, must_buffer_octets_without_handlers)
+{
+  hooks_type sut;
+  queue_type queue;
+  ASSERT_FALSE(sut.armed());
+  ASSERT_TRUE(sut.dispatch(1, queue));
+  ASSERT_TRUE(sut.dispatch(2, queue));
+  ASSERT_EQ(queue.size(), 2u);
+  ASSERT_EQ(queue.pop(), 1);
+  ASSERT_EQ(queue.pop(), 2);
+}
+
+//------------------------------------------------------------------------
+TEST(rx_hooks_test, must_report_overflow_without_handlers)
+{
+  hooks_type sut;
+  tiny::queue<uint8_t, 2> queue;
+  ASSERT_TRUE(sut.dispatch(1, queue));
+  ASSERT_FALSE(sut.dispatch(2, queue));
+}
+
+//------------------------------------------------------------------------
+TEST(rx_hooks_test, octet_handler_must_see_every_octet_and_may_consume_it)
+{
+  hooks_type sut;
+  queue_type queue;
+  std::vector<uint8_t> seen;
+  sut.on_octet(consume_odd, &seen);
+  ASSERT_TRUE(sut.armed());
+  ASSERT_FALSE(sut.dispatch(1, queue));
+  ASSERT_TRUE(sut.dispatch(2, queue));
+  ASSERT_FALSE(sut.dispatch(3, queue));
+  ASSERT_TRUE(sut.dispatch(4, queue));
+  ASSERT_EQ(seen, std::vector<uint8_t>({1, 2, 3, 4}));
+  ASSERT_EQ(queue.size(), 2u);
+  ASSERT_EQ(queue.pop(), 2);
+  ASSERT_EQ(queue.pop(), 4);
+}
+
+//------------------------------------------------------------------------
+TEST(rx_hooks_test, match_handler_must_fire_after_delimiter_is_buffered)
+{
+  hooks_type sut;
+  queue_type queue;
+  int matches = 0;
+  sut.on_match('\n', count_match, &matches);
+  sut.dispatch('a', queue);
+  ASSERT_EQ(matches, 0);
+  sut.dispatch('\n', queue);
+  ASSERT_EQ(matches, 1);
+  ASSERT_EQ(queue.size(), 2u);
+}
+
+//------------------------------------------------------------------------
+TEST(rx_hooks_test, must_report_match_without_handler)
+{
+  hooks_type sut;
+  queue_type queue;
+  sut.on_match('\n');
+  ASSERT_TRUE(sut.armed());
+  ASSERT_EQ(sut.dispatch('a', queue), tiny::io::rx_buffered);
+  ASSERT_EQ(sut.dispatch('\n', queue), tiny::io::rx_buffered | tiny::io::rx_matched);
+  sut.no_match();
+  ASSERT_FALSE(sut.armed());
+  ASSERT_EQ(sut.dispatch('\n', queue), tiny::io::rx_buffered);
+}
+
+//------------------------------------------------------------------------
+TEST(rx_hooks_test, consumed_octet_must_not_trigger_match)
+{
+  hooks_type sut;
+  queue_type queue;
+  std::vector<uint8_t> seen;
+  int matches = 0;
+  sut.on_octet(consume_odd, &seen);
+  sut.on_match(3, count_match, &matches);
+  sut.dispatch(3, queue);
+  ASSERT_EQ(matches, 0);
+  ASSERT_TRUE(queue.empty());
+}
+
+//------------------------------------------------------------------------
+TEST(rx_hooks_test, clear_must_disarm_hooks)
+{
+  hooks_type sut;
+  queue_type queue;
+  std::vector<uint8_t> seen;
+  sut.on_octet(consume_odd, &seen);
+  sut.clear();
+  ASSERT_FALSE(sut.armed());
+  ASSERT_TRUE(sut.dispatch(1, queue));
+  ASSERT_TRUE(seen.empty());
+}
+
+//------------------------------------------------------------------------
+TEST(rx_hooks_test, no_hooks_must_only_push)
+{
+  tiny::io::no_rx_hooks<uint8_t> sut;
+  queue_type queue;
+  ASSERT_FALSE(sut.armed());
+  uint8_t i = 0;
+  while (queue.can_push()) { ASSERT_EQ(sut.dispatch(i++, queue), unsigned(tiny::io::rx_buffered)); }
+  ASSERT_EQ(sut.dispatch(i, queue), unsigned(tiny::io::rx_none));
+  ASSERT_EQ(*queue.front(), 0);
+}
+
+//------------------------------------------------------------------------
+TEST(rx_hooks_test, port_without_hooks_must_receive)
+{
+  tiny::io::host_usart_registers regs;
+  bare_uart uart(regs);
+  uart.open(9600);
+  regs.shift_in('a');
+  uart.service();
+  ASSERT_EQ(uart.read(), 'a');
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
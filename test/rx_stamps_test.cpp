@@ -0,0 +1,193 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/rx_stamps.hpp>
+#include <tiny/serial/idle_line.hpp>
+#include <tiny/serial/rx_hooks.hpp>
+#include <tiny/container.hpp>
+
+#include <vector>
+
+#include "virtual_clock.hpp"
+
+namespace
+{
+
+typedef sim::us_clock virtual_clock;
+
+/** The rx side of the uarts, receive is the rx interrupt. */
+template <int Mode>
+struct stamped_port
+{
+  enum { capacity = 16 };
+
+  typedef tiny::io::rx_stamps<Mode, capacity, virtual_clock> stamps_type;
+  typedef tiny::io::rx_hooks<uint8_t> hooks_type;
+
+  stamped_port(uint32_t idle_us = 0)
+  {
+    virtual_clock::reads = 0;
+    if (idle_us != 0) { idle.enable(idle_us, 10); }
+  }
+
+  void receive(uint8_t octet)
+  {
+    const uint32_t now = stamps.now();
+    const size_t slot  = stamps_type::mode == tiny::io::rx_stamp_octets? rx.head_index(): 0;
+    bool starts        = stamps_type::mode == tiny::io::rx_stamp_frames && !idle.in_frame();
+
+    const unsigned int res = hooks.dispatch(octet, rx);
+    if ((res & tiny::io::rx_buffered) == 0) { return; }
+
+    if (idle.enabled() && idle.on_octet(virtual_clock::us))
+    {
+      stamps.on_frame();
+      starts = true;
+    }
+    stamps.on_octet(slot, now, starts);
+  }
+
+  void receive_at(uint32_t us, uint8_t octet)
+  {
+    virtual_clock::us = us;
+    receive(octet);
+  }
+
+  bool read_timestamped(uint8_t& octet, uint32_t& time)
+  {
+    if (rx.empty()) { return false; }
+
+    time  = stamps.octet(rx.tail_index());
+    octet = rx.pop();
+    return true;
+  }
+
+  size_t read_frame(std::vector<uint8_t>& data, uint32_t& time)
+  {
+    if (idle.poll(virtual_clock::us)) { stamps.on_frame(); }
+    if (!idle.frame_ready()) { return 0; }
+
+    const size_t length = idle.pop_frame();
+    stamps.pop_frame(time);
+    data.clear();
+    for (size_t i = 0; i < length && !rx.empty(); ++i) { data.push_back(rx.pop()); }
+    return data.size();
+  }
+
+  tiny::queue<uint8_t, capacity> rx;
+  hooks_type hooks;
+  tiny::io::idle_line_detector<> idle;
+  stamps_type stamps;
+};
+
+//------------------------------------------------------------------------
+bool drop_odd(uint8_t octet, void*)
+{
+  return (octet & 1) != 0;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(rx_stamps_test, must_stamp_every_octet_across_ring_wrap)
+{
+  stamped_port<tiny::io::rx_stamp_octets> sut;
+
+  uint8_t octet = 0;
+  uint32_t time = 0;
+  for (uint32_t round = 0; round < 5; ++round)
+  {
+    for (uint8_t i = 0; i < 7; ++i) { sut.receive_at(1000 * round + 10 * i, i); }
+
+    for (uint8_t i = 0; i < 7; ++i)
+    {
+      ASSERT_TRUE(sut.read_timestamped(octet, time));
+      ASSERT_EQ(octet, i);
+      ASSERT_EQ(time, 1000 * round + 10 * i);
+    }
+  }
+  ASSERT_FALSE(sut.read_timestamped(octet, time));
+}
+
+//------------------------------------------------------------------------
+TEST(rx_stamps_test, must_keep_times_aligned_over_consume_and_hooks)
+{
+  stamped_port<tiny::io::rx_stamp_octets> sut;
+  sut.hooks.on_octet(&drop_odd, nullptr);
+
+  for (uint8_t i = 0; i < 12; ++i) { sut.receive_at(100 + i, i); }
+
+  // the even octets are buffered, the first two are taken in place
+  const uint8_t* data = nullptr;
+  ASSERT_GE(sut.rx.readable(data), 2u);
+  sut.rx.consume(2);
+
+  uint8_t octet = 0;
+  uint32_t time = 0;
+  for (uint8_t i = 4; i < 12; i += 2)
+  {
+    ASSERT_TRUE(sut.read_timestamped(octet, time));
+    ASSERT_EQ(octet, i);
+    ASSERT_EQ(time, 100u + i);
+  }
+}
+
+//------------------------------------------------------------------------
+TEST(rx_stamps_test, must_stamp_first_octet_of_frames)
+{
+  stamped_port<tiny::io::rx_stamp_frames> sut(500);
+
+  for (uint8_t i = 0; i < 4; ++i) { sut.receive_at(1000 + 100 * i, i); }
+  for (uint8_t i = 0; i < 3; ++i) { sut.receive_at(5000 + 100 * i, i); }
+  virtual_clock::us = 9000;
+
+  std::vector<uint8_t> data;
+  uint32_t time = 0;
+  ASSERT_EQ(sut.read_frame(data, time), 4u);
+  ASSERT_EQ(time, 1000u);
+  ASSERT_EQ(sut.read_frame(data, time), 3u);
+  ASSERT_EQ(time, 5000u);
+  ASSERT_EQ(sut.read_frame(data, time), 0u);
+}
+
+//------------------------------------------------------------------------
+TEST(rx_stamps_test, must_keep_earlier_time_of_merged_frames)
+{
+  stamped_port<tiny::io::rx_stamp_frames> sut(500);
+
+  // four frames fit, the fifth and sixth merge
+  for (uint32_t f = 0; f < 6; ++f) { sut.receive_at(1000 * (f + 1), static_cast<uint8_t>(f)); }
+  virtual_clock::us = 20000;
+
+  std::vector<uint8_t> data;
+  uint32_t time = 0;
+  for (uint32_t f = 0; f < 4; ++f)
+  {
+    ASSERT_EQ(sut.read_frame(data, time), 1u);
+    ASSERT_EQ(time, 1000 * (f + 1));
+  }
+  ASSERT_EQ(sut.read_frame(data, time), 2u);
+  ASSERT_EQ(time, 5000u);
+}
+
+//------------------------------------------------------------------------
+TEST(rx_stamps_test, must_not_read_clock_when_off)
+{
+  stamped_port<tiny::io::rx_stamp_none> sut;
+
+  for (uint8_t i = 0; i < 8; ++i) { sut.receive_at(i, i); }
+  ASSERT_EQ(virtual_clock::reads, 0u);
+  ASSERT_EQ(sut.rx.size(), 8u);
+
+  stamped_port<tiny::io::rx_stamp_octets> on;
+  on.receive_at(1, 1);
+  ASSERT_EQ(virtual_clock::reads, 1u);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
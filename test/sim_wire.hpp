@@ -0,0 +1,205 @@
+// Simulated ports and lossy wire shared by the link tests and benchmarks.
+
+#ifndef TINY_TEST_SIM_WIRE_HPP_
+#define TINY_TEST_SIM_WIRE_HPP_
+
+#include <tiny/container.hpp>
+#include <tiny/serial/rx_hooks.hpp>
+
+#include <deque>
+#include <random>
+#include <utility>
+
+namespace sim
+{
+
+/** Virtual millisecond clock. */
+struct clock
+{
+  typedef unsigned long time_type;
+
+  static time_type now(void) { return ms; }
+
+  static time_type ms;
+};
+
+clock::time_type clock::ms = 0;
+
+/** Simulated port, the rings the uart interrupts would serve. */
+template <size_t Capacity = 256>
+struct port
+{
+  typedef uint8_t octet_type;
+
+  size_t readable(const uint8_t*& data) const { return rx.readable(data); }
+  void consume(size_t n) { rx.consume(n); }
+  size_t writable(uint8_t*& data) { return tx.writable(data); }
+  void commit(size_t n) { tx.commit(n); }
+
+  tiny::queue<uint8_t, Capacity> rx;
+  tiny::queue<uint8_t, Capacity> tx;
+};
+
+/** Simulated uart, the buffers, the rx hooks and the octet API of
+ *  basic_uart, receive stands for the rx interrupt.
+ */
+template <typename OctetT = uint8_t, size_t Capacity = 32>
+struct uart
+{
+  typedef OctetT octet_type;
+  typedef tiny::io::rx_hooks<octet_type> hooks_type;
+
+  void receive(octet_type octet) { hooks.dispatch(octet, rx); }
+
+  void on_rx(typename hooks_type::octet_handler handler, void* context = nullptr)
+  {
+    hooks.on_octet(handler, context);
+  }
+
+  size_t available(void) const { return rx.size(); }
+  octet_type async_read(void) { return rx.pop(); }
+  bool async_write(octet_type octet) { return tx.push(octet); }
+  size_t readable(const octet_type*& data) const { return rx.readable(data); }
+  void consume(size_t n) { rx.consume(n); }
+
+  hooks_type hooks;
+  tiny::queue<octet_type, Capacity> rx;
+  tiny::queue<octet_type, Capacity> tx;
+};
+
+/** One direction of the wire, moves the octets with the delay and bit
+ *  errors, the octets not fitting into the receiver are lost as overruns.
+ */
+template <typename PortT>
+class wire
+{
+public:
+  wire(PortT& from, PortT& to, double error_rate = 0, size_t delay = 0, unsigned seed = 1):
+    _from(from),
+    _to(to),
+    _error_rate(error_rate),
+    _delay(delay),
+    _random(seed),
+    _corrupt_at(0),
+    _passed(0),
+    _corrupted(0)
+  {
+    // empty
+  }
+
+public:
+  /** Transmits up to the given number of octets and delivers the ones due. */
+  void tick(size_t octets = 1)
+  {
+    std::uniform_real_distribution<double> chance(0, 1);
+    std::uniform_int_distribution<int> bit(0, 7);
+
+    for (size_t i = 0; i < octets && !_from.tx.empty(); ++i)
+    {
+      uint8_t octet = _from.tx.pop();
+      ++_passed;
+      if ((_error_rate != 0 && chance(_random) < _error_rate) || _passed == _corrupt_at)
+      {
+        octet = static_cast<uint8_t>(octet ^ (1 << bit(_random)));
+        ++_corrupted;
+      }
+      _line.push_back(std::make_pair(clock::ms + _delay, octet));
+    }
+
+    while (!_line.empty() && _line.front().first <= clock::ms)
+    {
+      _to.rx.push(_line.front().second);
+      _line.pop_front();
+    }
+  }
+
+  /** Corrupts the n-th octet passed, 1 based. */
+  void corrupt_at(size_t n) { _corrupt_at = n; }
+
+  /** Returns the number of the octets passed. */
+  size_t passed(void) const { return _passed; }
+
+  /** Returns the number of the octets corrupted. */
+  size_t corrupted(void) const { return _corrupted; }
+
+private:
+  PortT& _from;
+  PortT& _to;
+  double _error_rate;
+  size_t _delay;
+  std::mt19937 _random;
+  std::deque<std::pair<clock::time_type, uint8_t> > _line;
+  size_t _corrupt_at;
+  size_t _passed;
+  size_t _corrupted;
+};
+
+/** Simulated timer and pins of a soft uart, ticks of 0.5 us as a Mega
+ *  timer at F_CPU / 8.
+ */
+struct soft_io
+{
+  soft_io(void):
+    rx(true),
+    last_rx(true),
+    tx(true),
+    listening(false),
+    rx_armed(false),
+    tx_armed(false),
+    rx_due(0),
+    tx_due(0),
+    irqs(0)
+  {
+    // empty
+  }
+
+  /** Runs the interrupts due at the tick, rx is the line level now. */
+  template <typename UartT>
+  void step(UartT& uart)
+  {
+    if (listening && last_rx && !rx) { ++irqs; uart.handle_start_irq(); }
+    last_rx = rx;
+    if (rx_armed && rx_due == ticks) { ++irqs; uart.handle_rx_timer_irq(); }
+    if (tx_armed && tx_due == ticks) { ++irqs; uart.handle_tx_timer_irq(); }
+  }
+
+  bool rx;
+  bool last_rx;
+  bool tx;
+  bool listening;
+  bool rx_armed;
+  bool tx_armed;
+  unsigned long rx_due;
+  unsigned long tx_due;
+  size_t irqs;
+
+  static unsigned long ticks;
+};
+
+unsigned long soft_io::ticks = 0;
+
+/** Soft uart timer and pins policy over soft_io. */
+class soft_hardware
+{
+public:
+  explicit soft_hardware(soft_io* io = nullptr): _io(io) { }
+
+  void open(void) { }
+  unsigned long ticks_per_bit(unsigned long baud) const { return (2000000 + baud / 2) / baud; }
+  bool rx(void) const { return _io->rx; }
+  void tx(bool level) { _io->tx = level; }
+  void start_detect(bool enable) { _io->listening = enable; }
+  void arm_rx(unsigned long delay) { _io->rx_due = soft_io::ticks + delay; _io->rx_armed = true; }
+  void next_rx(unsigned long period) { _io->rx_due += period; }
+  void disarm_rx(void) { _io->rx_armed = false; }
+  void arm_tx(unsigned long delay) { _io->tx_due = soft_io::ticks + delay; _io->tx_armed = true; }
+  void next_tx(unsigned long period) { _io->tx_due += period; }
+  void disarm_tx(void) { _io->tx_armed = false; }
+
+private:
+  soft_io* _io;
+};
+
+} // namespace sim
+
+#endif // TINY_TEST_SIM_WIRE_HPP_
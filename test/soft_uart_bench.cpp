@@ -0,0 +1,109 @@
+// Soft uart CPU load per port at each baud rate, full duplex 8n1 traffic.
+// The interrupts per second are counted on the simulated timer and pins,
+// the handler time is measured on the host. The Mega load is estimated by
+// the cycles per interrupt given below, the handler with the prologue and
+// epilogue of a vector saving the call-clobbered registers.
+
+#include <tiny/serial/soft_uart.hpp>
+
+#include "sim_wire.hpp"
+
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+
+typedef tiny::io::soft_uart<sim::soft_hardware> uart_type;
+
+enum { mega_cycles_per_irq = 120, mega_hz = 16000000 };
+
+/** Two soft ports wired back to back, both sending all the time. */
+struct duplex
+{
+  duplex(void):
+    a(sim::soft_hardware(&a_io)),
+    b(sim::soft_hardware(&b_io))
+  {
+    // empty
+  }
+
+  void run(unsigned long ticks)
+  {
+    for (unsigned long t = 0; t < ticks; ++t)
+    {
+      ++sim::soft_io::ticks;
+      while (a.async_write(0x55)) { }
+      while (b.async_write(0xaa)) { }
+      while (a.available()) { a.async_read(); }
+      while (b.available()) { b.async_read(); }
+
+      a_io.step(a);
+      b_io.step(b);
+      b_io.rx = a_io.tx;
+      a_io.rx = b_io.tx;
+    }
+  }
+
+  sim::soft_io a_io;
+  sim::soft_io b_io;
+  uart_type a;
+  uart_type b;
+};
+
+//------------------------------------------------------------------------
+double host_ns_per_irq(void)
+{
+  sim::soft_io io;
+  uart_type sut((sim::soft_hardware(&io)));
+  sut.open(9600);
+
+  const size_t octets = 1000000;
+  size_t irqs = 0;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < octets; ++i)
+  {
+    sut.async_write(static_cast<unsigned char>(i));
+    for (size_t bit = 0; bit < 10; ++bit, ++irqs) { sut.handle_tx_timer_irq(); }
+
+    io.rx = false;
+    sut.handle_start_irq();
+    for (size_t bit = 0; bit < 10; ++bit)
+    {
+      io.rx = bit == 0? false: ((i >> (bit - 1)) & 1) != 0 || bit == 9;
+      sut.handle_rx_timer_irq();
+    }
+    io.rx = true;
+    irqs += 11;
+    sut.async_read();
+  }
+  const std::chrono::duration<double, std::nano> spent = std::chrono::steady_clock::now() - start;
+
+  return spent.count() / irqs;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main(void)
+{
+  const unsigned long bauds[] = { 1200, 2400, 4800, 9600, 19200, 38400 };
+  const double ns = host_ns_per_irq();
+
+  std::printf("soft uart load per port, full duplex 8n1, %d cycles per interrupt on Mega\n",
+              static_cast<int>(mega_cycles_per_irq));
+  std::printf("  host handler %.1f ns per interrupt\n", ns);
+  for (size_t i = 0; i < sizeof(bauds) / sizeof(bauds[0]); ++i)
+  {
+    duplex d;
+    d.a.open(bauds[i]);
+    d.b.open(bauds[i]);
+    d.run(2000000); // a second
+
+    const double irqs = static_cast<double>(d.a_io.irqs);
+    std::printf("  %6lu bps: %6.0f irq/s, Mega %5.1f%% CPU, host %.3f%% CPU\n", bauds[i], irqs,
+                100.0 * irqs * mega_cycles_per_irq / mega_hz, 100.0 * irqs * ns / 1e9);
+  }
+
+  return 0;
+}
@@ -0,0 +1,217 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/soft_uart.hpp>
+
+#include "sim_wire.hpp"
+
+#include <vector>
+
+namespace
+{
+
+using tiny::io::soft_uart_traits;
+
+typedef tiny::io::soft_uart<sim::soft_hardware> uart8;
+typedef tiny::io::soft_uart<sim::soft_hardware, unsigned short> uart9;
+
+/** Two soft uarts wired a.tx to b.rx. */
+template <typename UartT>
+struct loop
+{
+  loop(void):
+    a(sim::soft_hardware(&a_io)),
+    b(sim::soft_hardware(&b_io))
+  {
+    // empty
+  }
+
+  void run(unsigned long ticks)
+  {
+    for (unsigned long t = 0; t < ticks; ++t)
+    {
+      ++sim::soft_io::ticks;
+      a_io.step(a);
+      b_io.rx = a_io.tx;
+      b_io.step(b);
+    }
+  }
+
+  sim::soft_io a_io;
+  sim::soft_io b_io;
+  UartT a;
+  UartT b;
+};
+
+/** Drives the rx pin by the bits of the frames at the given bit time. */
+struct waveform
+{
+  explicit waveform(double bit_ticks): bit_ticks(bit_ticks) { }
+
+  /** Adds the bits LSB first, start bit included. */
+  void add(uint16_t word, size_t bits)
+  {
+    for (size_t i = 0; i < bits; ++i) { levels.push_back(((word >> i) & 1) != 0); }
+  }
+
+  template <typename UartT>
+  void play(UartT& uart, sim::soft_io& io)
+  {
+    const unsigned long ticks = static_cast<unsigned long>(bit_ticks * (levels.size() + 2));
+    for (unsigned long t = 0; t < ticks; ++t)
+    {
+      ++sim::soft_io::ticks;
+      const size_t bit = static_cast<size_t>(t / bit_ticks);
+      io.rx = bit >= levels.size() || levels[bit];
+      io.step(uart);
+    }
+  }
+
+  double bit_ticks;
+  std::vector<bool> levels;
+};
+
+//------------------------------------------------------------------------
+template <typename UartT>
+std::vector<unsigned> received(UartT& uart)
+{
+  std::vector<unsigned> result;
+  while (uart.available()) { result.push_back(uart.async_read()); }
+  return result;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(soft_uart_test, must_encode_frames)
+{
+  tiny::io::detail::soft_frame frame;
+
+  frame.configure(soft_uart_traits::_8n1);
+  ASSERT_EQ(frame.tx_bits(), 10u);
+  ASSERT_EQ(frame.encode(0x55) & 0x3ff, 0x2aa);
+
+  frame.configure(soft_uart_traits::_9e2);
+  ASSERT_EQ(frame.tx_bits(), 13u);
+  ASSERT_EQ(frame.rx_bits(), 12u);
+  ASSERT_EQ(frame.encode(0x101) & 0x1fff, 0x1a02); // two ones, even parity 0
+
+  frame.configure(soft_uart_traits::_8o1);
+  uint16_t octet = 0;
+  ASSERT_TRUE(frame.decode(frame.encode(0x07), octet));
+  ASSERT_EQ(octet, 0x07);
+  ASSERT_FALSE(frame.decode(static_cast<uint16_t>(frame.encode(0x07) ^ 0x200), octet));
+  ASSERT_FALSE(frame.decode(static_cast<uint16_t>(frame.encode(0x07) ^ 0x400), octet));
+}
+
+//------------------------------------------------------------------------
+TEST(soft_uart_test, must_loop_octets_back)
+{
+  loop<uart8> sut;
+  sut.a.open(9600);
+  sut.b.open(9600);
+
+  const char text[] = "soft uart";
+  for (size_t i = 0; i + 1 < sizeof(text); ++i) { ASSERT_TRUE(sut.a.async_write(text[i])); }
+  sut.run(208 * 10 * sizeof(text));
+
+  const std::vector<unsigned> result = received(sut.b);
+  ASSERT_EQ(result.size(), sizeof(text) - 1);
+  for (size_t i = 0; i < result.size(); ++i) { ASSERT_EQ(result[i], static_cast<unsigned>(text[i])); }
+  ASSERT_FALSE(sut.a_io.tx_armed);
+  ASSERT_EQ(sut.b.errors(), 0u);
+}
+
+//------------------------------------------------------------------------
+TEST(soft_uart_test, must_pass_nine_bits_with_parity_at_38400)
+{
+  loop<uart9> sut;
+  sut.a.open(38400, soft_uart_traits::_9e1);
+  sut.b.open(38400, soft_uart_traits::_9e1);
+
+  const unsigned short words[] = { 0x000, 0x1ff, 0x100, 0x0aa, 0x155 };
+  for (size_t i = 0; i < 5; ++i) { sut.a.write(words[i]); }
+  sut.run(52 * 12 * 6);
+
+  const std::vector<unsigned> result = received(sut.b);
+  ASSERT_EQ(result.size(), 5u);
+  for (size_t i = 0; i < 5; ++i) { ASSERT_EQ(result[i], words[i]); }
+}
+
+//------------------------------------------------------------------------
+TEST(soft_uart_test, must_tolerate_baud_mismatch)
+{
+  sim::soft_io io;
+  uart8 sut((sim::soft_hardware(&io)));
+  sut.open(19200);
+
+  tiny::io::detail::soft_frame frame;
+  const double nominal = 2000000.0 / 19200;
+  const double skews[] = { 0.97, 1.03 };
+  for (size_t s = 0; s < 2; ++s)
+  {
+    for (unsigned i = 0; i < 256; ++i)
+    {
+      waveform w(nominal * skews[s]);
+      w.add(frame.encode(static_cast<uint16_t>(i)), frame.tx_bits());
+      w.play(sut, io);
+      ASSERT_EQ(sut.available(), 1u) << skews[s];
+      ASSERT_EQ(sut.async_read(), static_cast<unsigned char>(i)) << skews[s];
+    }
+  }
+  ASSERT_EQ(sut.errors(), 0u);
+}
+
+//------------------------------------------------------------------------
+TEST(soft_uart_test, must_count_errors_and_ignore_glitches)
+{
+  sim::soft_io io;
+  uart8 sut((sim::soft_hardware(&io)));
+  sut.open(9600, soft_uart_traits::_8e1);
+
+  tiny::io::detail::soft_frame frame;
+  frame.configure(soft_uart_traits::_8e1);
+
+  waveform w(2000000.0 / 9600);
+  w.add(static_cast<uint16_t>(frame.encode(0x31) ^ 0x200), frame.tx_bits()); // parity broken
+  w.add(static_cast<uint16_t>(frame.encode(0x32) & ~0x400), frame.tx_bits()); // no stop bit
+  w.add(0xffff, 1);
+  w.add(frame.encode(0x33), frame.tx_bits());
+  w.play(sut, io);
+  ASSERT_EQ(sut.errors(), 2u);
+
+  // a spike shorter than half a bit
+  for (unsigned long t = 0; t < 300; ++t)
+  {
+    ++sim::soft_io::ticks;
+    io.rx = t < 10 || t >= 40;
+    io.step(sut);
+  }
+  ASSERT_EQ(sut.errors(), 2u);
+
+  ASSERT_EQ(sut.available(), 1u);
+  ASSERT_EQ(sut.async_read(), 0x33);
+}
+
+//------------------------------------------------------------------------
+TEST(soft_uart_test, must_serve_as_tiny_serial)
+{
+  loop<uart8> sut;
+  tiny::serial8b& a = sut.a;
+  tiny::serial8b& b = sut.b;
+  a.open(tiny::baud_rate::br_4800);
+  b.open(tiny::baud_rate::br_4800);
+
+  a.write(0xa5);
+  sut.run(417 * 11);
+  ASSERT_EQ(b.available(), 1u);
+  ASSERT_EQ(b.read(), 0xa5);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,240 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/tx_lanes.hpp>
+#include <tiny/serial/uart_host.hpp>
+
+#include <string>
+
+namespace
+{
+
+typedef tiny::io::tx_lanes<uint8_t, 32, 4, 4> lanes_type;
+
+//------------------------------------------------------------------------
+void write(lanes_type& lanes, const std::string& s)
+{
+  for (size_t i = 0; i < s.size(); ++i) { ASSERT_TRUE(lanes.push(static_cast<uint8_t>(s[i]))); }
+}
+
+/** The transmitter as the tx ready interrupt drives it, an octet a call. */
+std::string transmit(lanes_type& lanes, size_t octets = 100)
+{
+  std::string line;
+  uint8_t octet = 0;
+  for (size_t i = 0; i < octets && lanes.pop(octet); ++i) { line.push_back(static_cast<char>(octet)); }
+  return line;
+}
+
+typedef tiny::io::host_uart<uint8_t, 32> uart_type;
+
+/** An octet time at 115200 bps, us. */
+const uint32_t octet_us = 87;
+
+/** Sends the line through the uart, an octet time a shift, and returns
+ *  the time the octet given is on the line at, us after the start.
+ */
+uint32_t line_time_of(tiny::io::host_usart_registers& regs, uart_type& uart, uint8_t octet, std::string* line = nullptr)
+{
+  uint32_t& now     = tiny::io::host_clock::ticks();
+  const uint32_t t0 = now;
+  uint32_t found    = 0;
+  uint16_t out      = 0;
+
+  uart.service();
+  while (regs.shift_out(out))
+  {
+    now += octet_us;
+    if (line != nullptr) { line->push_back(static_cast<char>(out)); }
+    if (out == octet && found == 0) { found = now - t0; }
+    uart.service();
+  }
+
+  return found;
+}
+
+/** The time the octet is on the line written after the bulk ones. */
+uint32_t latency_after(size_t bulk, bool urgent)
+{
+  tiny::io::host_usart_registers regs;
+  uart_type uart(regs);
+  uart.open(115200);
+
+  for (size_t i = 0; i < bulk; ++i) { EXPECT_TRUE(uart.async_write('x')); }
+  EXPECT_TRUE(urgent? uart.async_write_urgent('!'): uart.async_write('!'));
+  return line_time_of(regs, uart, '!');
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(tx_lanes_test, urgent_must_go_ahead_of_bulk)
+{
+  lanes_type sut;
+  write(sut, "bulk");
+  ASSERT_EQ(transmit(sut, 1), "b");
+
+  ASSERT_TRUE(sut.push_urgent('!'));
+  ASSERT_EQ(transmit(sut), "!ulk");
+  ASSERT_TRUE(sut.empty());
+}
+
+//------------------------------------------------------------------------
+TEST(tx_lanes_test, urgent_must_wait_for_the_frame_end)
+{
+  lanes_type sut;
+  ASSERT_TRUE(sut.begin_frame());
+  write(sut, "abc");
+  sut.end_frame();
+  ASSERT_TRUE(sut.begin_frame());
+  write(sut, "de");
+  sut.end_frame();
+  write(sut, "fg");
+
+  ASSERT_EQ(transmit(sut, 1), "a");
+  sut.push_urgent('!');
+  ASSERT_EQ(transmit(sut, 3), "bc!");
+
+  // frames back to back have a boundary between
+  sut.push_urgent('?');
+  ASSERT_EQ(transmit(sut, 1), "?");
+  ASSERT_EQ(transmit(sut, 1), "d");
+  sut.push_urgent('#');
+  ASSERT_EQ(transmit(sut), "e#fg");
+  ASSERT_FALSE(sut.marked());
+}
+
+//------------------------------------------------------------------------
+TEST(tx_lanes_test, urgent_must_wait_while_the_frame_is_being_written)
+{
+  lanes_type sut;
+  ASSERT_TRUE(sut.begin_frame());
+  write(sut, "ab");
+  ASSERT_EQ(transmit(sut, 1), "a");
+  sut.push_urgent('!');
+
+  ASSERT_EQ(transmit(sut), "b");
+  ASSERT_FALSE(sut.empty()); // urgent waits
+
+  write(sut, "c");
+  sut.end_frame();
+  ASSERT_EQ(transmit(sut), "c!");
+  ASSERT_TRUE(sut.empty());
+}
+
+//------------------------------------------------------------------------
+TEST(tx_lanes_test, marks_must_count_spans_committed)
+{
+  lanes_type sut;
+  write(sut, "0123456789012345678901234567"); // near the wrap
+  ASSERT_EQ(transmit(sut).size(), 28u);
+
+  ASSERT_TRUE(sut.begin_frame());
+  for (size_t written = 0; written < 6; )
+  {
+    uint8_t* data = nullptr;
+    const size_t room = sut.writable(data);
+    const size_t n    = room < 6 - written? room: 6 - written;
+    for (size_t i = 0; i < n; ++i) { data[i] = static_cast<uint8_t>('a' + written + i); }
+    sut.commit(n);
+    written += n;
+  }
+  sut.end_frame();
+
+  ASSERT_EQ(transmit(sut, 1), "a");
+  sut.push_urgent('!');
+  ASSERT_EQ(transmit(sut), "bcdef!");
+}
+
+//------------------------------------------------------------------------
+TEST(tx_lanes_test, begin_frame_must_fail_without_room_for_marks)
+{
+  lanes_type sut;
+  ASSERT_TRUE(sut.begin_frame());
+  ASSERT_FALSE(sut.begin_frame()); // already open
+  write(sut, "a");
+  sut.end_frame();
+
+  ASSERT_TRUE(sut.begin_frame());
+  write(sut, "b");
+  sut.end_frame();
+  ASSERT_FALSE(sut.begin_frame()); // four marks taken
+
+  ASSERT_EQ(transmit(sut), "ab");
+  ASSERT_TRUE(sut.begin_frame());
+}
+
+//------------------------------------------------------------------------
+TEST(tx_lanes_test, urgent_latency_must_not_depend_on_bulk)
+{
+  // the octet in the data register goes first, then the urgent one
+  ASSERT_EQ(latency_after(0, true), octet_us);
+  ASSERT_EQ(latency_after(1, true), 2 * octet_us);
+  ASSERT_EQ(latency_after(8, true), 2 * octet_us);
+  ASSERT_EQ(latency_after(31, true), 2 * octet_us);
+
+  // the bulk lane waits for every octet written before
+  ASSERT_EQ(latency_after(8, false), 9 * octet_us);
+  ASSERT_EQ(latency_after(30, false), 31 * octet_us);
+}
+
+//------------------------------------------------------------------------
+TEST(tx_lanes_test, uart_must_not_split_the_frame_written_to_the_empty_buffer)
+{
+  tiny::io::host_usart_registers regs;
+  uart_type uart(regs);
+  uart.open(115200);
+
+  // the frame starts while the data register is free, the urgent octet
+  // goes ahead of it as a whole
+  ASSERT_TRUE(uart.begin_frame());
+  ASSERT_TRUE(uart.async_write('a'));
+  ASSERT_TRUE(uart.async_write('b'));
+  ASSERT_TRUE(uart.async_write('c'));
+  uart.end_frame();
+  ASSERT_TRUE(uart.async_write_urgent('!'));
+
+  std::string line;
+  ASSERT_EQ(line_time_of(regs, uart, '!', &line), octet_us);
+  ASSERT_EQ(line, "!abc");
+
+  // the frame started on the line, the urgent octet waits for its end
+  ASSERT_TRUE(uart.begin_frame());
+  ASSERT_TRUE(uart.async_write('a'));
+  ASSERT_TRUE(uart.async_write('b'));
+  ASSERT_TRUE(uart.async_write('c'));
+  uart.end_frame();
+  uart.service();
+  ASSERT_TRUE(uart.async_write_urgent('!'));
+
+  line.clear();
+  ASSERT_EQ(line_time_of(regs, uart, '!', &line), 4 * octet_us);
+  ASSERT_EQ(line, "abc!");
+
+  // unmarked the octet is written straight to the data register again
+  ASSERT_TRUE(uart.async_write('d'));
+  ASSERT_FALSE(regs.tx_ready);
+}
+
+//------------------------------------------------------------------------
+TEST(tx_lanes_test, clear_must_drop_everything)
+{
+  lanes_type sut;
+  sut.begin_frame();
+  write(sut, "abc");
+  sut.push_urgent('!');
+  sut.clear();
+
+  ASSERT_TRUE(sut.empty());
+  ASSERT_FALSE(sut.marked());
+  sut.push_urgent('!');
+  ASSERT_EQ(transmit(sut), "!");
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
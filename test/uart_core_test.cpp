@@ -0,0 +1,351 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <tiny/serial/uart_host.hpp>
+
+#include <vector>
+
+namespace
+{
+
+typedef tiny::io::host_uart<uint8_t, 16> uart_type;
+typedef tiny::io::host_uart<uint16_t, 16> uart9_type;
+typedef tiny::io::host_uart<uint8_t, 16, false> timed_uart_type;
+
+//------------------------------------------------------------------------
+template <typename UartT>
+void receive(tiny::io::host_usart_registers& regs, UartT& uart, const uint8_t* data, size_t size)
+{
+  for (size_t i = 0; i < size; ++i)
+  {
+    regs.shift_in(data[i]);
+    uart.service();
+  }
+}
+
+//------------------------------------------------------------------------
+template <typename UartT>
+std::vector<uint16_t> send_all(tiny::io::host_usart_registers& regs, UartT& uart)
+{
+  std::vector<uint16_t> line;
+  uint16_t octet;
+  uart.service();
+  while (regs.shift_out(octet))
+  {
+    line.push_back(octet);
+    uart.service();
+  }
+
+  return line;
+}
+
+//------------------------------------------------------------------------
+bool take_even(uint8_t octet, void*)
+{
+  return octet % 2 == 0;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+TEST(uart_core_test, must_open_and_close_the_peripheral)
+{
+  tiny::io::host_usart_registers regs;
+  uart_type uart(regs);
+  ASSERT_FALSE(uart.opened());
+
+  uart.open(tiny::baud_rate::br_115200);
+  ASSERT_TRUE(uart.opened());
+  ASSERT_TRUE(regs.rx_irq);
+  ASSERT_FALSE(regs.tx_irq);
+  ASSERT_EQ(regs.baud, 115200ul);
+  ASSERT_EQ(regs.config, 0x06u);
+
+  ASSERT_TRUE(uart.reconfigure(9600, 0x26));
+  ASSERT_EQ(regs.baud, 9600ul);
+  ASSERT_EQ(regs.config, 0x26u);
+
+  uart.close();
+  ASSERT_FALSE(uart.opened());
+}
+
+//------------------------------------------------------------------------
+TEST(uart_core_test, must_receive_and_send_in_order)
+{
+  tiny::io::host_usart_registers regs;
+  uart_type uart(regs);
+  uart.open(9600, 0x06);
+
+  const uint8_t in[] = { 1, 2, 3, 4, 5 };
+  receive(regs, uart, in, sizeof(in));
+  ASSERT_EQ(uart.available(), 5u);
+
+  uint8_t octet = 0;
+  ASSERT_EQ(uart.read(), 1);
+  ASSERT_TRUE(uart.try_read(octet));
+  ASSERT_EQ(octet, 2);
+
+  uint8_t rest[8];
+  ASSERT_EQ(uart.read(rest, sizeof(rest), 0), 3u);
+  ASSERT_EQ(rest[2], 5);
+  ASSERT_FALSE(uart.try_read(octet));
+
+  // the first octet goes straight to the data register
+  for (uint8_t i = 10; i < 20; ++i) { ASSERT_TRUE(uart.async_write(i)); }
+  ASSERT_FALSE(uart.drained());
+
+  const std::vector<uint16_t> line = send_all(regs, uart);
+  ASSERT_EQ(line.size(), 10u);
+  for (size_t i = 0; i < line.size(); ++i) { ASSERT_EQ(line[i], 10 + i); }
+  ASSERT_FALSE(regs.tx_irq);
+  ASSERT_TRUE(uart.drained());
+}
+
+//------------------------------------------------------------------------
+TEST(uart_core_test, must_keep_nine_bits)
+{
+  tiny::io::host_usart_registers regs;
+  uart9_type uart(regs);
+  uart.open(9600, 0x106);
+
+  regs.shift_in(0x1a5);
+  uart.service();
+  ASSERT_EQ(uart.read(), 0x1a5);
+
+  ASSERT_TRUE(uart.async_write(0x155));
+  ASSERT_TRUE(uart.async_write(0x0aa));
+  const std::vector<uint16_t> line = send_all(regs, uart);
+  ASSERT_EQ(line.size(), 2u);
+  ASSERT_EQ(line[0], 0x155);
+  ASSERT_EQ(line[1], 0x0aa);
+}
+
+//------------------------------------------------------------------------
+TEST(uart_core_test, must_send_urgent_octets_first)
+{
+  tiny::io::host_usart_registers regs;
+  uart_type uart(regs);
+  uart.open(9600);
+
+  ASSERT_TRUE(uart.async_write(1));
+  ASSERT_TRUE(uart.async_write(2));
+  ASSERT_TRUE(uart.async_write(3));
+  ASSERT_TRUE(uart.async_write_urgent(0x7f));
+
+  const std::vector<uint16_t> line = send_all(regs, uart);
+  ASSERT_EQ(line.size(), 4u);
+  ASSERT_EQ(line[0], 1);
+  ASSERT_EQ(line[1], 0x7f);
+  ASSERT_EQ(line[3], 3);
+}
+
+//------------------------------------------------------------------------
+TEST(uart_core_test, must_signal_events_and_run_hooks)
+{
+  tiny::io::host_usart_registers regs;
+  tiny::io::event_word events;
+  uart_type uart(regs);
+  uart.open(9600, 0x06);
+  uart.bind(events, 2);
+  uart.on_match('\n');
+
+  const uint8_t in[] = { 'a', '\n' };
+  receive(regs, uart, in, sizeof(in));
+  ASSERT_EQ(tiny::io::event_word::slot_events(events.take(), 2),
+            unsigned(tiny::io::ev_rx_data | tiny::io::ev_rx_delimiter));
+
+  regs.shift_in('b');
+  regs.shift_in('c'); // overrun
+  uart.service();
+  ASSERT_EQ(tiny::io::event_word::slot_events(events.take(), 2), unsigned(tiny::io::ev_rx_data | tiny::io::ev_error));
+  ASSERT_FALSE(regs.rx_error);
+
+  ASSERT_TRUE(uart.async_write(1));
+  ASSERT_TRUE(uart.async_write(2));
+  send_all(regs, uart);
+  ASSERT_EQ(tiny::io::event_word::slot_events(events.take(), 2), unsigned(tiny::io::ev_tx_drained));
+
+  // the octets taken by the hook aren't buffered
+  uart.no_match();
+  uart.on_rx(&take_even);
+  const uint8_t mixed[] = { 2, 3, 4, 5 };
+  const size_t before   = uart.available();
+  receive(regs, uart, mixed, sizeof(mixed));
+  ASSERT_EQ(uart.available(), before + 2);
+}
+
+//------------------------------------------------------------------------
+TEST(uart_core_test, must_signal_only_the_events_of_the_mask)
+{
+  tiny::io::host_usart_registers regs;
+  tiny::io::event_word events;
+  uart_type uart(regs);
+  uart.open(9600, 0x06);
+  uart.bind(events, 1, tiny::io::ev_rx_delimiter);
+  uart.on_match('\n');
+
+  const uint8_t line[] = { 'a', 'b', 'c' };
+  receive(regs, uart, line, sizeof(line));
+  ASSERT_EQ(events.pending(), 0u);
+
+  const uint8_t end[] = { '\n' };
+  receive(regs, uart, end, sizeof(end));
+  ASSERT_EQ(tiny::io::event_word::slot_events(events.take(), 1), unsigned(tiny::io::ev_rx_delimiter));
+  ASSERT_EQ(uart.available(), 4u);
+
+  ASSERT_TRUE(uart.async_write(1));
+  send_all(regs, uart);
+  ASSERT_EQ(events.pending(), 0u);
+}
+
+//------------------------------------------------------------------------
+TEST(uart_core_test, must_refuse_slots_out_of_the_event_word)
+{
+  tiny::io::host_usart_registers regs;
+  tiny::io::event_word events;
+  uart_type uart(regs);
+  uart.bind(events, tiny::io::event_word::max_slots - 1);
+  ASSERT_DEATH(uart.bind(events, tiny::io::event_word::max_slots), "out of the event word");
+}
+
+//------------------------------------------------------------------------
+TEST(uart_core_test, must_delimit_frames_by_receiver_timeout)
+{
+  tiny::io::host_usart_registers regs;
+  uart_type uart(regs);
+  uart.idle_frames(39);
+  uart.open(9600, 0x06);
+  ASSERT_EQ(regs.rx_timeout, 39ul);
+  ASSERT_TRUE(regs.idle_irq);
+
+  const uint8_t first[] = { 1, 2, 3 };
+  receive(regs, uart, first, sizeof(first));
+  ASSERT_FALSE(uart.frame_ready());
+
+  regs.rx_idle = true;
+  uart.service();
+  ASSERT_FALSE(regs.rx_idle);
+  ASSERT_TRUE(uart.frame_ready());
+
+  const uint8_t second[] = { 4, 5 };
+  receive(regs, uart, second, sizeof(second));
+
+  uint8_t frame[8];
+  ASSERT_EQ(uart.read_frame(frame, sizeof(frame)), 3u);
+  ASSERT_EQ(frame[2], 3);
+  ASSERT_FALSE(uart.frame_ready());
+
+  regs.rx_idle = true;
+  uart.service();
+  ASSERT_EQ(uart.read_frame(frame, sizeof(frame)), 2u);
+  ASSERT_EQ(frame[0], 4);
+}
+
+//------------------------------------------------------------------------
+TEST(uart_core_test, must_delimit_frames_by_octet_times)
+{
+  tiny::io::host_usart_registers regs;
+  timed_uart_type uart(regs);
+  uint32_t& now = tiny::io::host_clock::ticks();
+  now           = 0;
+
+  uart.open(9600, 0x06);
+  uart.idle_frames(39); // 4063 us
+  ASSERT_FALSE(regs.idle_irq);
+
+  const uint8_t first[] = { 1, 2, 3 };
+  for (size_t i = 0; i < sizeof(first); ++i)
+  {
+    now += 1042;
+    receive(regs, uart, first + i, 1);
+  }
+
+  now += 1000;
+  uart.service();
+  ASSERT_FALSE(uart.frame_ready());
+  now += 4000;
+  uart.service(); // the idle timer
+  ASSERT_TRUE(uart.frame_ready());
+
+  uint8_t frame[8];
+  ASSERT_EQ(uart.read_frame(frame, sizeof(frame)), 3u);
+  ASSERT_EQ(frame[0], 1);
+}
+
+//------------------------------------------------------------------------
+TEST(uart_core_test, idle_timer_must_close_the_last_frame_of_a_burst)
+{
+  tiny::io::host_usart_registers regs;
+  timed_uart_type uart(regs);
+  tiny::io::event_word events;
+  uint32_t& now = tiny::io::host_clock::ticks();
+  now           = 0;
+
+  uart.open(9600, 0x06);
+  uart.bind(events, 1);
+  uart.idle_frames(39); // 4063 us
+
+  // the burst outlasts the deadline armed by its first octet
+  for (uint8_t i = 0; i < 6; ++i)
+  {
+    now += 1042;
+    receive(regs, uart, &i, 1);
+  }
+
+  ASSERT_TRUE(regs.idle_timer); // re-armed at 5210 for 8231
+  events.take();
+
+  now = 10300;
+  uart.service();
+  ASSERT_EQ(tiny::io::event_word::slot_events(events.take(), 1), 0u);
+  ASSERT_TRUE(regs.idle_timer); // re-armed at 8231 for 10315
+
+  now = 10315;
+  uart.service();
+  ASSERT_EQ(tiny::io::event_word::slot_events(events.take(), 1), unsigned(tiny::io::ev_rx_delimiter));
+  ASSERT_FALSE(regs.idle_timer);
+
+  uint8_t frame[8];
+  ASSERT_EQ(uart.read_frame(frame, sizeof(frame)), 6u);
+  ASSERT_EQ(frame[5], 5);
+}
+
+//------------------------------------------------------------------------
+TEST(uart_core_test, octet_time_must_follow_the_format)
+{
+  tiny::io::host_usart_registers regs;
+  timed_uart_type uart(regs);
+  uint32_t& now = tiny::io::host_clock::ticks();
+  now           = 0;
+
+  uart.open(9600, 0x106);
+  ASSERT_EQ(uart.hardware().char_bits(), 11u);
+
+  // 8E2, 12 bits a character, 1250 us at 9600
+  uart.open(9600, 0x2e);
+  ASSERT_EQ(uart.hardware().char_bits(), 12u);
+  uart.idle_frames(39); // 4063 us
+
+  const uint8_t octets[] = { 1, 2, 3 };
+  receive(regs, uart, octets, 1);
+
+  // the idle timer is late, the next octet closes the frame, 10 bits
+  // would close it at 4063 + 1042 us
+  regs.idle_timer = false;
+  now += 5200;
+  receive(regs, uart, octets + 1, 1);
+  now += 5400;
+  receive(regs, uart, octets + 2, 1);
+
+  uint8_t frame[8];
+  ASSERT_EQ(uart.read_frame(frame, sizeof(frame)), 2u);
+  ASSERT_EQ(frame[1], 2);
+}
+
+//------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleMock(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,39 @@
+// Virtual clocks shared by the tests and benchmarks, the test sets the time.
+
+#ifndef TINY_TEST_VIRTUAL_CLOCK_HPP_
+#define TINY_TEST_VIRTUAL_CLOCK_HPP_
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace sim
+{
+
+/** Virtual clock of us microseconds counting the reads.
+ *
+ *  @tparam TimeT Time type returned by now.
+ *  @tparam Divider now returns us / Divider, e.g. 1000 for milliseconds.
+ */
+template <typename TimeT = uint32_t, unsigned long Divider = 1>
+struct virtual_clock
+{
+  typedef TimeT time_type;
+
+  static time_type now(void) { ++reads; return static_cast<time_type>(us / Divider); }
+
+  static uint32_t us;
+  static size_t reads;
+};
+
+template <typename TimeT, unsigned long Divider> uint32_t virtual_clock<TimeT, Divider>::us = 0;
+template <typename TimeT, unsigned long Divider> size_t virtual_clock<TimeT, Divider>::reads = 0;
+
+/** Microsecond clock, the timestamps and the rtu timing. */
+typedef virtual_clock<> us_clock;
+
+/** Microseconds inside, milliseconds outside, the mdb timeouts. */
+typedef virtual_clock<unsigned long, 1000> ms_clock;
+
+} // namespace sim
+
+#endif // TINY_TEST_VIRTUAL_CLOCK_HPP_